@@ -26,7 +26,8 @@ tar -xzf $fst_v.tar.gz
 
 cmake -B ./build -DPYTHON_EXECUTABLE:PATH="$(command -v python)" -DCMAKE_INSTALL_PREFIX:PATH="$(realpath ./build)" \
     -DCMAKE_BUILD_TYPE=$BUILD_TYPE -DPYTHON_INCLUDE_DIR:PATH="$(python -c "from sysconfig import get_paths; print(get_paths()['include'])")" \
-    -DFST_DIR="$(realpath ./$fst_v)" -DLIBRARY_OUTPUT_DIRECTORY:PATH="$(realpath ./zctc)" .
+    -DFST_DIR="$(realpath ./$fst_v)" -DLIBRARY_OUTPUT_DIRECTORY:PATH="$(realpath ./zctc)" \
+    -DZCTC_NATIVE="${ZCTC_NATIVE:-OFF}" -DZCTC_MARCH="${ZCTC_MARCH:-}" .
 
 cd build || exit
 make "-j$WORKER" && make install
@@ -64,6 +64,10 @@ class CMakeBuild(build_ext):
                 "-DCMAKE_INSTALL_PREFIX=" + str(ext._lib_dir.parent),
                 "-DFST_DIR=" + str(Path(tmp_dir) / fst_v),
             ]
+            if os.environ.get("ZCTC_NATIVE", "0") not in ("", "0"):
+                cmake_args.append("-DZCTC_NATIVE=ON")
+            if os.environ.get("ZCTC_MARCH"):
+                cmake_args.append("-DZCTC_MARCH=" + os.environ["ZCTC_MARCH"])
 
             # example of build args
             build_args = ["--config", config, "--", "-j" + str(os.cpu_count())]
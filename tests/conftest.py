@@ -42,6 +42,19 @@ def decoder_params():
     }
 
 
+@pytest.fixture
+def unigram_lm_path(sample_vocab, tmp_path):
+    """Write a unigram ARPA LM of the sample vocabulary."""
+    words = ["<unk>", "<s>", "</s>"] + [tok for tok in sample_vocab if tok.strip()]
+    lm_path = tmp_path / "unigram.arpa"
+    lm_path.write_text(
+        f"\\data\\\nngram 1={len(words)}\n\n\\1-grams:\n"
+        + "".join(f"-1.5\t{word}\n" for word in words)
+        + "\n\\end\\\n"
+    )
+    return lm_path
+
+
 @pytest.fixture
 def zctc_decoder(sample_vocab, decoder_params):
     """Create a ZCTC CTCBeamDecoder instance for testing."""
@@ -2,14 +2,19 @@
 Test suite for CTCBeamDecoder functionality.
 """
 
+import asyncio
 import gc
+import json
+import os
 import time
+from concurrent.futures import Future, ThreadPoolExecutor
 from typing import List, Tuple
 
+import numpy as np
 import pytest
 import torch
 
-from zctc import CTCBeamDecoder
+from zctc import CTCBeamDecoder, flush_trace, shared_scorer_resources
 
 
 class TestCTCBeamDecoderInitialization:
@@ -193,6 +198,196 @@ class TestCTCBeamDecoderDecoding:
             assert labels.shape == (batch_size, zctc_decoder.beam_width, seq_len)
             assert labels.dtype == torch.int32
 
+    @pytest.mark.parametrize("dtype", [torch.float16, torch.bfloat16])
+    def test_decoding_half_precision(self, zctc_decoder, sample_logits, sample_seq_lens, dtype):
+        """Test 16-bit logits decode the same as their float32 upcast."""
+        half_logits = sample_logits.to(dtype)
+
+        outputs = zctc_decoder.decode(half_logits, sample_seq_lens)
+        expected = zctc_decoder.decode(half_logits.to(torch.float32), sample_seq_lens)
+
+        for output, expected_output in zip(outputs, expected):
+            assert torch.equal(output, expected_output)
+
+    def test_decoding_numpy_input(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test numpy inputs decode the same as torch, returning numpy arrays."""
+        outputs = zctc_decoder.decode(
+            sample_logits.numpy(), sample_seq_lens.numpy().astype(np.int64)
+        )
+        expected = zctc_decoder.decode(sample_logits, sample_seq_lens)
+
+        for output, expected_output in zip(outputs, expected):
+            assert isinstance(output, np.ndarray)
+            assert output.dtype == np.int32
+            assert np.array_equal(output, expected_output.numpy())
+
+    def test_decoding_time_major_view(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test strided time major views decode the same as the batch major tensor."""
+        padded = torch.zeros(sample_logits.shape[:2] + (zctc_decoder.vocab_size + 3,))
+        padded[:, :, : zctc_decoder.vocab_size] = sample_logits
+        time_major = padded.transpose(0, 1)[:, :, : zctc_decoder.vocab_size]
+        assert not time_major.is_contiguous()
+
+        outputs = zctc_decoder.decode(time_major, sample_seq_lens, time_major=True)
+        expected = zctc_decoder.decode(sample_logits, sample_seq_lens)
+
+        for output, expected_output in zip(outputs, expected):
+            assert torch.equal(output, expected_output)
+
+    def test_decode_async(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test concurrently submitted batches complete with the decode outputs."""
+        expected = zctc_decoder.decode(sample_logits, sample_seq_lens)
+
+        futures = [
+            zctc_decoder.decode_async(sample_logits, sample_seq_lens) for _ in range(4)
+        ]
+        for future in futures:
+            for output, expected_output in zip(future.result(timeout=60), expected):
+                assert torch.equal(output, expected_output)
+
+    def test_done_callback_decodes_synchronously(
+        self, sample_vocab, decoder_params, sample_logits, sample_seq_lens
+    ):
+        """Test a done callback decoding on a single worker thread."""
+        decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **{**decoder_params, "thread_count": 1}
+        )
+        expected = decoder.decode(sample_logits, sample_seq_lens)
+        nested = Future()
+
+        def on_done(future):
+            try:
+                nested.set_result(decoder.decode(sample_logits, sample_seq_lens))
+            except Exception as error:
+                nested.set_exception(error)
+
+        decoder.decode_async(sample_logits, sample_seq_lens).add_done_callback(on_done)
+
+        for output, expected_output in zip(nested.result(timeout=60), expected):
+            assert torch.equal(output, expected_output)
+
+    def test_adecode(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test the awaitable decode, overlapped with other work on the event loop."""
+        expected = zctc_decoder.decode(sample_logits, sample_seq_lens)
+
+        async def run():
+            ticks = 0
+            task = asyncio.ensure_future(
+                zctc_decoder.adecode(sample_logits, sample_seq_lens, return_stats=True)
+            )
+            while not task.done():
+                ticks += 1
+                await asyncio.sleep(0)
+            return await task, ticks
+
+        (*outputs, stats), ticks = asyncio.run(run())
+
+        assert ticks > 0
+        assert len(stats) == sample_logits.shape[0]
+        for output, expected_output in zip(outputs, expected):
+            assert torch.equal(output, expected_output)
+
+    def test_submit_from_many_threads(
+        self, zctc_decoder, sample_logits, sample_seq_lens
+    ):
+        """Test the utterances submitted from many threads decode as batches of one."""
+        utterances = [
+            sample_logits[i, : sample_seq_lens[i]]
+            for i in range(sample_logits.shape[0])
+        ] * 4
+
+        with ThreadPoolExecutor(max_workers=8) as executor:
+            futures = list(executor.map(zctc_decoder.submit, utterances))
+
+        for utterance, future in zip(utterances, futures):
+            labels, timesteps, seq_pos = future.result(timeout=60)
+            expected = zctc_decoder.decode(
+                utterance.unsqueeze(0),
+                torch.tensor([utterance.shape[0]], dtype=torch.int32),
+            )
+            for output, expected_output in zip((labels, timesteps, seq_pos), expected):
+                assert torch.equal(output, expected_output[0])
+
+        labels, _, seq_pos = zctc_decoder.submit(
+            utterances[0].numpy(), options={"beam_width": 3}
+        ).result(timeout=60)
+        assert isinstance(labels, np.ndarray)
+        assert labels.shape == (3, utterances[0].shape[0])
+        assert seq_pos.shape == (3,)
+
+        with pytest.raises(ValueError):
+            zctc_decoder.submit(sample_logits)
+
+    def test_pinned_workers_decode_the_same(
+        self, sample_vocab, decoder_params, sample_logits, sample_seq_lens
+    ):
+        """Test the workers pinned to CPUs decode the same as the floating ones."""
+        cpus = sorted(os.sched_getaffinity(0))
+        params = decoder_params.copy()
+        params["thread_count"] = 2
+        floating = CTCBeamDecoder(vocab=sample_vocab, **params)
+        pinned = CTCBeamDecoder(vocab=sample_vocab, worker_cpus=cpus[:1], **params)
+
+        assert floating.worker_cpus == []
+        assert pinned.worker_cpus == [cpus[0]] * 2
+
+        for output, expected_output in zip(
+            pinned.decode(sample_logits, sample_seq_lens),
+            floating.decode(sample_logits, sample_seq_lens),
+        ):
+            assert torch.equal(output, expected_output)
+
+        ranged = CTCBeamDecoder(
+            vocab=sample_vocab, worker_cpus=f"{cpus[0]}-{cpus[0]}", **params
+        )
+        assert ranged.worker_cpus == [cpus[0]] * 2
+
+        with pytest.raises(RuntimeError):
+            CTCBeamDecoder(vocab=sample_vocab, worker_cpus="0-", **params)
+        with pytest.raises(RuntimeError):
+            CTCBeamDecoder(vocab=sample_vocab, worker_cpus=[cpus[-1] + 1], **params)
+
+    @pytest.mark.parametrize("per_frame", [True, False])
+    def test_decoding_quantized(self, zctc_decoder, sample_logits, sample_seq_lens, per_frame):
+        """Test decoding of int8 quantized log probabilities."""
+        log_probs = sample_logits.clamp_min(1e-12).log()
+        reduce_dims = (2,) if per_frame else (1, 2)
+        max_lp = log_probs.amax(dim=reduce_dims)
+        min_lp = log_probs.amin(dim=reduce_dims)
+        scales = ((max_lp - min_lp) / 254).clamp_min(1e-6)
+        offsets = (max_lp + min_lp) / 2
+
+        shape = scales.shape + (1,) * (3 - scales.ndim)
+        values = ((log_probs - offsets.view(shape)) / scales.view(shape)).round().to(torch.int8)
+
+        labels, timesteps, seq_pos, stats = zctc_decoder.decode_quantized(
+            values, scales, offsets, sample_seq_lens, return_stats=True
+        )
+
+        batch_size, seq_len, _ = sample_logits.shape
+        assert labels.shape == (batch_size, zctc_decoder.beam_width, seq_len)
+        assert timesteps.shape == (batch_size, zctc_decoder.beam_width, seq_len)
+        assert seq_pos.shape == (batch_size, zctc_decoder.beam_width)
+        assert [stat.frames for stat in stats] == sample_seq_lens.tolist()
+
+    def test_decoding_quantized_invalid_inputs(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test quantized decoding rejects float values, mismatched and non-positive scales."""
+        batch_size, seq_len, _ = sample_logits.shape
+        scales = torch.ones((batch_size, seq_len))
+
+        with pytest.raises(ValueError, match="Invalid values"):
+            zctc_decoder.decode_quantized(sample_logits, scales, scales, sample_seq_lens)
+
+        values = torch.zeros(sample_logits.shape, dtype=torch.int8)
+        with pytest.raises(ValueError, match="Invalid scales"):
+            zctc_decoder.decode_quantized(values, scales, scales[:, 0], sample_seq_lens)
+
+        for scale in (0.0, -1.0):
+            with pytest.raises(RuntimeError, match="Invalid quantization scale"):
+                zctc_decoder.decode_quantized(
+                    values, torch.full_like(scales, scale), scales, sample_seq_lens
+                )
+
     def test_decoding_gpu_to_cpu_transfer(self, zctc_decoder, batch_size, seq_len):
         """Test that GPU tensors are properly transferred to CPU."""
         if not torch.cuda.is_available():
@@ -305,6 +500,138 @@ class TestCTCBeamDecoderEdgeCases:
         batch_size, seq_len = sample_logits.shape[:2]
         assert labels.shape == (batch_size, zctc_decoder.beam_width, seq_len)
 
+    def test_decode_stats(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test the per utterance stats returned along with the decoded output."""
+        expected = zctc_decoder.decode(sample_logits, sample_seq_lens)
+        *outputs, stats = zctc_decoder.decode(
+            sample_logits, sample_seq_lens, return_stats=True
+        )
+
+        for output, expected_output in zip(outputs, expected):
+            assert torch.equal(output, expected_output)
+
+        assert len(stats) == sample_logits.shape[0]
+        for stat, seq_len in zip(stats, sample_seq_lens.tolist()):
+            assert stat.frames == seq_len
+            assert stat.candidates > 0
+            assert stat.nodes_created > 0
+            assert stat.total_nodes == 1 + stat.nodes_created + stat.nodes_cloned
+            assert stat.lm_queries == 0  # No LM configured
+            assert stat.expand_ns > 0
+            assert stat.ext_scoring_ns == 0  # No external scoring
+
+    def test_decode_hw_counters(self, zctc_decoder, sample_logits, sample_seq_lens):
+        """Test the per phase hardware counters, which may be unavailable."""
+        *_, stats = zctc_decoder.decode(sample_logits, sample_seq_lens, hw_counters=True)
+
+        assert len(stats) == sample_logits.shape[0]
+        for stat in stats:
+            phases = [stat.expand_hw, stat.ext_scoring_hw, stat.score_hw, stat.prune_hw]
+            if stat.hw_counters:
+                assert stat.expand_hw.cycles > 0
+                assert stat.expand_hw.instructions > 0
+            else:
+                # NOTE: No PMU or not permitted, counts stay zero.
+                assert all(phase.cycles == 0 for phase in phases)
+
+    def test_chrome_trace_export(
+        self, sample_vocab, decoder_params, sample_logits, sample_seq_lens, tmp_path
+    ):
+        """Test the batch decoding spans written as a Chrome trace."""
+        trace_path = tmp_path / "trace.json"
+        decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **decoder_params, trace_path=str(trace_path)
+        )
+
+        decoder.decode(sample_logits, sample_seq_lens)
+        flush_trace()
+
+        with open(trace_path) as f:
+            events = json.load(f)["traceEvents"]
+
+        spans = [event for event in events if event["ph"] == "X"]
+        names = {span["name"] for span in spans}
+        assert {"batch_decode", "queue_wait", "decode", "backtrace"} <= names
+        assert sum(span["name"] == "decode" for span in spans) >= len(sample_seq_lens)
+
+    def test_trace_path_is_process_wide(
+        self, sample_vocab, decoder_params, sample_logits, sample_seq_lens, tmp_path
+    ):
+        """Test a second trace path rejected till the first one is released."""
+        first_path, second_path = tmp_path / "first.json", tmp_path / "second.json"
+        decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **decoder_params, trace_path=str(first_path)
+        )
+
+        with pytest.raises(RuntimeError, match="process wide"):
+            CTCBeamDecoder(
+                vocab=sample_vocab, **decoder_params, trace_path=str(second_path)
+            )
+
+        decoder.decode(sample_logits, sample_seq_lens)
+        del decoder
+
+        with open(first_path) as f:
+            assert any(event["ph"] == "X" for event in json.load(f)["traceEvents"])
+
+        decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **decoder_params, trace_path=str(second_path)
+        )
+        del decoder
+
+        with open(second_path) as f:
+            assert all(event["ph"] != "X" for event in json.load(f)["traceEvents"])
+
+    def test_shared_language_model(
+        self,
+        sample_vocab,
+        decoder_params,
+        sample_logits,
+        sample_seq_lens,
+        unigram_lm_path,
+    ):
+        """Test the decoders loading the same LM sharing a single instance of it."""
+        params = {**decoder_params, "lm_path": str(unigram_lm_path)}
+        loaded = shared_scorer_resources()
+
+        first = CTCBeamDecoder(vocab=sample_vocab, **params)
+        second = CTCBeamDecoder(
+            vocab=sample_vocab,
+            **{**params, "lm_path": f"{unigram_lm_path.parent}/./unigram.arpa"},
+        )
+        assert shared_scorer_resources() == loaded + 1
+        assert not first.ext_scorer.lm_load_stats.shared
+        assert second.ext_scorer.lm_load_stats.shared
+
+        expected = first.decode(sample_logits, sample_seq_lens)
+        del first
+        gc.collect()
+        labels, _, seq_pos = second.decode(sample_logits, sample_seq_lens)
+        assert torch.equal(labels, expected[0])
+        assert torch.equal(seq_pos, expected[2])
+
+        del second
+        gc.collect()
+        assert shared_scorer_resources() == loaded
+
+    def test_lm_load_config(self, sample_vocab, decoder_params, unigram_lm_path):
+        """Test the KenLM load options and the reported load stats."""
+        params = {**decoder_params, "lm_path": str(unigram_lm_path)}
+
+        with pytest.raises(RuntimeError, match="ARPA"):
+            CTCBeamDecoder(vocab=sample_vocab, **params, lm_require_binary=True)
+        with pytest.raises(AssertionError):
+            CTCBeamDecoder(vocab=sample_vocab, **params, lm_load_method="eager")
+
+        decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **params, lm_load_method="lazy", lm_warm_up=True
+        )
+        stats = decoder.ext_scorer.lm_load_stats
+        assert not stats.binary
+        assert not stats.shared
+        assert stats.file_bytes == unigram_lm_path.stat().st_size
+        assert stats.load_seconds > 0
+
 
 class TestCTCBeamDecoderPerformance:
     """Test performance-related aspects."""
@@ -441,6 +768,250 @@ class TestCTCBeamDecoderComparisons:
             assert timesteps.shape[1] == expected_beam_width
             assert seq_pos.shape[1] == expected_beam_width
 
+    def test_fast_math_wer_drift(self, sample_vocab, decoder_params):
+        """Test the fast math approximations barely change the top beams, by their WER."""
+        batch_size = 32
+        seq_len = 200
+        vocab_size = len(sample_vocab)
+
+        # Sharpened logits of a reference set, peaky like the acoustic models.
+        generator = torch.Generator().manual_seed(7)
+        logits = torch.randn((batch_size, seq_len, vocab_size), generator=generator)
+        logits = (4 * logits).softmax(dim=2)
+        seq_lens = torch.full((batch_size,), seq_len, dtype=torch.int32)
+
+        exact_decoder = CTCBeamDecoder(vocab=sample_vocab, **decoder_params)
+        fast_decoder = CTCBeamDecoder(
+            vocab=sample_vocab, **decoder_params, fast_math=True
+        )
+        assert fast_decoder.fast_math and not exact_decoder.fast_math
+
+        def transcripts(decoder):
+            labels, _, seq_pos = decoder.decode(logits.clone(), seq_lens.clone())
+            return [
+                "".join(sample_vocab[i] for i in beam[start:].tolist()).split()
+                for beam, start in zip(labels[:, 0], seq_pos[:, 0].tolist())
+            ]
+
+        def edit_distance(ref, hyp):
+            row = list(range(len(hyp) + 1))
+            for i, ref_word in enumerate(ref, 1):
+                prev, row[0] = row[0], i
+                for j, hyp_word in enumerate(hyp, 1):
+                    substitution = prev + (ref_word != hyp_word)
+                    prev, row[j] = row[j], min(row[j] + 1, row[j - 1] + 1, substitution)
+            return row[-1]
+
+        references = transcripts(exact_decoder)
+        hypotheses = transcripts(fast_decoder)
+
+        errors = sum(map(edit_distance, references, hypotheses))
+        words = sum(len(ref) for ref in references)
+        assert words > 0
+        wer = errors / words
+        assert wer <= 0.01, f"WER drift of {wer:.4f} over {words} words"
+
+    @pytest.mark.parametrize("adaptive_beam", ["entropy", "margin"])
+    def test_adaptive_beam_saves_work(
+        self, sample_vocab, decoder_params, adaptive_beam
+    ):
+        """Test the adaptive budget narrows the confident frames, within its bounds."""
+        batch_size = 8
+        seq_len = 100
+        vocab_size = len(sample_vocab)
+
+        generator = torch.Generator().manual_seed(7)
+        logits = torch.randn((batch_size, seq_len, vocab_size), generator=generator)
+        logits = (4 * logits).softmax(dim=2)
+        seq_lens = torch.full((batch_size,), seq_len, dtype=torch.int32)
+
+        fixed_decoder = CTCBeamDecoder(vocab=sample_vocab, **decoder_params)
+        adaptive_decoder = CTCBeamDecoder(
+            vocab=sample_vocab,
+            **decoder_params,
+            adaptive_beam=adaptive_beam,
+            min_beam_width=5,
+            min_cutoff_top_n=4,
+        )
+        adaptive = adaptive_decoder.adaptive
+        assert adaptive.measure.name == adaptive_beam.upper()
+        assert (adaptive.min_beam_width, adaptive.max_beam_width) == (5, 25)
+        assert (adaptive.min_cutoff_top_n, adaptive.max_cutoff_top_n) == (4, 20)
+
+        *_, fixed_stats = fixed_decoder.decode(
+            logits.clone(), seq_lens.clone(), return_stats=True
+        )
+        labels, _, seq_pos, stats = adaptive_decoder.decode(
+            logits.clone(), seq_lens.clone(), return_stats=True
+        )
+        assert labels.shape == (batch_size, 25, seq_len)
+        assert seq_pos.shape == (batch_size, 25)
+
+        for fixed_stat, stat in zip(fixed_stats, stats):
+            assert fixed_stat.narrowed_frames == 0
+            assert fixed_stat.beam_width_saved == fixed_stat.cutoff_top_n_saved == 0
+
+            assert 0 < stat.narrowed_frames <= seq_len
+            assert 0 < stat.beam_width_saved <= stat.narrowed_frames * (25 - 5)
+            assert 0 < stat.cutoff_top_n_saved <= stat.narrowed_frames * (20 - 4)
+            assert stat.candidates <= fixed_stat.candidates
+
+        assert sum(stat.nodes_created for stat in stats) < sum(
+            stat.nodes_created for stat in fixed_stats
+        )
+
+    def test_adaptive_beam_invalid_bounds(self, sample_vocab, decoder_params):
+        """Test the adaptive bounds are validated."""
+        with pytest.raises(RuntimeError):
+            CTCBeamDecoder(
+                vocab=sample_vocab,
+                **decoder_params,
+                adaptive_beam="entropy",
+                min_beam_width=26,
+            )
+        with pytest.raises(RuntimeError):
+            CTCBeamDecoder(
+                vocab=sample_vocab,
+                **decoder_params,
+                adaptive_beam="margin",
+                adaptive_threshold=1.0,
+            )
+        with pytest.raises(AssertionError):
+            CTCBeamDecoder(vocab=sample_vocab, **decoder_params, adaptive_beam="width")
+
+    def test_decode_multi_matches_single_decodes(self, sample_vocab, decoder_params):
+        """Test every scorer params decodes the same as a decoder of its own."""
+        batch_size = 4
+        seq_len = 50
+        vocab_size = len(sample_vocab)
+
+        generator = torch.Generator().manual_seed(11)
+        logits = torch.randn((batch_size, seq_len, vocab_size), generator=generator)
+        logits = (4 * logits).softmax(dim=2)
+        seq_lens = torch.full((batch_size,), seq_len, dtype=torch.int32)
+
+        scorer_params = [
+            {"alpha": alpha, "beta": beta}
+            for alpha in (0.1, 0.5)
+            for beta in (0.0, 1.5)
+        ]
+        scorer_params.append({})
+
+        decoder = CTCBeamDecoder(vocab=sample_vocab, **decoder_params)
+        outputs = decoder.decode_multi(
+            logits.clone(), seq_lens.clone(), scorer_params, return_stats=True
+        )
+        assert len(outputs) == len(scorer_params)
+
+        for params, (labels, timesteps, seq_pos, stats) in zip(scorer_params, outputs):
+            single_decoder = CTCBeamDecoder(
+                vocab=sample_vocab, **{**decoder_params, **params}
+            )
+            expected_labels, expected_timesteps, expected_seq_pos = (
+                single_decoder.decode(logits.clone(), seq_lens.clone())
+            )
+            assert torch.equal(labels, expected_labels)
+            assert torch.equal(timesteps, expected_timesteps)
+            assert torch.equal(seq_pos, expected_seq_pos)
+            assert len(stats) == batch_size
+
+        with pytest.raises(AssertionError):
+            decoder.decode_multi(logits.clone(), seq_lens.clone(), [])
+        for bad_params in ({"alpha": -1.0}, {"beta": float("nan")}):
+            with pytest.raises(RuntimeError):
+                decoder.decode_multi(
+                    logits.clone(), seq_lens.clone(), [{"alpha": 0.5}, bad_params]
+                )
+
+    def test_decode_options_match_own_decoder(self, sample_vocab, decoder_params):
+        """Test the per call options decode the same as a decoder of its own."""
+        batch_size = 4
+        seq_len = 50
+        vocab_size = len(sample_vocab)
+
+        generator = torch.Generator().manual_seed(13)
+        logits = torch.randn((batch_size, seq_len, vocab_size), generator=generator)
+        logits = (4 * logits).softmax(dim=2)
+        seq_lens = torch.full((batch_size,), seq_len, dtype=torch.int32)
+
+        options = [
+            {"beam_width": 5, "cutoff_top_n": 10},
+            {"alpha": 0.8, "beta": 1.5, "min_tok_prob": -3.0},
+            {"cutoff_prob": 0.9, "max_beam_deviation": -4.0},
+        ]
+
+        decoder = CTCBeamDecoder(vocab=sample_vocab, **decoder_params)
+        futures = [
+            decoder.decode_async(logits.clone(), seq_lens.clone(), options=opts)
+            for opts in options
+        ]
+
+        for opts, future in zip(options, futures):
+            own_decoder = CTCBeamDecoder(
+                vocab=sample_vocab, **{**decoder_params, **opts}
+            )
+            expected = own_decoder.decode(logits.clone(), seq_lens.clone())
+            for outputs in (
+                future.result(),
+                decoder.decode(logits.clone(), seq_lens.clone(), options=opts),
+            ):
+                assert outputs[0].shape == (batch_size, own_decoder.beam_width, seq_len)
+                for output, expected_output in zip(outputs, expected):
+                    assert torch.equal(output, expected_output)
+
+        # NOTE: The options don't outlive their call.
+        labels, _, _ = decoder.decode(logits.clone(), seq_lens.clone())
+        assert labels.shape[1] == decoder_params["beam_width"]
+
+        with pytest.raises(AssertionError):
+            decoder.decode(logits.clone(), seq_lens.clone(), options={"beam": 5})
+        with pytest.raises(AssertionError):
+            decoder.decode(
+                logits.clone(), seq_lens.clone(), options={"cutoff_top_n": 0}
+            )
+        # NOTE: The options the wrapper doesn't bound are validated by the decoder.
+        for opts in ({"min_tok_prob": 1.0}, {"unk_lexicon_penalty": float("nan")}):
+            with pytest.raises(RuntimeError):
+                decoder.decode(logits.clone(), seq_lens.clone(), options=opts)
+
+    def test_greedy_decode_best_path(self, sample_vocab, decoder_params):
+        """Test the greedy decode is the collapsed argmax of every frame."""
+        batch_size = 4
+        seq_len = 60
+        vocab_size = len(sample_vocab)
+
+        generator = torch.Generator().manual_seed(3)
+        logits = torch.randn((batch_size, seq_len, vocab_size), generator=generator)
+        logits = (4 * logits).softmax(dim=2)
+        seq_lens = torch.tensor([60, 45, 1, 0], dtype=torch.int32)
+
+        decoder = CTCBeamDecoder(vocab=sample_vocab, **decoder_params)
+        labels, timesteps, seq_pos = decoder.greedy_decode(logits, seq_lens)
+        assert labels.shape == timesteps.shape == (batch_size, 1, seq_len)
+        assert seq_pos.shape == (batch_size, 1)
+
+        best_ids = logits.argmax(dim=2)
+        for b in range(batch_size):
+            expected_labels, expected_timesteps, prev_id = [], [], 0
+            for t in range(seq_lens[b]):
+                token_id = best_ids[b, t].item()
+                if token_id != 0 and token_id != prev_id:
+                    expected_labels.append(token_id)
+                    expected_timesteps.append(t)
+                prev_id = token_id
+
+            assert seq_pos[b, 0] == seq_len - len(expected_labels)
+            assert labels[b, 0, seq_pos[b, 0] :].tolist() == expected_labels
+            assert timesteps[b, 0, seq_pos[b, 0] :].tolist() == expected_timesteps
+
+        time_major_outputs = decoder.greedy_decode(
+            logits.transpose(0, 1), seq_lens, time_major=True
+        )
+        for output, time_major_output in zip(
+            (labels, timesteps, seq_pos), time_major_outputs
+        ):
+            assert torch.equal(output, time_major_output)
+
 
 @pytest.mark.unit
 class TestCTCBeamDecoderCppInspiredTests:
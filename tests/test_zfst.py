@@ -0,0 +1,175 @@
+"""
+Tests for the ZFST lexicon builder.
+"""
+
+import pytest
+
+from zctc import ZFST
+
+
+@pytest.fixture
+def bpe_vocab_file(tmp_path):
+    """Vocabulary file with a few BPE tokens."""
+    vocab_file = tmp_path / "vocab.txt"
+    vocab_file.write_text("\n".join(["_", "a", "##b", "##c", "'"]) + "\n")
+    return str(vocab_file)
+
+
+@pytest.fixture
+def lexicon_file(tmp_path):
+    """Tokenized lexicon file with a few malformed and unknown entries."""
+    lexicon = tmp_path / "lexicon.txt"
+    lexicon.write_text(
+        "\n".join(
+            [
+                "5 abc a ##b ##c",
+                "1 a a",
+                "7 axx a ##xx",
+                "",
+                "x bad",
+                "3 ab\ta  ##b",
+                "9 ac a ##c",
+            ]
+        )
+    )
+    return str(lexicon)
+
+
+class TestZFSTLexiconParsing:
+    """Test parsing tokenized lexicon files into the FST."""
+
+    def test_parse_counts(self, bpe_vocab_file, lexicon_file):
+        """Parsed, skipped and malformed lines should be counted."""
+        zfst = ZFST(bpe_vocab_file)
+        zfst.parse_lexicon_file(lexicon_file, 2)
+
+        stats = zfst.lexicon_stats
+        assert stats.lines == 7
+        assert stats.words == 3
+        assert stats.skipped_by_freq == 1
+        assert stats.malformed_lines == 2
+
+    def test_unknown_tokens_are_reported(self, bpe_vocab_file, lexicon_file):
+        """Unknown tokens should be reported and not inserted into the vocab."""
+        zfst = ZFST(bpe_vocab_file)
+        zfst.parse_lexicon_file(lexicon_file, 0)
+
+        stats = zfst.lexicon_stats
+        assert stats.unknown_tokens == 1
+        assert stats.skipped_with_unknown == 1
+        assert stats.unknown_samples == ["##xx"]
+        assert "##xx" not in zfst.char_map
+
+    @pytest.mark.parametrize("worker_count", [2, 4])
+    def test_parallel_parse_matches_serial(
+        self, bpe_vocab_file, lexicon_file, worker_count
+    ):
+        """Chunked parsing should see every line exactly once."""
+        serial = ZFST(bpe_vocab_file)
+        serial.parse_lexicon_file(lexicon_file, 0)
+
+        parallel = ZFST(bpe_vocab_file)
+        parallel.parse_lexicon_file(lexicon_file, 0, worker_count)
+
+        assert parallel.lexicon_stats.lines == serial.lexicon_stats.lines
+        assert parallel.lexicon_stats.words == serial.lexicon_stats.words
+        assert parallel.fst.NumStates() == serial.fst.NumStates()
+
+    def test_large_vocab_lookup(self, tmp_path):
+        """Tokens of a large BPE vocab should all be found in the vocab."""
+        vocab = ["_", "'"] + [f"##t{i}" for i in range(60000)]
+        vocab_file = tmp_path / "large_vocab.txt"
+        vocab_file.write_text("\n".join(vocab) + "\n")
+
+        lexicon = tmp_path / "large_lexicon.txt"
+        lexicon.write_text(
+            "\n".join(f"1 w{i} ##t{i} ##t{59999 - i}" for i in range(0, 60000, 997))
+            + "\n1 bad ##t60000\n"
+        )
+
+        zfst = ZFST(str(vocab_file))
+        zfst.parse_lexicon_file(str(lexicon), 0)
+
+        stats = zfst.lexicon_stats
+        assert stats.words == len(range(0, 60000, 997))
+        assert stats.unknown_samples == ["##t60000"]
+        assert all(zfst.char_map[token] == i for i, token in enumerate(vocab))
+
+
+class TestZFSTMinimalBuild:
+    """Test building the minimal lexicon FST directly."""
+
+    def test_minimal_matches_optimized_trie(self, bpe_vocab_file, lexicon_file):
+        """Direct construction should give the same size as trie + optimize."""
+        trie = ZFST(bpe_vocab_file)
+        trie.parse_lexicon_file(lexicon_file, 0)
+        trie.optimize()
+
+        minimal = ZFST(bpe_vocab_file)
+        minimal.build_minimal([lexicon_file], 0)
+
+        assert minimal.fst.NumStates() == trie.fst.NumStates()
+        assert minimal.lexicon_stats.words == trie.lexicon_stats.words
+
+    def test_minimal_merges_common_suffixes(self, bpe_vocab_file, tmp_path):
+        """Words sharing a suffix should share its states."""
+        lexicon = tmp_path / "suffix.txt"
+        lexicon.write_text("1 abc a ##b ##c\n1 bc ##b ##c\n1 cc ##c ##c\n")
+
+        zfst = ZFST(bpe_vocab_file)
+        zfst.build_minimal([str(lexicon)], 0, 2)
+
+        # start, after "a", before the last "##c", final
+        assert zfst.fst.NumStates() == 4
+
+    def test_minimal_unsorted_matches_sorted(self, bpe_vocab_file, tmp_path):
+        """Unsorted lexicons should give the same FST as the sorted ones."""
+        words = [
+            "1 abc a ##b ##c",
+            "1 ab a ##b",
+            "1 bcb ##b ##c ##b",
+            "1 a a",
+            "1 acc a ##c ##c",
+            "1 ab a ##b",
+            "1 cc ##c ##c",
+        ]
+        token_ids = {"a": 1, "##b": 2, "##c": 3}
+
+        unsorted = tmp_path / "unsorted.txt"
+        unsorted.write_text("\n".join(words) + "\n")
+        sorted_lexicon = tmp_path / "sorted.txt"
+        sorted_lexicon.write_text(
+            "\n".join(
+                sorted(words, key=lambda w: [token_ids[t] for t in w.split()[2:]])
+            )
+            + "\n"
+        )
+
+        expected = ZFST(bpe_vocab_file)
+        expected.build_minimal([str(sorted_lexicon)], 0)
+
+        for worker_count in [1, 2]:
+            zfst = ZFST(bpe_vocab_file)
+            zfst.build_minimal([str(unsorted)], 0, worker_count)
+
+            assert zfst.fst.NumStates() == expected.fst.NumStates()
+            assert zfst.lexicon_stats.words == len(words)
+
+    def test_minimal_fst_round_trip(self, bpe_vocab_file, lexicon_file, tmp_path):
+        """The built FST should be written and read back."""
+        zfst = ZFST(bpe_vocab_file)
+        zfst.build_minimal([lexicon_file], 0)
+
+        fst_path = str(tmp_path / "lexicon.fst")
+        assert zfst.write(fst_path)
+
+        loaded = ZFST(bpe_vocab_file, fst_path)
+        assert loaded.fst.NumStates() == zfst.fst.NumStates()
+
+    def test_minimal_requires_empty_fst(self, bpe_vocab_file, lexicon_file):
+        """Building into an already populated FST should fail."""
+        zfst = ZFST(bpe_vocab_file)
+        zfst.parse_lexicon_file(lexicon_file, 0)
+
+        with pytest.raises(RuntimeError):
+            zfst.build_minimal([lexicon_file], 0)
@@ -1,10 +1,24 @@
-__all__ = ["CTCBeamDecoder", "ZFST"]
+__all__ = ["CTCBeamDecoder", "ZFST", "flush_trace", "shared_scorer_resources"]
 
+import asyncio
 import logging
+from concurrent.futures import Future
 from typing import Optional, Tuple, Union
 
+import numpy as np
 import torch
-from _zctc import _ZFST, _Decoder, _Fst
+from _zctc import (
+    _ZFST,
+    _AdaptiveMeasure,
+    _Decoder,
+    _DecodeOptions,
+    _DecodeStats,
+    _Fst,
+    _LmLoadMethod,
+    _ScorerParams,
+    flush_trace,
+    shared_scorer_resources,
+)
 
 
 def _get_apostrophe_id_from_vocab(vocab: list[str]) -> int:
@@ -30,6 +44,26 @@ def _get_apostrophe_id_from_vocab(vocab: list[str]) -> int:
     return -1
 
 
+def _wrap_outputs(outputs: tuple, is_torch: bool, with_stats: bool) -> tuple:
+    """
+    Converts the numpy outputs of the decoder to torch tensors, without
+    copying, if the logits were a torch tensor, and drops the stats if not
+    requested.
+    """
+    labels, timesteps, seq_pos, stats = outputs
+    if is_torch:
+        labels, timesteps, seq_pos = (
+            torch.from_numpy(labels),
+            torch.from_numpy(timesteps),
+            torch.from_numpy(seq_pos),
+        )
+
+    if with_stats:
+        return labels, timesteps, seq_pos, stats
+
+    return labels, timesteps, seq_pos
+
+
 class ZFST(_ZFST):
     """
     Lexicon FST builder for CTC decoder.
@@ -41,6 +75,15 @@ class ZFST(_ZFST):
     fst_path: Optional[str] = None
         Path to the output existing build FST file. If not provided,
         the FST will be initialized clean and empty.
+
+    NOTE: Lexicon files can either be inserted as a trie with
+          `parse_lexicon_file(s)` followed by `optimize`, or built
+          directly into the minimal FST with `build_minimal`, which
+          needs no `optimize` step. Lexicons sorted by their token ids
+          are streamed into it, needing far less peak memory, while the
+          unsorted ones are parsed a second time and sorted externally
+          through temporary files, which costs about twice the parsing
+          time plus the disk I/O of the sort.
     """
 
     def __init__(self, vocab_path: str, fst_path: Optional[str] = None):
@@ -94,6 +137,66 @@ class CTCBeamDecoder(_Decoder):
         Path to KenLM build language model file (either `bin` or `arpa`).
     lexicon_fst_path: Optional[str] = None
         Path to ZFST build lexicon file (either `fst` or `fst.opt`).
+    trace_path: Optional[str] = None
+        Path to write a Chrome trace JSON of the batch decoding spans per
+        worker thread, viewable in `chrome://tracing` or Perfetto. Defaults
+        to the `ZCTC_TRACE` environment variable, and tracing is disabled
+        if neither is set. Tracing is process wide, so while a decoder
+        traces to a path, the spans of every decoder are written there, and
+        a decoder with a different path is rejected. The trace is written on
+        `flush_trace()` and once the last decoder tracing to it is destroyed.
+    fast_math: bool = False
+        Whether to score the beams with fast polynomial approximations of
+        log and exp instead of the libm accurate ones. The scores drift by
+        about 1e-5 in log scale, which rarely reorders the beams.
+    adaptive_beam: Optional[str] = None
+        Measure of every frame's uncertainty to derive its beam width and
+        number of candidates from, either "entropy" (over the frame's
+        `cutoff_top_n` candidates) or "margin" (between the top two
+        tokens). Confident frames are searched with down to
+        `min_beam_width` beams and `min_cutoff_top_n` candidates, while
+        uncertain frames get up to `beam_width` and `cutoff_top_n`. The
+        budget is fixed for every frame if not set.
+    min_beam_width: Optional[int] = None
+        Beam width of the most confident frames, defaults to a quarter
+        of `beam_width`.
+    min_cutoff_top_n: Optional[int] = None
+        Number of candidates of the most confident frames, defaults to a
+        quarter of `cutoff_top_n`.
+    adaptive_threshold: Optional[float] = None
+        Entropy, in nats, at or above which, or margin at or below which,
+        a frame gets the full budget. Defaults to 1.0 for the entropy and
+        0.5 for the margin.
+    lm_load_method: str = "populate_or_read"
+        How KenLM loads a binary `lm_path`, either "lazy" (maps the file,
+        faulting its pages in on the first queries), "populate_or_lazy",
+        "populate_or_read" (maps the file populated, falling back to a lazy
+        map or a read), "read" or "parallel_read". ARPA files are always
+        parsed into memory.
+    lm_require_binary: bool = False
+        Whether to reject an ARPA `lm_path`, which loads far slower than a
+        binary one.
+    lm_warm_up: bool = False
+        Whether to read the LM file into the page cache on a background
+        thread after loading, so a lazily mapped LM doesn't read from the
+        disk on its first queries.
+    submit_max_batch_size: int = 32
+        Number of utterances queued with `submit` decoded together at most.
+    submit_max_wait_ms: float = 1.0
+        Time an utterance queued with `submit` waits for others to be
+        decoded together with, if fewer than `submit_max_batch_size` are
+        queued.
+    worker_cpus: Optional[Union[str, list[int]]] = None
+        CPUs to pin the decoding threads to, one each, either as a list or
+        in the format of `taskset -c` (Eg: "0-7,16-23"). The threads take
+        the CPUs in the order listed, wrapping around if there are more
+        threads than CPUs, and allocate their memory on their CPU's NUMA
+        node, so listing the CPUs of the node holding the LM first keeps
+        the LM queries local. The threads float across the CPUs if not set.
+
+    The LM and lexicon are shared by every decoder loading the same file,
+    and the time and memory taken by loading the LM are reported by
+    `ext_scorer.lm_load_stats`.
     """
 
     def __init__(
@@ -112,6 +215,18 @@ class CTCBeamDecoder(_Decoder):
         tok_sep: str = "#",
         lm_path: Optional[str] = None,
         lexicon_fst_path: Optional[str] = None,
+        trace_path: Optional[str] = None,
+        fast_math: bool = False,
+        adaptive_beam: Optional[str] = None,
+        min_beam_width: Optional[int] = None,
+        min_cutoff_top_n: Optional[int] = None,
+        adaptive_threshold: Optional[float] = None,
+        lm_load_method: str = "populate_or_read",
+        lm_require_binary: bool = False,
+        lm_warm_up: bool = False,
+        submit_max_batch_size: int = 32,
+        submit_max_wait_ms: float = 1.0,
+        worker_cpus: Optional[Union[str, list[int]]] = None,
     ):
         apostrophe_id = _get_apostrophe_id_from_vocab(vocab)
         if apostrophe_id < 0:
@@ -129,6 +244,36 @@ class CTCBeamDecoder(_Decoder):
             max_beam_deviation,
         )
 
+        if adaptive_beam is None:
+            adaptive_measure = _AdaptiveMeasure.NONE
+        else:
+            assert adaptive_beam in (
+                "entropy",
+                "margin",
+            ), "Adaptive beam must be either 'entropy' or 'margin'"
+            adaptive_measure = _AdaptiveMeasure.__members__[adaptive_beam.upper()]
+
+        assert (
+            lm_load_method.upper() in _LmLoadMethod.__members__
+        ), "LM load method must be one of " + ", ".join(
+            name.lower() for name in _LmLoadMethod.__members__
+        )
+
+        assert submit_max_batch_size > 0, "Submit max batch size must be positive"
+        assert submit_max_wait_ms >= 0, "Submit max wait must be non-negative"
+
+        if worker_cpus is None:
+            worker_cpus = ""
+        elif not isinstance(worker_cpus, str):
+            worker_cpus = ",".join(str(cpu) for cpu in worker_cpus)
+
+        if min_beam_width is None:
+            min_beam_width = max(1, beam_width // 4)
+        if min_cutoff_top_n is None:
+            min_cutoff_top_n = max(1, cutoff_top_n // 4)
+        if adaptive_threshold is None:
+            adaptive_threshold = 1.0 if adaptive_beam == "entropy" else 0.5
+
         super().__init__(
             thread_count,
             blank_id,
@@ -145,6 +290,18 @@ class CTCBeamDecoder(_Decoder):
             vocab,
             lm_path,
             lexicon_fst_path,
+            trace_path,
+            fast_math,
+            adaptive_measure,
+            min_beam_width,
+            min_cutoff_top_n,
+            adaptive_threshold,
+            _LmLoadMethod.__members__[lm_load_method.upper()],
+            lm_require_binary,
+            lm_warm_up,
+            submit_max_batch_size,
+            submit_max_wait_ms,
+            worker_cpus,
         )
 
     @staticmethod
@@ -202,27 +359,106 @@ class CTCBeamDecoder(_Decoder):
             *self.sort_hotwords_by_length(hotwords_id, hotwords_weight)
         )
 
+    def _decode_options(self, options: Optional[dict]) -> Optional[_DecodeOptions]:
+        """
+        Builds the options of a single decode call from the decoder's own,
+        overridden by the provided ones, named as the constructor's params.
+
+        Parameters
+        ----------
+        options: Optional[dict]
+            Any of `alpha`, `beta`, `unk_lexicon_penalty`, `beam_width`,
+            `cutoff_top_n`, `cutoff_prob`, `min_tok_prob` and
+            `max_beam_deviation`.
+
+        Returns
+        -------
+        decode_options: Optional[_DecodeOptions]
+            The options of the call, or None to decode with the decoder's own.
+        """
+        if not options:
+            return None
+
+        unknown = set(options) - {
+            "alpha",
+            "beta",
+            "unk_lexicon_penalty",
+            "beam_width",
+            "cutoff_top_n",
+            "cutoff_prob",
+            "min_tok_prob",
+            "max_beam_deviation",
+        }
+        assert not unknown, "Unknown decode options: " + ", ".join(sorted(unknown))
+
+        decode_options = self.options()
+        scorer = decode_options.scorer
+        decode_options.scorer = _ScorerParams(
+            options.get("alpha", scorer.alpha),
+            options.get("beta", scorer.beta),
+            options.get("unk_lexicon_penalty", scorer.lex_penalty),
+        )
+        decode_options.beam_width = options.get("beam_width", self.beam_width)
+        decode_options.cutoff_top_n = options.get("cutoff_top_n", self.cutoff_top_n)
+        decode_options.nucleus_prob_per_timestep = options.get(
+            "cutoff_prob", self.nucleus_prob_per_timestep
+        )
+        if "min_tok_prob" in options:
+            decode_options.min_tok_prob = options["min_tok_prob"]
+        decode_options.max_beam_score_deviation = options.get(
+            "max_beam_deviation", self.max_beam_score_deviation
+        )
+
+        self.evaluate_parameters(
+            self.thread_count,
+            self.blank_id,
+            decode_options.cutoff_top_n,
+            decode_options.nucleus_prob_per_timestep,
+            decode_options.scorer.alpha,
+            decode_options.scorer.beta,
+            decode_options.beam_width,
+            self.vocab_size,
+            decode_options.max_beam_score_deviation,
+        )
+
+        return decode_options
+
     def decode(
         self,
-        logits: torch.Tensor,
-        seq_lens: torch.Tensor,
+        logits: Union[torch.Tensor, np.ndarray],
+        seq_lens: Union[torch.Tensor, np.ndarray],
         hotwords_id: list[list[int]] = [],
         hotwords_weight: Union[float, list[float]] = [],
         hotwords_fst: _Fst = None,
-    ) -> Tuple[torch.Tensor, torch.Tensor, torch.Tensor]:
+        return_stats: bool = False,
+        hw_counters: bool = False,
+        time_major: bool = False,
+        options: Optional[dict] = None,
+    ) -> Union[
+        Tuple[torch.Tensor, torch.Tensor, torch.Tensor],
+        Tuple[torch.Tensor, torch.Tensor, torch.Tensor, list[_DecodeStats]],
+    ]:
         """
         Performs CTC based beam decoding of the input logits with optional
         hotword boosting, lexicon FST, and language model scoring.
 
         NOTE:Expecting the logits to be softmaxed and not in log scale.
 
+        NOTE: The logits are decoded in place, at any strides, through DLPack
+              or the buffer protocol, so time major or sliced tensors are not
+              copied. Only the tensors on other devices are moved to CPU.
+
         Parameters
         ----------
-        logits: torch.Tensor
-            Input logits from model (batch_size, seq_len, vocab_size),
-            can be of type `torch.float32` or `torch.float64`.
-        seq_lens: torch.Tensor
-            Length of each unpadded sequence in the batch.
+        logits: Union[torch.Tensor, np.ndarray]
+            Input logits from model (batch_size, seq_len, vocab_size), or
+            (seq_len, batch_size, vocab_size) if `time_major`. Can be any
+            tensor implementing DLPack or the buffer protocol, of type
+            float16, bfloat16, float32 or float64. The 16-bit logits are
+            decoded as is, without upcasting the tensor, only the consumed
+            candidates are widened.
+        seq_lens: Union[torch.Tensor, np.ndarray]
+            Length of each unpadded sequence in the batch, of type int32 or int64.
         hotwords_id: list[list[int]]
             List of hotword tokens, where each inner list contains the token ids
             of the hotword. If no hotwords are provided, this can be an empty list
@@ -233,6 +469,24 @@ class CTCBeamDecoder(_Decoder):
             If a list is provided, it should match the length of `hotwords_id`.
         hotwords_fst: _Fst
             Hotword FST object build using `self.generate_hw_fst` method.
+        return_stats: bool
+            Whether to also return the search counters and phase timings
+            (in nanoseconds) of every utterance, to diagnose slow decodes.
+        hw_counters: bool
+            Whether to also count the cycles, instructions, LLC misses and
+            branch misses of every decode phase with `perf_event_open`,
+            implies `return_stats`. If the counters are unavailable,
+            `stats[i].hw_counters` is False and the counts are zero.
+        time_major: bool
+            Whether the logits are of shape (seq_len, batch_size, vocab_size).
+        options: Optional[dict]
+            The options to override for this call only, any of `alpha`,
+            `beta`, `unk_lexicon_penalty`, `beam_width`, `cutoff_top_n`,
+            `cutoff_prob`, `min_tok_prob` and `max_beam_deviation`, as the
+            constructor's params. The LM, lexicon and worker threads are
+            still the decoder's, so the calls with different options can
+            run concurrently on the same decoder.
+            Eg: `{"alpha": 0.8, "beam_width": 16}`.
 
         Returns
         -------
@@ -242,6 +496,12 @@ class CTCBeamDecoder(_Decoder):
             Timesteps of the decoded labels (batch_size, beam_width, seq_len).
         seq_pos: torch.Tensor
             Start index of both labels and timesteps (batch_size, beam_width).
+        stats: list[_DecodeStats]
+            Decode stats of every utterance in the batch, only if `return_stats`
+            or `hw_counters` is set.
+
+        The outputs are `torch.int32` tensors if `logits` is a `torch.Tensor`,
+        else `np.int32` arrays.
 
         Raises
         ------
@@ -249,6 +509,267 @@ class CTCBeamDecoder(_Decoder):
                         or if the shape of `seq_lens` is not (batch_size).
             AssertionError: If the vocab size of `logits` does not match the decoder's vocab size.
         """
+        is_torch, logits, seq_lens, hotwords_id, hotwords_weight = self._prepare_inputs(
+            logits, seq_lens, hotwords_id, hotwords_weight
+        )
+
+        outputs = self.batch_decode_tensor(
+            logits,
+            seq_lens,
+            time_major,
+            hotwords_id,
+            hotwords_weight,
+            hotwords_fst,
+            return_stats,
+            hw_counters,
+            self._decode_options(options),
+        )
+
+        return _wrap_outputs(outputs, is_torch, return_stats or hw_counters)
+
+    def decode_async(
+        self,
+        logits: Union[torch.Tensor, np.ndarray],
+        seq_lens: Union[torch.Tensor, np.ndarray],
+        hotwords_id: list[list[int]] = [],
+        hotwords_weight: Union[float, list[float]] = [],
+        hotwords_fst: _Fst = None,
+        return_stats: bool = False,
+        hw_counters: bool = False,
+        time_major: bool = False,
+        options: Optional[dict] = None,
+    ) -> Future:
+        """
+        Submits the logits for decoding on the decoder's worker threads and
+        returns immediately, so the next batch can be run through the model
+        while this one is decoded.
+
+        The returned future completes with the same outputs as `decode`, or
+        with a `RuntimeError` if the decoding failed. Use `result()` to wait,
+        `add_done_callback` to be notified, or `adecode` within asyncio. The
+        done callbacks run on the decoder's completion thread, one at a time,
+        so they should return quickly, but may call the decoder's methods.
+
+        NOTE: The logits are not copied, so they shouldn't be modified until
+              the future is done.
+
+        Parameters
+        ----------
+        Same as `decode`.
+
+        Returns
+        -------
+        future: concurrent.futures.Future
+            The future of the outputs of `decode`.
+
+        Raises
+        ------
+        Same as `decode`, raised on submission.
+        """
+        is_torch, logits, seq_lens, hotwords_id, hotwords_weight = self._prepare_inputs(
+            logits, seq_lens, hotwords_id, hotwords_weight
+        )
+
+        future = Future()
+        future.set_running_or_notify_cancel()
+        with_stats = return_stats or hw_counters
+
+        # NOTE: The callback runs on the decoder's completion thread, off the
+        #       workers, so the done callbacks may decode synchronously too.
+        def on_complete(outputs, error):
+            if error is not None:
+                future.set_exception(RuntimeError(error))
+            else:
+                future.set_result(_wrap_outputs(outputs, is_torch, with_stats))
+
+        self.batch_decode_tensor_async(
+            logits,
+            seq_lens,
+            time_major,
+            hotwords_id,
+            hotwords_weight,
+            hotwords_fst,
+            return_stats,
+            hw_counters,
+            on_complete,
+            self._decode_options(options),
+        )
+
+        return future
+
+    async def adecode(self, *args, **kwargs):
+        """
+        Awaitable `decode`, which decodes on the decoder's worker threads
+        without blocking the event loop. Takes the same parameters and
+        returns the same outputs as `decode`.
+        """
+        return await asyncio.wrap_future(self.decode_async(*args, **kwargs))
+
+    def submit(
+        self,
+        logits: Union[torch.Tensor, np.ndarray],
+        options: Optional[dict] = None,
+    ) -> Future:
+        """
+        Queues a single utterance to be decoded along with the utterances
+        submitted from the other threads, and returns immediately. The queued
+        utterances are decoded together in micro-batches of up to
+        `submit_max_batch_size`, once full or once the oldest has waited
+        `submit_max_wait_ms`, so many concurrent callers of one utterance each
+        keep every worker thread busy, without padding them into one batch.
+
+        Parameters
+        ----------
+        logits: Union[torch.Tensor, np.ndarray]
+            Input logits of a single utterance (seq_len, vocab_size), softmaxed
+            and not in log scale. Converted to a contiguous float32 array, if
+            not one already, otherwise not copied, so it shouldn't be modified
+            until the future is done.
+        options: Optional[dict]
+            The options to override for this utterance only, same as `decode`.
+
+        Returns
+        -------
+        future: concurrent.futures.Future
+            The future of the decoded `labels` and `timesteps` of shape
+            (beam_width, seq_len) and `seq_pos` of shape (beam_width), the
+            same as `decode`'s of a batch of one.
+        """
+        if logits.ndim != 2:
+            raise ValueError(
+                f"Invalid logits shape {logits.shape}, expecting (seq_len, vocab_size)"
+            )
+        assert (
+            logits.shape[1] == self.vocab_size
+        ), f"Vocab size mismatch {logits.shape[1]} != {self.vocab_size}"
+
+        is_torch = isinstance(logits, torch.Tensor)
+        if is_torch:
+            logits = logits.detach().cpu().float().numpy()
+
+        future = Future()
+        future.set_running_or_notify_cancel()
+
+        def on_complete(outputs, error):
+            if error is not None:
+                future.set_exception(RuntimeError(error))
+            else:
+                future.set_result(_wrap_outputs((*outputs, None), is_torch, False))
+
+        self.submit_tensor(logits, on_complete, self._decode_options(options))
+
+        return future
+
+    def decode_multi(
+        self,
+        logits: Union[torch.Tensor, np.ndarray],
+        seq_lens: Union[torch.Tensor, np.ndarray],
+        scorer_params: list[dict],
+        hotwords_id: list[list[int]] = [],
+        hotwords_weight: Union[float, list[float]] = [],
+        hotwords_fst: _Fst = None,
+        return_stats: bool = False,
+        hw_counters: bool = False,
+        time_major: bool = False,
+    ) -> list[tuple]:
+        """
+        Decodes the same logits once for each of the scorer params, like
+        an `alpha`/`beta` grid search, with the already loaded language
+        model and lexicon. The candidate selection, the adaptive budgets
+        and the language model queries don't depend on the scorer params,
+        so they're done once per utterance and shared by every decode.
+
+        Parameters
+        ----------
+        scorer_params: list[dict]
+            The scorer params to decode with, each a dict of any of `alpha`,
+            `beta` and `unk_lexicon_penalty`, where the missing ones are the
+            decoder's own. Eg: `[{"alpha": 0.5, "beta": 1.0}, {"alpha": 0.8}]`.
+
+        The rest of the parameters are the same as `decode`.
+
+        Returns
+        -------
+        outputs: list[tuple]
+            The outputs of every scorer params, in order, each the same as
+            the outputs of `decode`.
+        """
+        assert len(scorer_params) > 0, "At least one scorer params is required"
+        configs = [
+            _ScorerParams(
+                params.get("alpha", self.ext_scorer.alpha),
+                params.get("beta", self.ext_scorer.beta),
+                params.get("unk_lexicon_penalty", self.ext_scorer.lex_penalty),
+            )
+            for params in scorer_params
+        ]
+
+        is_torch, logits, seq_lens, hotwords_id, hotwords_weight = self._prepare_inputs(
+            logits, seq_lens, hotwords_id, hotwords_weight
+        )
+
+        outputs = self.batch_decode_tensor_multi(
+            logits,
+            seq_lens,
+            time_major,
+            configs,
+            hotwords_id,
+            hotwords_weight,
+            hotwords_fst,
+            return_stats,
+            hw_counters,
+        )
+
+        return [
+            _wrap_outputs(output, is_torch, return_stats or hw_counters)
+            for output in outputs
+        ]
+
+    def greedy_decode(
+        self,
+        logits: Union[torch.Tensor, np.ndarray],
+        seq_lens: Union[torch.Tensor, np.ndarray],
+        time_major: bool = False,
+    ) -> tuple:
+        """
+        Decodes the best path of the logits, (ie) the most probable token of
+        every frame, with the repeats collapsed and the blanks dropped. It's
+        far cheaper than `decode` with `beam_width=1`, as there's no search,
+        external scoring or hotwords, only an argmax over every frame.
+
+        Parameters
+        ----------
+        logits: Union[torch.Tensor, np.ndarray]
+            Same as `decode`.
+        seq_lens: Union[torch.Tensor, np.ndarray]
+            Same as `decode`.
+        time_major: bool = False
+            Same as `decode`.
+
+        Returns
+        -------
+        The same outputs as `decode`, of a single beam, (ie) `labels` and
+        `timesteps` of shape (batch_size, 1, seq_len) and `seq_pos` of shape
+        (batch_size, 1).
+        """
+        is_torch, logits, seq_lens, *_ = self._prepare_inputs(logits, seq_lens, [], [])
+
+        outputs = self.batch_greedy_decode_tensor(logits, seq_lens, time_major)
+
+        return _wrap_outputs(outputs, is_torch, False)
+
+    def _prepare_inputs(
+        self,
+        logits,
+        seq_lens,
+        hotwords_id: list[list[int]],
+        hotwords_weight: Union[float, list[float]],
+    ):
+        """
+        Validates the input shapes, moves the torch tensors to CPU without
+        copying the CPU ones, and sorts the hotwords, also returning whether
+        the logits are a torch tensor.
+        """
         if logits.ndim != 3:
             raise ValueError(
                 f"Invalid logits shape {logits.shape}, expecting (batch_size, seq_len, vocab_size)"
@@ -258,17 +779,16 @@ class CTCBeamDecoder(_Decoder):
                 f"Invalid seq_lens shape {seq_lens.shape}, expecting (batch_size)"
             )
 
-        if logits.device.type != "cpu":
-            logits = logits.detach().cpu()
-        else:
+        is_torch = isinstance(logits, torch.Tensor)
+        if is_torch:
             logits = logits.detach()
+            if logits.device.type != "cpu":
+                logits = logits.cpu()
 
-        if seq_lens.device.type != "cpu":
-            seq_lens = seq_lens.detach().to("cpu", torch.int32)
-        else:
-            seq_lens = seq_lens.detach().to("cpu", torch.int32)
+        if isinstance(seq_lens, torch.Tensor):
+            seq_lens = seq_lens.detach().cpu()
 
-        batch_size, seq_len, vocab_size = logits.shape
+        vocab_size = logits.shape[2]
         assert (
             vocab_size == self.vocab_size
         ), f"Vocab size mismatch {vocab_size} != {self.vocab_size}"
@@ -280,31 +800,103 @@ class CTCBeamDecoder(_Decoder):
             hotwords_id, hotwords_weight
         )
 
-        sorted_indices = torch.argsort(logits, dim=2, descending=True).to(
-            "cpu", torch.int32
-        )
-        labels = torch.zeros((batch_size, self.beam_width, seq_len), dtype=torch.int32)
-        timesteps = torch.zeros(
-            (batch_size, self.beam_width, seq_len), dtype=torch.int32
+        return is_torch, logits, seq_lens, hotwords_id, hotwords_weight
+
+    def decode_quantized(
+        self,
+        values: torch.Tensor,
+        scales: torch.Tensor,
+        offsets: torch.Tensor,
+        seq_lens: torch.Tensor,
+        hotwords_id: list[list[int]] = [],
+        hotwords_weight: Union[float, list[float]] = [],
+        hotwords_fst: _Fst = None,
+        return_stats: bool = False,
+        hw_counters: bool = False,
+    ) -> Union[
+        Tuple[torch.Tensor, torch.Tensor, torch.Tensor],
+        Tuple[torch.Tensor, torch.Tensor, torch.Tensor, list[_DecodeStats]],
+    ]:
+        """
+        Performs CTC based beam decoding of int8 quantized log probabilities,
+        dequantized as `values * scale + offset`, where every frame or every
+        utterance has its own scale and offset. Only the consumed candidates
+        are dequantized, so the logits are never materialised in float.
+
+        NOTE: The scales must be positive, as the candidates are ranked by
+              their quantized values.
+
+        Parameters
+        ----------
+        values: torch.Tensor
+            Quantized log probabilities (batch_size, seq_len, vocab_size) of
+            type `torch.int8`.
+        scales: torch.Tensor
+            Scale of every frame (batch_size, seq_len) or of every utterance
+            (batch_size).
+        offsets: torch.Tensor
+            Offset of every frame or utterance, of the same shape as `scales`.
+        seq_lens: torch.Tensor
+            Length of each unpadded sequence in the batch.
+        hotwords_id, hotwords_weight, hotwords_fst, return_stats, hw_counters:
+            Same as in `decode`.
+
+        Returns
+        -------
+        Same as `decode`.
+
+        Raises
+        ------
+            ValueError: If the shapes or the dtype of the inputs are invalid.
+            AssertionError: If the vocab size of `values` does not match the decoder's vocab size.
+            RuntimeError: If any of the scales is not positive.
+        """
+        if values.ndim != 3 or values.dtype != torch.int8:
+            raise ValueError(
+                f"Invalid values {values.dtype} {values.shape}, expecting int8 (batch_size, seq_len, vocab_size)"
+            )
+        if scales.shape != offsets.shape or scales.shape not in (
+            values.shape[:1],
+            values.shape[:2],
+        ):
+            raise ValueError(
+                f"Invalid scales {scales.shape} or offsets {offsets.shape}, expecting (batch_size, seq_len) or (batch_size)"
+            )
+        if seq_lens.ndim != 1:
+            raise ValueError(
+                f"Invalid seq_lens shape {seq_lens.shape}, expecting (batch_size)"
+            )
+
+        values = values.detach().cpu().contiguous()
+        scales = scales.detach().to("cpu", torch.float32)
+        offsets = offsets.detach().to("cpu", torch.float32)
+        seq_lens = seq_lens.detach().to("cpu", torch.int32)
+
+        vocab_size = values.shape[2]
+        assert (
+            vocab_size == self.vocab_size
+        ), f"Vocab size mismatch {vocab_size} != {self.vocab_size}"
+
+        if isinstance(hotwords_weight, float):
+            hotwords_weight = [hotwords_weight] * len(hotwords_id)
+
+        hotwords_id, hotwords_weight = self.sort_hotwords_by_length(
+            hotwords_id, hotwords_weight
         )
-        seq_pos = torch.zeros((batch_size, self.beam_width), dtype=torch.int32)
 
-        self.batch_decode(
-            logits.data_ptr(),
-            logits.element_size(),
-            sorted_indices.data_ptr(),
-            labels.data_ptr(),
-            timesteps.data_ptr(),
-            seq_lens.data_ptr(),
-            seq_pos.data_ptr(),
-            batch_size,
-            seq_len,
+        outputs = self.batch_decode_quantized_tensor(
+            values,
+            scales,
+            offsets,
+            seq_lens,
             hotwords_id,
             hotwords_weight,
             hotwords_fst,
+            return_stats,
+            hw_counters,
         )
 
-        return labels, timesteps, seq_pos
+        return _wrap_outputs(outputs, True, return_stats or hw_counters)
 
     def sequential_decode(
         self,
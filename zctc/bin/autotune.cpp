@@ -0,0 +1,478 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+#include "zctc/decoder.hh"
+#include "zctc/npy.hh"
+
+#include "./common.hh"
+
+/**
+ * @brief Command line configuration of the tuning run. Every list is a
+ * 		  search axis, the decoder is measured over their cartesian product.
+ */
+struct TuneConfig {
+	std::vector<int> beam_widths = { 8, 16, 32, 64 };
+	std::vector<int> cutoff_top_ns = { 10, 20, 40 };
+	std::vector<float> min_tok_probs = { -5.0, -10.0, -20.0 };
+	std::vector<float> max_beam_score_deviations = { -10.0, -20.0 };
+	int thread_count = std::max(1u, std::thread::hardware_concurrency()), batch_size = 32, warmup = 1, repeats = 3;
+	int blank_id = 0;
+	float alpha = 0.5, beta = 1.0, lex_penalty = -5.0, frame_ms = 40;
+	bool log_probs = false;
+	char tok_sep = '#';
+	std::string data_dir, vocab_path, lm_path, lexicon_path, output;
+};
+
+/**
+ * @brief A recorded utterance, its posteriors of shape SeqLen x Vocab and
+ * 		  its reference transcript.
+ */
+struct Utterance {
+	std::string name;
+	int seq_len;
+	std::vector<float> logits;
+	std::string reference;
+};
+
+/**
+ * @brief The utterances of a batch, padded to the longest one, as `batch_decode` expects.
+ */
+struct Batch {
+	int size, max_seq_len;
+	std::size_t first;
+	std::vector<float> logits;
+	std::vector<int> seq_lens;
+};
+
+/**
+ * @brief The measured speed and accuracy of a point of the search space.
+ */
+struct TunePoint {
+	int beam_width, cutoff_top_n;
+	float min_tok_prob, max_beam_score_deviation;
+	long decode_ns;
+	double rtf, utterances_per_sec, wer, cer;
+	long p50_latency_ns, p99_latency_ns;
+	bool pareto = false;
+};
+
+std::vector<std::string>
+split_words(const std::string& text)
+{
+	std::vector<std::string> words;
+	std::stringstream ss(text);
+	std::string word;
+
+	while (ss >> word)
+		words.emplace_back(word);
+
+	return words;
+}
+
+std::string
+join_words(const std::vector<std::string>& words)
+{
+	std::string text;
+	for (const std::string& word : words)
+		text += (text.empty() ? "" : " ") + word;
+
+	return text;
+}
+
+/**
+ * @brief Loads every `<name>.npy` of the directory along with its reference
+ * 		  transcript `<name>.txt`, in the order of the names. The arrays are
+ * 		  of shape SeqLen x Vocab or 1 x SeqLen x Vocab, of probabilities, or
+ * 		  of log probabilities if `log_probs`, which are exponentiated.
+ */
+std::vector<Utterance>
+load_dataset(const TuneConfig& config, int vocab_size)
+{
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::directory_iterator(config.data_dir)) {
+		if (entry.path().extension() == ".npy")
+			paths.emplace_back(entry.path());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::vector<Utterance> dataset;
+	for (const std::filesystem::path& path : paths) {
+		zctc::NpyArray array = zctc::load_npy(path.string());
+		if (array.shape.size() == 3 && array.shape[0] == 1)
+			array.shape.erase(array.shape.begin());
+		if (array.shape.size() != 2 || static_cast<int>(array.shape[1]) != vocab_size)
+			throw std::runtime_error("Expected logits of shape SeqLen x " + std::to_string(vocab_size) + ", "
+									 + path.string());
+
+		std::filesystem::path reference_path(path);
+		reference_path.replace_extension(".txt");
+		std::ifstream reference_file(reference_path);
+		if (!reference_file)
+			throw std::runtime_error("Cannot open the reference transcript, " + reference_path.string());
+
+		std::stringstream reference;
+		reference << reference_file.rdbuf();
+
+		Utterance& utterance = dataset.emplace_back();
+		utterance.name = path.stem().string();
+		utterance.seq_len = array.shape[0];
+		utterance.logits = array.as<float>();
+		utterance.reference = join_words(split_words(reference.str()));
+
+		if (config.log_probs) {
+			for (float& logit : utterance.logits)
+				logit = std::exp(logit);
+		}
+	}
+
+	if (dataset.empty())
+		throw std::runtime_error("No npy files found in " + config.data_dir);
+
+	return dataset;
+}
+
+/**
+ * @brief Packs the dataset into padded batches once, so the packing isn't part of the measured decode.
+ */
+std::vector<Batch>
+make_batches(const std::vector<Utterance>& dataset, int batch_size, int vocab_size)
+{
+	std::vector<Batch> batches;
+
+	for (std::size_t first = 0; first < dataset.size(); first += batch_size) {
+		Batch& batch = batches.emplace_back();
+		batch.first = first;
+		batch.size = std::min(static_cast<std::size_t>(batch_size), dataset.size() - first);
+		batch.max_seq_len = 0;
+		for (int i = 0; i < batch.size; i++) {
+			batch.seq_lens.emplace_back(dataset[first + i].seq_len);
+			batch.max_seq_len = std::max(batch.max_seq_len, dataset[first + i].seq_len);
+		}
+
+		std::size_t frame_stride = static_cast<std::size_t>(batch.max_seq_len) * vocab_size;
+		batch.logits.assign(batch.size * frame_stride, 0.0f);
+		for (int i = 0; i < batch.size; i++) {
+			const std::vector<float>& logits = dataset[first + i].logits;
+			std::copy(logits.begin(), logits.end(), batch.logits.begin() + i * frame_stride);
+		}
+	}
+
+	return batches;
+}
+
+/**
+ * @brief Joins the decoded tokens into words, with the same start of word
+ * 		  rule as the external scorer, (ie) a token starts a word unless it's
+ * 		  a subword token, an apostrophe or follows an apostrophe.
+ */
+std::string
+detokenize(const int* labels, int length, const std::vector<std::string>& vocab, char tok_sep, int apostrophe_id)
+{
+	std::string text;
+	int prev_id = -1;
+
+	for (int i = 0; i < length; prev_id = labels[i++]) {
+		const std::string& token = vocab[labels[i]];
+		bool is_start_of_word
+			= !(labels[i] == apostrophe_id || prev_id == apostrophe_id || token.empty() || token.at(0) == tok_sep);
+
+		if (is_start_of_word && !text.empty())
+			text += ' ';
+		text += token.substr(std::min(token.find_first_not_of(tok_sep), token.size()));
+	}
+
+	return text;
+}
+
+template <typename Seq>
+long
+edit_distance(const Seq& reference, const Seq& hypothesis)
+{
+	std::vector<long> prev(hypothesis.size() + 1), curr(hypothesis.size() + 1);
+	std::iota(prev.begin(), prev.end(), 0L);
+
+	for (std::size_t i = 1; i <= reference.size(); i++) {
+		curr[0] = i;
+		for (std::size_t j = 1; j <= hypothesis.size(); j++) {
+			long substitution = prev[j - 1] + (reference[i - 1] != hypothesis[j - 1]);
+			curr[j] = std::min({ prev[j] + 1, curr[j - 1] + 1, substitution });
+		}
+		std::swap(prev, curr);
+	}
+
+	return prev[hypothesis.size()];
+}
+
+/**
+ * @brief Decodes the dataset `warmup + repeats` times with the options of the
+ * 		  provided search point, taking the median pass as its speed and the
+ * 		  top beams of the last pass as its accuracy. Every point is decoded
+ * 		  by the same decoder, through its per call options, so the LM and
+ * 		  lexicon are loaded once for the whole search, and not measured.
+ */
+TunePoint
+measure_point(const TuneConfig& config, const zctc::Decoder& decoder, const std::vector<std::string>& vocab,
+			  const std::vector<Utterance>& dataset, std::vector<Batch>& batches, TunePoint point)
+{
+	zctc::DecodeOptions options = decoder.options();
+	options.beam_width = point.beam_width;
+	options.cutoff_top_n = std::min(point.cutoff_top_n, static_cast<int>(vocab.size()));
+	options.min_tok_prob = point.min_tok_prob;
+	options.max_beam_score_deviation = point.max_beam_score_deviation;
+
+	std::vector<std::vector<int>> hotwords_id;
+	std::vector<float> hotwords_weight;
+	std::vector<long> pass_ns, batch_ns;
+	std::vector<std::string> hypotheses(dataset.size());
+
+	const int apostrophe = apostrophe_id(vocab);
+
+	for (int pass = 0; pass < config.warmup + config.repeats; pass++) {
+		long total_ns = 0;
+
+		for (Batch& batch : batches) {
+			std::vector<int> labels(static_cast<std::size_t>(batch.size) * point.beam_width * batch.max_seq_len);
+			std::vector<int> timesteps(labels.size());
+			std::vector<int> seq_pos(static_cast<std::size_t>(batch.size) * point.beam_width);
+
+			auto start = std::chrono::steady_clock::now();
+			decoder.batch_decode(batch.logits.data(), nullptr, labels.data(), timesteps.data(), batch.seq_lens.data(),
+								 seq_pos.data(), batch.size, batch.max_seq_len, hotwords_id,
+								 hotwords_weight, nullptr, nullptr, &options);
+			long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+						  .count();
+
+			if (pass < config.warmup)
+				continue;
+
+			total_ns += ns;
+			batch_ns.emplace_back(ns);
+
+			for (int i = 0; i < batch.size; i++) {
+				const int* top = labels.data() + static_cast<std::size_t>(i) * point.beam_width * batch.max_seq_len;
+				int top_pos = seq_pos[static_cast<std::size_t>(i) * point.beam_width];
+				hypotheses[batch.first + i] = detokenize(top + top_pos, batch.max_seq_len - top_pos, vocab,
+														 config.tok_sep, apostrophe);
+			}
+		}
+
+		if (pass >= config.warmup)
+			pass_ns.emplace_back(total_ns);
+	}
+
+	long word_errors = 0, words = 0, char_errors = 0, chars = 0;
+	for (std::size_t i = 0; i < dataset.size(); i++) {
+		std::vector<std::string> reference = split_words(dataset[i].reference);
+		word_errors += edit_distance(reference, split_words(hypotheses[i]));
+		words += reference.size();
+		char_errors += edit_distance(dataset[i].reference, hypotheses[i]);
+		chars += dataset[i].reference.size();
+	}
+
+	long total_frames = 0;
+	for (const Utterance& utterance : dataset)
+		total_frames += utterance.seq_len;
+
+	point.decode_ns = percentile(pass_ns, 0.5);
+	point.rtf = (point.decode_ns / 1e9) / (total_frames * config.frame_ms / 1e3);
+	point.utterances_per_sec = dataset.size() / (point.decode_ns / 1e9);
+	point.wer = words ? static_cast<double>(word_errors) / words : 0.0;
+	point.cer = chars ? static_cast<double>(char_errors) / chars : 0.0;
+	point.p50_latency_ns = percentile(batch_ns, 0.5);
+	point.p99_latency_ns = percentile(batch_ns, 0.99);
+
+	return point;
+}
+
+/**
+ * @brief Marks the points on the Pareto frontier of speed versus accuracy,
+ * 		  (ie) those which no other point is both faster and more accurate
+ * 		  than, and sorts the points by their real time factor.
+ */
+void
+mark_pareto(std::vector<TunePoint>& points)
+{
+	std::sort(points.begin(), points.end(), [](const TunePoint& a, const TunePoint& b) {
+		return (a.rtf != b.rtf) ? a.rtf < b.rtf : (a.wer != b.wer) ? a.wer < b.wer : a.cer < b.cer;
+	});
+
+	double best_wer = std::numeric_limits<double>::infinity();
+	for (TunePoint& point : points) {
+		point.pareto = point.wer < best_wer;
+		best_wer = std::min(best_wer, point.wer);
+	}
+}
+
+void
+emit(std::ostream& out, const TunePoint& point)
+{
+	out << "{\"params\": {\"beam_width\": " << point.beam_width << ", \"cutoff_top_n\": " << point.cutoff_top_n
+		<< ", \"min_tok_prob\": " << point.min_tok_prob
+		<< ", \"max_beam_score_deviation\": " << point.max_beam_score_deviation << "}"
+		<< ", \"decode_ns\": " << point.decode_ns << ", \"rtf\": " << point.rtf
+		<< ", \"utterances_per_sec\": " << point.utterances_per_sec << ", \"p50_latency_ns\": " << point.p50_latency_ns
+		<< ", \"p99_latency_ns\": " << point.p99_latency_ns << ", \"wer\": " << point.wer << ", \"cer\": " << point.cer
+		<< ", \"pareto\": " << (point.pareto ? "true" : "false") << "}" << std::endl;
+}
+
+void
+print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " --data DIR --vocab PATH [options]\n"
+			  << "  --data DIR                 directory of <name>.npy logits and <name>.txt references\n"
+			  << "  --vocab PATH               vocab file, one token per line\n"
+			  << "  --log-probs                the logits are log probabilities, else probabilities\n"
+			  << "  --beam-widths LIST         beam widths to search (default 8,16,32,64)\n"
+			  << "  --cutoff-top-n LIST        candidate cutoffs to search (default 10,20,40)\n"
+			  << "  --min-tok-probs LIST       min token log probabilities to search (default -5,-10,-20)\n"
+			  << "  --max-beam-deviations LIST max beam score deviations to search (default -10,-20)\n"
+			  << "  --threads N                decoder threads (default all the cores)\n"
+			  << "  --batch-size N             utterances per batch (default 32)\n"
+			  << "  --warmup N                 untimed passes over the dataset (default 1)\n"
+			  << "  --repeats N                timed passes over the dataset (default 3)\n"
+			  << "  --frame-ms F               frame shift used for the real time factor (default 40)\n"
+			  << "  --blank-id N               blank token id (default 0)\n"
+			  << "  --tok-sep C                subword token prefix (default #)\n"
+			  << "  --alpha F                  LM weight (default 0.5)\n"
+			  << "  --beta F                   word insertion bonus (default 1.0)\n"
+			  << "  --lex-penalty F            out of lexicon penalty (default -5.0)\n"
+			  << "  --lm PATH                  KenLM model\n"
+			  << "  --lexicon PATH             lexicon FST\n"
+			  << "  --output PATH              write JSON lines here instead of stdout\n";
+}
+
+int
+main(int argc, char** argv)
+{
+	TuneConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--log-probs") {
+			config.log_probs = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--data")
+			config.data_dir = value;
+		else if (arg == "--vocab")
+			config.vocab_path = value;
+		else if (arg == "--beam-widths")
+			config.beam_widths = parse_int_list(value);
+		else if (arg == "--cutoff-top-n")
+			config.cutoff_top_ns = parse_int_list(value);
+		else if (arg == "--min-tok-probs")
+			config.min_tok_probs = parse_float_list(value);
+		else if (arg == "--max-beam-deviations")
+			config.max_beam_score_deviations = parse_float_list(value);
+		else if (arg == "--threads")
+			config.thread_count = std::stoi(value);
+		else if (arg == "--batch-size")
+			config.batch_size = std::stoi(value);
+		else if (arg == "--warmup")
+			config.warmup = std::stoi(value);
+		else if (arg == "--repeats")
+			config.repeats = std::stoi(value);
+		else if (arg == "--frame-ms")
+			config.frame_ms = std::stof(value);
+		else if (arg == "--blank-id")
+			config.blank_id = std::stoi(value);
+		else if (arg == "--tok-sep")
+			config.tok_sep = value.at(0);
+		else if (arg == "--alpha")
+			config.alpha = std::stof(value);
+		else if (arg == "--beta")
+			config.beta = std::stof(value);
+		else if (arg == "--lex-penalty")
+			config.lex_penalty = std::stof(value);
+		else if (arg == "--lm")
+			config.lm_path = value;
+		else if (arg == "--lexicon")
+			config.lexicon_path = value;
+		else if (arg == "--output")
+			config.output = value;
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (config.data_dir.empty() || config.vocab_path.empty() || config.repeats < 1 || config.batch_size < 1
+		|| config.beam_widths.empty() || config.cutoff_top_ns.empty() || config.min_tok_probs.empty()
+		|| config.max_beam_score_deviations.empty()) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> vocab = load_vocab(config.vocab_path);
+	std::vector<Utterance> dataset = load_dataset(config, vocab.size());
+	std::vector<Batch> batches = make_batches(dataset, config.batch_size, vocab.size());
+
+	// NOTE: The decoder's own beam width and cutoff are the largest searched, the points override all four axes.
+	std::string lm_path(config.lm_path), lexicon_path(config.lexicon_path);
+	int beam_width = *std::max_element(config.beam_widths.begin(), config.beam_widths.end());
+	int cutoff_top_n = std::min(*std::max_element(config.cutoff_top_ns.begin(), config.cutoff_top_ns.end()),
+								static_cast<int>(vocab.size()));
+
+	zctc::Decoder decoder(config.thread_count, config.blank_id, cutoff_top_n, apostrophe_id(vocab), 1.0, config.alpha,
+						  config.beta, beam_width, config.lex_penalty, config.min_tok_probs.front(),
+						  config.max_beam_score_deviations.front(), config.tok_sep, vocab,
+						  lm_path.empty() ? nullptr : lm_path.data(), lexicon_path.empty() ? nullptr : lexicon_path.data());
+
+	std::vector<TunePoint> points;
+	for (int beam_width : config.beam_widths) {
+		for (int cutoff_top_n : config.cutoff_top_ns) {
+			for (float min_tok_prob : config.min_tok_probs) {
+				for (float max_beam_score_deviation : config.max_beam_score_deviations) {
+					TunePoint point { beam_width, cutoff_top_n, min_tok_prob, max_beam_score_deviation };
+					points.emplace_back(measure_point(config, decoder, vocab, dataset, batches, point));
+
+					std::cerr << "beam_width=" << beam_width << " cutoff_top_n=" << cutoff_top_n
+							  << " min_tok_prob=" << min_tok_prob
+							  << " max_beam_score_deviation=" << max_beam_score_deviation
+							  << " rtf=" << points.back().rtf << " wer=" << points.back().wer << std::endl;
+				}
+			}
+		}
+	}
+
+	mark_pareto(points);
+
+	std::ofstream file;
+	if (!config.output.empty())
+		file.open(config.output);
+	std::ostream& out = config.output.empty() ? std::cout : file;
+
+	for (const TunePoint& point : points)
+		emit(out, point);
+
+	std::cerr << "Pareto frontier, fastest first:" << std::endl;
+	for (const TunePoint& point : points) {
+		if (point.pareto)
+			std::cerr << "  beam_width=" << point.beam_width << " cutoff_top_n=" << point.cutoff_top_n
+					  << " min_tok_prob=" << point.min_tok_prob
+					  << " max_beam_score_deviation=" << point.max_beam_score_deviation << " rtf=" << point.rtf
+					  << " wer=" << point.wer << " cer=" << point.cer << std::endl;
+	}
+
+	return 0;
+}
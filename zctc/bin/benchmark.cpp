@@ -0,0 +1,1113 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "zctc/decoder.hh"
+#include "zctc/workload.hh"
+
+#include "./common.hh"
+
+/**
+ * @brief Command line configuration of the benchmark run. Every list is
+ * 		  a sweep axis, the benchmarks run over their cartesian product.
+ */
+struct BenchConfig {
+	std::vector<std::string> benches = { "extend_path", "update_score", "ext_scoring", "populate_hotword_fst",
+										 "decode", "quantized", "adaptive", "greedy", "throughput", "affinity" };
+	std::vector<int> beam_widths = { 8, 32, 128 };
+	std::vector<int> cutoff_top_ns = { 10, 40 };
+	std::vector<int> vocab_sizes = { 128, 1024 };
+	std::vector<int> seq_lens = { 100, 1000 };
+	std::vector<int> hotword_counts = { 10, 100, 1000 };
+	std::vector<int> thread_counts = { 1, 2, 4, 8 };
+	std::vector<int> batch_sizes = { 1, 8, 32 };
+	int warmup = 2, repeats = 10, utterances = 32;
+	float blank_ratio = 0.7, peakiness = 0.9, token_rate = 0.1, frame_ms = 40;
+	unsigned int seed = 0;
+	std::string lm_path, lexicon_path, vocab_path, output, worker_cpus;
+};
+
+/**
+ * @brief Timing samples of a benchmark, in nanoseconds.
+ */
+struct Timing {
+	std::vector<long> samples;
+
+	long percentile(double p) const
+	{
+		std::vector<long> sorted(this->samples);
+		std::sort(sorted.begin(), sorted.end());
+		return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+	}
+
+	double mean() const
+	{
+		return std::accumulate(this->samples.begin(), this->samples.end(), 0.0) / this->samples.size();
+	}
+};
+
+using Params = std::vector<std::pair<std::string, std::string>>;
+
+/**
+ * @brief Writes one JSON object per benchmark result line.
+ */
+class Reporter {
+public:
+	explicit Reporter(std::ostream& out)
+		: out(out)
+	{
+	}
+
+	/**
+	 * @brief Emits the ISA the SIMD kernels are built for, as the first line,
+	 * 		  so the results of differently built binaries aren't compared.
+	 */
+	void build_info()
+	{
+		this->out << "{\"build\": {\"simd_isa\": \"" << zctc::SIMD_ISA << "\", \"simd_bytes\": " << zctc::SIMD_BYTES
+				  << ", \"float_lanes\": " << zctc::LANES<float> << ", \"double_lanes\": " << zctc::LANES<double>
+				  << ", \"f16c\": "
+#if defined(__F16C__)
+				  << "true"
+#else
+				  << "false"
+#endif // __F16C__
+				  << "}}" << std::endl;
+	}
+
+	void emit(const std::string& bench, const Params& params, const Timing& timing, long items,
+			  const Params& metrics = {})
+	{
+		this->out << "{\"bench\": \"" << bench << "\", \"params\": {";
+		for (std::size_t i = 0; i < params.size(); i++) {
+			this->out << (i ? ", " : "") << "\"" << params[i].first << "\": " << params[i].second;
+		}
+
+		long median = timing.percentile(0.5);
+		this->out << "}, \"repeats\": " << timing.samples.size() << ", \"items\": " << items
+				  << ", \"min_ns\": " << timing.percentile(0.0) << ", \"median_ns\": " << median
+				  << ", \"mean_ns\": " << static_cast<long>(timing.mean()) << ", \"p90_ns\": " << timing.percentile(0.9)
+				  << ", \"max_ns\": " << timing.percentile(1.0)
+				  << ", \"ns_per_item\": " << (items ? static_cast<double>(median) / items : 0.0);
+		for (const auto& [name, value] : metrics)
+			this->out << ", \"" << name << "\": " << value;
+		this->out << "}" << std::endl;
+	}
+
+private:
+	std::ostream& out;
+};
+
+/**
+ * @brief Runs the provided measurement `warmup + repeats` times and keeps
+ * 		  the samples of the repeats. The measurement returns the nanoseconds
+ * 		  of its own timed region, so setup and teardown are excluded.
+ */
+template <typename Measure>
+Timing
+measure(const BenchConfig& config, Measure&& run)
+{
+	Timing timing;
+	for (int i = 0; i < config.warmup + config.repeats; i++) {
+		long ns = run();
+		if (i >= config.warmup)
+			timing.samples.emplace_back(ns);
+	}
+
+	return timing;
+}
+
+template <typename Clock>
+long
+elapsed_ns(typename Clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Generates a synthetic BPE like vocab, where blank is at 0 and
+ * 		  apostrophe is at 1, and the remaining are alternating word start
+ * 		  and subword tokens.
+ */
+std::vector<std::string>
+synthetic_vocab(int vocab_size)
+{
+	std::vector<std::string> vocab = { "_", "'" };
+	for (int i = 2; i < vocab_size; i++)
+		vocab.emplace_back((i % 2 ? "##t" : "t") + std::to_string(i));
+
+	return vocab;
+}
+
+zctc::SyntheticCTC
+make_generator(const BenchConfig& config, int vocab_size, unsigned int seed)
+{
+	return zctc::SyntheticCTC(vocab_size, 0, config.blank_ratio, config.peakiness, config.token_rate, seed);
+}
+
+std::unique_ptr<zctc::Decoder>
+make_decoder(const BenchConfig& config, const std::vector<std::string>& vocab, int beam_width, int cutoff_top_n,
+			 bool use_lm, bool use_lexicon, int thread_count = 1,
+			 zctc::AdaptiveMeasure adaptive = zctc::AdaptiveMeasure::NONE, const std::string& worker_cpus = "")
+{
+	std::string lm_path(config.lm_path), lexicon_path(config.lexicon_path);
+	cutoff_top_n = std::min(cutoff_top_n, static_cast<int>(vocab.size()));
+
+	// NOTE: Same adaptive defaults as the Python decoder.
+	return std::make_unique<zctc::Decoder>(
+		thread_count, 0, cutoff_top_n, apostrophe_id(vocab), 1.0, 0.5, 1.0, beam_width, -5.0, -20.0, -20.0, '#', vocab,
+		use_lm ? lm_path.data() : nullptr, use_lexicon ? lexicon_path.data() : nullptr, nullptr, false, adaptive,
+		std::max(1, beam_width / 4), std::max(1, cutoff_top_n / 4),
+		(adaptive == zctc::AdaptiveMeasure::ENTROPY) ? 1.0f : 0.5f, zctc::LmLoadMethod::POPULATE_OR_READ, false,
+		false, 32, 1.0, worker_cpus);
+}
+
+/**
+ * @brief Fills `reader` with `beam_width` nodes extended from `root` at
+ * 		  timestep 0 and scored, as the reader of the next timestep would be.
+ */
+void
+build_beam(const zctc::Decoder& decoder, zctc::Node<float>& root, std::vector<zctc::Node<float>*>& reader,
+		   int beam_width, std::mt19937& rng, fst::StdVectorFst* hotwords_fst)
+{
+	int span = decoder.vocab_size - 2;
+	std::vector<zctc::Node<float>*> writer, more_confident_repeats, setup_reader;
+	std::uniform_real_distribution<float> dist { 0.01f, 1.0f };
+	fst::SortedMatcher<fst::StdVectorFst> lexicon_matcher(decoder.ext_scorer.lexicon, fst::MATCH_INPUT);
+	fst::SortedMatcher<fst::StdVectorFst> hotwords_matcher(hotwords_fst, fst::MATCH_INPUT);
+
+	decoder.ext_scorer.initialise_start_states(&root, hotwords_fst);
+
+	/**
+	 * NOTE: The first `span` nodes are the childs of the root, every next
+	 * 		 level extends one node of the previous level, shifting the
+	 * 		 ids by one so no node repeats its parent's id.
+	 */
+	for (int i = 0; i < beam_width; i++) {
+		zctc::Node<float>* parent = i < span ? &root : writer[i - span];
+		int id = 2 + ((i + i / span) % span);
+		zctc::Node<float>* child = parent->extend_path(id, 0, dist(rng), decoder.vocab[id], writer, setup_reader);
+
+		if (child)
+			decoder.ext_scorer.run_ext_scoring(child, &lexicon_matcher, hotwords_fst, &hotwords_matcher);
+	}
+
+	for (zctc::Node<float>* node : writer)
+		node->update_score(0, more_confident_repeats);
+
+	reader.assign(writer.begin(), writer.end());
+}
+
+/**
+ * @brief Extends every reader node with the `cutoff_top_n` candidates of
+ * 		  timestep 1, collecting the newly created childs.
+ */
+long
+expand(const zctc::Decoder& decoder, std::vector<zctc::Node<float>*>& reader, std::vector<zctc::Node<float>*>& writer,
+	   std::vector<zctc::Node<float>*>& created, const std::vector<int>& candidates, const std::vector<float>& probs)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	for (std::size_t i = 0; i < candidates.size(); i++) {
+		for (zctc::Node<float>* r_node : reader) {
+			zctc::Node<float>* child
+				= r_node->extend_path(candidates[i], 1, probs[i], decoder.vocab[candidates[i]], writer, reader);
+			if (child)
+				created.emplace_back(child);
+		}
+	}
+
+	return elapsed_ns<std::chrono::steady_clock>(start);
+}
+
+void
+draw_candidates(std::mt19937& rng, int vocab_size, int cutoff_top_n, std::vector<int>& candidates,
+				std::vector<float>& probs)
+{
+	std::vector<int> ids(vocab_size - 2);
+	std::iota(ids.begin(), ids.end(), 2);
+	std::shuffle(ids.begin(), ids.end(), rng);
+
+	std::uniform_real_distribution<float> dist { 0.001f, 0.5f };
+	candidates.assign(ids.begin(), ids.begin() + std::min(cutoff_top_n, vocab_size - 2));
+	probs.resize(candidates.size());
+	for (float& prob : probs)
+		prob = dist(rng);
+	std::sort(probs.begin(), probs.end(), std::greater<float>());
+}
+
+fst::StdVectorFst*
+random_hotwords_fst(const zctc::Decoder& decoder, std::mt19937& rng, int count)
+{
+	std::vector<std::vector<int>> hotwords;
+	std::vector<float> weights;
+	std::uniform_int_distribution<int> len_dist { 1, 5 }, id_dist { 2, decoder.vocab_size - 1 };
+
+	for (int i = 0; i < count; i++) {
+		std::vector<int> hotword(len_dist(rng));
+		for (int& id : hotword)
+			id = id_dist(rng);
+
+		hotwords.emplace_back(hotword);
+		weights.emplace_back(5.0f);
+	}
+
+	return decoder.generate_hw_fst(hotwords, weights, nullptr);
+}
+
+std::vector<std::string>
+bench_vocab(const BenchConfig& config, int vocab_size)
+{
+	return config.vocab_path.empty() ? synthetic_vocab(vocab_size) : load_vocab(config.vocab_path);
+}
+
+std::vector<int>
+bench_vocab_sizes(const BenchConfig& config)
+{
+	// NOTE: A provided vocab fixes the vocab size, so there's nothing to sweep.
+	return config.vocab_path.empty() ? config.vocab_sizes : std::vector<int> { 0 };
+}
+
+void
+bench_extend_path(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int beam_width : config.beam_widths) {
+			for (int cutoff_top_n : config.cutoff_top_ns) {
+				std::mt19937 rng(config.seed);
+				auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, false, false);
+				long items = 0;
+
+				Timing timing = measure(config, [&]() {
+					zctc::Node<float> root(zctc::ROOT_ID, -1, 0.0, "<s>", nullptr);
+					std::vector<zctc::Node<float>*> reader, writer, created;
+					std::vector<int> candidates;
+					std::vector<float> probs;
+
+					build_beam(*decoder, root, reader, beam_width, rng, nullptr);
+					draw_candidates(rng, decoder->vocab_size, cutoff_top_n, candidates, probs);
+					items = candidates.size() * reader.size();
+
+					return expand(*decoder, reader, writer, created, candidates, probs);
+				});
+
+				reporter.emit("extend_path",
+							  { { "vocab_size", std::to_string(vocab.size()) },
+								{ "beam_width", std::to_string(beam_width) },
+								{ "cutoff_top_n", std::to_string(cutoff_top_n) } },
+							  timing, items);
+			}
+		}
+	}
+}
+
+void
+bench_update_score(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int beam_width : config.beam_widths) {
+			for (int cutoff_top_n : config.cutoff_top_ns) {
+				// NOTE: Without `simd` the nodes are scored one by one, else together as in decode.
+				for (int simd = 0; simd < 2; simd++) {
+					std::mt19937 rng(config.seed);
+					auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, false, false);
+					zctc::ScoreBatch<float> score_batch;
+					long items = 0;
+
+					Timing timing = measure(config, [&]() {
+						zctc::Node<float> root(zctc::ROOT_ID, -1, 0.0, "<s>", nullptr);
+						std::vector<zctc::Node<float>*> reader, writer, created, more_confident_repeats;
+						std::vector<int> candidates;
+						std::vector<float> probs;
+
+						build_beam(*decoder, root, reader, beam_width, rng, nullptr);
+						draw_candidates(rng, decoder->vocab_size, cutoff_top_n, candidates, probs);
+						expand(*decoder, reader, writer, created, candidates, probs);
+						items = writer.size();
+
+						auto start = std::chrono::steady_clock::now();
+						if (simd) {
+							score_batch.update(writer, 1, more_confident_repeats);
+						} else {
+							for (zctc::Node<float>* w_node : writer)
+								w_node->update_score(1, more_confident_repeats);
+						}
+
+						return elapsed_ns<std::chrono::steady_clock>(start);
+					});
+
+					reporter.emit("update_score",
+								  { { "vocab_size", std::to_string(vocab.size()) },
+									{ "beam_width", std::to_string(beam_width) },
+									{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+									{ "simd", simd ? "true" : "false" } },
+								  timing, items);
+				}
+			}
+		}
+	}
+}
+
+void
+bench_ext_scoring(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int use_lm = 0; use_lm < 2; use_lm++) {
+			for (int use_lexicon = 0; use_lexicon < 2; use_lexicon++) {
+				if ((use_lm && config.lm_path.empty()) || (use_lexicon && config.lexicon_path.empty()))
+					continue;
+
+				for (int use_hotwords = 0; use_hotwords < 2; use_hotwords++) {
+					for (int beam_width : config.beam_widths) {
+						std::mt19937 rng(config.seed);
+						int cutoff_top_n = config.cutoff_top_ns.back();
+						auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, use_lm, use_lexicon);
+						fst::StdVectorFst* hotwords_fst = use_hotwords ? random_hotwords_fst(*decoder, rng, 100)
+																	   : nullptr;
+						long items = 0;
+
+						Timing timing = measure(config, [&]() {
+							zctc::Node<float> root(zctc::ROOT_ID, -1, 0.0, "<s>", nullptr);
+							std::vector<zctc::Node<float>*> reader, writer, created;
+							std::vector<int> candidates;
+							std::vector<float> probs;
+							fst::SortedMatcher<fst::StdVectorFst> lexicon_matcher(decoder->ext_scorer.lexicon,
+																				  fst::MATCH_INPUT);
+							fst::SortedMatcher<fst::StdVectorFst> hotwords_matcher(hotwords_fst, fst::MATCH_INPUT);
+
+							build_beam(*decoder, root, reader, beam_width, rng, hotwords_fst);
+							draw_candidates(rng, decoder->vocab_size, cutoff_top_n, candidates, probs);
+							expand(*decoder, reader, writer, created, candidates, probs);
+							items = created.size();
+
+							auto start = std::chrono::steady_clock::now();
+							for (zctc::Node<float>* child : created)
+								decoder->ext_scorer.run_ext_scoring(child, &lexicon_matcher, hotwords_fst,
+																	&hotwords_matcher);
+
+							return elapsed_ns<std::chrono::steady_clock>(start);
+						});
+
+						reporter.emit("ext_scoring",
+									  { { "vocab_size", std::to_string(vocab.size()) },
+										{ "beam_width", std::to_string(beam_width) },
+										{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+										{ "lm", use_lm ? "true" : "false" },
+										{ "lexicon", use_lexicon ? "true" : "false" },
+										{ "hotwords", use_hotwords ? "true" : "false" } },
+									  timing, items);
+
+						delete hotwords_fst;
+					}
+				}
+			}
+		}
+	}
+}
+
+void
+bench_populate_hotword_fst(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int count : config.hotword_counts) {
+			std::mt19937 rng(config.seed);
+			std::uniform_int_distribution<int> len_dist { 1, 5 }, id_dist { 2, static_cast<int>(vocab.size()) - 1 };
+
+			Timing timing = measure(config, [&]() {
+				std::vector<std::vector<int>> hotwords;
+				std::vector<float> weights;
+				for (int i = 0; i < count; i++) {
+					std::vector<int> hotword(len_dist(rng));
+					for (int& id : hotword)
+						id = id_dist(rng);
+
+					hotwords.emplace_back(hotword);
+					weights.emplace_back(5.0f);
+				}
+
+				fst::StdVectorFst hotwords_fst;
+				auto start = std::chrono::steady_clock::now();
+				zctc::populate_hotword_fst(&hotwords_fst, hotwords, weights);
+
+				return elapsed_ns<std::chrono::steady_clock>(start);
+			});
+
+			reporter.emit("populate_hotword_fst",
+						  { { "vocab_size", std::to_string(vocab.size()) }, { "hotwords", std::to_string(count) } },
+						  timing, count);
+		}
+	}
+}
+
+void
+bench_decode(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int seq_len : config.seq_lens) {
+			zctc::SyntheticCTC generator = make_generator(config, vocab.size(), config.seed);
+			std::vector<float> logits(static_cast<std::size_t>(seq_len) * vocab.size());
+			std::vector<int> ids(logits.size());
+			generator.generate(seq_len, logits.data(), ids.data());
+
+			for (int beam_width : config.beam_widths) {
+				for (int cutoff_top_n : config.cutoff_top_ns) {
+					for (int fast_math = 0; fast_math < 2; fast_math++) {
+						auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, !config.lm_path.empty(),
+													!config.lexicon_path.empty());
+						std::vector<int> labels(static_cast<std::size_t>(beam_width) * seq_len);
+						std::vector<int> timesteps(labels.size());
+						std::vector<int> seq_pos(beam_width);
+
+						Timing timing = measure(config, [&]() {
+							auto start = std::chrono::steady_clock::now();
+							if (fast_math)
+								zctc::decode<float*, float, zctc::FastMath>(decoder.get(), logits.data(), ids.data(),
+																			 labels.data(), timesteps.data(), seq_len,
+																			 seq_len, seq_pos.data(), nullptr);
+							else
+								zctc::decode(decoder.get(), logits.data(), ids.data(), labels.data(), timesteps.data(),
+											 seq_len, seq_len, seq_pos.data(), nullptr);
+
+							return elapsed_ns<std::chrono::steady_clock>(start);
+						});
+
+						reporter.emit("decode",
+									  { { "vocab_size", std::to_string(vocab.size()) },
+										{ "seq_len", std::to_string(seq_len) },
+										{ "beam_width", std::to_string(beam_width) },
+										{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+										{ "lm", config.lm_path.empty() ? "false" : "true" },
+										{ "lexicon", config.lexicon_path.empty() ? "false" : "true" },
+										{ "fast_math", fast_math ? "true" : "false" } },
+									  timing, seq_len);
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Quantizes the probabilities of every frame to int8 log probabilities,
+ * 		  with the frame's scale and offset spanning its log probability range,
+ * 		  floored at `min_log_prob`.
+ */
+void
+quantize_frames(const float* probs, int seq_len, int vocab_size, float min_log_prob, std::int8_t* values,
+				float* scales, float* offsets)
+{
+	std::vector<float> log_probs(vocab_size);
+
+	for (int t = 0; t < seq_len; t++) {
+		const float* frame = probs + static_cast<std::size_t>(t) * vocab_size;
+		std::int8_t* frame_values = values + static_cast<std::size_t>(t) * vocab_size;
+
+		for (int v = 0; v < vocab_size; v++)
+			log_probs[v] = std::max(std::log(frame[v]), min_log_prob);
+
+		auto [min_lp, max_lp] = std::minmax_element(log_probs.begin(), log_probs.end());
+		scales[t] = std::max((*max_lp - *min_lp) / 254.0f, 1e-6f);
+		offsets[t] = (*max_lp + *min_lp) / 2.0f;
+
+		for (int v = 0; v < vocab_size; v++)
+			frame_values[v] = static_cast<std::int8_t>(std::lround((log_probs[v] - offsets[t]) / scales[t]));
+	}
+}
+
+/**
+ * @brief `zctc::decode` of the same utterance from float32 probabilities and
+ * 		  from their per frame int8 quantized log probabilities, reporting the
+ * 		  input bytes per frame and, for int8, the fraction of the beams which
+ * 		  decoded the same as float32. Neither is given the sorted ids, so
+ * 		  both include ranking the candidates of every frame, in float32 and
+ * 		  on the int8 values respectively.
+ */
+void
+bench_quantized(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int seq_len : config.seq_lens) {
+			zctc::SyntheticCTC generator = make_generator(config, vocab.size(), config.seed);
+			std::vector<float> logits(static_cast<std::size_t>(seq_len) * vocab.size());
+			std::vector<int> ids(logits.size());
+			generator.generate(seq_len, logits.data(), ids.data());
+
+			std::vector<std::int8_t> values(logits.size());
+			std::vector<float> scales(seq_len), offsets(seq_len);
+			quantize_frames(logits.data(), seq_len, vocab.size(), -30.0f, values.data(), scales.data(), offsets.data());
+			zctc::QuantizedLogits quantized { values.data(), scales.data(), offsets.data(), true };
+
+			for (int beam_width : config.beam_widths) {
+				for (int cutoff_top_n : config.cutoff_top_ns) {
+					auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, !config.lm_path.empty(),
+												!config.lexicon_path.empty());
+					std::vector<int> labels(static_cast<std::size_t>(beam_width) * seq_len);
+					std::vector<int> timesteps(labels.size()), q_labels(labels.size()), q_timesteps(labels.size());
+					std::vector<int> seq_pos(beam_width), q_seq_pos(beam_width);
+
+					Timing timing = measure(config, [&]() {
+						auto start = std::chrono::steady_clock::now();
+						zctc::decode(decoder.get(), logits.data(), nullptr, labels.data(), timesteps.data(), seq_len,
+									 seq_len, seq_pos.data(), nullptr);
+
+						return elapsed_ns<std::chrono::steady_clock>(start);
+					});
+					Timing q_timing = measure(config, [&]() {
+						auto start = std::chrono::steady_clock::now();
+						zctc::decode(decoder.get(), quantized, nullptr, q_labels.data(), q_timesteps.data(), seq_len,
+									 seq_len, q_seq_pos.data(), nullptr);
+
+						return elapsed_ns<std::chrono::steady_clock>(start);
+					});
+
+					auto beam_matches = [&](int b) {
+						auto beam = labels.begin() + static_cast<std::size_t>(b) * seq_len;
+						auto q_beam = q_labels.begin() + static_cast<std::size_t>(b) * seq_len;
+						return (seq_pos[b] == q_seq_pos[b])
+							&& std::equal(beam + seq_pos[b], beam + seq_len, q_beam + q_seq_pos[b]);
+					};
+					int matched = 0;
+					for (int b = 0; b < beam_width; b++)
+						matched += beam_matches(b);
+
+					Params params = { { "vocab_size", std::to_string(vocab.size()) },
+									  { "seq_len", std::to_string(seq_len) },
+									  { "beam_width", std::to_string(beam_width) },
+									  { "cutoff_top_n", std::to_string(cutoff_top_n) } };
+
+					params.emplace_back("input", "\"float32\"");
+					reporter.emit("quantized", params, timing, seq_len,
+								  { { "bytes_per_frame", std::to_string(vocab.size() * sizeof(float)) } });
+
+					params.back().second = "\"int8\"";
+					reporter.emit("quantized", params, q_timing, seq_len,
+								  { { "bytes_per_frame", std::to_string(vocab.size() + 2 * sizeof(float)) },
+									{ "top_beam_match", beam_matches(0) ? "true" : "false" },
+									{ "beam_match_ratio", std::to_string(static_cast<double>(matched) / beam_width) } });
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief `zctc::decode` of the same utterance with the fixed and with the
+ * 		  entropy and margin adaptive budgets, reporting the frames narrowed
+ * 		  and the beam width and candidates saved per frame by the adaptive
+ * 		  budgets, and whether their top beam decoded the same as the fixed.
+ */
+void
+bench_adaptive(const BenchConfig& config, Reporter& reporter)
+{
+	const std::pair<zctc::AdaptiveMeasure, const char*> measures[]
+		= { { zctc::AdaptiveMeasure::NONE, "\"none\"" },
+			{ zctc::AdaptiveMeasure::ENTROPY, "\"entropy\"" },
+			{ zctc::AdaptiveMeasure::MARGIN, "\"margin\"" } };
+
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int seq_len : config.seq_lens) {
+			zctc::SyntheticCTC generator = make_generator(config, vocab.size(), config.seed);
+			std::vector<float> logits(static_cast<std::size_t>(seq_len) * vocab.size());
+			std::vector<int> ids(logits.size());
+			generator.generate(seq_len, logits.data(), ids.data());
+
+			for (int beam_width : config.beam_widths) {
+				for (int cutoff_top_n : config.cutoff_top_ns) {
+					std::vector<int> fixed_top;
+
+					for (const auto& [adaptive, name] : measures) {
+						auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, !config.lm_path.empty(),
+													!config.lexicon_path.empty(), 1, adaptive);
+						std::vector<int> labels(static_cast<std::size_t>(beam_width) * seq_len);
+						std::vector<int> timesteps(labels.size());
+						std::vector<int> seq_pos(beam_width);
+						zctc::DecodeStats stats;
+
+						Timing timing = measure(config, [&]() {
+							stats = zctc::DecodeStats();
+							auto start = std::chrono::steady_clock::now();
+							zctc::decode(decoder.get(), logits.data(), ids.data(), labels.data(), timesteps.data(),
+										 seq_len, seq_len, seq_pos.data(), nullptr, &stats);
+
+							return elapsed_ns<std::chrono::steady_clock>(start);
+						});
+
+						std::vector<int> top(labels.begin() + seq_pos[0], labels.begin() + seq_len);
+						if (adaptive == zctc::AdaptiveMeasure::NONE)
+							fixed_top = top;
+
+						reporter.emit("adaptive",
+									  { { "vocab_size", std::to_string(vocab.size()) },
+										{ "seq_len", std::to_string(seq_len) },
+										{ "beam_width", std::to_string(beam_width) },
+										{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+										{ "measure", name } },
+									  timing, seq_len,
+									  { { "narrowed_frames", std::to_string(stats.narrowed_frames) },
+										{ "beam_width_saved_per_frame",
+										  std::to_string(static_cast<double>(stats.beam_width_saved) / seq_len) },
+										{ "cutoff_top_n_saved_per_frame",
+										  std::to_string(static_cast<double>(stats.cutoff_top_n_saved) / seq_len) },
+										{ "nodes_created", std::to_string(stats.nodes_created) },
+										{ "top_beam_match", (top == fixed_top) ? "true" : "false" } });
+					}
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief `zctc::greedy_decode` of an utterance against `zctc::decode` with a
+ * 		  beam width of 1, neither given the sorted ids, reporting the rate at
+ * 		  which the greedy decode reads the logits and whether both decoded
+ * 		  the same labels.
+ */
+void
+bench_greedy(const BenchConfig& config, Reporter& reporter)
+{
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+
+		for (int seq_len : config.seq_lens) {
+			zctc::SyntheticCTC generator = make_generator(config, vocab.size(), config.seed);
+			std::vector<float> logits(static_cast<std::size_t>(seq_len) * vocab.size());
+			std::vector<int> ids(logits.size());
+			generator.generate(seq_len, logits.data(), ids.data(), 1);
+
+			auto decoder = make_decoder(config, vocab, 1, 1, false, false);
+			std::vector<int> labels(seq_len), timesteps(seq_len), g_labels(seq_len), g_timesteps(seq_len);
+			int seq_pos = 0, g_seq_pos = 0;
+
+			Timing timing = measure(config, [&]() {
+				auto start = std::chrono::steady_clock::now();
+				zctc::decode(decoder.get(), logits.data(), nullptr, labels.data(), timesteps.data(), seq_len, seq_len,
+							 &seq_pos, nullptr);
+
+				return elapsed_ns<std::chrono::steady_clock>(start);
+			});
+			Timing g_timing = measure(config, [&]() {
+				auto start = std::chrono::steady_clock::now();
+				zctc::greedy_decode(logits.data(), decoder->vocab_size, decoder->blank_id, g_labels.data(),
+									g_timesteps.data(), seq_len, seq_len, &g_seq_pos);
+
+				return elapsed_ns<std::chrono::steady_clock>(start);
+			});
+
+			bool matched = (seq_pos == g_seq_pos)
+				&& std::equal(labels.begin() + seq_pos, labels.end(), g_labels.begin() + g_seq_pos);
+			double bytes = static_cast<double>(logits.size()) * sizeof(float);
+
+			Params params = { { "vocab_size", std::to_string(vocab.size()) },
+							  { "seq_len", std::to_string(seq_len) } };
+
+			params.emplace_back("decoder", "\"beam\"");
+			reporter.emit("greedy", params, timing, seq_len,
+						  { { "gb_per_sec", std::to_string(bytes / timing.percentile(0.5)) } });
+			params.back().second = "\"greedy\"";
+			reporter.emit("greedy", params, g_timing, seq_len,
+						  { { "gb_per_sec", std::to_string(bytes / g_timing.percentile(0.5)) },
+							{ "top_beam_match", matched ? "true" : "false" } });
+		}
+	}
+}
+
+/**
+ * @brief Samples the lengths of the utterances of the throughput dataset,
+ * 		  between the smallest and largest `seq_lens`.
+ */
+std::vector<int>
+dataset_lens(const BenchConfig& config, int vocab_size)
+{
+	auto [min_len, max_len] = std::minmax_element(config.seq_lens.begin(), config.seq_lens.end());
+	std::vector<int> utt_lens(config.utterances);
+	zctc::SyntheticCTC len_generator = make_generator(config, vocab_size, config.seed);
+	for (int& len : utt_lens)
+		len = len_generator.sample_seq_len(*min_len, *max_len);
+
+	return utt_lens;
+}
+
+/**
+ * @brief Decodes the dataset of the provided utterance lengths with
+ * 		  `batch_decode`, `warmup + repeats` times, in batches of
+ * 		  `batch_size`, keeping the latency of every batch of the repeats.
+ */
+Timing
+decode_dataset(const BenchConfig& config, const zctc::Decoder& decoder, const std::vector<int>& utt_lens,
+			   int batch_size)
+{
+	int beam_width = decoder.beam_width, cutoff_top_n = decoder.cutoff_top_n, vocab_size = decoder.vocab_size;
+	std::vector<std::vector<int>> hotwords_id;
+	std::vector<float> hotwords_weight;
+	Timing timing;
+
+	for (int pass = 0; pass < config.warmup + config.repeats; pass++) {
+		for (int first = 0; first < config.utterances; first += batch_size) {
+			/**
+			 * NOTE: Every utterance is generated from its own seed,
+			 * 		 so the dataset is the same for every sweep point.
+			 */
+			int size = std::min(batch_size, config.utterances - first);
+			int max_seq_len = *std::max_element(utt_lens.begin() + first, utt_lens.begin() + first + size);
+			std::size_t frame_stride = static_cast<std::size_t>(max_seq_len) * vocab_size;
+
+			std::vector<float> logits(size * frame_stride, 0.0f);
+			std::vector<int> ids(logits.size(), 0);
+			std::vector<int> labels(static_cast<std::size_t>(size) * beam_width * max_seq_len);
+			std::vector<int> timesteps(labels.size());
+			std::vector<int> seq_pos(static_cast<std::size_t>(size) * beam_width);
+			std::vector<int> seq_lens(utt_lens.begin() + first, utt_lens.begin() + first + size);
+
+			for (int i = 0; i < size; i++) {
+				zctc::SyntheticCTC generator = make_generator(config, vocab_size, config.seed + first + i);
+				generator.generate(seq_lens[i], logits.data() + i * frame_stride, ids.data() + i * frame_stride,
+								   cutoff_top_n);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			decoder.batch_decode(logits.data(), ids.data(), labels.data(), timesteps.data(), seq_lens.data(),
+								 seq_pos.data(), size, max_seq_len, hotwords_id, hotwords_weight, nullptr);
+			long ns = elapsed_ns<std::chrono::steady_clock>(start);
+
+			if (pass >= config.warmup)
+				timing.samples.emplace_back(ns);
+		}
+	}
+
+	return timing;
+}
+
+/**
+ * @brief End to end throughput of `batch_decode` over a synthetic dataset of
+ * 		  `utterances` utterances, with lengths between the smallest and
+ * 		  largest `seq_lens`. The dataset is decoded `repeats` times for every
+ * 		  batch size and thread count, reporting the per batch latency, the real
+ * 		  time factor assuming `frame_ms` per frame, the utterances per second
+ * 		  and the speedup over the first thread count of the sweep.
+ */
+void
+bench_throughput(const BenchConfig& config, Reporter& reporter)
+{
+	int beam_width = config.beam_widths.back(), cutoff_top_n = config.cutoff_top_ns.back();
+
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+		std::vector<int> utt_lens = dataset_lens(config, vocab.size());
+		long total_frames = std::accumulate(utt_lens.begin(), utt_lens.end(), 0L);
+
+		for (int batch_size : config.batch_sizes) {
+			double base_throughput = 0;
+
+			for (int thread_count : config.thread_counts) {
+				auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, !config.lm_path.empty(),
+											!config.lexicon_path.empty(), thread_count);
+				Timing timing = decode_dataset(config, *decoder, utt_lens, batch_size);
+
+				double decode_s = std::accumulate(timing.samples.begin(), timing.samples.end(), 0L) / 1e9;
+				double audio_s = config.repeats * total_frames * config.frame_ms / 1e3;
+				double throughput = config.repeats * config.utterances / decode_s;
+				if (base_throughput == 0)
+					base_throughput = throughput;
+
+				reporter.emit("throughput",
+							  { { "vocab_size", std::to_string(vocab.size()) },
+								{ "beam_width", std::to_string(beam_width) },
+								{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+								{ "batch_size", std::to_string(batch_size) },
+								{ "thread_count", std::to_string(thread_count) },
+								{ "utterances", std::to_string(config.utterances) },
+								{ "blank_ratio", std::to_string(config.blank_ratio) },
+								{ "peakiness", std::to_string(config.peakiness) },
+								{ "token_rate", std::to_string(config.token_rate) } },
+							  timing, batch_size,
+							  { { "p50_latency_ns", std::to_string(timing.percentile(0.5)) },
+								{ "p99_latency_ns", std::to_string(timing.percentile(0.99)) },
+								{ "rtf", std::to_string(decode_s / audio_s) },
+								{ "utterances_per_sec", std::to_string(throughput) },
+								{ "speedup", std::to_string(throughput / base_throughput) },
+								{ "scaling_efficiency",
+								  std::to_string(throughput / base_throughput * config.thread_counts.front()
+												 / thread_count) } });
+			}
+		}
+	}
+}
+
+/**
+ * @brief Orders the CPUs for the workers to take, either filling one NUMA node
+ * 		  before the next ("compact"), which keeps the workers close to the LM
+ * 		  until a node runs out of CPUs, or alternating between the nodes
+ * 		  ("spread"), which uses the memory bandwidth of every node.
+ */
+std::vector<int>
+order_cpus(const std::vector<int>& cpus, bool spread)
+{
+	std::map<int, std::vector<int>> nodes;
+	for (int cpu : cpus)
+		nodes[zctc::cpu_numa_node(cpu)].emplace_back(cpu);
+
+	std::vector<int> ordered;
+	for (std::size_t i = 0; ordered.size() < cpus.size(); i++) {
+		for (const auto& [node, node_cpus] : nodes) {
+			if (spread && i < node_cpus.size())
+				ordered.emplace_back(node_cpus[i]);
+			else if (!spread && i == 0)
+				ordered.insert(ordered.end(), node_cpus.begin(), node_cpus.end());
+		}
+	}
+
+	return ordered;
+}
+
+std::string
+join_cpus(const std::vector<int>& cpus)
+{
+	std::string cpu_list;
+	for (int cpu : cpus)
+		cpu_list += (cpu_list.empty() ? "" : ",") + std::to_string(cpu);
+
+	return cpu_list;
+}
+
+/**
+ * @brief Throughput of the same dataset as `bench_throughput`, with the
+ * 		  workers floating across the `worker_cpus` CPU set, or the CPUs the
+ * 		  process is allowed to run on if not set, and with the workers
+ * 		  pinned to its CPUs in the compact and in the spread order. Reports
+ * 		  the NUMA nodes the workers span and the speedup over the floating
+ * 		  workers. A CPU set within one node, or a `taskset` of the benchmark,
+ * 		  simulates a smaller machine on a single node one.
+ */
+void
+bench_affinity(const BenchConfig& config, Reporter& reporter)
+{
+	int beam_width = config.beam_widths.back(), cutoff_top_n = config.cutoff_top_ns.back();
+	int batch_size = config.batch_sizes.back();
+	std::vector<int> cpus = config.worker_cpus.empty() ? zctc::allowed_cpus()
+													   : zctc::parse_cpu_list(config.worker_cpus);
+	const std::pair<const char*, std::vector<int>> placements[] = { { "\"floating\"", {} },
+																	 { "\"compact\"", order_cpus(cpus, false) },
+																	 { "\"spread\"", order_cpus(cpus, true) } };
+
+	/**
+	 * NOTE: The floating workers are confined to the CPU set like the pinned
+	 * 		 ones, as the workers inherit the affinity of the thread creating
+	 * 		 them, so only the placement within the set differs between them.
+	 * 		 The benchmark's own affinity is restored for the next benchmarks.
+	 */
+	cpu_set_t set, original;
+	sched_getaffinity(0, sizeof(original), &original);
+	CPU_ZERO(&set);
+	for (int cpu : cpus)
+		CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) != 0)
+		throw std::runtime_error("Cannot confine the benchmark to the CPUs " + join_cpus(cpus));
+
+	for (int vocab_size : bench_vocab_sizes(config)) {
+		std::vector<std::string> vocab = bench_vocab(config, vocab_size);
+		std::vector<int> utt_lens = dataset_lens(config, vocab.size());
+
+		for (int thread_count : config.thread_counts) {
+			double base_throughput = 0;
+
+			for (const auto& [placement, ordered] : placements) {
+				auto decoder = make_decoder(config, vocab, beam_width, cutoff_top_n, !config.lm_path.empty(),
+											!config.lexicon_path.empty(), thread_count, zctc::AdaptiveMeasure::NONE,
+											join_cpus(ordered));
+				Timing timing = decode_dataset(config, *decoder, utt_lens, batch_size);
+
+				double decode_s = std::accumulate(timing.samples.begin(), timing.samples.end(), 0L) / 1e9;
+				double throughput = config.repeats * config.utterances / decode_s;
+				if (base_throughput == 0)
+					base_throughput = throughput;
+
+				std::set<int> nodes;
+				for (int cpu : decoder->worker_cpus.empty() ? cpus : decoder->worker_cpus)
+					nodes.insert(zctc::cpu_numa_node(cpu));
+
+				reporter.emit("affinity",
+							  { { "vocab_size", std::to_string(vocab.size()) },
+								{ "beam_width", std::to_string(beam_width) },
+								{ "cutoff_top_n", std::to_string(cutoff_top_n) },
+								{ "batch_size", std::to_string(batch_size) },
+								{ "thread_count", std::to_string(thread_count) },
+								{ "cpus", std::to_string(cpus.size()) },
+								{ "placement", placement } },
+							  timing, batch_size,
+							  { { "numa_nodes", std::to_string(nodes.size()) },
+								{ "utterances_per_sec", std::to_string(throughput) },
+								{ "speedup", std::to_string(throughput / base_throughput) } });
+			}
+		}
+	}
+
+	sched_setaffinity(0, sizeof(original), &original);
+}
+
+std::vector<std::string>
+parse_str_list(const std::string& value)
+{
+	std::vector<std::string> values;
+	std::stringstream ss(value);
+	std::string item;
+
+	while (std::getline(ss, item, ','))
+		values.emplace_back(item);
+
+	return values;
+}
+
+void
+print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " [options]\n"
+			  << "  --bench LIST           benchmarks to run (extend_path,update_score,ext_scoring,\n"
+			  << "                         populate_hotword_fst,decode,quantized,adaptive,greedy,throughput,\n"
+			  << "                         affinity)\n"
+			  << "  --beam-widths LIST     beam widths to sweep (default 8,32,128)\n"
+			  << "  --cutoff-top-n LIST    candidate cutoffs to sweep (default 10,40)\n"
+			  << "  --vocab-sizes LIST     synthetic vocab sizes to sweep (default 128,1024)\n"
+			  << "  --seq-lens LIST        sequence lengths to sweep (default 100,1000)\n"
+			  << "  --hotword-counts LIST  hotword counts to sweep (default 10,100,1000)\n"
+			  << "  --thread-counts LIST   decoder threads to sweep for throughput (default 1,2,4,8)\n"
+			  << "  --batch-sizes LIST     batch sizes to sweep for throughput (default 1,8,32)\n"
+			  << "  --worker-cpus LIST     CPU set of the affinity benchmark, as taskset -c (default allowed CPUs)\n"
+			  << "  --utterances N         utterances of the throughput dataset (default 32)\n"
+			  << "  --blank-ratio F        synthetic fraction of blank frames (default 0.7)\n"
+			  << "  --peakiness F          synthetic mean top token probability (default 0.9)\n"
+			  << "  --token-rate F         synthetic tokens emitted per frame (default 0.1)\n"
+			  << "  --frame-ms F           frame shift used for the real time factor (default 40)\n"
+			  << "  --warmup N             untimed runs per benchmark (default 2)\n"
+			  << "  --repeats N            timed runs per benchmark (default 10)\n"
+			  << "  --seed N               random seed (default 0)\n"
+			  << "  --vocab PATH           vocab file, replaces the synthetic vocab\n"
+			  << "  --lm PATH              KenLM model for the LM variants\n"
+			  << "  --lexicon PATH         lexicon FST for the lexicon variants\n"
+			  << "  --output PATH          write JSON lines here instead of stdout\n";
+}
+
+int
+main(int argc, char** argv)
+{
+	BenchConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--bench")
+			config.benches = parse_str_list(value);
+		else if (arg == "--beam-widths")
+			config.beam_widths = parse_int_list(value);
+		else if (arg == "--cutoff-top-n")
+			config.cutoff_top_ns = parse_int_list(value);
+		else if (arg == "--vocab-sizes")
+			config.vocab_sizes = parse_int_list(value);
+		else if (arg == "--seq-lens")
+			config.seq_lens = parse_int_list(value);
+		else if (arg == "--hotword-counts")
+			config.hotword_counts = parse_int_list(value);
+		else if (arg == "--thread-counts")
+			config.thread_counts = parse_int_list(value);
+		else if (arg == "--batch-sizes")
+			config.batch_sizes = parse_int_list(value);
+		else if (arg == "--worker-cpus")
+			config.worker_cpus = value;
+		else if (arg == "--utterances")
+			config.utterances = std::stoi(value);
+		else if (arg == "--blank-ratio")
+			config.blank_ratio = std::stof(value);
+		else if (arg == "--peakiness")
+			config.peakiness = std::stof(value);
+		else if (arg == "--token-rate")
+			config.token_rate = std::stof(value);
+		else if (arg == "--frame-ms")
+			config.frame_ms = std::stof(value);
+		else if (arg == "--warmup")
+			config.warmup = std::stoi(value);
+		else if (arg == "--repeats")
+			config.repeats = std::stoi(value);
+		else if (arg == "--seed")
+			config.seed = std::stoul(value);
+		else if (arg == "--vocab")
+			config.vocab_path = value;
+		else if (arg == "--lm")
+			config.lm_path = value;
+		else if (arg == "--lexicon")
+			config.lexicon_path = value;
+		else if (arg == "--output")
+			config.output = value;
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::ofstream file;
+	if (!config.output.empty())
+		file.open(config.output);
+	Reporter reporter(config.output.empty() ? std::cout : file);
+	reporter.build_info();
+
+	for (const std::string& bench : config.benches) {
+		if (bench == "extend_path")
+			bench_extend_path(config, reporter);
+		else if (bench == "update_score")
+			bench_update_score(config, reporter);
+		else if (bench == "ext_scoring")
+			bench_ext_scoring(config, reporter);
+		else if (bench == "populate_hotword_fst")
+			bench_populate_hotword_fst(config, reporter);
+		else if (bench == "decode")
+			bench_decode(config, reporter);
+		else if (bench == "quantized")
+			bench_quantized(config, reporter);
+		else if (bench == "adaptive")
+			bench_adaptive(config, reporter);
+		else if (bench == "greedy")
+			bench_greedy(config, reporter);
+		else if (bench == "throughput")
+			bench_throughput(config, reporter);
+		else if (bench == "affinity")
+			bench_affinity(config, reporter);
+		else {
+			std::cerr << "Unknown benchmark " << bench << std::endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,112 @@
+#ifndef _ZCTC_BIN_COMMON_H
+#define _ZCTC_BIN_COMMON_H
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The helpers shared by the command line tools, for reading their
+ * 		  vocab files, parsing their list options and summarizing latencies.
+ */
+
+std::vector<std::string> load_vocab(const std::string& vocab_path);
+int apostrophe_id(const std::vector<std::string>& vocab);
+
+std::vector<int> parse_int_list(const std::string& value);
+std::vector<float> parse_float_list(const std::string& value);
+
+long percentile(std::vector<long> samples, double p);
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Reads the vocab file, one token per line.
+ *
+ * @param vocab_path The path to the vocab file.
+ *
+ * @return std::vector<std::string> The tokens, in the order of their ids.
+ */
+std::vector<std::string>
+load_vocab(const std::string& vocab_path)
+{
+	std::vector<std::string> vocab;
+	std::ifstream file(vocab_path);
+	if (!file)
+		throw std::runtime_error("Cannot open vocab file from the path provided, " + vocab_path);
+
+	std::string line;
+	while (std::getline(file, line))
+		vocab.emplace_back(line);
+
+	return vocab;
+}
+
+/**
+ * @brief Finds the id of the apostrophe token.
+ *
+ * @param vocab The tokens of the vocab.
+ *
+ * @return int The id of the apostrophe, -1 if the vocab has none.
+ */
+int
+apostrophe_id(const std::vector<std::string>& vocab)
+{
+	auto it = std::find(vocab.begin(), vocab.end(), "'");
+	return it == vocab.end() ? -1 : static_cast<int>(it - vocab.begin());
+}
+
+/**
+ * @brief Parses a comma separated list of integers, as "8,16,32".
+ */
+std::vector<int>
+parse_int_list(const std::string& value)
+{
+	std::vector<int> values;
+	std::stringstream ss(value);
+	std::string item;
+
+	while (std::getline(ss, item, ','))
+		values.emplace_back(std::stoi(item));
+
+	return values;
+}
+
+/**
+ * @brief Parses a comma separated list of floats, as "-5,-10.5".
+ */
+std::vector<float>
+parse_float_list(const std::string& value)
+{
+	std::vector<float> values;
+	std::stringstream ss(value);
+	std::string item;
+
+	while (std::getline(ss, item, ','))
+		values.emplace_back(std::stof(item));
+
+	return values;
+}
+
+/**
+ * @brief Gets the provided percentile of the samples.
+ *
+ * @param samples The samples, in any order.
+ * @param p The percentile, in [0, 1].
+ *
+ * @return long The sample at the percentile, 0 if there are none.
+ */
+long
+percentile(std::vector<long> samples, double p)
+{
+	if (samples.empty())
+		return 0;
+
+	std::sort(samples.begin(), samples.end());
+	return samples[std::min(samples.size() - 1, static_cast<std::size_t>(p * samples.size()))];
+}
+
+#endif // _ZCTC_BIN_COMMON_H
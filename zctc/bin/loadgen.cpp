@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "zctc/protocol.hh"
+#include "zctc/workload.hh"
+
+#include "./common.hh"
+
+/**
+ * @brief Command line configuration of the load generator. Every connection
+ * 		  keeps `pipeline` requests outstanding, sending the next one as soon
+ * 		  as a response arrives, until `requests` are sent in total.
+ */
+struct LoadConfig {
+	int requests = 1000, connections = 8, pipeline = 1, beams = 1;
+	int min_seq_len = 100, max_seq_len = 500, utterances = 64;
+	float blank_ratio = 0.6, peakiness = 0.7, token_rate = 0.2;
+	unsigned int seed = 0;
+	std::string socket_path;
+};
+
+struct Utterance {
+	zctc::protocol::RequestHeader header;
+	std::vector<float> logits;
+};
+
+struct LoadResult {
+	long responses = 0, errors = 0, frames = 0;
+	std::vector<long> latency_ns;
+};
+
+/**
+ * @brief Connects to the server and reads its hello.
+ *
+ * @return int The connected socket.
+ */
+int
+connect_server(const std::string& socket_path, zctc::protocol::ServerHello& hello)
+{
+	sockaddr_un address = zctc::unix_address(socket_path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+		if (fd >= 0)
+			::close(fd);
+		throw std::runtime_error("Cannot connect to " + socket_path + ", " + std::strerror(errno));
+	}
+
+	if (!zctc::read_exact(fd, &hello, sizeof(hello)) || hello.magic != zctc::protocol::MAGIC
+		|| hello.version != zctc::protocol::VERSION) {
+		::close(fd);
+		throw std::runtime_error("Unexpected hello from " + socket_path);
+	}
+
+	return fd;
+}
+
+/**
+ * @brief Generates the utterances sent round robin, before the measurement,
+ * 		  so generating the posteriors isn't part of the measured load.
+ */
+std::vector<Utterance>
+make_utterances(const LoadConfig& config, const zctc::protocol::ServerHello& hello)
+{
+	zctc::SyntheticCTC generator(hello.vocab_size, hello.blank_id, config.blank_ratio, config.peakiness,
+								 config.token_rate, config.seed);
+	std::vector<Utterance> utterances(config.utterances);
+	std::vector<int> ids;
+
+	for (Utterance& utterance : utterances) {
+		int seq_len = generator.sample_seq_len(config.min_seq_len, config.max_seq_len);
+		utterance.header = { zctc::protocol::MAGIC, 0, static_cast<std::uint32_t>(seq_len),
+							 static_cast<std::uint32_t>(config.beams) };
+		utterance.logits.resize(static_cast<std::size_t>(seq_len) * hello.vocab_size);
+		ids.resize(utterance.logits.size());
+		generator.generate(seq_len, utterance.logits.data(), ids.data(), 1);
+	}
+
+	return utterances;
+}
+
+/**
+ * @brief Reads a response, checking its beams are well formed.
+ *
+ * @return bool Whether a response is read, false if the connection is lost.
+ */
+bool
+read_response(int fd, zctc::protocol::ResponseHeader& header, bool& ok)
+{
+	if (!zctc::read_exact(fd, &header, sizeof(header)) || header.magic != zctc::protocol::MAGIC)
+		return false;
+
+	if (header.status != zctc::protocol::OK) {
+		std::string message(header.count, '\0');
+		if (!zctc::read_exact(fd, message.data(), message.size()))
+			return false;
+
+		std::cerr << "Request " << header.id << " failed, " << message << std::endl;
+		ok = false;
+		return true;
+	}
+
+	std::vector<int> beam;
+	for (std::uint32_t b = 0; b < header.count; b++) {
+		std::uint32_t length;
+		if (!zctc::read_exact(fd, &length, sizeof(length)))
+			return false;
+
+		beam.resize(2 * length);
+		if (!zctc::read_exact(fd, beam.data(), beam.size() * sizeof(int)))
+			return false;
+	}
+
+	ok = header.count > 0;
+	return true;
+}
+
+/**
+ * @brief Drives one connection, sending the utterances round robin from
+ * 		  `next` and timing every request from its send to its response.
+ */
+void
+drive_connection(const LoadConfig& config, const std::vector<Utterance>& utterances, std::atomic<int>& next,
+				 LoadResult& result)
+{
+	zctc::protocol::ServerHello hello;
+	int fd = connect_server(config.socket_path, hello);
+
+	std::unordered_map<std::uint32_t, std::chrono::steady_clock::time_point> sent;
+	auto send_next = [&]() {
+		int id = next.fetch_add(1, std::memory_order_relaxed);
+		if (id >= config.requests)
+			return false;
+
+		const Utterance& utterance = utterances[id % utterances.size()];
+		zctc::protocol::RequestHeader header = utterance.header;
+		header.id = id;
+
+		sent[header.id] = std::chrono::steady_clock::now();
+		if (!zctc::write_exact(fd, &header, sizeof(header))
+			|| !zctc::write_exact(fd, utterance.logits.data(), utterance.logits.size() * sizeof(float)))
+			throw std::runtime_error("Lost the connection while sending request " + std::to_string(id));
+
+		result.frames += header.seq_len;
+		return true;
+	};
+
+	for (int i = 0; i < config.pipeline && send_next(); i++)
+		continue;
+
+	while (!sent.empty()) {
+		zctc::protocol::ResponseHeader header;
+		bool ok = false;
+		if (!read_response(fd, header, ok))
+			throw std::runtime_error("Lost the connection while awaiting " + std::to_string(sent.size())
+									 + " responses");
+
+		auto it = sent.find(header.id);
+		if (it == sent.end())
+			throw std::runtime_error("Unexpected response id " + std::to_string(header.id));
+
+		result.latency_ns.emplace_back(
+			std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - it->second)
+				.count());
+		result.responses++;
+		result.errors += !ok;
+		sent.erase(it);
+
+		send_next();
+	}
+
+	::close(fd);
+}
+
+void
+print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " --socket PATH [options]\n"
+			  << "  --socket PATH              Unix domain socket of the zctc-server\n"
+			  << "  --requests N               requests to send in total (default 1000)\n"
+			  << "  --connections N            concurrent connections (default 8)\n"
+			  << "  --pipeline N               outstanding requests per connection (default 1)\n"
+			  << "  --beams N                  top beams to request (default 1)\n"
+			  << "  --min-seq-len N            min frames per utterance (default 100)\n"
+			  << "  --max-seq-len N            max frames per utterance (default 500)\n"
+			  << "  --utterances N             distinct synthetic utterances to send (default 64)\n"
+			  << "  --blank-ratio F            fraction of blank frames (default 0.6)\n"
+			  << "  --peakiness F              mean probability of the top token (default 0.7)\n"
+			  << "  --token-rate F             mean tokens emitted per frame (default 0.2)\n"
+			  << "  --seed N                   seed of the synthetic utterances (default 0)\n";
+}
+
+int
+main(int argc, char** argv)
+{
+	LoadConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--socket")
+			config.socket_path = value;
+		else if (arg == "--requests")
+			config.requests = std::stoi(value);
+		else if (arg == "--connections")
+			config.connections = std::stoi(value);
+		else if (arg == "--pipeline")
+			config.pipeline = std::stoi(value);
+		else if (arg == "--beams")
+			config.beams = std::stoi(value);
+		else if (arg == "--min-seq-len")
+			config.min_seq_len = std::stoi(value);
+		else if (arg == "--max-seq-len")
+			config.max_seq_len = std::stoi(value);
+		else if (arg == "--utterances")
+			config.utterances = std::stoi(value);
+		else if (arg == "--blank-ratio")
+			config.blank_ratio = std::stof(value);
+		else if (arg == "--peakiness")
+			config.peakiness = std::stof(value);
+		else if (arg == "--token-rate")
+			config.token_rate = std::stof(value);
+		else if (arg == "--seed")
+			config.seed = std::stoul(value);
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (config.socket_path.empty() || config.requests < 1 || config.connections < 1 || config.pipeline < 1
+		|| config.utterances < 1 || config.min_seq_len < 1 || config.max_seq_len < config.min_seq_len) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	zctc::protocol::ServerHello hello;
+	::close(connect_server(config.socket_path, hello));
+	std::vector<Utterance> utterances = make_utterances(config, hello);
+
+	std::atomic<int> next = 0;
+	std::vector<LoadResult> results(config.connections);
+	std::vector<std::thread> threads;
+	std::mutex error_mutex;
+	std::string error;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int c = 0; c < config.connections; c++) {
+		threads.emplace_back([&, c]() {
+			try {
+				drive_connection(config, utterances, next, results[c]);
+			} catch (const std::exception& e) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				error = e.what();
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	if (!error.empty()) {
+		std::cerr << error << std::endl;
+		return 1;
+	}
+
+	LoadResult total;
+	for (LoadResult& result : results) {
+		total.responses += result.responses;
+		total.errors += result.errors;
+		total.frames += result.frames;
+		total.latency_ns.insert(total.latency_ns.end(), result.latency_ns.begin(), result.latency_ns.end());
+	}
+
+	std::cout << "{\"requests\": " << total.responses << ", \"errors\": " << total.errors
+			  << ", \"connections\": " << config.connections << ", \"pipeline\": " << config.pipeline
+			  << ", \"seconds\": " << seconds << ", \"requests_per_sec\": " << total.responses / seconds
+			  << ", \"frames_per_sec\": " << total.frames / seconds
+			  << ", \"p50_latency_ns\": " << percentile(total.latency_ns, 0.5)
+			  << ", \"p90_latency_ns\": " << percentile(total.latency_ns, 0.9)
+			  << ", \"p99_latency_ns\": " << percentile(total.latency_ns, 0.99)
+			  << ", \"max_latency_ns\": " << percentile(total.latency_ns, 1.0) << "}" << std::endl;
+
+	return total.errors ? 1 : 0;
+}
@@ -1,260 +1,560 @@
-#include <cassert>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
-#include <ctime>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
-#include <numeric>
-#include <random>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "zctc/decoder.hh"
+#include "zctc/npy.hh"
+
+#include "./common.hh"
 
 /**
- * @brief Loads the vocabulary from the provided path to the vocab vector and returns the index of the apostrophe.
- *
- * @param vocab The vector to store the vocab.
- * @param vocab_path The path to the vocab file.
- *
- * @return The index of the apostrophe in the vocab.
+ * @brief Command line configuration of the offline decoding run.
  */
-int
-load_vocab(std::vector<std::string>& vocab, const char* vocab_path)
-{
+struct DecodeConfig {
+	int thread_count = std::max(1u, std::thread::hardware_concurrency());
+	int blank_id = 0, cutoff_top_n = 40, beam_width = 32, beams = 1;
+	float cutoff_prob = 1.0, min_tok_prob = -20.0, max_beam_score_deviation = -10.0;
+	float alpha = 0.5, beta = 1.0, lex_penalty = -5.0;
+	char tok_sep = '#';
+	int max_batch_size = 32, prefetch = 64;
+	float max_wait_ms = 1.0, frame_ms = 40;
+	bool log_probs = false, binary = false;
+	std::string input_dir, output, vocab_path, lm_path, lexicon_path, worker_cpus;
+};
+
+/**
+ * @brief An utterance read ahead of its decode. The float32 probabilities are
+ * 		  decoded in place from the mapped file, while the float64 and the log
+ * 		  probabilities are converted to float32 probabilities first.
+ */
+struct Utterance {
+	std::size_t index;
+	std::string name;
+	int seq_len = 0;
+	std::unique_ptr<zctc::MappedNpy> file;
+	std::vector<float> converted;
+	const float* logits = nullptr;
+};
+
+/**
+ * @brief Bounds the utterances read ahead and not yet written, so the reader
+ * 		  stays at most `prefetch` utterances ahead of the output, and neither
+ * 		  the mapped files nor the results waiting for an earlier one pile up
+ * 		  in memory when the decode or the output is slower.
+ */
+class PrefetchWindow {
+public:
+	explicit PrefetchWindow(int prefetch)
+		: prefetch(prefetch)
+	{
+	}
+
+	/**
+	 * @brief Waits for a free slot in the window.
+	 *
+	 * @return double The seconds waited, (ie) the time the reader was ahead of the decoder.
+	 */
+	double acquire()
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->released.wait(lock, [this]() { return this->used < this->prefetch; });
+		this->used++;
+
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
 
-	std::ifstream inputFile(vocab_path);
-	int apostrophe_id = -1;
+	void release()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->used--;
+		this->released.notify_all();
+	}
 
-	if (!inputFile.is_open())
-		std::runtime_error("Cannot open vocab file from the path provided.");
+	void drain()
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->released.wait(lock, [this]() { return this->used == 0; });
+	}
 
-	std::string line;
-	while (std::getline(inputFile, line)) {
-		vocab.emplace_back(line);
+private:
+	const int prefetch;
+	std::mutex mutex;
+	std::condition_variable released;
+	int used = 0;
+};
 
-		if (line == "'")
-			apostrophe_id = vocab.size() - 1;
+/**
+ * @brief Writes the results of the utterances in the order of their files as
+ * 		  soon as every earlier one is written, while the utterances complete
+ * 		  in any order across the worker threads. The results are formatted
+ * 		  and written on the writer's own thread, so the workers only queue
+ * 		  them, and the window slot of an utterance is released once its
+ * 		  result is written.
+ *
+ * 		  The JSON lines are `{"name", "seq_len", "beams": [{"labels",
+ * 		  "timesteps"}]}`, or `{"name", "error"}` if the utterance failed. The
+ * 		  binary records are, in native byte order, the uint32 name length,
+ * 		  the name, the uint32 seq len and the uint32 number of beams, then for
+ * 		  every beam the uint32 length and as many int32 labels and timesteps.
+ * 		  The failed utterances are left out of the binary output.
+ */
+class ResultWriter {
+public:
+	ResultWriter(std::ostream& out, bool binary, int beams, PrefetchWindow& window)
+		: out(out)
+		, binary(binary)
+		, beams(beams)
+		, window(window)
+		, thread(&ResultWriter::write_ready, this)
+	{
 	}
 
-	return apostrophe_id;
-}
+	~ResultWriter() { this->stop(); }
+
+	void write(std::size_t index, std::string name, zctc::DecodeResult&& result, std::string error = "");
+	void stop();
+
+	long errors() { return this->error_count.load(); }
+
+private:
+	struct Pending {
+		std::string name;
+		zctc::DecodeResult result;
+		std::string error;
+	};
 
-template <typename T>
+	std::ostream& out;
+	const bool binary;
+	const int beams;
+	PrefetchWindow& window;
+
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::size_t next = 0;
+	std::map<std::size_t, Pending> pending;
+	bool stopped = false;
+	std::atomic<long> error_count = 0;
+	// NOTE: Declared last, as it writes the members above as soon as it's started.
+	std::thread thread;
+
+	void write_ready();
+	void emit(const Pending& pending);
+};
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Queues the result of an utterance, to be written along with the
+ * 		  queued results following it, once the results before it are written.
+ *
+ * @param index The index of the utterance's file.
+ * @param name The name of the utterance.
+ * @param result The decoded beams of the utterance.
+ * @param error The error the utterance failed with, empty if decoded.
+ *
+ * @return void
+ */
 void
-normalise(std::vector<T>& logits)
+ResultWriter::write(std::size_t index, std::string name, zctc::DecodeResult&& result, std::string error)
 {
-	T sum = 0, max = *std::max_element(logits.begin(), logits.end());
-	for (T& i : logits) {
-		i = i - max;
-		sum += i;
-	}
-	for (T& i : logits) {
-		i /= sum;
-	}
+	// NOTE: Notified under the lock, as the writer may be destroyed as soon as it writes the last result.
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->pending[index] = { std::move(name), std::move(result), std::move(error) };
+	if (index == this->next)
+		this->queued.notify_one();
 }
 
-template <typename T>
+/**
+ * @brief Writes the results queued so far and stops the writer's thread.
+ *
+ * @return void
+ */
 void
-normalise(T* logits, int size)
+ResultWriter::stop()
 {
-	T sum = 0, max = std::numeric_limits<T>::lowest();
-	T* temp = logits;
-	for (int i = 0; i < size; i++, temp++) {
-		if (*temp > max)
-			max = *temp;
-	}
-
-	temp = logits;
-	for (int i = 0; i < size; i++, temp++) {
-		*temp = *temp - max;
-		sum += *temp;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopped = true;
 	}
+	this->queued.notify_one();
 
-	temp = logits;
-	for (int i = 0; i < size; i++, temp++) {
-		*temp = *temp / sum;
-	}
+	if (this->thread.joinable())
+		this->thread.join();
 }
 
 /**
- * @brief Test the decoder with random logits.
+ * @brief Writes the results in order as they're ready, releasing the window
+ * 		  slot of each once it's written, until the writer is stopped.
  *
- * @return int 0 on successful execution
+ * @return void
  */
-int
-debug_decoder()
+void
+ResultWriter::write_ready()
 {
-
-	char tok_sep = '#';
-	int iter_count, blank_id, seq_len = 1000, thread_count = 1, cutoff_top_n = 40;
-	int batch_size = 4;
-	float nucleus_prob_per_timestep = 1.0, penalty = -5.0, alpha = 0.017, beta = 0;
-	float min_tok_prob = -10.0, max_beam_deviation = -20.0;
-	std::size_t beam_width = 25;
-	std::string lm_path, lexicon_path, vocab_path;
-	std::vector<std::string> vocab;
-
-	std::cout << "Enter lm path: ";
-	std::cin >> lm_path;
-	std::cout << "Enter lexicon path: ";
-	std::cin >> lexicon_path;
-	std::cout << "Enter vocab path: ";
-	std::cin >> vocab_path;
-	std::cout << "Enter number of iterations to run: ";
-	std::cin >> iter_count;
-	std::cout << "Enter blank id: ";
-	std::cin >> blank_id;
-	std::cout << "Enter alpha[" << alpha << "]: ";
-	std::cin >> alpha;
-	std::cout << "Enter beta[" << beta << "]: ";
-	std::cin >> beta;
-
-	int apostrophe_id = load_vocab(vocab, vocab_path.c_str());
-
-	zctc::Decoder decoder(thread_count, blank_id, cutoff_top_n, apostrophe_id, nucleus_prob_per_timestep, alpha, beta,
-						  beam_width, penalty, min_tok_prob, max_beam_deviation, tok_sep, vocab, lm_path.data(),
-						  lexicon_path.data());
-
-	std::vector<float> logits(batch_size * decoder.vocab_size * seq_len);
-	std::vector<int> sorted_indices(batch_size * decoder.vocab_size * seq_len);
-	std::vector<int> labels(batch_size * decoder.beam_width * seq_len, 0);
-	std::vector<int> timesteps(batch_size * decoder.beam_width * seq_len, 0);
-	std::vector<int> seq_lens(batch_size, seq_len);
-	std::vector<int> seq_pos(batch_size * decoder.beam_width, 0);
-
-	std::vector<std::vector<int>> hotwords({ { 1, 2, 3, 4, 5 }, { 1, 5, 7, 9, 11 }, { 3, 6, 9 } });
-	std::vector<float> hotwords_weight({ 5.0, 10.0, 20.0 });
-
-	// To generate random values for logits
-	std::chrono::milliseconds duration(0);
-	std::random_device rnd_device;
-	std::mt19937 mersenne_engine { rnd_device() };
-	// std::uniform_real_distribution<float> dist { 0.0f, 0.05f };
-	std::normal_distribution<float> dist { 0.1f, 3.0f };
-	auto gen = [&dist, &mersenne_engine]() { return dist(mersenne_engine); };
-
-	for (int t = 1; t <= iter_count; t++) {
-
-		std::cout << "\rIteration: " << t << " / " << iter_count << " [" << duration.count() << " ms / it]"
-				  << std::flush;
-		std::generate(logits.begin(), logits.end(), gen);
-
-		// To get the sorted indices for the logits, timesteps wise
-		for (int i = 0; i < batch_size; i++) {
-			for (int j = 0, temp = 0; j < seq_len; j++) {
-				temp = (i * seq_len * decoder.vocab_size) + (j * decoder.vocab_size);
-				normalise(logits.data() + temp, decoder.vocab_size);
-				std::iota(sorted_indices.begin() + temp, sorted_indices.begin() + (temp + decoder.vocab_size), 0);
-				std::stable_sort(sorted_indices.begin() + temp, sorted_indices.begin() + (temp + decoder.vocab_size),
-								 [&logits, &temp](int a, int b) { return logits[temp + a] > logits[temp + b]; });
-			}
+	std::vector<Pending> ready;
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (true) {
+		this->queued.wait(lock, [this]() {
+			return this->stopped || (!this->pending.empty() && this->pending.begin()->first == this->next);
+		});
+
+		for (auto it = this->pending.begin(); it != this->pending.end() && it->first == this->next;) {
+			ready.emplace_back(std::move(it->second));
+			it = this->pending.erase(it);
+			this->next++;
 		}
 
-		auto start = std::chrono::high_resolution_clock::now();
-		decoder.serial_decode(logits.data(), sorted_indices.data(), labels.data(), timesteps.data(), seq_lens.data(),
-							  seq_pos.data(), batch_size, seq_len, hotwords, hotwords_weight, nullptr);
-		auto end = std::chrono::high_resolution_clock::now();
-		duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-
-		for (int i = 0; i < batch_size; i++) {
-			for (int j = 0; j < beam_width; j++) {
-				int prev_val = -1, curr_val = -1;
-				for (int k = seq_pos[(i * beam_width) + j]; k < seq_len; k++) {
-					curr_val = timesteps[(i * beam_width * seq_len) + (j * seq_len) + k];
-					assert(("The timestep is not in increasing order...", prev_val < curr_val));
-					prev_val = curr_val;
-				}
-			}
-		}
+		if (ready.empty())
+			return;
 
-		std::fill(labels.begin(), labels.end(), 0);
-		std::fill(timesteps.begin(), timesteps.end(), 0);
-		std::fill(seq_pos.begin(), seq_pos.end(), 0);
-	}
-
-	std::cout << std::endl;
+		lock.unlock();
+		for (const Pending& result : ready)
+			this->emit(result);
+		this->out.flush();
 
-	return 0;
+		for (std::size_t i = 0; i < ready.size(); i++)
+			this->window.release();
+		ready.clear();
+		lock.lock();
+	}
 }
 
 /**
- * @brief A toy experiment to test the decoder.
- *
- * @return int 0 on successful execution
+ * @brief Quotes the provided text as a JSON string.
  */
-int
-debug_decoder_with_toy_exp()
+std::string
+json_string(const std::string& text)
 {
-
-	char tok_sep = '#';
-	int blank_id = 0, seq_len = 2, thread_count = 1, cutoff_top_n = 3;
-	float nucleus_prob_per_timestep = 1.0, penalty = -5.0, alpha = 0.017, beta = 0;
-	float min_tok_prob = -5.0, max_beam_deviation = -10.0;
-	std::size_t beam_width = 9;
-	std::vector<std::string> vocab = { "_", "'", "b" };
-
-	zctc::Decoder decoder(thread_count, blank_id, cutoff_top_n, 1, nucleus_prob_per_timestep, alpha, beta, beam_width,
-						  penalty, min_tok_prob, max_beam_deviation, tok_sep, vocab, nullptr, nullptr);
-
-	std::vector<float> logits = { 0.6, 0.3, 0.1, 0.6, 0.35, 0.05 };
-	std::vector<int> sorted_indices(decoder.vocab_size * seq_len);
-	std::vector<int> labels(decoder.beam_width * seq_len, 0);
-	std::vector<int> timesteps(decoder.beam_width * seq_len, 0);
-	std::vector<int> seq_pos(decoder.beam_width, 0);
-
-	// To get the sorted indices for the logits, timesteps wise
-	for (int i = 0, temp = 0; i < seq_len; i++) {
-		temp = i * decoder.vocab_size;
-		std::iota(sorted_indices.begin() + temp, sorted_indices.begin() + (temp + decoder.vocab_size), 0);
-		std::stable_sort(sorted_indices.begin() + temp, sorted_indices.begin() + (temp + decoder.vocab_size),
-						 [&logits, &temp](int a, int b) { return logits[temp + a] > logits[temp + b]; });
+	std::string quoted = "\"";
+	for (char c : text) {
+		if (c == '"' || c == '\\')
+			quoted += '\\';
+		quoted += (static_cast<unsigned char>(c) < 0x20) ? ' ' : c;
 	}
 
-	zctc::decode<float>(&decoder, logits.data(), sorted_indices.data(), labels.data(), timesteps.data(), seq_len,
-						seq_len, seq_pos.data(), nullptr);
+	return quoted + "\"";
+}
+
+void
+ResultWriter::emit(const Pending& pending)
+{
+	if (!pending.error.empty()) {
+		this->error_count++;
+		std::cerr << "Cannot decode " << pending.name << ", " << pending.error << std::endl;
+		if (!this->binary)
+			this->out << "{\"name\": " << json_string(pending.name) << ", \"error\": " << json_string(pending.error)
+					  << "}\n";
+		return;
+	}
 
-	for (int i = 0; i < decoder.beam_width; i++) {
-		for (int j = 0; j < seq_len; j++) {
-			std::cout << labels[i * seq_len + j] << ":" << timesteps[i * seq_len + j] << " ";
+	const zctc::DecodeResult& result = pending.result;
+	int beams = std::min(this->beams, static_cast<int>(result.seq_pos.size()));
+
+	if (this->binary) {
+		auto put = [this](std::uint32_t value) { this->out.write(reinterpret_cast<const char*>(&value), 4); };
+		put(pending.name.size());
+		this->out.write(pending.name.data(), pending.name.size());
+		put(result.seq_len);
+		put(beams);
+
+		for (int b = 0; b < beams; b++) {
+			std::size_t first = static_cast<std::size_t>(b) * result.seq_len + result.seq_pos[b];
+			std::size_t length = result.seq_len - result.seq_pos[b];
+			put(length);
+			this->out.write(reinterpret_cast<const char*>(result.labels.data() + first), length * sizeof(int));
+			this->out.write(reinterpret_cast<const char*>(result.timesteps.data() + first), length * sizeof(int));
 		}
-		std::cout << std::endl;
+		return;
 	}
+
+	auto put_list = [this](const int* values, std::size_t length) {
+		this->out << "[";
+		for (std::size_t i = 0; i < length; i++)
+			this->out << (i ? ", " : "") << values[i];
+		this->out << "]";
+	};
+
+	this->out << "{\"name\": " << json_string(pending.name) << ", \"seq_len\": " << result.seq_len << ", \"beams\": [";
+	for (int b = 0; b < beams; b++) {
+		std::size_t first = static_cast<std::size_t>(b) * result.seq_len + result.seq_pos[b];
+		std::size_t length = result.seq_len - result.seq_pos[b];
+
+		this->out << (b ? ", " : "") << "{\"labels\": ";
+		put_list(result.labels.data() + first, length);
+		this->out << ", \"timesteps\": ";
+		put_list(result.timesteps.data() + first, length);
+		this->out << "}";
+	}
+	this->out << "]}\n";
 }
 
 /**
- * @brief Test the FST with the provided vocab and lexicon file.
- *
- * @return int 0 on successful execution
+ * @brief Maps the `.npy` file of an utterance, reading it into the page cache
+ * 		  on the reader thread, so the decode doesn't wait on the disk. The
+ * 		  array is of shape SeqLen x Vocab or 1 x SeqLen x Vocab, of
+ * 		  probabilities, or of log probabilities if `log_probs`.
  */
-int
-debug_fst()
+void
+read_utterance(const DecodeConfig& config, int vocab_size, const std::filesystem::path& path, Utterance& utterance)
 {
-	std::string vocab_path, file_path;
+	utterance.file = std::make_unique<zctc::MappedNpy>(path.string(), true);
+	std::vector<std::size_t> shape = utterance.file->shape;
+	if (shape.size() == 3 && shape[0] == 1)
+		shape.erase(shape.begin());
+	if (shape.size() != 2 || static_cast<int>(shape[1]) != vocab_size)
+		throw std::runtime_error("Expected logits of shape SeqLen x " + std::to_string(vocab_size));
+
+	utterance.seq_len = shape[0];
+	if (utterance.file->dtype == "<f4" && !config.log_probs) {
+		utterance.logits = static_cast<const float*>(utterance.file->values());
+		return;
+	}
 
-	std::cout << "Enter vocab path: ";
-	std::cin >> vocab_path;
-	std::cout << "Enter tokenized lexicon path: ";
-	std::cin >> file_path;
+	utterance.converted.resize(utterance.file->size());
+	if (utterance.file->dtype == "<f4") {
+		const float* values = static_cast<const float*>(utterance.file->values());
+		std::copy(values, values + utterance.converted.size(), utterance.converted.begin());
+	} else {
+		const double* values = static_cast<const double*>(utterance.file->values());
+		std::copy(values, values + utterance.converted.size(), utterance.converted.begin());
+	}
+	if (config.log_probs) {
+		for (float& logit : utterance.converted)
+			logit = std::exp(logit);
+	}
 
-	zctc::ZFST zfst(vocab_path.data(), (char*)nullptr);
-	zctc::parse_lexicon_file(&zfst, file_path, 0);
+	utterance.logits = utterance.converted.data();
+	utterance.file.reset();
+}
 
-	return 0;
+void
+print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " --input DIR --vocab PATH [options]\n"
+			  << "Decodes every <name>.npy of the directory, in the order of the names, writing the beams of\n"
+			  << "every utterance as soon as it and the utterances before it are decoded.\n"
+			  << "  --input DIR                directory of the logits, each of shape SeqLen x Vocab\n"
+			  << "  --vocab PATH               vocab file, one token per line\n"
+			  << "  --output PATH              write the results here instead of stdout\n"
+			  << "  --format F                 jsonl or binary (default jsonl)\n"
+			  << "  --beams N                  top beams to write per utterance (default 1)\n"
+			  << "  --log-probs                the logits are log probabilities instead of probabilities\n"
+			  << "  --prefetch N               utterances read ahead of the decode at most (default 64)\n"
+			  << "  --max-batch-size N         utterances per micro-batch at most (default 32)\n"
+			  << "  --max-wait-ms F            time the oldest queued utterance waits for a batch (default 1)\n"
+			  << "  --threads N                decoder threads (default all the cores)\n"
+			  << "  --worker-cpus LIST         CPUs to pin the decoder threads to, as taskset -c\n"
+			  << "  --beam-width N             beam width (default 32)\n"
+			  << "  --cutoff-top-n N           candidates per frame (default 40)\n"
+			  << "  --cutoff-prob F            cumulative probability of the candidates (default 1.0)\n"
+			  << "  --min-tok-prob F           min token log probability (default -20)\n"
+			  << "  --max-beam-deviation F     max beam score deviation (default -10)\n"
+			  << "  --blank-id N               blank token id (default 0)\n"
+			  << "  --tok-sep C                subword token prefix (default #)\n"
+			  << "  --alpha F                  LM weight (default 0.5)\n"
+			  << "  --beta F                   word insertion bonus (default 1.0)\n"
+			  << "  --lex-penalty F            out of lexicon penalty (default -5.0)\n"
+			  << "  --lm PATH                  KenLM model\n"
+			  << "  --lexicon PATH             lexicon FST\n"
+			  << "  --frame-ms F               frame shift used for the real time factor (default 40)\n";
 }
 
 int
 main(int argc, char** argv)
 {
-	int choice;
-	std::cout << "Enter choice(0 for Decoder(with rand inputs), 1 for Decoder(with toy exp), 2 for FST: ";
-	std::cin >> choice;
-
-	if (choice == 0)
-		return debug_decoder();
-	else if (choice == 1)
-		return debug_decoder_with_toy_exp();
-	else if (choice == 2)
-		return debug_fst();
-	else {
-		std::cout << "Invalid choice. Exiting..." << std::endl;
+	DecodeConfig config;
+	std::string format = "jsonl";
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--log-probs") {
+			config.log_probs = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--input")
+			config.input_dir = value;
+		else if (arg == "--vocab")
+			config.vocab_path = value;
+		else if (arg == "--output")
+			config.output = value;
+		else if (arg == "--format")
+			format = value;
+		else if (arg == "--beams")
+			config.beams = std::stoi(value);
+		else if (arg == "--prefetch")
+			config.prefetch = std::stoi(value);
+		else if (arg == "--max-batch-size")
+			config.max_batch_size = std::stoi(value);
+		else if (arg == "--max-wait-ms")
+			config.max_wait_ms = std::stof(value);
+		else if (arg == "--threads")
+			config.thread_count = std::stoi(value);
+		else if (arg == "--worker-cpus")
+			config.worker_cpus = value;
+		else if (arg == "--beam-width")
+			config.beam_width = std::stoi(value);
+		else if (arg == "--cutoff-top-n")
+			config.cutoff_top_n = std::stoi(value);
+		else if (arg == "--cutoff-prob")
+			config.cutoff_prob = std::stof(value);
+		else if (arg == "--min-tok-prob")
+			config.min_tok_prob = std::stof(value);
+		else if (arg == "--max-beam-deviation")
+			config.max_beam_score_deviation = std::stof(value);
+		else if (arg == "--blank-id")
+			config.blank_id = std::stoi(value);
+		else if (arg == "--tok-sep")
+			config.tok_sep = value[0];
+		else if (arg == "--alpha")
+			config.alpha = std::stof(value);
+		else if (arg == "--beta")
+			config.beta = std::stof(value);
+		else if (arg == "--lex-penalty")
+			config.lex_penalty = std::stof(value);
+		else if (arg == "--lm")
+			config.lm_path = value;
+		else if (arg == "--lexicon")
+			config.lexicon_path = value;
+		else if (arg == "--frame-ms")
+			config.frame_ms = std::stof(value);
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	config.binary = (format == "binary");
+	if (config.input_dir.empty() || config.vocab_path.empty() || (format != "jsonl" && format != "binary")
+		|| config.beams < 1 || config.prefetch < 1 || config.max_batch_size < 1 || config.max_wait_ms < 0
+		|| config.thread_count < 1) {
+		print_usage(argv[0]);
 		return 1;
 	}
+
+	std::vector<std::filesystem::path> paths;
+	for (const auto& entry : std::filesystem::directory_iterator(config.input_dir)) {
+		if (entry.path().extension() == ".npy")
+			paths.emplace_back(entry.path());
+	}
+	std::sort(paths.begin(), paths.end());
+
+	std::vector<std::string> vocab = load_vocab(config.vocab_path);
+	int cutoff_top_n = std::min(config.cutoff_top_n, static_cast<int>(vocab.size()));
+
+	zctc::Decoder decoder(config.thread_count, config.blank_id, cutoff_top_n, apostrophe_id(vocab),
+						  config.cutoff_prob, config.alpha, config.beta, config.beam_width, config.lex_penalty,
+						  config.min_tok_prob, config.max_beam_score_deviation, config.tok_sep, vocab,
+						  config.lm_path.empty() ? nullptr : config.lm_path.data(),
+						  config.lexicon_path.empty() ? nullptr : config.lexicon_path.data(), nullptr, false,
+						  zctc::AdaptiveMeasure::NONE, 0, 0, 0, zctc::LmLoadMethod::POPULATE_OR_READ, false, false,
+						  config.max_batch_size, config.max_wait_ms, config.worker_cpus);
+
+	// NOTE: The options are only validated on a decode, so the invalid ones are reported before any is read.
+	try {
+		decoder.check_options(decoder.options());
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return 1;
+	}
+
+	std::ofstream file;
+	if (!config.output.empty()) {
+		file.open(config.output, std::ios::binary);
+		if (!file) {
+			std::cerr << "Cannot open the output file, " << config.output << std::endl;
+			return 1;
+		}
+	}
+	PrefetchWindow window(config.prefetch);
+	ResultWriter writer(config.output.empty() ? std::cout : file, config.binary, config.beams, window);
+
+	/**
+	 * NOTE: This thread reads the files ahead of the decode while the worker
+	 * 		 threads decode the utterances read before, each from its own
+	 * 		 logits without padding, and the writer's thread writes their
+	 * 		 results. The time it spends waiting for the window is the time
+	 * 		 the decode or the output is behind, so a run bound by the decode
+	 * 		 waits far longer than it reads.
+	 */
+	double read_seconds = 0, wait_seconds = 0;
+	long frames = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	for (std::size_t i = 0; i < paths.size(); i++) {
+		wait_seconds += window.acquire();
+
+		auto utterance = std::make_shared<Utterance>();
+		utterance->index = i;
+		utterance->name = paths[i].stem().string();
+
+		auto read_start = std::chrono::steady_clock::now();
+		try {
+			read_utterance(config, decoder.vocab_size, paths[i], *utterance);
+		} catch (const std::exception& e) {
+			writer.write(i, utterance->name, {}, e.what());
+			continue;
+		}
+		read_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - read_start).count();
+		frames += utterance->seq_len;
+
+		auto on_complete = [&writer, utterance](zctc::DecodeResult&& result, std::exception_ptr error) {
+			std::string message;
+			if (error) {
+				try {
+					std::rethrow_exception(error);
+				} catch (const std::exception& e) {
+					message = e.what();
+				} catch (...) {
+					message = "Unknown error occured during execution";
+				}
+			}
+
+			// NOTE: The file is unmapped right away, while its window slot is held until the result is written.
+			utterance->file.reset();
+			utterance->converted = std::vector<float>();
+			writer.write(utterance->index, utterance->name, std::move(result), message);
+		};
+
+		try {
+			decoder.submit_async(utterance->logits, utterance->seq_len, on_complete);
+		} catch (...) {
+			on_complete({}, std::current_exception());
+		}
+	}
+
+	window.drain();
+	writer.stop();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << "{\"utterances\": " << paths.size() << ", \"errors\": " << writer.errors()
+			  << ", \"frames\": " << frames << ", \"seconds\": " << seconds
+			  << ", \"utterances_per_sec\": " << paths.size() / seconds << ", \"frames_per_sec\": " << frames / seconds
+			  << ", \"rtf\": " << (frames ? seconds / (frames * config.frame_ms / 1e3) : 0.0)
+			  << ", \"read_seconds\": " << read_seconds << ", \"prefetch_wait_seconds\": " << wait_seconds << "}"
+			  << std::endl;
+
+	return writer.errors() ? 1 : 0;
 }
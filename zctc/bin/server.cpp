@@ -0,0 +1,496 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "zctc/decoder.hh"
+#include "zctc/protocol.hh"
+
+#include "./common.hh"
+
+/**
+ * @brief Command line configuration of the server.
+ */
+struct ServerConfig {
+	int thread_count = std::max(1u, std::thread::hardware_concurrency());
+	int blank_id = 0, cutoff_top_n = 40, beam_width = 32;
+	float cutoff_prob = 1.0, min_tok_prob = -20.0, max_beam_score_deviation = -10.0;
+	float alpha = 0.5, beta = 1.0, lex_penalty = -5.0;
+	char tok_sep = '#';
+	int max_batch_size = 32, max_seq_len = 1 << 16, max_backlog_mb = 64;
+	float max_wait_ms = 5.0;
+	std::string socket_path, vocab_path, lm_path, lexicon_path;
+};
+
+/**
+ * @brief A client connection, shared by its reader and its pending requests,
+ * 		  with a writer thread sending the queued responses in order, so the
+ * 		  decoder's workers only queue them and never block on a client that
+ * 		  doesn't read. A client letting more than the backlog's bytes queue
+ * 		  up is dropped.
+ */
+class Connection {
+public:
+	const int fd;
+
+	Connection(int fd, std::size_t max_backlog_bytes);
+	~Connection();
+
+	void send(std::vector<char>&& message);
+	void expect_response();
+	void respond(std::vector<char>&& response);
+	void finish();
+
+private:
+	const std::size_t max_backlog_bytes;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<std::vector<char>> outbox;
+	std::size_t backlog_bytes = 0;
+	long pending = 0;
+	bool finished = false, dropped = false;
+	// NOTE: Declared last, as it writes the members above as soon as it's started.
+	std::thread writer;
+
+	void queue(std::vector<char>&& message, bool answers_request);
+	void write_queued();
+};
+
+struct Request {
+	std::shared_ptr<Connection> connection;
+	zctc::protocol::RequestHeader header;
+	std::vector<float> logits;
+};
+
+struct ServerCounters {
+	std::atomic<long> requests = 0, frames = 0;
+};
+
+void respond(const Request& request, std::size_t beam_width, zctc::DecodeResult&& result, std::exception_ptr error);
+void send_error(Connection& connection, std::uint32_t id, zctc::protocol::Status status, const std::string& message);
+
+/* ---------------------------------------------------------------------------- */
+
+Connection::Connection(int fd, std::size_t max_backlog_bytes)
+	: fd(fd)
+	, max_backlog_bytes(max_backlog_bytes)
+	, writer(&Connection::write_queued, this)
+{
+}
+
+Connection::~Connection()
+{
+	this->finish();
+	::close(this->fd);
+}
+
+/**
+ * @brief Queues a message which doesn't answer a request, as the hello and
+ * 		  the errors of the malformed requests.
+ */
+void
+Connection::send(std::vector<char>&& message)
+{
+	this->queue(std::move(message), false);
+}
+
+/**
+ * @brief Counts a request queued to the decoder, so the writer waits for its
+ * 		  response before exiting.
+ */
+void
+Connection::expect_response()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->pending++;
+}
+
+/**
+ * @brief Queues the response of a request counted by `expect_response`.
+ */
+void
+Connection::respond(std::vector<char>&& response)
+{
+	this->queue(std::move(response), true);
+}
+
+/**
+ * @brief Waits for the writer to send the responses of every pending request,
+ * 		  or to drop the connection. Called by the reader once the client
+ * 		  stopped sending requests.
+ */
+void
+Connection::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->finished = true;
+	}
+	this->changed.notify_all();
+
+	if (this->writer.joinable())
+		this->writer.join();
+}
+
+void
+Connection::queue(std::vector<char>&& message, bool answers_request)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->pending -= answers_request;
+		if (this->dropped)
+			return;
+
+		// NOTE: A message is always queued behind an empty backlog, however large it is.
+		if (this->backlog_bytes > 0 && this->backlog_bytes + message.size() > this->max_backlog_bytes) {
+			this->dropped = true;
+			this->outbox.clear();
+			// NOTE: Fails the writer's blocked send and the reader's blocked recv.
+			::shutdown(this->fd, SHUT_RDWR);
+		} else {
+			this->backlog_bytes += message.size();
+			this->outbox.emplace_back(std::move(message));
+		}
+	}
+	this->changed.notify_all();
+}
+
+/**
+ * @brief Sends the queued messages in order, until every pending request is
+ * 		  answered after the reader finished, or the connection is dropped.
+ */
+void
+Connection::write_queued()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+	while (true) {
+		this->changed.wait(lock, [this]() {
+			return !this->outbox.empty() || this->dropped || (this->finished && this->pending == 0);
+		});
+		if (this->outbox.empty())
+			return;
+
+		std::vector<char> message = std::move(this->outbox.front());
+		this->outbox.pop_front();
+
+		lock.unlock();
+		bool sent = zctc::write_exact(this->fd, message.data(), message.size());
+		lock.lock();
+
+		// NOTE: The message is part of the backlog until it's sent, as a client not reading blocks its send.
+		this->backlog_bytes -= message.size();
+		if (!sent && !this->dropped) {
+			// NOTE: A client gone before its responses is only dropped, its reader sees the closed socket.
+			this->dropped = true;
+			this->outbox.clear();
+			this->backlog_bytes = 0;
+			::shutdown(this->fd, SHUT_RDWR);
+		}
+	}
+}
+
+/**
+ * @brief Queues the requested number of top beams of the decoded request to
+ * 		  its connection, or the error if its decode failed.
+ */
+void
+respond(const Request& request, std::size_t beam_width, zctc::DecodeResult&& result, std::exception_ptr error)
+{
+	if (error) {
+		std::string message = "Unknown error";
+		try {
+			std::rethrow_exception(error);
+		} catch (const std::exception& e) {
+			message = e.what();
+		} catch (...) {
+		}
+
+		send_error(*request.connection, request.header.id, zctc::protocol::DECODE_FAILED, message);
+		return;
+	}
+
+	std::uint32_t beams = std::min<std::size_t>(std::max(request.header.beams, 1u), beam_width);
+	zctc::protocol::ResponseHeader header { zctc::protocol::MAGIC, request.header.id, zctc::protocol::OK, beams };
+
+	std::vector<char> response(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+	for (std::uint32_t b = 0; b < beams; b++) {
+		std::size_t offset = b * static_cast<std::size_t>(result.seq_len);
+		std::uint32_t start = result.seq_pos[b], length = result.seq_len - start;
+
+		const char* labels = reinterpret_cast<const char*>(result.labels.data() + offset + start);
+		const char* timesteps = reinterpret_cast<const char*>(result.timesteps.data() + offset + start);
+		response.insert(response.end(), reinterpret_cast<const char*>(&length),
+						reinterpret_cast<const char*>(&length + 1));
+		response.insert(response.end(), labels, labels + length * sizeof(int));
+		response.insert(response.end(), timesteps, timesteps + length * sizeof(int));
+	}
+
+	request.connection->respond(std::move(response));
+}
+
+/**
+ * @brief Queues an error response, answering a pending request if its status
+ * 		  is `DECODE_FAILED`.
+ */
+void
+send_error(Connection& connection, std::uint32_t id, zctc::protocol::Status status, const std::string& message)
+{
+	zctc::protocol::ResponseHeader header { zctc::protocol::MAGIC, id, status,
+											static_cast<std::uint32_t>(message.size()) };
+
+	std::vector<char> response(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header + 1));
+	response.insert(response.end(), message.begin(), message.end());
+
+	if (status == zctc::protocol::DECODE_FAILED)
+		connection.respond(std::move(response));
+	else
+		connection.send(std::move(response));
+}
+
+/**
+ * @brief Reads the requests of a connection until the client closes it, and
+ * 		  submits them to the decoder, which groups the requests of every
+ * 		  connection into micro-batches, each decoded from its own logits
+ * 		  without padding. An invalid request is answered with an error, and
+ * 		  a malformed header closes the connection, as the stream can't be
+ * 		  framed past it. Returns once every submitted request is answered.
+ */
+void
+serve_connection(std::shared_ptr<Connection> connection, const zctc::Decoder& decoder, const ServerConfig& config,
+				 ServerCounters& counters)
+{
+	zctc::protocol::ServerHello hello { zctc::protocol::MAGIC, zctc::protocol::VERSION,
+										static_cast<std::uint32_t>(decoder.vocab_size),
+										static_cast<std::uint32_t>(decoder.blank_id),
+										static_cast<std::uint32_t>(decoder.beam_width) };
+	connection->send(
+		std::vector<char>(reinterpret_cast<const char*>(&hello), reinterpret_cast<const char*>(&hello + 1)));
+
+	zctc::protocol::RequestHeader header;
+	while (zctc::read_exact(connection->fd, &header, sizeof(header))) {
+		if (header.magic != zctc::protocol::MAGIC) {
+			send_error(*connection, header.id, zctc::protocol::INVALID_REQUEST, "Invalid request magic");
+			break;
+		}
+		if (header.seq_len > static_cast<std::uint32_t>(config.max_seq_len)) {
+			send_error(*connection, header.id, zctc::protocol::INVALID_REQUEST,
+					   "Sequence length " + std::to_string(header.seq_len) + " exceeds the server's limit "
+						   + std::to_string(config.max_seq_len));
+			break;
+		}
+
+		// NOTE: The request owns its logits until it's decoded, as the decoder reads them in place.
+		auto request = std::make_shared<Request>();
+		request->connection = connection;
+		request->header = header;
+		request->logits.resize(static_cast<std::size_t>(header.seq_len) * decoder.vocab_size);
+		if (!zctc::read_exact(connection->fd, request->logits.data(), request->logits.size() * sizeof(float)))
+			break;
+
+		counters.requests++;
+		counters.frames += header.seq_len;
+
+		connection->expect_response();
+		auto on_complete = [request, beam_width = decoder.beam_width](zctc::DecodeResult&& result,
+																	   std::exception_ptr error) {
+			respond(*request, beam_width, std::move(result), error);
+		};
+
+		try {
+			decoder.submit_async(request->logits.data(), header.seq_len, on_complete);
+		} catch (...) {
+			on_complete({}, std::current_exception());
+		}
+	}
+
+	connection->finish();
+}
+
+void
+print_usage(const char* program)
+{
+	std::cerr << "Usage: " << program << " --socket PATH --vocab PATH [options]\n"
+			  << "  --socket PATH              Unix domain socket to listen on\n"
+			  << "  --vocab PATH               vocab file, one token per line\n"
+			  << "  --max-batch-size N         requests per batch at most (default 32)\n"
+			  << "  --max-wait-ms F            time the oldest queued request waits for a batch (default 5)\n"
+			  << "  --max-seq-len N            frames per request at most (default 65536)\n"
+			  << "  --max-backlog-mb N         unsent responses per client at most, before dropping it (default 64)\n"
+			  << "  --threads N                decoder threads (default all the cores)\n"
+			  << "  --beam-width N             beam width (default 32)\n"
+			  << "  --cutoff-top-n N           candidates per frame (default 40)\n"
+			  << "  --cutoff-prob F            cumulative probability of the candidates (default 1.0)\n"
+			  << "  --min-tok-prob F           min token log probability (default -20)\n"
+			  << "  --max-beam-deviation F     max beam score deviation (default -10)\n"
+			  << "  --blank-id N               blank token id (default 0)\n"
+			  << "  --tok-sep C                subword token prefix (default #)\n"
+			  << "  --alpha F                  LM weight (default 0.5)\n"
+			  << "  --beta F                   word insertion bonus (default 1.0)\n"
+			  << "  --lex-penalty F            out of lexicon penalty (default -5.0)\n"
+			  << "  --lm PATH                  KenLM model\n"
+			  << "  --lexicon PATH             lexicon FST\n";
+}
+
+namespace {
+int listen_fd = -1;
+volatile std::sig_atomic_t shutdown_requested = 0;
+
+void
+on_signal(int)
+{
+	shutdown_requested = 1;
+	// NOTE: Wakes the blocked accept, and is async signal safe.
+	::shutdown(listen_fd, SHUT_RDWR);
+}
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+	ServerConfig config;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--help" || arg == "-h") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (i + 1 >= argc) {
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+		if (arg == "--socket")
+			config.socket_path = value;
+		else if (arg == "--vocab")
+			config.vocab_path = value;
+		else if (arg == "--max-batch-size")
+			config.max_batch_size = std::stoi(value);
+		else if (arg == "--max-wait-ms")
+			config.max_wait_ms = std::stof(value);
+		else if (arg == "--max-seq-len")
+			config.max_seq_len = std::stoi(value);
+		else if (arg == "--max-backlog-mb")
+			config.max_backlog_mb = std::stoi(value);
+		else if (arg == "--threads")
+			config.thread_count = std::stoi(value);
+		else if (arg == "--beam-width")
+			config.beam_width = std::stoi(value);
+		else if (arg == "--cutoff-top-n")
+			config.cutoff_top_n = std::stoi(value);
+		else if (arg == "--cutoff-prob")
+			config.cutoff_prob = std::stof(value);
+		else if (arg == "--min-tok-prob")
+			config.min_tok_prob = std::stof(value);
+		else if (arg == "--max-beam-deviation")
+			config.max_beam_score_deviation = std::stof(value);
+		else if (arg == "--blank-id")
+			config.blank_id = std::stoi(value);
+		else if (arg == "--tok-sep")
+			config.tok_sep = value.at(0);
+		else if (arg == "--alpha")
+			config.alpha = std::stof(value);
+		else if (arg == "--beta")
+			config.beta = std::stof(value);
+		else if (arg == "--lex-penalty")
+			config.lex_penalty = std::stof(value);
+		else if (arg == "--lm")
+			config.lm_path = value;
+		else if (arg == "--lexicon")
+			config.lexicon_path = value;
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (config.socket_path.empty() || config.vocab_path.empty() || config.max_batch_size < 1
+		|| config.max_seq_len < 1 || config.max_backlog_mb < 1 || config.max_wait_ms < 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::vector<std::string> vocab = load_vocab(config.vocab_path);
+	int cutoff_top_n = std::min(config.cutoff_top_n, static_cast<int>(vocab.size()));
+
+	zctc::Decoder decoder(config.thread_count, config.blank_id, cutoff_top_n, apostrophe_id(vocab),
+						  config.cutoff_prob, config.alpha, config.beta, config.beam_width, config.lex_penalty,
+						  config.min_tok_prob, config.max_beam_score_deviation, config.tok_sep, vocab,
+						  config.lm_path.empty() ? nullptr : config.lm_path.data(),
+						  config.lexicon_path.empty() ? nullptr : config.lexicon_path.data(), nullptr, false,
+						  zctc::AdaptiveMeasure::NONE, 0, 0, 0, zctc::LmLoadMethod::POPULATE_OR_READ, false, false,
+						  config.max_batch_size, config.max_wait_ms);
+
+	sockaddr_un address = zctc::unix_address(config.socket_path);
+	listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	::unlink(config.socket_path.c_str());
+	if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+		|| ::listen(listen_fd, SOMAXCONN) != 0) {
+		std::cerr << "Cannot listen on " << config.socket_path << ", " << std::strerror(errno) << std::endl;
+		return 1;
+	}
+
+	std::signal(SIGINT, on_signal);
+	std::signal(SIGTERM, on_signal);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	std::cerr << "Listening on " << config.socket_path << ", vocab_size=" << vocab.size()
+			  << " beam_width=" << config.beam_width << " max_batch_size=" << config.max_batch_size
+			  << " max_wait_ms=" << config.max_wait_ms << std::endl;
+
+	ServerCounters counters;
+	std::vector<std::weak_ptr<Connection>> connections;
+	std::mutex reader_mutex;
+	std::condition_variable reader_exited;
+	int reader_count = 0;
+
+	while (!shutdown_requested) {
+		int fd = ::accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			break;
+		}
+
+		auto connection = std::make_shared<Connection>(fd, static_cast<std::size_t>(config.max_backlog_mb) << 20);
+		std::erase_if(connections, [](const std::weak_ptr<Connection>& c) { return c.expired(); });
+		connections.emplace_back(connection);
+
+		std::lock_guard<std::mutex> lock(reader_mutex);
+		reader_count++;
+		std::thread([&, connection]() {
+			serve_connection(connection, decoder, config, counters);
+
+			std::lock_guard<std::mutex> lock(reader_mutex);
+			reader_count--;
+			reader_exited.notify_all();
+		}).detach();
+	}
+
+	// NOTE: Stops reading new requests, while the readers wait for the queued ones to be decoded and answered.
+	for (const std::weak_ptr<Connection>& weak_connection : connections) {
+		if (std::shared_ptr<Connection> connection = weak_connection.lock())
+			::shutdown(connection->fd, SHUT_RD);
+	}
+	{
+		std::unique_lock<std::mutex> lock(reader_mutex);
+		reader_exited.wait(lock, [&]() { return reader_count == 0; });
+	}
+
+	::close(listen_fd);
+	::unlink(config.socket_path.c_str());
+
+	std::cerr << "requests=" << counters.requests << " frames=" << counters.frames << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,197 @@
+#ifndef _ZCTC_ADAPTIVE_H
+#define _ZCTC_ADAPTIVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "./logits.hh"
+
+namespace zctc {
+
+/**
+ * @brief The measure of a frame's uncertainty, which the adaptive search
+ * 		  budget of the frame is derived from.
+ *
+ * 		  - `NONE` disables the adaptive budget, every frame gets the maximum.
+ * 		  - `ENTROPY` is the entropy of the frame's distribution over its
+ * 		    candidates, in nats.
+ * 		  - `MARGIN` is the probability margin between the top two tokens.
+ */
+enum class AdaptiveMeasure { NONE, ENTROPY, MARGIN };
+
+/**
+ * @brief The search budget of a frame, (ie) the beam width it's pruned to
+ * 		  and the number of candidates it's expanded with.
+ */
+struct FrameBudget {
+	std::size_t beam_width;
+	int cutoff_top_n;
+};
+
+/**
+ * @brief Derives the search budget of every frame from its uncertainty,
+ * 		  interpolating between the minimum and maximum beam width and
+ * 		  number of candidates, so the confident frames, which are most of
+ * 		  the CTC frames, are searched narrowly while the uncertain ones get
+ * 		  the full budget.
+ *
+ * 		  The uncertainty is scaled by the `threshold`, being the entropy at
+ * 		  or above which, or the margin at or below which, a frame gets the
+ * 		  maximum budget.
+ */
+class AdaptiveBeam {
+public:
+	const AdaptiveMeasure measure;
+	const std::size_t min_beam_width, max_beam_width;
+	const int min_cutoff_top_n, max_cutoff_top_n;
+	const float threshold;
+
+	AdaptiveBeam(AdaptiveMeasure measure, std::size_t min_beam_width, std::size_t max_beam_width,
+				 int min_cutoff_top_n, int max_cutoff_top_n, float threshold);
+
+	inline bool enabled() const { return this->measure != AdaptiveMeasure::NONE; }
+
+	AdaptiveBeam bounded(std::size_t max_beam_width, int max_cutoff_top_n) const;
+
+	template <typename T, typename M, typename F>
+	T uncertainty(const F& frame, int vocab_size, const int* ids) const;
+
+	template <typename T, typename M, typename F>
+	FrameBudget budget(const F& frame, int vocab_size, const int* ids) const;
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Validates and stores the adaptive budget bounds. The bounds are only
+ * 		  validated if the budget is enabled, else the maximums are used.
+ *
+ * @param measure The measure of the frame's uncertainty.
+ * @param min_beam_width The beam width of the most confident frames.
+ * @param max_beam_width The beam width of the most uncertain frames, the decoder's beam width.
+ * @param min_cutoff_top_n The number of candidates of the most confident frames.
+ * @param max_cutoff_top_n The number of candidates of the most uncertain frames, the decoder's cutoff.
+ * @param threshold The entropy, in nats, at or above which, or the margin at or below which, the frame gets the
+ * maximum budget.
+ */
+zctc::AdaptiveBeam::AdaptiveBeam(zctc::AdaptiveMeasure measure, std::size_t min_beam_width,
+								 std::size_t max_beam_width, int min_cutoff_top_n, int max_cutoff_top_n,
+								 float threshold)
+	: measure(measure)
+	, min_beam_width(this->enabled() ? min_beam_width : max_beam_width)
+	, max_beam_width(max_beam_width)
+	, min_cutoff_top_n(this->enabled() ? min_cutoff_top_n : max_cutoff_top_n)
+	, max_cutoff_top_n(max_cutoff_top_n)
+	, threshold(threshold)
+{
+	if (!this->enabled())
+		return;
+
+	if (this->min_beam_width < 1 || this->min_beam_width > this->max_beam_width)
+		throw std::runtime_error("Invalid min beam width " + std::to_string(this->min_beam_width) + ", expected in [1, "
+								 + std::to_string(this->max_beam_width) + "].");
+	if (this->min_cutoff_top_n < 1 || this->min_cutoff_top_n > this->max_cutoff_top_n)
+		throw std::runtime_error("Invalid min cutoff top n " + std::to_string(this->min_cutoff_top_n)
+								 + ", expected in [1, " + std::to_string(this->max_cutoff_top_n) + "].");
+	if (measure == zctc::AdaptiveMeasure::ENTROPY && !(threshold > 0))
+		throw std::runtime_error("Invalid entropy threshold " + std::to_string(threshold) + ", expected positive.");
+	if (measure == zctc::AdaptiveMeasure::MARGIN && !(threshold >= 0 && threshold < 1))
+		throw std::runtime_error("Invalid margin threshold " + std::to_string(threshold) + ", expected in [0, 1).");
+}
+
+/**
+ * @brief Gets the same adaptive budget with other maximums, as overridden by
+ * 		  the options of a single decode, where the minimums are lowered to
+ * 		  the maximums if above them.
+ *
+ * @param max_beam_width The beam width of the most uncertain frames.
+ * @param max_cutoff_top_n The number of candidates of the most uncertain frames.
+ *
+ * @return zctc::AdaptiveBeam The bounded adaptive budget.
+ */
+zctc::AdaptiveBeam
+zctc::AdaptiveBeam::bounded(std::size_t max_beam_width, int max_cutoff_top_n) const
+{
+	return zctc::AdaptiveBeam(this->measure, std::min(this->min_beam_width, max_beam_width), max_beam_width,
+							  std::min(this->min_cutoff_top_n, max_cutoff_top_n), max_cutoff_top_n, this->threshold);
+}
+
+/**
+ * @brief Gets the uncertainty of the frame, scaled by the threshold into [0, 1].
+ *
+ * NOTE: Both measures only read the frame's candidates, which are selected
+ * 		 anyway, instead of the whole vocab. The entropy is of the candidates
+ * 		 with the rest of the probability mass as a single outcome, a lower
+ * 		 bound of the frame's entropy, which is close for the peaked frames
+ * 		 of CTC, while the margin only needs the top two candidates.
+ *
+ * @tparam T The score type of the decoder.
+ * @tparam M The precision policy of the log.
+ * @param frame The logits of the frame.
+ * @param vocab_size The vocab size.
+ * @param ids The ids of the frame sorted by their probability, at least the `max_cutoff_top_n` most probable ones.
+ *
+ * @return T The uncertainty, 0 for the most confident and 1 for the most uncertain frames.
+ */
+template <typename T, typename M, typename F>
+T
+zctc::AdaptiveBeam::uncertainty(const F& frame, int vocab_size, const int* ids) const
+{
+	const int count = std::min(this->max_cutoff_top_n, vocab_size);
+
+	if (this->measure == zctc::AdaptiveMeasure::ENTROPY) {
+		T prob, mass = 0, entropy = 0;
+		for (int i = 0; i < count; i++) {
+			prob = zctc::prob_at<T>(frame, ids[i]);
+			if (prob > 0) {
+				mass += prob;
+				entropy -= prob * M::log(prob);
+			}
+		}
+
+		T rest = 1 - mass;
+		if (rest > 0)
+			entropy -= rest * M::log(rest);
+
+		return std::min(entropy / static_cast<T>(this->threshold), static_cast<T>(1));
+	}
+
+	T top1 = zctc::prob_at<T>(frame, ids[0]);
+	T top2 = (count > 1) ? zctc::prob_at<T>(frame, ids[1]) : 0;
+
+	return std::clamp((1 - (top1 - top2)) / static_cast<T>(1 - this->threshold), static_cast<T>(0), static_cast<T>(1));
+}
+
+/**
+ * @brief Gets the search budget of the frame, linearly interpolated between
+ * 		  the minimum and maximum bounds by the frame's uncertainty.
+ *
+ * @tparam T The score type of the decoder.
+ * @tparam M The precision policy of the log.
+ * @param frame The logits of the frame.
+ * @param vocab_size The vocab size.
+ * @param ids The ids of the frame sorted by their probability, at least the `max_cutoff_top_n` most probable ones.
+ *
+ * @return zctc::FrameBudget The beam width and number of candidates of the frame.
+ */
+template <typename T, typename M, typename F>
+zctc::FrameBudget
+zctc::AdaptiveBeam::budget(const F& frame, int vocab_size, const int* ids) const
+{
+	if (!this->enabled())
+		return { this->max_beam_width, this->max_cutoff_top_n };
+
+	T level = this->uncertainty<T, M>(frame, vocab_size, ids);
+
+	return { this->min_beam_width
+				 + static_cast<std::size_t>(std::lround(level * (this->max_beam_width - this->min_beam_width))),
+			 this->min_cutoff_top_n
+				 + static_cast<int>(std::lround(level * (this->max_cutoff_top_n - this->min_cutoff_top_n))) };
+}
+
+#endif // _ZCTC_ADAPTIVE_H
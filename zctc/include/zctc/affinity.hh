@@ -0,0 +1,241 @@
+#ifndef _ZCTC_AFFINITY_H
+#define _ZCTC_AFFINITY_H
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ThreadPool.h"
+
+namespace zctc {
+
+std::vector<int> parse_cpu_list(const std::string& cpu_list);
+std::vector<int> allowed_cpus();
+int cpu_numa_node(int cpu);
+
+std::vector<int> assign_worker_cpus(int thread_count, const std::string& cpu_list);
+void pin_current_thread(int cpu);
+bool prefer_local_memory();
+void pin_workers(ThreadPool& pool, const std::vector<int>& worker_cpus);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Parses a CPU list in the format of `taskset -c` and the cpuset
+ * 		  files, (ie) comma separated CPUs and inclusive ranges, such as
+ * 		  "0-3,8,10-11", keeping the order they're listed in.
+ *
+ * @param cpu_list The CPU list to parse.
+ *
+ * @return std::vector<int> The CPUs listed.
+ */
+std::vector<int>
+zctc::parse_cpu_list(const std::string& cpu_list)
+{
+	std::vector<int> cpus;
+	std::stringstream ss(cpu_list);
+	std::string item;
+
+	while (std::getline(ss, item, ',')) {
+		item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+		if (item.empty())
+			continue;
+
+		auto parse_cpu = [](const std::string& value) {
+			std::size_t end;
+			int cpu = std::stoi(value, &end);
+			if (cpu < 0 || end != value.size())
+				throw std::invalid_argument(value);
+
+			return cpu;
+		};
+
+		std::size_t dash = item.find('-');
+		try {
+			int first = parse_cpu(item.substr(0, dash));
+			int last = (dash == std::string::npos) ? first : parse_cpu(item.substr(dash + 1));
+			if (last < first)
+				throw std::invalid_argument(item);
+
+			for (int cpu = first; cpu <= last; cpu++)
+				cpus.emplace_back(cpu);
+		} catch (const std::logic_error&) {
+			throw std::runtime_error("Invalid CPU list, " + cpu_list + ", expected CPUs and ranges like 0-3,8");
+		}
+	}
+
+	return cpus;
+}
+
+/**
+ * @brief Lists the CPUs the process is allowed to run on, which the cgroup's
+ * 		  cpuset or an outer `taskset` may restrict.
+ *
+ * @return std::vector<int> The allowed CPUs, in ascending order.
+ */
+std::vector<int>
+zctc::allowed_cpus()
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		throw std::runtime_error(std::string("Cannot get the CPU affinity of the process, ") + std::strerror(errno));
+
+	std::vector<int> cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &set))
+			cpus.emplace_back(cpu);
+	}
+
+	return cpus;
+}
+
+/**
+ * @brief Finds the NUMA node of the provided CPU from sysfs.
+ *
+ * @param cpu The CPU to find the node of.
+ *
+ * @return int The NUMA node of the CPU, 0 if the kernel doesn't expose one,
+ * 		   as on the single node machines.
+ */
+int
+zctc::cpu_numa_node(int cpu)
+{
+	std::error_code error;
+	std::filesystem::directory_iterator entries("/sys/devices/system/cpu/cpu" + std::to_string(cpu), error);
+	if (error)
+		return 0;
+
+	for (const auto& entry : entries) {
+		std::string name = entry.path().filename().string();
+		if (name.size() > 4 && name.compare(0, 4, "node") == 0
+			&& std::all_of(name.begin() + 4, name.end(), ::isdigit))
+			return std::stoi(name.substr(4));
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Assigns a CPU of the provided list to every worker, in the order the
+ * 		  CPUs are listed and wrapping around if there are more workers than
+ * 		  CPUs. Listing the CPUs of one NUMA node before the others fills that
+ * 		  node first.
+ *
+ * @param thread_count The number of workers.
+ * @param cpu_list The CPU list, as `parse_cpu_list`, empty to not pin the workers.
+ *
+ * @return std::vector<int> The CPU of every worker, empty if `cpu_list` is.
+ */
+std::vector<int>
+zctc::assign_worker_cpus(int thread_count, const std::string& cpu_list)
+{
+	std::vector<int> cpus = zctc::parse_cpu_list(cpu_list), worker_cpus;
+	if (cpus.empty())
+		return worker_cpus;
+
+	std::vector<int> allowed = zctc::allowed_cpus();
+	for (int cpu : cpus) {
+		if (!std::binary_search(allowed.begin(), allowed.end(), cpu))
+			throw std::runtime_error("Cannot pin the workers to CPU " + std::to_string(cpu)
+									 + ", which the process isn't allowed to run on");
+	}
+
+	for (int i = 0; i < thread_count; i++)
+		worker_cpus.emplace_back(cpus[i % cpus.size()]);
+
+	return worker_cpus;
+}
+
+/**
+ * @brief Pins the calling thread to the provided CPU.
+ *
+ * @param cpu The CPU to pin to.
+ *
+ * @return void
+ */
+void
+zctc::pin_current_thread(int cpu)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+
+	int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (error != 0)
+		throw std::runtime_error("Cannot pin the thread to CPU " + std::to_string(cpu) + ", " + std::strerror(error));
+}
+
+/**
+ * @brief Makes the pages first touched by the calling thread be allocated on
+ * 		  the NUMA node of the CPU it runs on, overriding a policy inherited
+ * 		  from the process, such as the interleaving of `numactl --interleave`.
+ *
+ * @return bool Whether the policy is set, false if the kernel isn't built with NUMA support.
+ */
+bool
+zctc::prefer_local_memory()
+{
+	return syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == 0;
+}
+
+/**
+ * @brief Pins every worker of the pool to its CPU, with its memory allocated
+ * 		  on the CPU's NUMA node from then on. The nodes, the scoring batches
+ * 		  and the LM caches of an utterance are allocated by the worker
+ * 		  decoding it, so they stay local to the worker.
+ *
+ * @param pool The pool to pin the workers of, which must be idle.
+ * @param worker_cpus The CPU of every worker, as `assign_worker_cpus`.
+ *
+ * @return void
+ */
+void
+zctc::pin_workers(ThreadPool& pool, const std::vector<int>& worker_cpus)
+{
+	/**
+	 * NOTE: The workers aren't reachable from outside the pool, so a task is
+	 * 		 queued per worker, and every task waits for the others to start,
+	 * 		 which makes every worker run exactly one of them.
+	 */
+	std::mutex mutex;
+	std::condition_variable all_started;
+	std::size_t started = 0;
+	std::vector<std::future<void>> pinned;
+
+	for (int cpu : worker_cpus) {
+		pinned.emplace_back(pool.enqueue([&, cpu]() {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				if (++started == worker_cpus.size())
+					all_started.notify_all();
+				else
+					all_started.wait(lock, [&]() { return started == worker_cpus.size(); });
+			}
+
+			zctc::pin_current_thread(cpu);
+			zctc::prefer_local_memory();
+		}));
+	}
+
+	for (std::future<void>& future : pinned)
+		future.get();
+}
+
+#endif // _ZCTC_AFFINITY_H
@@ -0,0 +1,320 @@
+#ifndef _ZCTC_BATCHER_H
+#define _ZCTC_BATCHER_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace zctc {
+
+/**
+ * @brief Groups the jobs pushed from any thread into micro-batches, each
+ * 		  dispatched once `max_batch_size` jobs are queued or the oldest of
+ * 		  them has waited `max_wait`, whichever is first. The batches are
+ * 		  dispatched one at a time on the batcher's own thread, in the order
+ * 		  the jobs were pushed.
+ *
+ * 		  At most `max_inflight` batches are dispatched and not yet completed
+ * 		  with `complete`. While they are, the jobs keep queueing, so under a
+ * 		  heavy load the batches grow up to `max_batch_size` rather than the
+ * 		  dispatched work piling up, and the deadline only bounds the latency
+ * 		  added at a light load.
+ *
+ * @tparam J The type of the jobs.
+ */
+template <typename J>
+class MicroBatcher {
+public:
+	using Dispatch = std::function<void(std::vector<J>&&)>;
+
+	struct Counters {
+		long jobs = 0, batches = 0;
+	};
+
+	MicroBatcher(int max_batch_size, std::chrono::microseconds max_wait, int max_inflight, Dispatch dispatch);
+	~MicroBatcher();
+
+	MicroBatcher(const MicroBatcher&) = delete;
+	MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+	void push(J job);
+	void complete();
+	void stop();
+
+	Counters counters();
+
+private:
+	const int max_batch_size, max_inflight;
+	const std::chrono::microseconds max_wait;
+	const Dispatch dispatch;
+
+	std::mutex mutex;
+	std::condition_variable queued, completed;
+	std::deque<std::pair<std::chrono::steady_clock::time_point, J>> queue;
+	int inflight = 0;
+	bool stopping = false;
+	Counters totals;
+	std::thread thread;
+
+	void run();
+};
+
+/**
+ * @brief Runs the completions posted from any thread on its own thread, one
+ * 		  at a time in the order they're posted, so the callers' callbacks
+ * 		  neither run on nor block the threads posting them.
+ *
+ * 		  If stopped from one of its own completions, like a callback dropping
+ * 		  the last reference to the owner, the thread is detached instead of
+ * 		  joining itself, and still runs the completions already posted.
+ */
+class CompletionQueue {
+public:
+	using Completion = std::function<void()>;
+
+	CompletionQueue();
+	~CompletionQueue();
+
+	CompletionQueue(const CompletionQueue&) = delete;
+	CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+	void post(Completion completion);
+	void stop();
+
+private:
+	struct State {
+		std::mutex mutex;
+		std::condition_variable posted;
+		std::deque<Completion> queue;
+		bool stopping = false;
+	};
+
+	// NOTE: Shared with the thread, which may outlive the queue once detached.
+	std::shared_ptr<State> state;
+	std::thread thread;
+
+	static void run(std::shared_ptr<State> state);
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Starts the batcher's thread.
+ *
+ * @param max_batch_size The number of jobs of a batch at most.
+ * @param max_wait The time the oldest queued job waits for more jobs to batch with.
+ * @param max_inflight The number of batches dispatched and not yet completed at most.
+ * @param dispatch The callable dispatching a batch, which must eventually call `complete` once for it, from any
+ * thread, even if it fails.
+ */
+template <typename J>
+zctc::MicroBatcher<J>::MicroBatcher(int max_batch_size, std::chrono::microseconds max_wait, int max_inflight,
+									Dispatch dispatch)
+	: max_batch_size(std::max(1, max_batch_size))
+	, max_inflight(std::max(1, max_inflight))
+	, max_wait(max_wait)
+	, dispatch(std::move(dispatch))
+{
+	this->thread = std::thread(&MicroBatcher::run, this);
+}
+
+template <typename J>
+zctc::MicroBatcher<J>::~MicroBatcher()
+{
+	this->stop();
+}
+
+/**
+ * @brief Queues a job to be dispatched with the next batch.
+ *
+ * @param job The job to queue.
+ *
+ * @return void
+ */
+template <typename J>
+void
+zctc::MicroBatcher<J>::push(J job)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (this->stopping)
+			throw std::runtime_error("Cannot queue a job on a stopped batcher.");
+
+		this->queue.emplace_back(std::chrono::steady_clock::now(), std::move(job));
+	}
+	this->queued.notify_one();
+}
+
+/**
+ * @brief Marks a dispatched batch as completed, letting the next one be dispatched.
+ *
+ * @return void
+ */
+template <typename J>
+void
+zctc::MicroBatcher<J>::complete()
+{
+	// NOTE: Notified under the lock, as the batcher may be freed right after its last batch completes.
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->inflight--;
+	this->completed.notify_all();
+}
+
+/**
+ * @brief Dispatches the queued jobs without waiting for their deadline, and
+ * 		  waits for every dispatched batch to complete. Pushing a job after
+ * 		  fails.
+ *
+ * @return void
+ */
+template <typename J>
+void
+zctc::MicroBatcher<J>::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->stopping = true;
+	}
+	this->queued.notify_one();
+
+	if (this->thread.joinable())
+		this->thread.join();
+
+	std::unique_lock<std::mutex> lock(this->mutex);
+	this->completed.wait(lock, [this]() { return this->inflight == 0; });
+}
+
+/**
+ * @brief Counts the jobs and batches dispatched so far.
+ *
+ * @return Counters The dispatch counters.
+ */
+template <typename J>
+typename zctc::MicroBatcher<J>::Counters
+zctc::MicroBatcher<J>::counters()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->totals;
+}
+
+template <typename J>
+void
+zctc::MicroBatcher<J>::run()
+{
+	std::unique_lock<std::mutex> lock(this->mutex);
+
+	while (true) {
+		this->queued.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+		if (this->queue.empty())
+			return;
+
+		auto deadline = this->queue.front().first + this->max_wait;
+		this->queued.wait_until(lock, deadline, [this]() {
+			return this->stopping || static_cast<int>(this->queue.size()) >= this->max_batch_size;
+		});
+		this->completed.wait(lock, [this]() { return this->inflight < this->max_inflight; });
+
+		std::vector<J> batch;
+		while (!this->queue.empty() && static_cast<int>(batch.size()) < this->max_batch_size) {
+			batch.emplace_back(std::move(this->queue.front().second));
+			this->queue.pop_front();
+		}
+		this->inflight++;
+		this->totals.jobs += batch.size();
+		this->totals.batches++;
+
+		lock.unlock();
+		this->dispatch(std::move(batch));
+		lock.lock();
+	}
+}
+
+/**
+ * @brief Starts the queue's thread.
+ */
+zctc::CompletionQueue::CompletionQueue()
+	: state(std::make_shared<State>())
+{
+	this->thread = std::thread(&CompletionQueue::run, this->state);
+}
+
+zctc::CompletionQueue::~CompletionQueue()
+{
+	this->stop();
+}
+
+/**
+ * @brief Queues a completion to be run on the queue's thread.
+ *
+ * @param completion The completion to run.
+ *
+ * @return void
+ */
+void
+zctc::CompletionQueue::post(Completion completion)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->state->mutex);
+		if (this->state->stopping)
+			throw std::runtime_error("Cannot post a completion on a stopped queue.");
+
+		this->state->queue.emplace_back(std::move(completion));
+	}
+	this->state->posted.notify_one();
+}
+
+/**
+ * @brief Runs the posted completions and stops the thread, waiting for it
+ * 		  unless called from it. Posting a completion after fails.
+ *
+ * @return void
+ */
+void
+zctc::CompletionQueue::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(this->state->mutex);
+		this->state->stopping = true;
+	}
+	this->state->posted.notify_one();
+
+	if (!this->thread.joinable())
+		return;
+
+	if (this->thread.get_id() == std::this_thread::get_id())
+		this->thread.detach();
+	else
+		this->thread.join();
+}
+
+void
+zctc::CompletionQueue::run(std::shared_ptr<State> state)
+{
+	std::unique_lock<std::mutex> lock(state->mutex);
+
+	while (true) {
+		state->posted.wait(lock, [&state]() { return state->stopping || !state->queue.empty(); });
+		if (state->queue.empty())
+			return;
+
+		Completion completion = std::move(state->queue.front());
+		state->queue.pop_front();
+
+		lock.unlock();
+		completion();
+		// NOTE: Destroyed before locking, as releasing its captures may stop the queue.
+		completion = nullptr;
+		lock.lock();
+	}
+}
+
+#endif // _ZCTC_BATCHER_H
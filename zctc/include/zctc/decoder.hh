@@ -1,54 +1,216 @@
 #ifndef _ZCTC_DECODER_H
 #define _ZCTC_DECODER_H
 
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+
 #include "ThreadPool.h"
+#include "pybind11/numpy.h"
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
 
+#include "./adaptive.hh"
+#include "./affinity.hh"
+#include "./batcher.hh"
 #include "./ext_scorer.hh"
+#include "./greedy.hh"
+#include "./logits.hh"
 #include "./node.hh"
+#include "./perf.hh"
+#include "./tensor.hh"
+#include "./trace.hh"
 #include "./zfst.hh"
 
 namespace py = pybind11;
 
 namespace zctc {
 
+/**
+ * @brief The views of a batch of tensors being decoded and the output arrays
+ * 		  it's decoded into, along with the completion callback of the
+ * 		  asynchronous decodes. Created and released with the GIL held, while
+ * 		  the raw pointers are used by the decoding threads without it.
+ */
+struct TensorBatch {
+	const bool time_major;
+	int batch_size, max_seq_len;
+	std::optional<zctc::TensorView> logits;
+	std::vector<int> seq_lens;
+	std::optional<py::array_t<int>> labels, timesteps, seq_pos;
+	int *labels_ptr, *timesteps_ptr, *seq_pos_ptr;
+	std::vector<zctc::DecodeStats> stats;
+	std::optional<py::function> callback;
+
+	TensorBatch(py::handle logits, py::handle seq_len, bool time_major, int vocab_size, std::size_t beam_width,
+				bool collect_stats, bool hw_counters, int configs = 1);
+
+	py::tuple outputs();
+	py::list config_outputs(int configs);
+	void release();
+};
+
+class Decoder;
+
+/**
+ * @brief The search and scorer params of a decode, which are the decoder's
+ * 		  own unless overridden for a single call, like a narrower beam to
+ * 		  shed load or the LM weights of a tenant, without constructing a
+ * 		  decoder and loading its LM and lexicon again. The values are in
+ * 		  the units of the decoder's constructor, so the min token prob is
+ * 		  a log probability, while the nucleus prob is in linear scale.
+ */
+struct DecodeOptions {
+	std::size_t beam_width;
+	int cutoff_top_n;
+	float nucleus_prob_per_timestep, min_tok_prob, max_beam_score_deviation;
+	zctc::ScorerParams scorer;
+};
+
+/**
+ * @brief The beams of an utterance decoded with `Decoder::submit`, of the
+ * 		  utterance's own length. The labels and timesteps are of shape
+ * 		  BeamWidth x SeqLen, where the beam `b` starts at `seq_pos[b]`.
+ */
+struct DecodeResult {
+	int seq_len;
+	std::vector<int> labels, timesteps, seq_pos;
+};
+
+/**
+ * @brief An utterance queued with `Decoder::submit`, until its micro-batch is
+ * 		  decoded. The logits are the caller's, of shape SeqLen x Vocab.
+ */
+struct SubmittedUtterance {
+	const float* logits;
+	int seq_len;
+	DecodeOptions options;
+	std::function<void(DecodeResult&&, std::exception_ptr)> on_complete;
+};
+
+/**
+ * @brief The work of decoding an utterance which doesn't depend on the scorer
+ * 		  params, (ie) the candidates and budget of every frame and the KenLM
+ * 		  queries, done once and shared by the decodes of the utterance with
+ * 		  every scorer params.
+ */
+struct UtteranceCache {
+	std::vector<int> ids;
+	std::vector<zctc::FrameBudget> budgets;
+	zctc::LmCache lm_cache;
+
+	template <typename T, typename M, typename S>
+	void prepare(const Decoder* decoder, S logits, const int* sorted_ids, int seq_len);
+};
+
 class Decoder {
 public:
-	template <typename T>
-	static bool descending_compare(zctc::Node<T>* x, zctc::Node<T>* y);
+	template <typename T, typename E>
+	static bool descending_compare(zctc::Node<T, E>* x, zctc::Node<T, E>* y);
 
 	const int thread_count, blank_id, cutoff_top_n, vocab_size;
 	const float nucleus_prob_per_timestep, min_tok_prob, max_beam_score_deviation;
 	const std::size_t beam_width;
+	const bool fast_math;
+	const AdaptiveBeam adaptive;
 	const std::vector<std::string> vocab;
 	const ExternalScorer ext_scorer;
+	// NOTE: The CPU every worker is pinned to, empty if the workers aren't pinned.
+	const std::vector<int> worker_cpus;
 
 	Decoder(int thread_count, int blank_id, int cutoff_top_n, int apostrophe_id, float nucleus_prob_per_timestep,
 			float alpha, float beta, std::size_t beam_width, float lex_penalty, float min_tok_prob,
 			float max_beam_score_deviation, char tok_sep, std::vector<std::string> vocab, char* lm_path,
-			char* lexicon_path)
+			char* lexicon_path, char* trace_path = nullptr, bool fast_math = false,
+			AdaptiveMeasure adaptive_measure = AdaptiveMeasure::NONE, std::size_t min_beam_width = 0,
+			int min_cutoff_top_n = 0, float adaptive_threshold = 0,
+			LmLoadMethod lm_load_method = LmLoadMethod::POPULATE_OR_READ, bool lm_require_binary = false,
+			bool lm_warm_up = false, int submit_max_batch_size = 32, float submit_max_wait_ms = 1.0,
+			const std::string& worker_cpu_list = "")
 		: thread_count(thread_count)
 		, blank_id(blank_id)
 		, cutoff_top_n(cutoff_top_n)
 		, vocab_size(vocab.size())
 		, nucleus_prob_per_timestep(nucleus_prob_per_timestep)
-		, min_tok_prob(std::exp(min_tok_prob))
+		, min_tok_prob(min_tok_prob)
 		, max_beam_score_deviation(max_beam_score_deviation)
 		, beam_width(beam_width)
+		, fast_math(fast_math)
+		, adaptive(adaptive_measure, min_beam_width, beam_width, min_cutoff_top_n, cutoff_top_n, adaptive_threshold)
 		, vocab(vocab)
-		, ext_scorer(tok_sep, apostrophe_id, alpha, beta, lex_penalty, lm_path, lexicon_path)
+		, ext_scorer(tok_sep, apostrophe_id, alpha, beta, lex_penalty, lm_path, lexicon_path,
+					 { lm_load_method, lm_require_binary, lm_warm_up })
+		, worker_cpus(zctc::assign_worker_cpus(thread_count, worker_cpu_list))
+		, pool(std::make_unique<ThreadPool>(thread_count))
+		, submit_max_batch_size(submit_max_batch_size)
+		, submit_max_wait_ms(submit_max_wait_ms)
 	{
+		if (!this->worker_cpus.empty())
+			zctc::pin_workers(*this->pool, this->worker_cpus);
+		this->tracing = zctc::Tracer::instance().configure(trace_path);
+	}
+
+	~Decoder()
+	{
+		/**
+		 * NOTE: The workers finish the pending batches before exiting,
+		 * 		 whose completions may need the GIL, so it's released
+		 * 		 while joining them, if destroyed from Python.
+		 */
+		std::optional<py::gil_scoped_release> release;
+		if (Py_IsInitialized() && PyGILState_Check())
+			release.emplace();
+
+		// NOTE: Stopped in place, as its last batch's completion still refers to it.
+		if (this->batcher)
+			this->batcher->stop();
+		this->pool.reset();
+		if (this->completions)
+			this->completions->stop();
+
+		if (this->tracing)
+			zctc::Tracer::instance().release();
 	}
 
 	fst::StdVectorFst* generate_hw_fst(const std::vector<std::vector<int>>& hotwords_id,
 									   const std::vector<float>& hotwords_weight,
 									   fst::StdVectorFst* hotwords_fst) const;
 
-	template <typename T>
-	void batch_decode(T* logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+	DecodeOptions options() const;
+	void check_options(const DecodeOptions& options) const;
+
+	std::future<DecodeResult> submit(const float* logits, int seq_len, const DecodeOptions* options = nullptr) const;
+	void submit_async(const float* logits, int seq_len,
+					  std::function<void(DecodeResult&&, std::exception_ptr)> on_complete,
+					  const DecodeOptions* options = nullptr) const;
+	void submit_tensor(py::array_t<float, py::array::c_style | py::array::forcecast> logits, py::function callback,
+					   const DecodeOptions* options) const;
+
+	template <typename S>
+	void batch_decode(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
 					  const int batch_size, const int max_seq_len, std::vector<std::vector<int>>& hotwords_id,
-					  std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst) const;
+					  std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+					  zctc::DecodeStats* stats = nullptr, const DecodeOptions* options = nullptr) const;
+
+	template <typename S>
+	void batch_decode_async(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+							const int batch_size, const int max_seq_len, std::vector<std::vector<int>>& hotwords_id,
+							std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+							zctc::DecodeStats* stats, std::function<void(std::exception_ptr)> on_complete,
+							const DecodeOptions* options = nullptr) const;
+
+	template <typename S>
+	void batch_decode_multi(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+							const int batch_size, const int max_seq_len, const std::vector<zctc::ScorerParams>& configs,
+							std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+							fst::StdVectorFst* hotwords_fst, zctc::DecodeStats* stats = nullptr) const;
+
+	template <typename S>
+	void batch_greedy_decode(S logits, int* labels, int* timesteps, int* seq_len, int* seq_pos, const int batch_size,
+							 const int max_seq_len) const;
 
 	/**
 	 * @brief Decodes the provided logits using CTC Beam Search algorithm. This function is the main entry point
@@ -56,9 +218,9 @@ public:
 	 * we need to use a wrapper function to convert the `long` type to the appropriate pointer type based on the
 	 * logit bytes.
 	 *
-	 * @param logits The logits array pointer, which can be either a float or double pointer, depending on the logit
-	 * bytes.
-	 * @param logit_bytes The size of the logit type in bytes (either 4 for float or 8 for double).
+	 * @param logits The logits array pointer, which can be either a half, float or double pointer, depending on the
+	 * logit bytes.
+	 * @param logit_bytes The size of the logit type in bytes (either 2 for half, 4 for float or 8 for double).
 	 * @param ids The sorted ids array pointer, which is an integer pointer.
 	 * @param labels The labels array pointer, which is an integer pointer.
 	 * @param timesteps The timesteps array pointer, which is an integer pointer.
@@ -69,27 +231,137 @@ public:
 	 * @param hotwords_id The hotwords ids vector, which is a vector of hotword token ids.
 	 * @param hotwords_weight The hotwords weights vector, which is a vector of hotword token weights.
 	 * @param hotwords_fst The hotwords finite state transducer, which is a pointer to a `fst::StdVectorFst` object.
+	 * @param collect_stats Whether to collect the per utterance decode stats.
+	 * @param hw_counters Whether to also collect the hardware counters of every decode phase, implies `collect_stats`.
+	 * @param is_bfloat16 Whether the 2 byte logits are bfloat16 instead of IEEE half precision.
+	 *
+	 * @return std::vector<zctc::DecodeStats> The stats of every utterance in the batch, if `collect_stats` is set,
+	 * else an empty vector.
 	 *
 	 * @note This function is used to decode the logits in a batch-wise manner, allowing for efficient decoding
 	 * of multiple sequences at once. The logits should be in the shape of Batch x SeqLen x Vocab, containing the
 	 * softmaxed probabilities in linear scale.
 	 */
-	void batch_decode_wrapper(long logits, int logit_bytes, long ids, long labels, long timesteps, long seq_len,
-							  long seq_pos, const int batch_size, const int max_seq_len,
-							  std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
-							  fst::StdVectorFst* hotwords_fst) const
+	std::vector<zctc::DecodeStats> batch_decode_wrapper(long logits, int logit_bytes, long ids, long labels,
+														long timesteps, long seq_len, long seq_pos, const int batch_size,
+														const int max_seq_len,
+														std::vector<std::vector<int>>& hotwords_id,
+														std::vector<float>& hotwords_weight,
+														fst::StdVectorFst* hotwords_fst, bool collect_stats,
+														bool hw_counters, bool is_bfloat16) const
 	{
-		if (logit_bytes == sizeof(float)) {
+		collect_stats = collect_stats || hw_counters;
+		std::vector<zctc::DecodeStats> stats(collect_stats ? batch_size : 0);
+		for (zctc::DecodeStats& stat : stats)
+			stat.hw_counters = hw_counters;
+
+		if (logit_bytes == sizeof(zctc::float16) && is_bfloat16) {
+			this->batch_decode((zctc::bfloat16*)logits, (int*)ids, (int*)labels, (int*)timesteps, (int*)seq_len,
+							   (int*)seq_pos, batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst,
+							   collect_stats ? stats.data() : nullptr);
+		} else if (logit_bytes == sizeof(zctc::float16)) {
+			this->batch_decode((zctc::float16*)logits, (int*)ids, (int*)labels, (int*)timesteps, (int*)seq_len,
+							   (int*)seq_pos, batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst,
+							   collect_stats ? stats.data() : nullptr);
+		} else if (logit_bytes == sizeof(float)) {
 			this->batch_decode((float*)logits, (int*)ids, (int*)labels, (int*)timesteps, (int*)seq_len, (int*)seq_pos,
-							   batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst);
+							   batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst,
+							   collect_stats ? stats.data() : nullptr);
 		} else if (logit_bytes == sizeof(double)) {
 			this->batch_decode((double*)logits, (int*)ids, (int*)labels, (int*)timesteps, (int*)seq_len, (int*)seq_pos,
-							   batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst);
+							   batch_size, max_seq_len, hotwords_id, hotwords_weight, hotwords_fst,
+							   collect_stats ? stats.data() : nullptr);
 		} else {
-			throw std::runtime_error("Invalid logit dtype. Expected floating point value of precision 32 or 64 bits.");
+			throw std::runtime_error(
+				"Invalid logit dtype. Expected floating point value of precision 16, 32 or 64 bits.");
 		}
+
+		return stats;
 	}
 
+	/**
+	 * @brief Decodes the provided tensor of logits in place, without copying or reordering it, where the tensor is
+	 * any object implementing either the DLPack or the buffer protocol, at any strides. The candidates of every
+	 * timestep are selected while decoding, so no sorted ids are needed.
+	 *
+	 * @param logits The logits tensor of shape Batch x SeqLen x Vocab, or SeqLen x Batch x Vocab if `time_major`,
+	 * of type float16, bfloat16, float32 or float64, containing the softmaxed probabilities in linear scale.
+	 * @param seq_len The 1-D int32 or int64 tensor of the sequence lengths, excluding the padding.
+	 * @param time_major Whether the first axis of the logits is the time instead of the batch.
+	 * @param options The options to decode the batch with, or `nullptr` for the decoder's own. The outputs have
+	 * their beam width.
+	 *
+	 * @return py::tuple The labels and timesteps arrays of shape Batch x BeamWidth x MaxSeqLen, the sequence
+	 * positions array of shape Batch x BeamWidth, as numpy int32 arrays, and the decode stats.
+	 *
+	 * @note The rest of the parameters are the same as `batch_decode_wrapper`. The GIL is only released while
+	 * decoding, as the views of the tensors are created and released with it held.
+	 */
+	py::tuple batch_decode_tensor(py::handle logits, py::handle seq_len, bool time_major,
+								  std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+								  fst::StdVectorFst* hotwords_fst, bool collect_stats, bool hw_counters,
+								  const DecodeOptions* options = nullptr) const;
+
+	/**
+	 * @brief Submits the provided tensor of logits for decoding on the decoder's worker threads and returns
+	 * immediately, without waiting for the batch to be decoded.
+	 *
+	 * @param callback The callable invoked once the batch is decoded, on the decoder's completion thread, off the
+	 * worker threads, with the GIL held. It's called as `callback(outputs, None)` with the same outputs as
+	 * `batch_decode_tensor`, or as `callback(None, error)` with the error message if the decoding failed.
+	 *
+	 * @note The rest of the parameters are the same as `batch_decode_tensor`. The tensors are kept alive until the
+	 * callback returns.
+	 */
+	void batch_decode_tensor_async(py::handle logits, py::handle seq_len, bool time_major,
+								   std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+								   fst::StdVectorFst* hotwords_fst, bool collect_stats, bool hw_counters,
+								   py::function callback, const DecodeOptions* options = nullptr) const;
+
+	/**
+	 * @brief Decodes the provided tensor of logits once for each of the scorer params, sharing the candidate
+	 * selection, the per frame budgets and the KenLM queries, which don't depend on the params, between them.
+	 *
+	 * @param configs The scorer params to decode the logits with.
+	 *
+	 * @return py::list The outputs of every scorer params, in order, each the same as `batch_decode_tensor`.
+	 *
+	 * @note The rest of the parameters are the same as `batch_decode_tensor`.
+	 */
+	py::list batch_decode_tensor_multi(py::handle logits, py::handle seq_len, bool time_major,
+									   const std::vector<zctc::ScorerParams>& configs,
+									   std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+									   fst::StdVectorFst* hotwords_fst, bool collect_stats, bool hw_counters) const;
+
+	/**
+	 * @brief Decodes the best path of the provided tensor of logits, (ie) the most probable token of every frame
+	 * with the repeats collapsed and the blanks dropped, without the beam search.
+	 *
+	 * @return py::tuple The same outputs as `batch_decode_tensor` with a single beam, without the stats.
+	 *
+	 * @note The parameters are the same as `batch_decode_tensor`.
+	 */
+	py::tuple batch_greedy_decode_tensor(py::handle logits, py::handle seq_len, bool time_major) const;
+
+	/**
+	 * @brief Decodes the provided int8 quantized log probabilities using CTC Beam Search algorithm. Only the
+	 * candidates consumed by the search are dequantized, as `exp(value * scale + offset)`.
+	 *
+	 * @param values The contiguous int8 tensor of the quantized log probabilities, of shape Batch x SeqLen x Vocab.
+	 * @param scales The float32 or float64 tensor of the scales, of shape Batch x SeqLen for per frame scales, or of
+	 * shape Batch for per utterance scales.
+	 * @param offsets The float32 or float64 tensor of the offsets, of the same shape as the scales.
+	 *
+	 * @return py::tuple The same outputs as `batch_decode_tensor`.
+	 *
+	 * @note The candidates of every frame are ranked on their quantized values, which is only valid for a positive
+	 * scale, so any other scale is rejected. The rest of the parameters are the same as `batch_decode_tensor`.
+	 */
+	py::tuple batch_decode_quantized_tensor(py::handle values, py::handle scales, py::handle offsets,
+											py::handle seq_len, std::vector<std::vector<int>>& hotwords_id,
+											std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+											bool collect_stats, bool hw_counters) const;
+
 #ifndef NDEBUG
 	/**
 	 * @note This function is only for debugging purpose. It will only be compiled in debug mode build.
@@ -115,6 +387,51 @@ public:
 		}
 	}
 #endif // NDEBUG
+
+private:
+	std::unique_ptr<ThreadPool> pool;
+	bool tracing = false;
+
+	/**
+	 * NOTE: The batcher of `submit` is started on the first submission, so
+	 * 		 the decoders only decoding batches don't run its thread. It's
+	 * 		 declared after the pool, to be stopped before the pool.
+	 */
+	const int submit_max_batch_size;
+	const float submit_max_wait_ms;
+	mutable std::once_flag batcher_started;
+	mutable std::unique_ptr<zctc::MicroBatcher<zctc::SubmittedUtterance>> batcher;
+
+	/**
+	 * NOTE: The Python callbacks of the asynchronous decodes are run on the
+	 * 		 completion queue's thread instead of the workers, so a callback
+	 * 		 decoding synchronously doesn't wait on its own worker, and one
+	 * 		 dropping the last reference to the decoder doesn't join the pool
+	 * 		 from within it. It's started on the first asynchronous decode.
+	 */
+	mutable std::once_flag completions_started;
+	mutable std::unique_ptr<zctc::CompletionQueue> completions;
+
+	/**
+	 * NOTE: The decoder whose worker the thread is running a task of, if
+	 * 		 any, so the batches enqueued from its own workers, like by a
+	 * 		 completion callback decoding synchronously, are run inline.
+	 */
+	inline static thread_local const Decoder* worker_decoder = nullptr;
+
+	void dispatch_submitted(std::vector<zctc::SubmittedUtterance>&& utterances) const;
+	void post_completion(zctc::CompletionQueue::Completion completion) const;
+
+	template <typename F>
+	decltype(auto) with_math(F&& decode_with) const;
+
+	template <typename F>
+	decltype(auto) with_features(fst::StdVectorFst* hotwords_fst, F&& decode_with) const;
+
+	template <typename F>
+	void enqueue_batch(const int batch_size, int* seq_len, std::vector<std::vector<int>>& hotwords_id,
+					   std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst, F decode_utterance,
+					   std::function<void(std::exception_ptr)> on_complete) const;
 };
 
 /**
@@ -126,9 +443,9 @@ public:
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 inline void
-move_clones_to_start(std::vector<zctc::Node<T>*>& source)
+move_clones_to_start(std::vector<zctc::Node<T, E>*>& source)
 {
 	for (int from_pos = 0, to_pos = 0; from_pos < source.size(); from_pos++) {
 		if (!source[from_pos]->is_clone)
@@ -150,9 +467,9 @@ move_clones_to_start(std::vector<zctc::Node<T>*>& source)
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 inline void
-remove_from_source(std::vector<zctc::Node<T>*>& source, std::vector<int>& remove_ids)
+remove_from_source(std::vector<zctc::Node<T, E>*>& source, std::vector<int>& remove_ids)
 {
 	int to_pos = source.size() - 1;
 
@@ -170,11 +487,17 @@ remove_from_source(std::vector<zctc::Node<T>*>& source, std::vector<int>& remove
  * using the provided decoder configuration. The decoded labels, timesteps
  * and sequence lengths are written to the provided array pointers.
  *
+ * @tparam S The type of the logits source, either a pointer to double, float, `zctc::float16` or `zctc::bfloat16`
+ * softmaxed probabilities, or a `zctc::QuantizedLogits` view of int8 log probabilities.
+ * @tparam T The type in which the nodes are scored, the candidates are converted to it one by one as consumed.
+ * @tparam M The precision policy of the log domain arithmetic, either `zctc::ExactMath` or `zctc::FastMath`.
+ * @tparam E The scorer features to decode with, see `Decoder::with_features`. The default `zctc::AllFeatures` checks
+ * at runtime which of them are loaded.
  * @param decoder The decoder configuration to be used for decoding.
- * @param logits The logits array of shape Batch x SeqLen x Vocab, containing the softmaxed probabilities in linear
- * scale.
- * @param ids The sorted ids array of shape Batch x SeqLen x Vocab, containing the sorted indices of the logits at each
- * timestep.
+ * @param logits The logits source of shape SeqLen x Vocab, containing the softmaxed probabilities in linear scale, or
+ * the quantized log probabilities.
+ * @param ids The sorted ids array of shape SeqLen x Vocab, containing the sorted indices of the logits at each
+ * timestep, or `nullptr` to select the top `cutoff_top_n` candidates of each timestep while decoding.
  * @param label The labels array of shape Batch x BeamWidth x MaxSeqLen, to write the decoded labels.
  * @param timestep The timesteps array of shape Batch x BeamWidth x MaxSeqLen, to write the decoded timesteps.
  * @param seq_len The sequence length of the sample in the logits array excluding the padding.
@@ -182,22 +505,36 @@ remove_from_source(std::vector<zctc::Node<T>*>& source, std::vector<int>& remove
  * @param seq_pos The sequence position array of shape Batch x BeamWidth, to write the sequence starting position of the
  * decoded labels.
  * @param hotwords_fst The FST representing the hotwords, if any, to be used for decoding.
+ * @param stats The stats to collect the search counters and phase timings of the utterance in, if any.
+ * @param options The options to decode with, or `nullptr` for the decoder's own. The labels, timesteps and sequence
+ * position arrays have their beam width. The adaptive budget, if enabled, is bounded by their beam width and cutoff.
+ * @param cache The candidates, budgets and KenLM queries of the utterance shared with its other decodes, if any,
+ * prepared with the same `ids`.
  *
  * @return int 0 on successful execution.
  */
-template <typename T>
+template <typename S, typename T = zctc::score_type_t<S>, typename M = zctc::ExactMath,
+		  typename E = zctc::AllFeatures>
 int
-decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, const int seq_len, const int max_seq_len,
-	   int* seq_pos, fst::StdVectorFst* hotwords_fst)
+decode(const Decoder* decoder, S logits, int* ids, int* label, int* timestep, const int seq_len, const int max_seq_len,
+	   int* seq_pos, fst::StdVectorFst* hotwords_fst, zctc::DecodeStats* stats = nullptr,
+	   const zctc::DecodeOptions* options = nullptr, zctc::UtteranceCache* cache = nullptr)
 {
 	bool is_blank, full_beam;
 	int iter_val, pos_val;
-	T nucleus_count, prob, max_beam_score, min_beam_score, beam_score;
+	T nucleus_count, prob, log_prob, max_beam_score, min_beam_score, beam_score;
 	int *curr_id, *curr_l, *curr_t, *curr_p;
-	zctc::Node<T>* child;
-	std::vector<int> writer_remove_ids;
-	std::vector<zctc::Node<T>*> prefixes0, prefixes1, more_confident_repeats;
-	zctc::Node<T> root(static_cast<T>(zctc::ROOT_ID), -1, 0.0, "<s>", nullptr);
+	zctc::Node<T, E>* child;
+	std::vector<int> writer_remove_ids, frame_ids((ids || cache) ? 0 : decoder->vocab_size);
+	std::vector<zctc::Node<T, E>*> prefixes0, prefixes1, more_confident_repeats, created;
+	zctc::ScoreBatch<T, M, E> score_batch;
+	const zctc::DecodeOptions opts = options ? *options : decoder->options();
+	const zctc::ScorerParams& weights = opts.scorer;
+	const float min_tok_prob = std::exp(opts.min_tok_prob);
+	const zctc::AdaptiveBeam adaptive = decoder->adaptive.bounded(opts.beam_width, opts.cutoff_top_n);
+	zctc::FrameBudget budget = { opts.beam_width, opts.cutoff_top_n };
+	zctc::LmCache* lm_cache = cache ? &cache->lm_cache : nullptr;
+	zctc::Node<T, E> root(static_cast<T>(zctc::ROOT_ID), -1, 0.0, "<s>", nullptr);
 	fst::SortedMatcher<fst::StdVectorFst> lexicon_matcher(decoder->ext_scorer.lexicon, fst::MATCH_INPUT);
 	fst::SortedMatcher<fst::StdVectorFst> hotwords_matcher(hotwords_fst, fst::MATCH_INPUT);
 
@@ -207,22 +544,65 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 	 * NOTE: For performance reasons, we initialise and reserve memory
 	 * 		 for the prefixes.
 	 */
-	prefixes0.reserve(2 * decoder->beam_width);
-	prefixes1.reserve(2 * decoder->beam_width);
+	prefixes0.reserve(2 * opts.beam_width);
+	prefixes1.reserve(2 * opts.beam_width);
 	prefixes0.emplace_back(&root);
 
+	/**
+	 * NOTE: Each lap closes the phase which just ended, so the time
+	 * 		 between the score update and the next timestep is the
+	 * 		 pruning, even if the beam didn't need any. The hardware
+	 * 		 counters, if requested, follow the same laps.
+	 */
+	zctc::PhaseCounters counters(stats);
+	zctc::PhaseClock clock(stats);
+
 	for (int timestep = 0; timestep < seq_len; timestep++) {
+		clock.lap(&zctc::DecodeStats::prune_ns);
+		counters.lap(&zctc::DecodeStats::prune_hw);
 		/**
 		 * NOTE: Swap the reader and writer vectors, as per the timestep,
 		 * 		 to avoid cleaning and copying the elements.
 		 */
-		std::vector<zctc::Node<T>*>& reader = ((timestep % 2) == 0 ? prefixes0 : prefixes1);
-		std::vector<zctc::Node<T>*>& writer = ((timestep % 2) == 0 ? prefixes1 : prefixes0);
+		std::vector<zctc::Node<T, E>*>& reader = ((timestep % 2) == 0 ? prefixes0 : prefixes1);
+		std::vector<zctc::Node<T, E>*>& writer = ((timestep % 2) == 0 ? prefixes1 : prefixes0);
 
 		nucleus_count = 0;
 		iter_val = timestep * decoder->vocab_size;
-		curr_id = ids + iter_val;
-		full_beam = (reader.size() >= decoder->beam_width) && decoder->ext_scorer.enabled;
+		auto frame = zctc::frame_logits(logits, timestep, decoder->vocab_size);
+
+		if (ids) {
+			curr_id = ids + iter_val;
+		} else if (cache) {
+			curr_id = cache->ids.data() + timestep * opts.cutoff_top_n;
+		} else {
+			zctc::top_candidates<T>(frame, decoder->vocab_size, opts.cutoff_top_n, frame_ids);
+			curr_id = frame_ids.data();
+		}
+
+		/**
+		 * NOTE: The budget of the frame is derived from its candidates,
+		 * 		 which are selected at the maximum budget, so the frame's
+		 * 		 uncertainty never needs a pass over the whole vocab.
+		 */
+		if (cache)
+			budget = cache->budgets[timestep];
+		else if (adaptive.enabled())
+			budget = adaptive.budget<T, M>(frame, decoder->vocab_size, curr_id);
+
+		if (stats && (budget.beam_width < opts.beam_width || budget.cutoff_top_n < opts.cutoff_top_n)) {
+			stats->narrowed_frames++;
+			stats->beam_width_saved += opts.beam_width - budget.beam_width;
+			stats->cutoff_top_n_saved += opts.cutoff_top_n - budget.cutoff_top_n;
+		}
+		/**
+		 * NOTE: The reader is considered full from the minimum beam
+		 * 		 width, which is the beam width unless adaptive, as it
+		 * 		 may have just been pruned to it. Else the frames widening
+		 * 		 the beam after a narrowed one would extend every node
+		 * 		 unpruned, creating more nodes than the fixed beam.
+		 */
+		full_beam = (reader.size() >= adaptive.min_beam_width) && decoder->ext_scorer.enabled;
 		move_clones_to_start(reader);
 
 		if (full_beam) {
@@ -231,32 +611,34 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 			 * 		 based on their score.
 			 */
 			min_beam_score = std::numeric_limits<T>::max();
-			for (zctc::Node<T>* r_node : reader) {
+			for (zctc::Node<T, E>* r_node : reader) {
 				if (r_node->ovrl_score < min_beam_score)
 					min_beam_score = r_node->ovrl_score;
 			}
 
-			min_beam_score += std::log(logits[iter_val + decoder->blank_id]) - std::abs(decoder->ext_scorer.beta);
+			min_beam_score += M::log(zctc::prob_at<T>(frame, decoder->blank_id)) - std::abs(weights.beta);
 		} else {
 			min_beam_score = std::numeric_limits<T>::lowest();
 		}
 
-		for (int i = 0, index = 0; i < decoder->cutoff_top_n; i++, curr_id++) {
+		for (int i = 0, index = 0; i < budget.cutoff_top_n; i++, curr_id++) {
 			index = *curr_id;
-			prob = logits[iter_val + index];
+			prob = zctc::prob_at<T>(frame, index);
 
-			if (prob < decoder->min_tok_prob)
+			if (prob < min_tok_prob)
 				break;
 
 			is_blank = index == decoder->blank_id;
 			nucleus_count += prob;
+			if (stats)
+				stats->candidates++;
 
 			if (is_blank) {
 				/**
 				 * NOTE: Just update the blank probs of the node and
 				 * 		 continue in case if the current is blank token.
 				 */
-				for (zctc::Node<T>* r_node : reader) {
+				for (zctc::Node<T, E>* r_node : reader) {
 					r_node->b_prob = prob;
 					/**
 					 * NOTE: In case, if a node encounters a blank and a repeat token
@@ -277,7 +659,8 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 				continue;
 			}
 
-			for (zctc::Node<T>* r_node : reader) {
+			log_prob = full_beam ? M::log(prob) : 0;
+			for (zctc::Node<T, E>* r_node : reader) {
 				/**
 				 * NOTE: Parlance style will be just accumulating
 				 * 		 the token probs, but we've included the blank
@@ -286,10 +669,10 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 				 * 		 but we update score only at the end of each timestep
 				 * 		 parsing.
 				 */
-				if (full_beam && ((r_node->ovrl_score + std::log(prob)) < min_beam_score))
+				if (full_beam && ((r_node->ovrl_score + log_prob) < min_beam_score))
 					break;
 
-				child = r_node->extend_path(index, timestep, prob, decoder->vocab[index], writer, reader);
+				child = r_node->extend_path(index, timestep, prob, decoder->vocab[index], writer, reader, stats);
 
 				/**
 				 * NOTE: `nullptr` means the path extension was not done,
@@ -300,30 +683,56 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 				if (child == nullptr)
 					continue;
 
+				if (stats)
+					stats->nodes_created++;
+
 				/**
 				 * NOTE: Only newly extended nodes from the `r_node` are
 				 * 		 considered for external scoring. This is done once
 				 * 		 per new node creation.
 				 */
-				decoder->ext_scorer.run_ext_scoring(child, &lexicon_matcher, hotwords_fst, &hotwords_matcher);
+				if constexpr (E::any)
+					created.emplace_back(child);
 			}
 
-			if (nucleus_count >= decoder->nucleus_prob_per_timestep)
+			if (nucleus_count >= opts.nucleus_prob_per_timestep)
 				break;
 		}
+		counters.lap(&zctc::DecodeStats::expand_hw);
+		clock.lap(&zctc::DecodeStats::expand_ns);
+
+		/**
+		 * NOTE: The new nodes are scored externally after the expansion,
+		 * 		 in the order they're created, as the expansion doesn't
+		 * 		 depend on their external scores. So the scoring is a phase
+		 * 		 of its own for both the wall time and the hardware
+		 * 		 counters, which are read once per phase instead of around
+		 * 		 every node.
+		 */
+		if constexpr (E::any) {
+			for (zctc::Node<T, E>* node : created)
+				decoder->ext_scorer.run_ext_scoring(node, &lexicon_matcher, hotwords_fst, &hotwords_matcher, stats,
+													&weights, lm_cache);
+			created.clear();
+			counters.lap(&zctc::DecodeStats::ext_scoring_hw);
+			clock.lap(&zctc::DecodeStats::ext_scoring_ns);
+		}
+
+		/**
+		 * NOTE: Updating the `score` and `ovrl_score` of the
+		 * 		 nodes, considering the AM probs, KenLM probs,
+		 * 		 lexicon penalty, hotword boosting values and
+		 * 		 beta word penalty. The whole writer is scored
+		 * 		 together, where a deprecated node is scored by
+		 * 		 its more confident clone instead.
+		 */
+		score_batch.update(writer, timestep, more_confident_repeats);
 
 		pos_val = -1;
 		max_beam_score = std::numeric_limits<T>::lowest();
-		for (zctc::Node<T>* w_node : writer) {
-			/**
-			 * NOTE: Updating the `score` and `ovrl_score` of the
-			 * 		 nodes, considering the AM probs, KenLM probs,
-			 * 		 lexicon penalty, hotword boosting values and
-			 * 		 beta word penalty.
-			 */
+		for (zctc::Node<T, E>* w_node : writer) {
 			pos_val++;
-
-			beam_score = w_node->update_score(timestep, more_confident_repeats);
+			beam_score = w_node->ovrl_score;
 
 			if (w_node->is_deprecated) {
 				writer_remove_ids.emplace_back(pos_val);
@@ -369,14 +778,20 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 		 * 		 And, any path which had `a1` within the path, will remain
 		 * 		 unchanged, but the `a1` node will be deprecated.
 		 */
+		if (stats) {
+			stats->nodes_deprecated += writer_remove_ids.size();
+			stats->nodes_cloned += more_confident_repeats.size();
+		}
 		remove_from_source(writer, writer_remove_ids);
-		for (zctc::Node<T>* repeat_node : more_confident_repeats) {
+		for (zctc::Node<T, E>* repeat_node : more_confident_repeats) {
 			writer.emplace_back(repeat_node);
 		}
 		more_confident_repeats.clear();
 
 		reader.clear();
-		if (writer.size() <= decoder->beam_width)
+		clock.lap(&zctc::DecodeStats::score_ns);
+		counters.lap(&zctc::DecodeStats::score_hw);
+		if (writer.size() <= budget.beam_width)
 			continue;
 
 		/**
@@ -391,15 +806,17 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 		 * 		 writer.
 		 */
 		pos_val = 0;
-		beam_score = max_beam_score + decoder->max_beam_score_deviation;
-		for (zctc::Node<T>* w_node : writer) {
+		beam_score = max_beam_score + opts.max_beam_score_deviation;
+		for (zctc::Node<T, E>* w_node : writer) {
 			if (w_node->ovrl_score < beam_score)
 				writer_remove_ids.emplace_back(pos_val);
 
 			pos_val++;
 		}
+		if (stats)
+			stats->pruned_by_deviation += writer_remove_ids.size();
 		remove_from_source(writer, writer_remove_ids);
-		if (writer.size() <= decoder->beam_width)
+		if (writer.size() <= budget.beam_width)
 			continue;
 
 		/**
@@ -409,14 +826,19 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 		 * 		 `Parlance` style of pruning the nodes based on their
 		 * 		 score, as mentioned above.
 		 */
-		std::nth_element(writer.begin(), writer.begin() + decoder->beam_width, writer.end(),
-						 Decoder::descending_compare<T>);
+		std::nth_element(writer.begin(), writer.begin() + budget.beam_width, writer.end(),
+						 Decoder::descending_compare<T, E>);
+		if (stats)
+			stats->pruned_by_beam_width += writer.size() - budget.beam_width;
 		// TODO: Try `resize()` instead of `erase()`, to avoid memory issue during benchmarking.
-		writer.erase(writer.begin() + decoder->beam_width, writer.end());
+		writer.erase(writer.begin() + budget.beam_width, writer.end());
 	}
+	clock.lap(&zctc::DecodeStats::prune_ns);
+	counters.lap(&zctc::DecodeStats::prune_hw);
 
-	std::vector<zctc::Node<T>*>& reader = ((seq_len % 2) == 0 ? prefixes0 : prefixes1);
-	std::sort(reader.begin(), reader.end(), Decoder::descending_compare<T>);
+	zctc::TraceSpan backtrace_span("backtrace");
+	std::vector<zctc::Node<T, E>*>& reader = ((seq_len % 2) == 0 ? prefixes0 : prefixes1);
+	std::sort(reader.begin(), reader.end(), Decoder::descending_compare<T, E>);
 
 	/**
 	 * NOTE: Write the final path in reverse order, from the end of the
@@ -426,7 +848,7 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 	 */
 	iter_val = 1;
 	curr_p = seq_pos;
-	for (zctc::Node<T>* r_node : reader) {
+	for (zctc::Node<T, E>* r_node : reader) {
 
 		curr_t = timestep + ((max_seq_len * iter_val) - 1);
 		curr_l = label + ((max_seq_len * iter_val) - 1);
@@ -448,6 +870,16 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
 		iter_val++;
 		curr_p++;
 	}
+	clock.lap(&zctc::DecodeStats::backtrace_ns);
+
+	if (stats) {
+		/**
+		 * NOTE: The nodes are only freed along with the root, so the
+		 * 		 total of the nodes is also the peak of the live ones.
+		 */
+		stats->frames = seq_len;
+		stats->total_nodes = 1 + stats->nodes_created + stats->nodes_cloned;
+	}
 
 	return 0;
 }
@@ -466,9 +898,9 @@ decode(const Decoder* decoder, T* logits, int* ids, int* label, int* timestep, c
  * @return `true` If the first node is better than the second node.
  * @return `false` If the second node is better than the first node.
  */
-template <typename T>
+template <typename T, typename E>
 bool
-zctc::Decoder::descending_compare(zctc::Node<T>* x, zctc::Node<T>* y)
+zctc::Decoder::descending_compare(zctc::Node<T, E>* x, zctc::Node<T, E>* y)
 {
 	// NOTE: If probabilities are same, then we'll consider shorter sequences.
 	return x->ovrl_score > y->ovrl_score; // ? x->ovrl_score > y->ovrl_score : x->seq_length < y->seq_length;
@@ -477,10 +909,15 @@ zctc::Decoder::descending_compare(zctc::Node<T>* x, zctc::Node<T>* y)
 /**
  * @brief Concurrently decodes the provided batch of logits and its supporting
  *  	  arrays using CTC Beam Search algorithm, using the provided decoder
- * 		  configuration. The decoded labels, timesteps and sequence positions
- * 		  are written to the provided array pointers.
+ * 		  configuration, on the decoder's worker threads, waiting for the
+ * 		  batch. The decoded labels, timesteps and sequence positions are
+ * 		  written to the provided array pointers. Called from one of the
+ * 		  decoder's own workers, like by a completion callback, the batch
+ * 		  is decoded inline on it, as the pool can't be waited on from it.
  *
- * @tparam T The type of the logits array.
+ * @tparam S The type of the logits source, either a pointer to double, float, `zctc::float16` or `zctc::bfloat16`
+ * softmaxed probabilities, a `zctc::StridedLogits` view of them, or a `zctc::QuantizedLogits` view of int8 log
+ * probabilities.
  * @param batch_log_logits The batch of logits array of shape Batch x SeqLen x Vocab, containing the softmaxed
  * probabilities in linear scale.
  * @param batch_sorted_ids The batch of sorted ids array of shape Batch x SeqLen x Vocab, containing the sorted indices
@@ -495,51 +932,935 @@ zctc::Decoder::descending_compare(zctc::Node<T>* x, zctc::Node<T>* y)
  * @param max_seq_len The maximum sequence length of the samples in the logits array including the padding.
  * @param hotwords Vector of hotword tokens to consider for hotword boosting.
  * @param hotwords_weight Vector of hotword weights to consider for hotword boosting.
+ * @param stats The array of `batch_size` stats, to collect the decode stats of every sample in, if any.
+ * @param options The options to decode the batch with, or `nullptr` for the decoder's own, whose beam width sizes
+ * the labels, timesteps and sequence positions in place of the decoder's.
  *
  * @return void
  */
-template <typename T>
+template <typename S>
 void
-zctc::Decoder::batch_decode(T* logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+zctc::Decoder::batch_decode(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
 							const int batch_size, const int max_seq_len, std::vector<std::vector<int>>& hotwords_id,
-							std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst) const
+							std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+							zctc::DecodeStats* stats, const zctc::DecodeOptions* options) const
 {
-	ThreadPool pool(std::min(this->thread_count, batch_size));
-	std::vector<std::future<int>> results;
-	bool free_hw_fst = false;
+	zctc::TraceSpan batch_span("batch_decode", "batch_size", batch_size);
+
+	/**
+	 * NOTE: The promise is shared with the completion, which may still
+	 * 		 be running on the worker right after the result is ready.
+	 */
+	auto completed = std::make_shared<std::promise<void>>();
+	std::future<void> result = completed->get_future();
+
+	this->batch_decode_async(
+		logits, ids, labels, timesteps, seq_len, seq_pos, batch_size, max_seq_len, hotwords_id, hotwords_weight,
+		hotwords_fst, stats,
+		[completed](std::exception_ptr error) {
+			if (error)
+				completed->set_exception(error);
+			else
+				completed->set_value();
+		},
+		options);
+
+	result.get();
+}
+
+/**
+ * @brief Enqueues the decoding of every sample of the provided batch on the
+ * 		  decoder's worker threads, without waiting for them. The last sample
+ * 		  to be decoded completes the batch, so no thread is blocked on it.
+ *
+ * @tparam S The type of the logits source, same as `batch_decode`.
+ * @param on_complete The callable invoked once every sample is decoded, with the first error if any, else `nullptr`.
+ *
+ * @note The rest of the parameters are the same as `batch_decode`. The logits, output arrays and stats must outlive
+ * the batch, while the hotwords and options are only used until this function returns. Called from one of the
+ * decoder's own workers, the batch is decoded inline and completed before this function returns.
+ *
+ * @return void
+ */
+template <typename S>
+void
+zctc::Decoder::batch_decode_async(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+								  const int batch_size, const int max_seq_len,
+								  std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+								  fst::StdVectorFst* hotwords_fst, zctc::DecodeStats* stats,
+								  std::function<void(std::exception_ptr)> on_complete,
+								  const zctc::DecodeOptions* options) const
+{
+	/**
+	 * NOTE: The options are copied into every task, so the concurrent
+	 * 		 calls with different options don't share anything but the
+	 * 		 decoder, which is only read.
+	 */
+	const zctc::DecodeOptions call_options = options ? *options : this->options();
+	this->check_options(call_options);
+
+	auto decode_utterance = [=, this](int i, fst::StdVectorFst* hotwords_fst) {
+		int ip_pos = i * max_seq_len * this->vocab_size;
+		int op_pos = i * call_options.beam_width * max_seq_len;
+		int s_p = i * call_options.beam_width;
+
+		return this->with_math([&](auto math) {
+			return this->with_features(hotwords_fst, [&](auto features) {
+				return zctc::decode<S, zctc::score_type_t<S>, decltype(math), decltype(features)>(
+					this, zctc::utterance_logits(logits, i, max_seq_len, this->vocab_size),
+					ids ? ids + ip_pos : nullptr, labels + op_pos, timesteps + op_pos, *(seq_len + i), max_seq_len,
+					seq_pos + s_p, hotwords_fst, stats ? stats + i : nullptr, &call_options);
+			});
+		});
+	};
+
+	this->enqueue_batch(batch_size, seq_len, hotwords_id, hotwords_weight, hotwords_fst, decode_utterance,
+						std::move(on_complete));
+}
+
+/**
+ * @brief Concurrently decodes the provided batch of logits once for each of
+ * 		  the scorer params, on the decoder's worker threads, waiting for the
+ * 		  batch. Every utterance is decoded with all the params on the same
+ * 		  worker, one after the other, so its candidates, per frame budgets
+ * 		  and KenLM queries, which don't depend on the params, are shared.
+ *
+ * @tparam S The type of the logits source, same as `batch_decode`.
+ * @param configs The scorer params to decode the batch with.
+ * @param labels The labels array of shape Configs x Batch x BeamWidth x MaxSeqLen, to write the decoded labels of
+ * every scorer params.
+ * @param timesteps The timesteps array of the same shape as the labels.
+ * @param seq_pos The sequence position array of shape Configs x Batch x BeamWidth.
+ * @param stats The array of `configs.size() * batch_size` stats, to collect the decode stats in, if any.
+ *
+ * @note The rest of the parameters are the same as `batch_decode`.
+ *
+ * @return void
+ */
+template <typename S>
+void
+zctc::Decoder::batch_decode_multi(S logits, int* ids, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+								  const int batch_size, const int max_seq_len,
+								  const std::vector<zctc::ScorerParams>& configs,
+								  std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+								  fst::StdVectorFst* hotwords_fst, zctc::DecodeStats* stats) const
+{
+	zctc::TraceSpan batch_span("batch_decode_multi", "configs", configs.size());
+
+	// NOTE: Every config is validated before the batch is fanned out, so a bad one fails the call as a whole.
+	zctc::DecodeOptions config_options = this->options();
+	for (const zctc::ScorerParams& config : configs) {
+		config_options.scorer = config;
+		this->check_options(config_options);
+	}
+
+	const zctc::ScorerParams* params = configs.data();
+	const int config_count = configs.size();
+	auto decode_utterance = [=, this](int i, fst::StdVectorFst* hotwords_fst) {
+		int ip_pos = i * max_seq_len * this->vocab_size;
+		zctc::DecodeOptions options = this->options();
+
+		return this->with_math([&](auto math) {
+			return this->with_features(hotwords_fst, [&](auto features) {
+				using T = zctc::score_type_t<S>;
+				using M = decltype(math);
+				using E = decltype(features);
+
+				S utterance = zctc::utterance_logits(logits, i, max_seq_len, this->vocab_size);
+				zctc::UtteranceCache cache;
+				cache.prepare<T, M>(this, utterance, ids ? ids + ip_pos : nullptr, *(seq_len + i));
+
+				for (int c = 0, pos = 0; c < config_count; c++) {
+					pos = c * batch_size + i;
+					options.scorer = params[c];
+					if (zctc::decode<S, T, M, E>(this, utterance, ids ? ids + ip_pos : nullptr,
+												 labels + pos * this->beam_width * max_seq_len,
+												 timesteps + pos * this->beam_width * max_seq_len, *(seq_len + i),
+												 max_seq_len, seq_pos + pos * this->beam_width, hotwords_fst,
+												 stats ? stats + pos : nullptr, &options, &cache)
+						!= 0)
+						return 1;
+				}
+
+				return 0;
+			});
+		});
+	};
+
+	// NOTE: The params are only borrowed by the workers, as the batch is waited for.
+	auto completed = std::make_shared<std::promise<void>>();
+	std::future<void> result = completed->get_future();
+
+	this->enqueue_batch(batch_size, seq_len, hotwords_id, hotwords_weight, hotwords_fst, decode_utterance,
+						[completed](std::exception_ptr error) {
+							if (error)
+								completed->set_exception(error);
+							else
+								completed->set_value();
+						});
+
+	result.get();
+}
+
+/**
+ * @brief Concurrently decodes the best path of every utterance of the provided
+ * 		  batch on the decoder's worker threads, waiting for the batch. Neither
+ * 		  the sorted ids nor the hotwords and external scorer are used.
+ *
+ * @tparam S The type of the logits source, same as `batch_decode`.
+ * @param labels The labels array of shape Batch x MaxSeqLen, to write the decoded labels of every utterance at the
+ * end of its row.
+ * @param timesteps The timesteps array of the same shape as the labels, or `nullptr` to skip the timesteps.
+ * @param seq_pos The sequence position array of shape Batch, to write the starting position of the decoded labels.
+ *
+ * @note The rest of the parameters are the same as `batch_decode`.
+ *
+ * @return void
+ */
+template <typename S>
+void
+zctc::Decoder::batch_greedy_decode(S logits, int* labels, int* timesteps, int* seq_len, int* seq_pos,
+								   const int batch_size, const int max_seq_len) const
+{
+	zctc::TraceSpan batch_span("batch_greedy_decode", "batch_size", batch_size);
+
+	std::vector<std::vector<int>> hotwords_id;
+	std::vector<float> hotwords_weight;
+	auto decode_utterance = [=, this](int i, fst::StdVectorFst*) {
+		int op_pos = i * max_seq_len;
+
+		return zctc::greedy_decode(zctc::utterance_logits(logits, i, max_seq_len, this->vocab_size), this->vocab_size,
+								   this->blank_id, labels + op_pos, timesteps ? timesteps + op_pos : nullptr,
+								   *(seq_len + i), max_seq_len, seq_pos + i);
+	};
+
+	auto completed = std::make_shared<std::promise<void>>();
+	std::future<void> result = completed->get_future();
+
+	this->enqueue_batch(batch_size, seq_len, hotwords_id, hotwords_weight, nullptr, decode_utterance,
+						[completed](std::exception_ptr error) {
+							if (error)
+								completed->set_exception(error);
+							else
+								completed->set_value();
+						});
+
+	result.get();
+}
+
+/**
+ * @brief Calls the provided callable with the precision policy of the decoder,
+ * 		  so the decode is instantiated once for each policy.
+ *
+ * @param decode_with The callable taking either `zctc::FastMath` or `zctc::ExactMath`.
+ *
+ * @return The result of the callable.
+ */
+template <typename F>
+decltype(auto)
+zctc::Decoder::with_math(F&& decode_with) const
+{
+	return this->fast_math ? decode_with(zctc::FastMath {}) : decode_with(zctc::ExactMath {});
+}
+
+/**
+ * @brief Calls the provided callable with the scorer features loaded for the
+ * 		  decode, among the LM, the lexicon and the hotwords, so the decode is
+ * 		  instantiated once for each of their combinations, and a decode skips
+ * 		  the scoring and node states of the features not loaded altogether.
+ *
+ * @param hotwords_fst The hotwords FST of the decode, if any.
+ * @param decode_with The callable taking a `zctc::ScorerFeatures`.
+ *
+ * @return The result of the callable.
+ */
+template <typename F>
+decltype(auto)
+zctc::Decoder::with_features(fst::StdVectorFst* hotwords_fst, F&& decode_with) const
+{
+	auto with_scorer = [&](auto hotwords) {
+		constexpr bool HOTWORDS = decltype(hotwords)::value;
+
+		if (this->ext_scorer.lm && this->ext_scorer.lexicon)
+			return decode_with(zctc::ScorerFeatures<true, true, HOTWORDS> {});
+		if (this->ext_scorer.lm)
+			return decode_with(zctc::ScorerFeatures<true, false, HOTWORDS> {});
+		if (this->ext_scorer.lexicon)
+			return decode_with(zctc::ScorerFeatures<false, true, HOTWORDS> {});
+
+		return decode_with(zctc::ScorerFeatures<false, false, HOTWORDS> {});
+	};
+
+	return hotwords_fst ? with_scorer(std::true_type {}) : with_scorer(std::false_type {});
+}
+
+/**
+ * @brief Gets the decoder's own options, to decode with as is or to override
+ * 		  some of them for a single call.
+ *
+ * @return zctc::DecodeOptions The options the decoder was constructed with.
+ */
+zctc::DecodeOptions
+zctc::Decoder::options() const
+{
+	return { this->beam_width,
+			 this->cutoff_top_n,
+			 this->nucleus_prob_per_timestep,
+			 this->min_tok_prob,
+			 this->max_beam_score_deviation,
+			 this->ext_scorer.params() };
+}
+
+/**
+ * @brief Validates every field of the options of a call, as the Python
+ * 		  wrapper's `evaluate_parameters` does, so the calls from C++ are
+ * 		  held to the same bounds.
+ *
+ * @param options The options to validate.
+ *
+ * @return void
+ */
+void
+zctc::Decoder::check_options(const zctc::DecodeOptions& options) const
+{
+	if (options.beam_width < 1)
+		throw std::runtime_error("Invalid beam width " + std::to_string(options.beam_width) + ", expected positive.");
+	if (options.cutoff_top_n < 1 || options.cutoff_top_n > this->vocab_size)
+		throw std::runtime_error("Invalid cutoff top n " + std::to_string(options.cutoff_top_n) + ", expected in [1, "
+								 + std::to_string(this->vocab_size) + "].");
+
+	// NOTE: The comparisons are written to fail on NaN as well.
+	if (!(options.nucleus_prob_per_timestep >= 0 && options.nucleus_prob_per_timestep <= 1))
+		throw std::runtime_error("Invalid cutoff prob " + std::to_string(options.nucleus_prob_per_timestep)
+								 + ", expected in [0, 1].");
+	if (!(options.min_tok_prob <= 0))
+		throw std::runtime_error("Invalid min token prob " + std::to_string(options.min_tok_prob)
+								 + ", expected a non-positive log probability.");
+	if (!(options.max_beam_score_deviation < 0))
+		throw std::runtime_error("Invalid max beam deviation " + std::to_string(options.max_beam_score_deviation)
+								 + ", expected negative.");
+	if (!(options.scorer.alpha >= 0 && std::isfinite(options.scorer.alpha)))
+		throw std::runtime_error("Invalid alpha " + std::to_string(options.scorer.alpha)
+								 + ", expected finite and non-negative.");
+	if (!(options.scorer.beta >= 0 && std::isfinite(options.scorer.beta)))
+		throw std::runtime_error("Invalid beta " + std::to_string(options.scorer.beta)
+								 + ", expected finite and non-negative.");
+	if (!std::isfinite(options.scorer.lex_penalty))
+		throw std::runtime_error("Invalid unk lexicon penalty " + std::to_string(options.scorer.lex_penalty)
+								 + ", expected finite.");
+}
+
+/**
+ * @brief Queues an utterance to be decoded with the other utterances submitted
+ * 		  from any thread, grouped into micro-batches of up to the decoder's
+ * 		  `submit_max_batch_size` utterances, each dispatched to the worker
+ * 		  threads once full or once its oldest utterance has waited
+ * 		  `submit_max_wait_ms`. Unlike `batch_decode`, the utterances aren't
+ * 		  padded into a single tensor, each is decoded from its own logits.
+ *
+ * @param logits The logits of shape SeqLen x Vocab, containing the softmaxed probabilities in linear scale, which
+ * must outlive the decode.
+ * @param seq_len The sequence length of the utterance.
+ * @param options The options to decode the utterance with, or `nullptr` for the decoder's own.
+ *
+ * @return std::future<zctc::DecodeResult> The future of the decoded beams.
+ */
+std::future<zctc::DecodeResult>
+zctc::Decoder::submit(const float* logits, int seq_len, const zctc::DecodeOptions* options) const
+{
+	auto promise = std::make_shared<std::promise<zctc::DecodeResult>>();
+	std::future<zctc::DecodeResult> result = promise->get_future();
+
+	this->submit_async(
+		logits, seq_len,
+		[promise](zctc::DecodeResult&& result, std::exception_ptr error) {
+			if (error)
+				promise->set_exception(error);
+			else
+				promise->set_value(std::move(result));
+		},
+		options);
+
+	return result;
+}
+
+/**
+ * @brief Queues an utterance like `submit`, calling back once it's decoded.
+ *
+ * @param on_complete The callable invoked on a worker thread once the utterance is decoded, with its beams and
+ * `nullptr`, or with the error if it failed.
+ *
+ * @note The rest of the parameters are the same as `submit`.
+ *
+ * @return void
+ */
+void
+zctc::Decoder::submit_async(const float* logits, int seq_len,
+							std::function<void(zctc::DecodeResult&&, std::exception_ptr)> on_complete,
+							const zctc::DecodeOptions* options) const
+{
+	zctc::DecodeOptions utterance_options = options ? *options : this->options();
+	this->check_options(utterance_options);
+	if (seq_len < 0)
+		throw std::runtime_error("Invalid sequence length " + std::to_string(seq_len) + ", expected non-negative.");
+
+	std::call_once(this->batcher_started, [this]() {
+		this->batcher = std::make_unique<zctc::MicroBatcher<zctc::SubmittedUtterance>>(
+			this->submit_max_batch_size,
+			std::chrono::microseconds(static_cast<long>(this->submit_max_wait_ms * 1000)), this->thread_count,
+			[this](std::vector<zctc::SubmittedUtterance>&& utterances) {
+				this->dispatch_submitted(std::move(utterances));
+			});
+	});
+
+	this->batcher->push({ logits, seq_len, utterance_options, std::move(on_complete) });
+}
+
+/**
+ * @brief Queues the utterance of a tensor like `submit`. This function is the
+ * 		  entry point of `submit` from the Python bindings.
+ *
+ * @param logits The logits of shape SeqLen x Vocab, converted to a contiguous float32 array if not one already.
+ * @param callback The Python callable invoked on the completion thread with the GIL held, once the utterance is
+ * decoded, with the tuple of its labels and timesteps of shape BeamWidth x SeqLen and its sequence positions of shape
+ * BeamWidth, and None, or with None and the error message if it failed.
+ * @param options The options to decode the utterance with, or `nullptr` for the decoder's own.
+ *
+ * @return void
+ */
+void
+zctc::Decoder::submit_tensor(py::array_t<float, py::array::c_style | py::array::forcecast> logits,
+							 py::function callback, const zctc::DecodeOptions* options) const
+{
+	if (logits.ndim() != 2 || logits.shape(1) != this->vocab_size)
+		throw std::runtime_error("Invalid logits shape. Expected SeqLen x " + std::to_string(this->vocab_size) + ".");
+
+	struct SubmittedTensor {
+		std::optional<py::array_t<float, py::array::c_style | py::array::forcecast>> logits;
+		std::optional<py::function> callback;
+	};
+
+	auto tensor = std::make_shared<SubmittedTensor>();
+	tensor->logits.emplace(std::move(logits));
+	tensor->callback.emplace(std::move(callback));
+
+	/**
+	 * NOTE: As with `batch_decode_tensor_async`, the callback is run on the
+	 * 		 completion thread, and the Python objects are released with the
+	 * 		 GIL held, right after it.
+	 */
+	auto on_complete = [this, tensor](zctc::DecodeResult&& result, std::exception_ptr error) {
+		this->post_completion([tensor, result = std::move(result), error]() {
+			py::gil_scoped_acquire acquire;
+			try {
+				if (error) {
+					std::string message = "Unknown error occured during execution";
+					try {
+						std::rethrow_exception(error);
+					} catch (const std::exception& e) {
+						message = e.what();
+					} catch (...) {
+					}
+					(*tensor->callback)(py::none(), message);
+				} else {
+					py::ssize_t beam_width = result.seq_pos.size();
+					(*tensor->callback)(
+						py::make_tuple(
+							py::array_t<int>({ beam_width, py::ssize_t(result.seq_len) }, result.labels.data()),
+							py::array_t<int>({ beam_width, py::ssize_t(result.seq_len) }, result.timesteps.data()),
+							py::array_t<int>(beam_width, result.seq_pos.data())),
+						py::none());
+				}
+			} catch (py::error_already_set& e) {
+				e.discard_as_unraisable("zctc submit callback");
+			}
+			tensor->logits.reset();
+			tensor->callback.reset();
+		});
+	};
+
+	this->submit_async(tensor->logits->data(), tensor->logits->shape(0), on_complete, options);
+}
+
+/**
+ * @brief Posts a completion to the decoder's completion thread, starting it
+ * 		  on the first one.
+ *
+ * @param completion The completion to run.
+ *
+ * @return void
+ */
+void
+zctc::Decoder::post_completion(zctc::CompletionQueue::Completion completion) const
+{
+	std::call_once(this->completions_started,
+				   [this]() { this->completions = std::make_unique<zctc::CompletionQueue>(); });
+
+	this->completions->post(std::move(completion));
+}
+
+/**
+ * @brief Decodes a micro-batch of the submitted utterances on the worker
+ * 		  threads, completing every utterance as soon as it's decoded, rather
+ * 		  than once the whole micro-batch is.
+ *
+ * @param utterances The utterances of the micro-batch.
+ *
+ * @return void
+ */
+void
+zctc::Decoder::dispatch_submitted(std::vector<zctc::SubmittedUtterance>&& utterances) const
+{
+	struct SubmittedBatch {
+		std::vector<zctc::SubmittedUtterance> utterances;
+		std::vector<int> seq_lens;
+	};
+
+	auto batch = std::make_shared<SubmittedBatch>();
+	batch->utterances = std::move(utterances);
+	for (const zctc::SubmittedUtterance& utterance : batch->utterances)
+		batch->seq_lens.emplace_back(utterance.seq_len);
+
+	auto decode_utterance = [this, batch](int i, fst::StdVectorFst* hotwords_fst) {
+		zctc::SubmittedUtterance& utterance = batch->utterances[i];
+		zctc::DecodeResult result { utterance.seq_len };
+		std::exception_ptr error;
+
+		try {
+			result.labels.assign(utterance.options.beam_width * utterance.seq_len, 0);
+			result.timesteps.assign(result.labels.size(), 0);
+			result.seq_pos.assign(utterance.options.beam_width, 0);
+
+			// NOTE: The logits are only read, the pointer isn't const for the logits source traits.
+			float* logits = const_cast<float*>(utterance.logits);
+			int status = this->with_math([&](auto math) {
+				return this->with_features(hotwords_fst, [&](auto features) {
+					return zctc::decode<float*, float, decltype(math), decltype(features)>(
+						this, logits, nullptr, result.labels.data(), result.timesteps.data(), utterance.seq_len,
+						utterance.seq_len, result.seq_pos.data(), hotwords_fst, nullptr, &utterance.options);
+				});
+			});
+			if (status != 0)
+				throw std::runtime_error("Unexpected error occured during execution");
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		utterance.on_complete(std::move(result), error);
+		return 0;
+	};
+
+	std::vector<std::vector<int>> hotwords_id;
+	std::vector<float> hotwords_weight;
+	try {
+		this->enqueue_batch(batch->utterances.size(), batch->seq_lens.data(), hotwords_id, hotwords_weight, nullptr,
+							decode_utterance, [this](std::exception_ptr) { this->batcher->complete(); });
+	} catch (...) {
+		for (zctc::SubmittedUtterance& utterance : batch->utterances)
+			utterance.on_complete({}, std::current_exception());
+		this->batcher->complete();
+	}
+}
+
+/**
+ * @brief Enqueues the decoding of every utterance of a batch on the worker
+ * 		  threads, building the batch's hotwords FST first, if any. The last
+ * 		  utterance to be decoded completes the batch with the first error.
+ *
+ * @param batch_size The number of utterances in the batch.
+ * @param seq_len The sequence lengths of the utterances, for the trace.
+ * @param decode_utterance The callable decoding the `i`th utterance with the batch's hotwords FST, as
+ * `decode_utterance(i, hotwords_fst)`, returning 0 on success. It's copied into every task.
+ * @param on_complete The callable invoked once every utterance is decoded, with the first error if any, else
+ * `nullptr`.
+ *
+ * @note The rest of the parameters are the same as `batch_decode`.
+ *
+ * @return void
+ */
+template <typename F>
+void
+zctc::Decoder::enqueue_batch(const int batch_size, int* seq_len, std::vector<std::vector<int>>& hotwords_id,
+							 std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst, F decode_utterance,
+							 std::function<void(std::exception_ptr)> on_complete) const
+{
+	struct PendingBatch {
+		std::atomic<int> remaining;
+		std::unique_ptr<fst::StdVectorFst> hotwords_fst;
+		std::mutex error_mutex;
+		std::exception_ptr error;
+		std::function<void(std::exception_ptr)> on_complete;
+	};
+
+	auto pending = std::make_shared<PendingBatch>();
+	pending->remaining = batch_size;
+	pending->on_complete = std::move(on_complete);
 
 	if (!hotwords_id.empty()) {
-		if (hotwords_fst == nullptr) {
-			hotwords_fst = new fst::StdVectorFst();
-			free_hw_fst = true;
-		} else {
-			/**
-			 * NOTE: The reason for cloning `hotwords_fst` is to avoid
-			 * 		 unncessary overwriting of the parameterly passed
-			 * 		 `hotwords_fst`.
-			 */
-			hotwords_fst = new fst::StdVectorFst(*hotwords_fst);
-			free_hw_fst = true;
+		zctc::TraceSpan hotwords_span("hotwords_fst", "hotwords", hotwords_id.size());
+		/**
+		 * NOTE: The reason for cloning `hotwords_fst` is to avoid
+		 * 		 unncessary overwriting of the parameterly passed
+		 * 		 `hotwords_fst`. The batch owns the FST, until its
+		 * 		 last sample is decoded.
+		 */
+		pending->hotwords_fst = hotwords_fst ? std::make_unique<fst::StdVectorFst>(*hotwords_fst)
+											 : std::make_unique<fst::StdVectorFst>();
+		populate_hotword_fst(pending->hotwords_fst.get(), hotwords_id, hotwords_weight);
+		hotwords_fst = pending->hotwords_fst.get();
+	}
+
+	if (batch_size == 0) {
+		pending->on_complete(nullptr);
+		return;
+	}
+
+	auto run_utterance = [=, this](int i) {
+		const zctc::Decoder* outer_decoder = zctc::Decoder::worker_decoder;
+		zctc::Decoder::worker_decoder = this;
+
+		try {
+			zctc::TraceSpan decode_span("decode", "seq_len", *(seq_len + i));
+			if (decode_utterance(i, hotwords_fst) != 0)
+				throw std::runtime_error("Unexpected error occured during execution");
+		} catch (...) {
+			std::lock_guard<std::mutex> lock(pending->error_mutex);
+			if (!pending->error)
+				pending->error = std::current_exception();
 		}
-		populate_hotword_fst(hotwords_fst, hotwords_id, hotwords_weight);
+
+		if (pending->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			pending->on_complete(pending->error);
+		zctc::Decoder::worker_decoder = outer_decoder;
+	};
+
+	/**
+	 * NOTE: A batch enqueued from one of the decoder's own workers is
+	 * 		 decoded inline, on that worker, as waiting for it to be
+	 * 		 decoded by the pool deadlocks once every worker waits.
+	 */
+	if (zctc::Decoder::worker_decoder == this) {
+		for (int i = 0; i < batch_size; i++)
+			run_utterance(i);
+		return;
 	}
 
-	for (int i = 0, ip_pos = 0, op_pos = 0, s_p = 0; i < batch_size; i++) {
-		ip_pos = i * max_seq_len * this->vocab_size;
-		op_pos = i * this->beam_width * max_seq_len;
-		s_p = i * this->beam_width;
+	for (int i = 0; i < batch_size; i++) {
+		/**
+		 * NOTE: The time spent in the queue is recorded on the worker,
+		 * 		 right before the decode span, so the stragglers are
+		 * 		 visible along with the reason for their delay.
+		 */
+		long enqueued_ns = zctc::Tracer::enabled() ? zctc::Tracer::instance().now_ns() : -1;
+		this->pool->enqueue([=]() {
+			if (enqueued_ns >= 0)
+				zctc::Tracer::instance().record("queue_wait", enqueued_ns, zctc::Tracer::instance().now_ns());
 
-		results.emplace_back(pool.enqueue(zctc::decode<T>, this, logits + ip_pos, ids + ip_pos, labels + op_pos,
-										  timesteps + op_pos, *(seq_len + i), max_seq_len, seq_pos + s_p,
-										  hotwords_fst));
+			run_utterance(i);
+		});
 	}
+}
 
-	for (auto&& result : results)
-		if (result.get() != 0)
-			throw std::runtime_error("Unexpected error occured during execution");
+/**
+ * @brief Prepares the work of decoding the utterance which doesn't depend on
+ * 		  the scorer params, (ie) the budget of every frame and, if the ids
+ * 		  aren't sorted, its `cutoff_top_n` candidates, keeping only the
+ * 		  budgeted number of them.
+ *
+ * @tparam T The score type of the decoder.
+ * @tparam M The precision policy of the decoder.
+ * @param decoder The decoder configuration.
+ * @param logits The logits source of the utterance.
+ * @param sorted_ids The sorted ids of the utterance of shape SeqLen x Vocab, or `nullptr` to select the candidates.
+ * @param seq_len The sequence length of the utterance.
+ *
+ * @return void
+ */
+template <typename T, typename M, typename S>
+void
+zctc::UtteranceCache::prepare(const zctc::Decoder* decoder, S logits, const int* sorted_ids, int seq_len)
+{
+	std::vector<int> frame_ids(sorted_ids ? 0 : decoder->vocab_size);
 
-	if (free_hw_fst)
-		delete hotwords_fst;
+	this->budgets.resize(seq_len);
+	this->ids.resize(sorted_ids ? 0 : static_cast<std::size_t>(seq_len) * decoder->cutoff_top_n);
+	for (int timestep = 0; timestep < seq_len; timestep++) {
+		auto frame = zctc::frame_logits(logits, timestep, decoder->vocab_size);
+		const int* frame_sorted_ids = sorted_ids ? sorted_ids + timestep * decoder->vocab_size : frame_ids.data();
+		if (!sorted_ids)
+			zctc::top_candidates<T>(frame, decoder->vocab_size, decoder->cutoff_top_n, frame_ids);
+
+		zctc::FrameBudget& budget = this->budgets[timestep];
+		budget = decoder->adaptive.budget<T, M>(frame, decoder->vocab_size, frame_sorted_ids);
+		if (!sorted_ids)
+			std::copy_n(frame_ids.begin(), budget.cutoff_top_n, this->ids.begin() + timestep * decoder->cutoff_top_n);
+	}
+}
+
+py::tuple
+zctc::Decoder::batch_decode_tensor(py::handle logits, py::handle seq_len, bool time_major,
+								   std::vector<std::vector<int>>& hotwords_id, std::vector<float>& hotwords_weight,
+								   fst::StdVectorFst* hotwords_fst, bool collect_stats, bool hw_counters,
+								   const zctc::DecodeOptions* options) const
+{
+	if (options)
+		this->check_options(*options);
+
+	zctc::TensorBatch batch(logits, seq_len, time_major, this->vocab_size,
+							options ? options->beam_width : this->beam_width, collect_stats, hw_counters);
+
+	{
+		py::gil_scoped_release release;
+		batch.logits->visit_logits(time_major, [&](auto strided_logits) {
+			this->batch_decode(strided_logits, nullptr, batch.labels_ptr, batch.timesteps_ptr, batch.seq_lens.data(),
+							   batch.seq_pos_ptr, batch.batch_size, batch.max_seq_len, hotwords_id, hotwords_weight,
+							   hotwords_fst, batch.stats.empty() ? nullptr : batch.stats.data(), options);
+		});
+	}
+
+	return batch.outputs();
+}
+
+py::tuple
+zctc::Decoder::batch_decode_quantized_tensor(py::handle values, py::handle scales, py::handle offsets,
+											 py::handle seq_len, std::vector<std::vector<int>>& hotwords_id,
+											 std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+											 bool collect_stats, bool hw_counters) const
+{
+	zctc::TensorBatch batch(values, seq_len, false, this->vocab_size, this->beam_width, collect_stats, hw_counters);
+
+	const zctc::TensorView& view = *batch.logits;
+	if (view.dtype != zctc::DType::INT8)
+		throw std::runtime_error("Invalid values dtype. Expected int8 quantized log probabilities.");
+	// NOTE: The quantized logits are only read as a contiguous Batch x SeqLen x Vocab array.
+	if (view.strides[2] != 1 || view.strides[1] != this->vocab_size
+		|| view.strides[0] != static_cast<long>(batch.max_seq_len) * this->vocab_size)
+		throw std::runtime_error("Invalid values strides. Expected a contiguous tensor.");
+
+	zctc::TensorView scales_view(scales), offsets_view(offsets);
+	bool per_frame = scales_view.shape.size() == 2;
+	if (scales_view.shape != offsets_view.shape || scales_view.shape.empty() || scales_view.shape[0] != batch.batch_size
+		|| (per_frame && scales_view.shape[1] != batch.max_seq_len))
+		throw std::runtime_error("Invalid scales or offsets shape. Expected Batch x SeqLen, or Batch.");
+
+	std::vector<float> scale_values = scales_view.to_floats(), offset_values = offsets_view.to_floats();
+	for (float scale : scale_values)
+		if (!(scale > 0))
+			throw std::runtime_error("Invalid quantization scale " + std::to_string(scale) + ", expected positive.");
+
+	{
+		py::gil_scoped_release release;
+		zctc::QuantizedLogits logits { static_cast<const std::int8_t*>(view.data), scale_values.data(),
+									   offset_values.data(), per_frame };
+		this->batch_decode(logits, nullptr, batch.labels_ptr, batch.timesteps_ptr, batch.seq_lens.data(),
+						   batch.seq_pos_ptr, batch.batch_size, batch.max_seq_len, hotwords_id, hotwords_weight,
+						   hotwords_fst, batch.stats.empty() ? nullptr : batch.stats.data());
+	}
+
+	return batch.outputs();
+}
+
+void
+zctc::Decoder::batch_decode_tensor_async(py::handle logits, py::handle seq_len, bool time_major,
+										 std::vector<std::vector<int>>& hotwords_id,
+										 std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+										 bool collect_stats, bool hw_counters, py::function callback,
+										 const zctc::DecodeOptions* options) const
+{
+	if (options)
+		this->check_options(*options);
+
+	auto batch = std::make_shared<zctc::TensorBatch>(logits, seq_len, time_major, this->vocab_size,
+													 options ? options->beam_width : this->beam_width, collect_stats,
+													 hw_counters);
+	batch->callback = std::move(callback);
+
+	/**
+	 * NOTE: The callback is posted to the completion thread, off the
+	 * 		 workers. The completion only holds the batch, whose Python
+	 * 		 objects are released with the GIL held, right after the
+	 * 		 callback, so the thread dropping the last reference doesn't
+	 * 		 need it.
+	 */
+	auto on_complete = [this, batch](std::exception_ptr error) {
+		this->post_completion([batch, error]() {
+			py::gil_scoped_acquire acquire;
+			try {
+				if (error) {
+					std::string message = "Unknown error occured during execution";
+					try {
+						std::rethrow_exception(error);
+					} catch (const std::exception& e) {
+						message = e.what();
+					} catch (...) {
+					}
+					(*batch->callback)(py::none(), message);
+				} else {
+					(*batch->callback)(batch->outputs(), py::none());
+				}
+			} catch (py::error_already_set& e) {
+				e.discard_as_unraisable("zctc decode callback");
+			}
+			batch->release();
+		});
+	};
+
+	py::gil_scoped_release release;
+	batch->logits->visit_logits(time_major, [&](auto strided_logits) {
+		this->batch_decode_async(strided_logits, nullptr, batch->labels_ptr, batch->timesteps_ptr,
+								 batch->seq_lens.data(), batch->seq_pos_ptr, batch->batch_size, batch->max_seq_len,
+								 hotwords_id, hotwords_weight, hotwords_fst,
+								 batch->stats.empty() ? nullptr : batch->stats.data(), on_complete, options);
+	});
+}
+
+py::list
+zctc::Decoder::batch_decode_tensor_multi(py::handle logits, py::handle seq_len, bool time_major,
+										 const std::vector<zctc::ScorerParams>& configs,
+										 std::vector<std::vector<int>>& hotwords_id,
+										 std::vector<float>& hotwords_weight, fst::StdVectorFst* hotwords_fst,
+										 bool collect_stats, bool hw_counters) const
+{
+	if (configs.empty())
+		throw std::runtime_error("Expected at least one scorer params to decode with.");
+
+	zctc::TensorBatch batch(logits, seq_len, time_major, this->vocab_size, this->beam_width, collect_stats,
+							hw_counters, configs.size());
+
+	{
+		py::gil_scoped_release release;
+		batch.logits->visit_logits(time_major, [&](auto strided_logits) {
+			this->batch_decode_multi(strided_logits, nullptr, batch.labels_ptr, batch.timesteps_ptr,
+									 batch.seq_lens.data(), batch.seq_pos_ptr, batch.batch_size, batch.max_seq_len,
+									 configs, hotwords_id, hotwords_weight, hotwords_fst,
+									 batch.stats.empty() ? nullptr : batch.stats.data());
+		});
+	}
+
+	return batch.config_outputs(configs.size());
+}
+
+py::tuple
+zctc::Decoder::batch_greedy_decode_tensor(py::handle logits, py::handle seq_len, bool time_major) const
+{
+	zctc::TensorBatch batch(logits, seq_len, time_major, this->vocab_size, 1, false, false);
+
+	{
+		py::gil_scoped_release release;
+		batch.logits->visit_logits(time_major, [&](auto strided_logits) {
+			this->batch_greedy_decode(strided_logits, batch.labels_ptr, batch.timesteps_ptr, batch.seq_lens.data(),
+									  batch.seq_pos_ptr, batch.batch_size, batch.max_seq_len);
+		});
+	}
+
+	return batch.outputs();
+}
+
+/**
+ * @brief Creates the views of the provided tensors and allocates the output
+ * 		  arrays of the batch, validating their shapes.
+ *
+ * @param logits The logits tensor of shape Batch x SeqLen x Vocab, or SeqLen x Batch x Vocab if `time_major`.
+ * @param seq_len The 1-D integer tensor of the sequence lengths.
+ * @param time_major Whether the first axis of the logits is the time instead of the batch.
+ * @param vocab_size The vocab size of the decoder.
+ * @param beam_width The beam width of the decoder.
+ * @param collect_stats Whether to collect the per utterance decode stats.
+ * @param hw_counters Whether to also collect the hardware counters, implies `collect_stats`.
+ * @param configs The number of scorer params the batch is decoded with, whose outputs are stacked along the batch.
+ */
+zctc::TensorBatch::TensorBatch(py::handle logits, py::handle seq_len, bool time_major, int vocab_size,
+							   std::size_t beam_width, bool collect_stats, bool hw_counters, int configs)
+	: time_major(time_major)
+{
+	this->logits.emplace(logits);
+	this->seq_lens = zctc::TensorView(seq_len).to_ints();
+
+	const std::vector<long>& shape = this->logits->shape;
+	if (shape.size() != 3)
+		throw std::runtime_error("Invalid logits shape. Expected Batch x SeqLen x Vocab, or SeqLen x Batch x Vocab if "
+								 "time major.");
+	if (shape[2] != vocab_size)
+		throw std::runtime_error("Vocab size mismatch " + std::to_string(shape[2]) + " != " + std::to_string(vocab_size));
+
+	this->batch_size = shape[time_major ? 1 : 0];
+	this->max_seq_len = shape[time_major ? 0 : 1];
+	if (this->seq_lens.size() != static_cast<std::size_t>(this->batch_size))
+		throw std::runtime_error("Invalid seq_lens shape. Expected a length for each of the "
+								 + std::to_string(this->batch_size) + " utterances.");
+	for (int length : this->seq_lens)
+		if (length < 0 || length > this->max_seq_len)
+			throw std::runtime_error("Invalid sequence length " + std::to_string(length) + ", expected in [0, "
+									 + std::to_string(this->max_seq_len) + "].");
+
+	py::ssize_t batch = static_cast<py::ssize_t>(configs) * this->batch_size, beams = beam_width,
+				frames = this->max_seq_len;
+	this->labels.emplace(std::vector<py::ssize_t> { batch, beams, frames });
+	this->timesteps.emplace(std::vector<py::ssize_t> { batch, beams, frames });
+	this->seq_pos.emplace(std::vector<py::ssize_t> { batch, beams });
+	this->labels_ptr = this->labels->mutable_data();
+	this->timesteps_ptr = this->timesteps->mutable_data();
+	this->seq_pos_ptr = this->seq_pos->mutable_data();
+	std::fill_n(this->labels_ptr, this->labels->size(), 0);
+	std::fill_n(this->timesteps_ptr, this->timesteps->size(), 0);
+	std::fill_n(this->seq_pos_ptr, this->seq_pos->size(), 0);
+
+	this->stats.resize((collect_stats || hw_counters) ? batch : 0);
+	for (zctc::DecodeStats& stat : this->stats)
+		stat.hw_counters = hw_counters;
+}
+
+/**
+ * @brief Gets the decoded outputs of the batch, as a tuple of the labels,
+ * 		  timesteps and sequence positions arrays and the decode stats.
+ *
+ * @return py::tuple The outputs.
+ */
+py::tuple
+zctc::TensorBatch::outputs()
+{
+	return py::make_tuple(*this->labels, *this->timesteps, *this->seq_pos, py::cast(this->stats));
+}
+
+/**
+ * @brief Gets the decoded outputs of the batch decoded with every scorer
+ * 		  params, as views of the stacked outputs.
+ *
+ * @param configs The number of scorer params the batch was decoded with.
+ *
+ * @return py::list The outputs of every scorer params, in order, same as `outputs`.
+ */
+py::list
+zctc::TensorBatch::config_outputs(int configs)
+{
+	py::list outputs;
+	for (int c = 0; c < configs; c++) {
+		py::slice rows(static_cast<py::ssize_t>(c) * this->batch_size,
+					   static_cast<py::ssize_t>(c + 1) * this->batch_size, 1);
+		std::vector<zctc::DecodeStats> stats;
+		if (!this->stats.empty())
+			stats.assign(this->stats.begin() + c * this->batch_size, this->stats.begin() + (c + 1) * this->batch_size);
+
+		outputs.append(py::make_tuple(py::object((*this->labels)[rows]), py::object((*this->timesteps)[rows]),
+									  py::object((*this->seq_pos)[rows]), py::cast(stats)));
+	}
+
+	return outputs;
+}
+
+/**
+ * @brief Releases the Python objects held by the batch, which needs the GIL.
+ *
+ * @return void
+ */
+void
+zctc::TensorBatch::release()
+{
+	this->callback.reset();
+	this->seq_pos.reset();
+	this->timesteps.reset();
+	this->labels.reset();
+	this->logits.reset();
 }
 
 /**
@@ -620,8 +1941,8 @@ zctc::Decoder::serial_decode(T* logits, int* ids, int* labels, int* timesteps, i
 		op_pos = i * this->beam_width * max_seq_len;
 		s_p = i * this->beam_width;
 
-		zctc::decode<T>(this, logits + ip_pos, ids + ip_pos, labels + op_pos, timesteps + op_pos, *(seq_len + i),
-						max_seq_len, seq_pos + s_p, hotwords_fst);
+		zctc::decode(this, logits + ip_pos, ids + ip_pos, labels + op_pos, timesteps + op_pos, *(seq_len + i),
+					 max_seq_len, seq_pos + s_p, hotwords_fst);
 	}
 
 	if (free_hw_fst)
@@ -1,13 +1,72 @@
 #ifndef _ZCTC_EXT_SCORER_H
 #define _ZCTC_EXT_SCORER_H
 
+#include <unordered_map>
+
 #include "fst/fstlib.h"
 #include "lm/model.hh"
 
 #include "./node.hh"
+#include "./resources.hh"
 
 namespace zctc {
 
+/**
+ * @brief The weights of the external scores, which can be varied across the
+ * 		  decodes of the same logits without reloading the LM and lexicon.
+ */
+struct ScorerParams {
+	float alpha, beta, lex_penalty;
+};
+
+/**
+ * @brief Memo of the KenLM queries, keyed by the context state and the word,
+ * 		  which don't depend on the scorer params. Shared by the decodes of the
+ * 		  same utterance with different params, whose beams mostly extend the
+ * 		  same contexts. Not thread safe, it's meant to be used by one decode
+ * 		  at a time.
+ */
+class LmCache {
+public:
+	inline bool find(const lm::ngram::State& state, lm::WordIndex word, float& score, lm::ngram::State& out_state) const
+	{
+		auto entry = this->entries.find({ state, word });
+		if (entry == this->entries.end())
+			return false;
+
+		score = entry->second.score;
+		out_state = entry->second.out_state;
+		return true;
+	}
+
+	inline void insert(const lm::ngram::State& state, lm::WordIndex word, float score,
+					   const lm::ngram::State& out_state)
+	{
+		this->entries.emplace(Key { state, word }, Entry { score, out_state });
+	}
+
+	inline std::size_t size() const { return this->entries.size(); }
+
+private:
+	struct Key {
+		lm::ngram::State state;
+		lm::WordIndex word;
+
+		bool operator==(const Key& other) const { return this->word == other.word && this->state == other.state; }
+	};
+
+	struct KeyHash {
+		std::size_t operator()(const Key& key) const { return lm::ngram::hash_value(key.state, key.word); }
+	};
+
+	struct Entry {
+		float score;
+		lm::ngram::State out_state;
+	};
+
+	std::unordered_map<Key, Entry, KeyHash> entries;
+};
+
 class ExternalScorer {
 public:
 	const bool enabled;
@@ -18,8 +77,17 @@ public:
 	lm::base::Model* lm;
 	fst::StdVectorFst* lexicon;
 
+	/**
+	 * NOTE: The LM and lexicon are shared with the other decoders loading
+	 * 		 the same files, through `zctc::ScorerResources`, and are only
+	 * 		 read while decoding. The raw pointers above are their views.
+	 */
+	std::shared_ptr<lm::base::Model> shared_lm;
+	std::shared_ptr<fst::StdVectorFst> shared_lexicon;
+	zctc::LmLoadStats lm_load_stats;
+
 	ExternalScorer(char tok_sep, int apostrophe_id, float alpha, float beta, float lex_penalty, char* lm_path,
-				   char* lexicon_path)
+				   char* lexicon_path, const zctc::LmLoadConfig& lm_config = {})
 		: enabled(lm_path || lexicon_path)
 		, tok_sep(tok_sep)
 		, apostrophe_id(apostrophe_id)
@@ -30,32 +98,31 @@ public:
 		, lexicon(nullptr)
 	{
 
-		if (lm_path)
-			this->lm = lm::ngram::LoadVirtual(lm_path);
-		this->unk_lm_tok_id = this->lm->BaseVocabulary().NotFound();
+		if (lm_path) {
+			this->shared_lm
+				= zctc::ScorerResources::instance().language_model(lm_path, lm_config, &this->lm_load_stats);
+			this->lm = this->shared_lm.get();
+			this->unk_lm_tok_id = this->lm->BaseVocabulary().NotFound();
+		}
 
-		if (lexicon_path)
-			this->lexicon = fst::StdVectorFst::Read(lexicon_path);
+		if (lexicon_path) {
+			this->shared_lexicon = zctc::ScorerResources::instance().lexicon(lexicon_path);
+			this->lexicon = this->shared_lexicon.get();
+		}
 	}
 
-	~ExternalScorer()
-	{
-		if (this->lm)
-			delete this->lm;
+	inline ScorerParams params() const { return { this->alpha, this->beta, this->lex_penalty }; }
 
-		if (this->lexicon)
-			delete this->lexicon;
-	}
-
-	template <typename T>
-	inline void start_of_word_check(zctc::Node<T>* node, fst::StdVectorFst* hotwords_fst) const;
-	template <typename T>
-	inline void initialise_start_states(zctc::Node<T>* root, fst::StdVectorFst* hotwords_fst) const;
+	template <typename T, typename E>
+	inline void start_of_word_check(zctc::Node<T, E>* node, fst::StdVectorFst* hotwords_fst) const;
+	template <typename T, typename E>
+	inline void initialise_start_states(zctc::Node<T, E>* root, fst::StdVectorFst* hotwords_fst) const;
 
-	template <typename T>
-	void run_ext_scoring(zctc::Node<T>* node, fst::SortedMatcher<fst::StdVectorFst>* lexicon_matcher,
+	template <typename T, typename E>
+	void run_ext_scoring(zctc::Node<T, E>* node, fst::SortedMatcher<fst::StdVectorFst>* lexicon_matcher,
 						 fst::StdVectorFst* hotwords_fst,
-						 fst::SortedMatcher<fst::StdVectorFst>* hotwords_matcher) const;
+						 fst::SortedMatcher<fst::StdVectorFst>* hotwords_matcher, zctc::DecodeStats* stats = nullptr,
+						 const ScorerParams* params = nullptr, LmCache* lm_cache = nullptr) const;
 };
 
 } // namespace zctc
@@ -74,9 +141,9 @@ public:
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::ExternalScorer::start_of_word_check(zctc::Node<T>* node, fst::StdVectorFst* hotwords_fst) const
+zctc::ExternalScorer::start_of_word_check(zctc::Node<T, E>* node, fst::StdVectorFst* hotwords_fst) const
 {
 	node->is_start_of_word = !(node->id == this->apostrophe_id || node->parent->id == this->apostrophe_id
 							   || node->token.at(0) == this->tok_sep);
@@ -84,11 +151,15 @@ zctc::ExternalScorer::start_of_word_check(zctc::Node<T>* node, fst::StdVectorFst
 	if (!node->is_start_of_word)
 		return;
 
-	if (this->lexicon)
-		node->lexicon_state = this->lexicon->Start();
+	if constexpr (E::lexicon) {
+		if (this->lexicon)
+			node->lexicon_state = this->lexicon->Start();
+	}
 
-	if (hotwords_fst)
-		node->hotword_state = hotwords_fst->Start();
+	if constexpr (E::hotwords) {
+		if (hotwords_fst)
+			node->hotword_state = hotwords_fst->Start();
+	}
 }
 
 /**
@@ -100,56 +171,81 @@ zctc::ExternalScorer::start_of_word_check(zctc::Node<T>* node, fst::StdVectorFst
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::ExternalScorer::initialise_start_states(zctc::Node<T>* root, fst::StdVectorFst* hotwords_fst) const
+zctc::ExternalScorer::initialise_start_states(zctc::Node<T, E>* root, fst::StdVectorFst* hotwords_fst) const
 {
-	if (this->lexicon)
-		root->lexicon_state = this->lexicon->Start();
+	if constexpr (E::lexicon) {
+		if (this->lexicon)
+			root->lexicon_state = this->lexicon->Start();
+	}
 
-	if (this->lm)
-		this->lm->BeginSentenceWrite(&(root->lm_state));
+	if constexpr (E::lm) {
+		if (this->lm)
+			this->lm->BeginSentenceWrite(&(root->lm_state));
+	}
 
-	if (hotwords_fst)
-		root->hotword_state = hotwords_fst->Start();
+	if constexpr (E::hotwords) {
+		if (hotwords_fst)
+			root->hotword_state = hotwords_fst->Start();
+	}
 }
 
 /**
  * @brief Run the external scoring for the provided node, considering the
  * 		  language model, lexicon, hotwords FSTs and beta word penalty
- * 		  using the external scorer parameters.
+ * 		  using the external scorer parameters. Only the features of `E`
+ * 		  are scored, and those loaded among them.
  *
+ * @tparam E The scorer features of the node.
  * @param node The node for which the external scoring is to be done.
  * @param lexicon_matcher The lexicon matcher to be used for lexicon searching.
  * @param hotwords_fst The hotwords FST to be used for hotword scoring.
  * @param hotwords_matcher The hotwords matcher to be used for hotword searching.
+ * @param stats The decode stats to count the LM queries, lexicon and hotword lookups in, if any.
+ * @param params The weights of the external scores, or `nullptr` for the scorer's own.
+ * @param lm_cache The memo of the KenLM queries to look up and fill, if any.
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::ExternalScorer::run_ext_scoring(zctc::Node<T>* node, fst::SortedMatcher<fst::StdVectorFst>* lexicon_matcher,
+zctc::ExternalScorer::run_ext_scoring(zctc::Node<T, E>* node, fst::SortedMatcher<fst::StdVectorFst>* lexicon_matcher,
 									  fst::StdVectorFst* hotwords_fst,
-									  fst::SortedMatcher<fst::StdVectorFst>* hotwords_matcher) const
+									  fst::SortedMatcher<fst::StdVectorFst>* hotwords_matcher,
+									  zctc::DecodeStats* stats, const zctc::ScorerParams* params,
+									  zctc::LmCache* lm_cache) const
 {
+	const zctc::ScorerParams weights = params ? *params : this->params();
 
-	if (this->lm) {
+	if constexpr (E::lm) {
+		if (this->lm) {
+			if (stats)
+				stats->lm_queries++;
 
-		lm::WordIndex word_id = this->lm->BaseVocabulary().Index(node->token);
+			lm::WordIndex word_id = this->lm->BaseVocabulary().Index(node->token);
 
-		if (word_id == this->unk_lm_tok_id) {
-			node->lm_lex_score += -1000; // OOV char
-		} else {
-			/**
-			 * NOTE: Since KenLM returns the log probability with base 10,
-			 * 		 converting the log probability to base e, using,
-			 *
-			 * 		 logb(x) = loga(x) / loga(b)
-			 */
-			node->lm_lex_score
-				+= (this->alpha
-					* (this->lm->BaseScore(&(node->parent->lm_state), word_id, &(node->lm_state)) / zctc::LOG_A_OF_B))
-				   + this->beta;
+			if (word_id == this->unk_lm_tok_id) {
+				node->lm_lex_score += -1000; // OOV char
+			} else {
+				float lm_score;
+				if (lm_cache && lm_cache->find(node->parent->lm_state, word_id, lm_score, node->lm_state)) {
+					if (stats)
+						stats->lm_cache_hits++;
+				} else {
+					lm_score = this->lm->BaseScore(&(node->parent->lm_state), word_id, &(node->lm_state));
+					if (lm_cache)
+						lm_cache->insert(node->parent->lm_state, word_id, lm_score, node->lm_state);
+				}
+
+				/**
+				 * NOTE: Since KenLM returns the log probability with base 10,
+				 * 		 converting the log probability to base e, using,
+				 *
+				 * 		 logb(x) = loga(x) / loga(b)
+				 */
+				node->lm_lex_score += (weights.alpha * (lm_score / zctc::LOG_A_OF_B)) + weights.beta;
+			}
 		}
 	}
 
@@ -161,103 +257,117 @@ zctc::ExternalScorer::run_ext_scoring(zctc::Node<T>* node, fst::SortedMatcher<fs
 	 *
 	 * 		 But, the language model and lexicon scores will be passed to the child nodes.
 	 */
-	if (hotwords_fst && (node->parent->is_hotpath || node->is_start_of_word)) {
-		/**
-		 * NOTE: If the node is the start of word, then
-		 * 		 check whether the parent is a hotword path or not.
-		 * 		 If yes, then continue from the parent's hotword state.
-		 * 		 If not, then start from the initial state of the hotwords FST.
-		 */
-		fst::StdVectorFst::StateId state
-			= (node->is_start_of_word && (!node->is_hotpath)) ? node->hotword_state : node->parent->hotword_state;
-		hotwords_matcher->SetState(state);
-
-		if (hotwords_matcher->Find(node->id)) {
-			float hw_completion_ration;
-			const fst::StdArc& arc = hotwords_matcher->Value();
+	if constexpr (E::hotwords) {
+		if (hotwords_fst && (node->parent->is_hotpath || node->is_start_of_word)) {
 			/**
-			 * NOTE: Here,
-			 * 		 arc.olabel is the token completion ratio so far in the hotword,
-			 * 		 arc.weight.Value() is the weight for that hotword.
+			 * NOTE: If the node is the start of word, then
+			 * 		 check whether the parent is a hotword path or not.
+			 * 		 If yes, then continue from the parent's hotword state.
+			 * 		 If not, then start from the initial state of the hotwords FST.
 			 */
-			node->hotword_state = arc.nextstate;
-			std::memcpy(&hw_completion_ration, &(arc.olabel), sizeof(float));
-			node->hw_score = zctc::quadratic_hw_score(hw_completion_ration, arc.weight.Value());
-			node->is_hotpath = true;
+			fst::StdVectorFst::StateId state
+				= (node->is_start_of_word && (!node->is_hotpath)) ? node->hotword_state : node->parent->hotword_state;
+			hotwords_matcher->SetState(state);
+			if (stats)
+				stats->hotword_lookups++;
 
-		} else if (node->is_start_of_word) {
-			hotwords_matcher->SetState(node->hotword_state);
 			if (hotwords_matcher->Find(node->id)) {
 				float hw_completion_ration;
 				const fst::StdArc& arc = hotwords_matcher->Value();
-				node->hotword_state = arc.nextstate;
 				/**
-				 * NOTE: Since the output label of an arc should be an integer,
-				 * 		 we're byte-level casting the float hotword completion ratio to an integer,
-				 * 		 and then recasting it back to float here.
+				 * NOTE: Here,
+				 * 		 arc.olabel is the token completion ratio so far in the hotword,
+				 * 		 arc.weight.Value() is the weight for that hotword.
 				 */
+				node->hotword_state = arc.nextstate;
 				std::memcpy(&hw_completion_ration, &(arc.olabel), sizeof(float));
 				node->hw_score = zctc::quadratic_hw_score(hw_completion_ration, arc.weight.Value());
 				node->is_hotpath = true;
+
+			} else if (node->is_start_of_word) {
+				hotwords_matcher->SetState(node->hotword_state);
+				if (stats)
+					stats->hotword_lookups++;
+
+				if (hotwords_matcher->Find(node->id)) {
+					float hw_completion_ration;
+					const fst::StdArc& arc = hotwords_matcher->Value();
+					node->hotword_state = arc.nextstate;
+					/**
+					 * NOTE: Since the output label of an arc should be an integer,
+					 * 		 we're byte-level casting the float hotword completion ratio to an integer,
+					 * 		 and then recasting it back to float here.
+					 */
+					std::memcpy(&hw_completion_ration, &(arc.olabel), sizeof(float));
+					node->hw_score = zctc::quadratic_hw_score(hw_completion_ration, arc.weight.Value());
+					node->is_hotpath = true;
+				}
 			}
-		}
 
-		if (node->parent->is_hotpath
-			&& (hotwords_fst->Final(node->parent->hotword_state) != fst::StdArc::Weight::Zero())
-			&& (hotwords_matcher->state_ == hotwords_fst->Start())) {
-			/**
-			 * NOTE: Adding the previously completed hotword score to the `lm_lex_score` as this
-			 * 		 attribute's value will be passed hereditarily to the successor nodes.
-			 */
-			node->lm_lex_score += node->parent->hw_score;
+			if (node->parent->is_hotpath
+				&& (hotwords_fst->Final(node->parent->hotword_state) != fst::StdArc::Weight::Zero())
+				&& (hotwords_matcher->state_ == hotwords_fst->Start())) {
+				/**
+				 * NOTE: Adding the previously completed hotword score to the `lm_lex_score` as this
+				 * 		 attribute's value will be passed hereditarily to the successor nodes.
+				 */
+				node->lm_lex_score += node->parent->hw_score;
+			}
 		}
 	}
 
-	if (this->lexicon) {
-		/**
-		 * NOTE: Improper combinations of tokens are penalized with `lex_penalty`.
-		 */
-		if (!(node->parent->is_lex_path || node->is_start_of_word)) {
-
-			node->is_lex_path = false;
-			node->lm_lex_score += (node->is_hotpath ? 0 : this->lex_penalty);
-
-		} else {
+	if constexpr (E::lexicon) {
+		if (this->lexicon) {
 			/**
-			 * NOTE: If the node is the start of word, then
-			 * 		 check whether the parent is a lexicon path or not.
-			 * 		 If yes, then continue from the parent's lexicon state.
-			 * 		 If not, then start from the initial state of the lexicon FST.
+			 * NOTE: Improper combinations of tokens are penalized with `lex_penalty`.
 			 */
-			fst::StdVectorFst::StateId state = (node->is_start_of_word && (!node->parent->is_lex_path))
-												   ? node->lexicon_state
-												   : node->parent->lexicon_state;
-			lexicon_matcher->SetState(state);
+			if (!(node->parent->is_lex_path || node->is_start_of_word)) {
 
-			/**
-			 * NOTE: If the node's parent is a valid lexicon path, and also the
-			 * 		 node is a start of the word, then we'll first check if the
-			 * 		 node is a proper lexicon child for the parent, if not, then
-			 * 		 we'll check if the start of the word is a seperate
-			 * 		 lexicon entity.
-			 */
-			if (lexicon_matcher->Find(node->id)) {
-				node->lexicon_state = lexicon_matcher->Value().nextstate;
-				node->is_lex_path = true;
+				node->is_lex_path = false;
+				node->lm_lex_score += (node->is_hotpath ? 0 : weights.lex_penalty);
 
-			} else if (node->is_start_of_word && node->parent->is_lex_path) {
-				lexicon_matcher->SetState(node->lexicon_state);
+			} else {
+				/**
+				 * NOTE: If the node is the start of word, then
+				 * 		 check whether the parent is a lexicon path or not.
+				 * 		 If yes, then continue from the parent's lexicon state.
+				 * 		 If not, then start from the initial state of the lexicon FST.
+				 */
+				fst::StdVectorFst::StateId state = (node->is_start_of_word && (!node->parent->is_lex_path))
+													   ? node->lexicon_state
+													   : node->parent->lexicon_state;
+				lexicon_matcher->SetState(state);
+				if (stats)
+					stats->lexicon_lookups++;
+
+				/**
+				 * NOTE: If the node's parent is a valid lexicon path, and also the
+				 * 		 node is a start of the word, then we'll first check if the
+				 * 		 node is a proper lexicon child for the parent, if not, then
+				 * 		 we'll check if the start of the word is a seperate
+				 * 		 lexicon entity.
+				 */
 				if (lexicon_matcher->Find(node->id)) {
 					node->lexicon_state = lexicon_matcher->Value().nextstate;
 					node->is_lex_path = true;
+
+				} else if (node->is_start_of_word && node->parent->is_lex_path) {
+					lexicon_matcher->SetState(node->lexicon_state);
+					if (stats)
+						stats->lexicon_lookups++;
+
+					if (lexicon_matcher->Find(node->id)) {
+						node->lexicon_state = lexicon_matcher->Value().nextstate;
+						node->is_lex_path = true;
+					} else {
+						node->is_lex_path = false;
+						node->lm_lex_score += (node->is_hotpath ? 0 : weights.lex_penalty);
+					}
+
 				} else {
 					node->is_lex_path = false;
-					node->lm_lex_score += (node->is_hotpath ? 0 : this->lex_penalty);
+					node->lm_lex_score += (node->is_hotpath ? 0 : weights.lex_penalty);
 				}
-
-			} else {
-				node->is_lex_path = false;
-				node->lm_lex_score += (node->is_hotpath ? 0 : this->lex_penalty);
 			}
 		}
 	}
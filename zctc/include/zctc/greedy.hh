@@ -0,0 +1,76 @@
+#ifndef _ZCTC_GREEDY_H
+#define _ZCTC_GREEDY_H
+
+#include <algorithm>
+
+#include "./logits.hh"
+
+namespace zctc {
+
+template <typename S>
+int greedy_decode(S logits, int vocab_size, int blank_id, int* label, int* timestep, const int seq_len,
+				  const int max_seq_len, int* seq_pos);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Decodes the best path of the provided logits, (ie) the most probable
+ * 		  token of every frame, collapsing the repeats and dropping the blanks,
+ * 		  which is what the beam search converges to with a beam width of 1,
+ * 		  without its prefix tree, matchers and candidate selection. Only the
+ * 		  argmax of every frame is computed, so it runs at the speed the frames
+ * 		  are read from memory.
+ *
+ * 		  The outputs are laid out as `zctc::decode` with a single beam, so it
+ * 		  can replace the beam search of width 1.
+ *
+ * @tparam S The type of the logits source, same as `zctc::decode`.
+ * @param logits The logits source of shape SeqLen x Vocab.
+ * @param vocab_size The vocab size.
+ * @param blank_id The blank token id.
+ * @param label The labels array of MaxSeqLen, to write the decoded labels at its end.
+ * @param timestep The timesteps array of MaxSeqLen, to write the first frame of every decoded label at its end, or
+ * `nullptr` to skip the timesteps.
+ * @param seq_len The sequence length of the sample excluding the padding.
+ * @param max_seq_len The maximum sequence length of the sample including the padding.
+ * @param seq_pos The sequence position, to write the starting position of the decoded labels.
+ *
+ * @return int 0 on successful execution.
+ */
+template <typename S>
+int
+zctc::greedy_decode(S logits, int vocab_size, int blank_id, int* label, int* timestep, const int seq_len,
+					const int max_seq_len, int* seq_pos)
+{
+	int length = 0, prev_id = blank_id;
+
+	/**
+	 * NOTE: The labels are written from the start, as their count isn't
+	 * 		 known until the last frame, and moved to the end once, which
+	 * 		 is cheap as there are far fewer labels than frames.
+	 */
+	for (int t = 0; t < seq_len; t++) {
+		int id = zctc::frame_argmax(zctc::frame_logits(logits, t, vocab_size), vocab_size);
+		if (id != blank_id && id != prev_id) {
+			label[length] = id;
+			if (timestep)
+				timestep[length] = t;
+			length++;
+		}
+		prev_id = id;
+	}
+
+	std::move_backward(label, label + length, label + max_seq_len);
+	std::fill_n(label, std::min(length, max_seq_len - length), 0);
+	if (timestep) {
+		std::move_backward(timestep, timestep + length, timestep + max_seq_len);
+		std::fill_n(timestep, std::min(length, max_seq_len - length), 0);
+	}
+	*seq_pos = max_seq_len - length;
+
+	return 0;
+}
+
+#endif // _ZCTC_GREEDY_H
@@ -0,0 +1,141 @@
+#ifndef _ZCTC_HALF_H
+#define _ZCTC_HALF_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif // __F16C__
+
+namespace zctc {
+
+/**
+ * @brief Storage only 16-bit floating point types of the logits, which are
+ * 		  never computed with, only widened to the score type of the decoder,
+ * 		  one candidate at a time, as they are consumed by `zctc::decode`.
+ */
+struct float16 {
+	std::uint16_t bits;
+};
+
+struct bfloat16 {
+	std::uint16_t bits;
+};
+
+/**
+ * @brief The type in which the probabilities of the logits type `L` are scored,
+ * 		  the logits type itself, except for the 16-bit types, scored in float.
+ */
+template <typename L>
+struct score_type {
+	using type = L;
+};
+
+template <>
+struct score_type<float16> {
+	using type = float;
+};
+
+template <>
+struct score_type<bfloat16> {
+	using type = float;
+};
+
+template <typename L>
+struct score_type<L*> : score_type<std::remove_cv_t<L>> {
+};
+
+template <typename L>
+using score_type_t = typename score_type<L>::type;
+
+template <typename L>
+inline L widen(L value);
+inline float widen(float16 value);
+inline float widen(bfloat16 value);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Widens the logit value to its score type, (ie) the value itself for
+ * 		  the float and double logits.
+ *
+ * @param value The logit value.
+ *
+ * @return L The same value.
+ */
+template <typename L>
+L
+zctc::widen(L value)
+{
+	return value;
+}
+
+/**
+ * @brief Widens the IEEE half precision value to float, which is exact. Uses
+ * 		  the single F16C instruction when built for it, (ie) with `ZCTC_NATIVE`
+ * 		  on a CPU having it or a `ZCTC_MARCH` of x86-64-v3 or above, otherwise
+ * 		  the bits are rebiased, with the subnormals normalised.
+ *
+ * @param value The half precision value.
+ *
+ * @return float The widened value.
+ */
+float
+zctc::widen(zctc::float16 value)
+{
+#if defined(__F16C__)
+	return _cvtsh_ss(value.bits);
+#else
+	std::uint32_t sign = static_cast<std::uint32_t>(value.bits & 0x8000) << 16;
+	std::uint32_t exponent = (value.bits >> 10) & 0x1f;
+	std::uint32_t mantissa = value.bits & 0x3ff;
+	std::uint32_t bits;
+
+	if (exponent == 0x1f) {
+		// NOTE: Infinity and NaN keep the all ones exponent.
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else if (exponent != 0) {
+		bits = sign | ((exponent + (127 - 15)) << 23) | (mantissa << 13);
+	} else if (mantissa == 0) {
+		bits = sign;
+	} else {
+		/**
+		 * NOTE: Subnormal halves are normal floats, so shift the mantissa
+		 * 		 until the implicit bit is set and adjust the exponent.
+		 */
+		exponent = 127 - 15 + 1;
+		while ((mantissa & 0x400) == 0) {
+			mantissa <<= 1;
+			exponent--;
+		}
+		bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(float));
+	return result;
+#endif // __F16C__
+}
+
+/**
+ * @brief Widens the bfloat16 value to float, which is the upper half of the
+ * 		  float bits.
+ *
+ * @param value The bfloat16 value.
+ *
+ * @return float The widened value.
+ */
+float
+zctc::widen(zctc::bfloat16 value)
+{
+	std::uint32_t bits = static_cast<std::uint32_t>(value.bits) << 16;
+	float result;
+	std::memcpy(&result, &bits, sizeof(float));
+	return result;
+}
+
+#endif // _ZCTC_HALF_H
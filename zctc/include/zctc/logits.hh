@@ -0,0 +1,310 @@
+#ifndef _ZCTC_LOGITS_H
+#define _ZCTC_LOGITS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#include "./half.hh"
+#include "./simd.hh"
+
+namespace zctc {
+
+/**
+ * @brief Batch of int8 quantized log probabilities of shape Batch x SeqLen x Vocab,
+ * 		  where every frame (or every utterance) has its own scale and offset,
+ * 		  dequantized as,
+ *
+ * 		  log_prob = value * scale + offset
+ *
+ * 		  The `scales` and `offsets` arrays are of shape Batch x SeqLen if
+ * 		  `per_frame` is set, else of shape Batch.
+ */
+struct QuantizedLogits {
+	const std::int8_t* values;
+	const float* scales;
+	const float* offsets;
+	bool per_frame;
+};
+
+/**
+ * @brief A single frame of the quantized logits, with its scale and offset
+ * 		  already resolved.
+ */
+struct QuantizedFrame {
+	const std::int8_t* values;
+	float scale, offset;
+};
+
+/**
+ * @brief Batch of logits of shape Batch x SeqLen x Vocab at arbitrary strides,
+ * 		  in elements, so the time major and sliced tensors can be decoded
+ * 		  in place, without making them contiguous first.
+ */
+template <typename L>
+struct StridedLogits {
+	const L* data;
+	std::ptrdiff_t batch_stride, time_stride, vocab_stride;
+};
+
+template <typename L>
+struct StridedFrame {
+	const L* data;
+	std::ptrdiff_t vocab_stride;
+};
+
+template <>
+struct score_type<QuantizedLogits> {
+	using type = float;
+};
+
+template <typename L>
+struct score_type<StridedLogits<L>> : score_type<L> {
+};
+
+/**
+ * NOTE: The logits sources are passed to `zctc::decode` by value, either a
+ * 		 pointer to the softmaxed probabilities or a `QuantizedLogits` view,
+ * 		 and accessed only through the following functions, so the decoder
+ * 		 reads one frame at a time and converts only the consumed candidates.
+ */
+template <typename L>
+inline L* utterance_logits(L* logits, int utterance, int max_seq_len, int vocab_size);
+inline QuantizedLogits utterance_logits(const QuantizedLogits& logits, int utterance, int max_seq_len, int vocab_size);
+
+template <typename L>
+inline StridedLogits<L> utterance_logits(const StridedLogits<L>& logits, int utterance, int max_seq_len,
+										 int vocab_size);
+
+template <typename L>
+inline L* frame_logits(L* logits, int timestep, int vocab_size);
+inline QuantizedFrame frame_logits(const QuantizedLogits& logits, int timestep, int vocab_size);
+template <typename L>
+inline StridedFrame<L> frame_logits(const StridedLogits<L>& logits, int timestep, int vocab_size);
+
+template <typename T, typename L>
+inline T prob_at(const L* frame, int id);
+template <typename T>
+inline T prob_at(const QuantizedFrame& frame, int id);
+template <typename T, typename L>
+inline T prob_at(const StridedFrame<L>& frame, int id);
+
+template <typename T, typename F>
+inline void top_candidates(const F& frame, int vocab_size, int count, std::vector<int>& ids);
+template <typename T>
+inline void top_candidates(const QuantizedFrame& frame, int vocab_size, int count, std::vector<int>& ids);
+
+template <typename L>
+inline int frame_argmax(const L* frame, int vocab_size);
+inline int frame_argmax(const QuantizedFrame& frame, int vocab_size);
+template <typename L>
+inline int frame_argmax(const StridedFrame<L>& frame, int vocab_size);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Gets the logits of the provided utterance of the batch.
+ *
+ * @param logits The batch of logits of shape Batch x MaxSeqLen x Vocab.
+ * @param utterance The index of the utterance in the batch.
+ * @param max_seq_len The maximum sequence length of the batch, including the padding.
+ * @param vocab_size The vocab size.
+ *
+ * @return L* The logits of the utterance.
+ */
+template <typename L>
+L*
+zctc::utterance_logits(L* logits, int utterance, int max_seq_len, int vocab_size)
+{
+	return logits + static_cast<std::size_t>(utterance) * max_seq_len * vocab_size;
+}
+
+zctc::QuantizedLogits
+zctc::utterance_logits(const zctc::QuantizedLogits& logits, int utterance, int max_seq_len, int vocab_size)
+{
+	std::size_t params_pos = logits.per_frame ? static_cast<std::size_t>(utterance) * max_seq_len : utterance;
+
+	return { logits.values + static_cast<std::size_t>(utterance) * max_seq_len * vocab_size,
+			 logits.scales + params_pos, logits.offsets + params_pos, logits.per_frame };
+}
+
+template <typename L>
+zctc::StridedLogits<L>
+zctc::utterance_logits(const zctc::StridedLogits<L>& logits, int utterance, int max_seq_len, int vocab_size)
+{
+	return { logits.data + utterance * logits.batch_stride, logits.batch_stride, logits.time_stride,
+			 logits.vocab_stride };
+}
+
+/**
+ * @brief Gets the logits of the provided frame of an utterance.
+ *
+ * @param logits The logits of the utterance, of shape SeqLen x Vocab.
+ * @param timestep The frame index.
+ * @param vocab_size The vocab size.
+ *
+ * @return L* The logits of the frame.
+ */
+template <typename L>
+L*
+zctc::frame_logits(L* logits, int timestep, int vocab_size)
+{
+	return logits + static_cast<std::size_t>(timestep) * vocab_size;
+}
+
+zctc::QuantizedFrame
+zctc::frame_logits(const zctc::QuantizedLogits& logits, int timestep, int vocab_size)
+{
+	std::size_t params_pos = logits.per_frame ? timestep : 0;
+
+	return { logits.values + static_cast<std::size_t>(timestep) * vocab_size, logits.scales[params_pos],
+			 logits.offsets[params_pos] };
+}
+
+template <typename L>
+zctc::StridedFrame<L>
+zctc::frame_logits(const zctc::StridedLogits<L>& logits, int timestep, int vocab_size)
+{
+	return { logits.data + timestep * logits.time_stride, logits.vocab_stride };
+}
+
+/**
+ * @brief Gets the probability of the token in the frame, in linear scale.
+ *
+ * @tparam T The score type of the decoder.
+ * @param frame The logits of the frame.
+ * @param id The token id.
+ *
+ * @return T The probability of the token.
+ */
+template <typename T, typename L>
+T
+zctc::prob_at(const L* frame, int id)
+{
+	return static_cast<T>(zctc::widen(frame[id]));
+}
+
+template <typename T>
+T
+zctc::prob_at(const zctc::QuantizedFrame& frame, int id)
+{
+	return std::exp(static_cast<T>(frame.values[id]) * frame.scale + frame.offset);
+}
+
+template <typename T, typename L>
+T
+zctc::prob_at(const zctc::StridedFrame<L>& frame, int id)
+{
+	return static_cast<T>(zctc::widen(frame.data[id * frame.vocab_stride]));
+}
+
+/**
+ * @brief Selects the `count` most probable tokens of the frame, in descending
+ * 		  order of their probability, for the callers which don't provide the
+ * 		  sorted ids. Only the selected prefix is sorted, instead of the whole
+ * 		  vocab.
+ *
+ * @tparam T The score type of the decoder.
+ * @param frame The logits of the frame.
+ * @param vocab_size The vocab size.
+ * @param count The number of tokens to select, clamped to the vocab size.
+ * @param ids The vector of size `vocab_size` to write the token ids to, the first `count` of which are the selected.
+ *
+ * @return void
+ */
+template <typename T, typename F>
+void
+zctc::top_candidates(const F& frame, int vocab_size, int count, std::vector<int>& ids)
+{
+	/**
+	 * NOTE: The frame is converted once into the thread's scratch, so the
+	 * 		 16-bit floats are widened and the strided views are indexed once
+	 * 		 per token, instead of on every comparison of the sort.
+	 */
+	thread_local std::vector<T> probs;
+	probs.resize(vocab_size);
+	for (int i = 0; i < vocab_size; i++)
+		probs[i] = zctc::prob_at<T>(frame, i);
+
+	const T* values = probs.data();
+	std::iota(ids.begin(), ids.end(), 0);
+	std::partial_sort(ids.begin(), ids.begin() + std::min(count, vocab_size), ids.end(),
+					  [values](int x, int y) { return values[x] > values[y]; });
+}
+
+/**
+ * @brief Selects the `count` most probable tokens of the quantized frame.
+ * 		  The scale is positive, so the tokens are ranked by their quantized
+ * 		  values, without dequantizing any of them.
+ */
+template <typename T>
+void
+zctc::top_candidates(const zctc::QuantizedFrame& frame, int vocab_size, int count, std::vector<int>& ids)
+{
+	const std::int8_t* values = frame.values;
+
+	std::iota(ids.begin(), ids.end(), 0);
+	std::partial_sort(ids.begin(), ids.begin() + std::min(count, vocab_size), ids.end(),
+					  [values](int x, int y) { return values[x] > values[y]; });
+}
+
+/**
+ * @brief Gets the most probable token of the frame, the first one if tied.
+ * 		  The contiguous float and double frames are scanned with the SIMD
+ * 		  `zctc::argmax`, the rest are compared in their own type, as the
+ * 		  conversion doesn't change the order, so nothing is dequantized.
+ *
+ * @param frame The logits of the frame.
+ * @param vocab_size The vocab size.
+ *
+ * @return int The token id.
+ */
+template <typename L>
+int
+zctc::frame_argmax(const L* frame, int vocab_size)
+{
+	if constexpr (std::is_same_v<L, float> || std::is_same_v<L, double>) {
+		return zctc::argmax(frame, vocab_size);
+	} else {
+		int best = 0;
+		for (int i = 1; i < vocab_size; i++)
+			if (zctc::widen(frame[i]) > zctc::widen(frame[best]))
+				best = i;
+
+		return best;
+	}
+}
+
+int
+zctc::frame_argmax(const zctc::QuantizedFrame& frame, int vocab_size)
+{
+	int best = 0;
+	for (int i = 1; i < vocab_size; i++)
+		if (frame.values[i] > frame.values[best])
+			best = i;
+
+	return best;
+}
+
+template <typename L>
+int
+zctc::frame_argmax(const zctc::StridedFrame<L>& frame, int vocab_size)
+{
+	if (frame.vocab_stride == 1)
+		return zctc::frame_argmax(frame.data, vocab_size);
+
+	int best = 0;
+	for (int i = 1; i < vocab_size; i++)
+		if (zctc::widen(frame.data[i * frame.vocab_stride]) > zctc::widen(frame.data[best * frame.vocab_stride]))
+			best = i;
+
+	return best;
+}
+
+#endif // _ZCTC_LOGITS_H
@@ -5,16 +5,53 @@
 #include <cassert>
 #include <cmath>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "fst/fstlib.h"
 #include "lm/state.hh"
 
+#include "./simd.hh"
+#include "./stats.hh"
 #include "./utils.hh"
 
 namespace zctc {
 
-template <typename T>
+/**
+ * @brief The external scorer features a decode is specialized on. The scoring
+ * 		  of a disabled feature is compiled out of the decode, and its states
+ * 		  out of the nodes. `AllFeatures` keeps every feature, checking at
+ * 		  runtime whether the LM, lexicon and hotwords are loaded.
+ *
+ * @tparam LM Whether the nodes are scored with the language model.
+ * @tparam LEXICON Whether the nodes are checked against the lexicon.
+ * @tparam HOTWORDS Whether the nodes are boosted with the hotwords.
+ */
+template <bool LM, bool LEXICON, bool HOTWORDS>
+struct ScorerFeatures {
+	static constexpr bool lm = LM, lexicon = LEXICON, hotwords = HOTWORDS;
+	static constexpr bool any = LM || LEXICON || HOTWORDS;
+};
+
+using AllFeatures = ScorerFeatures<true, true, true>;
+
+/**
+ * @brief Stands in for the node state of a disabled feature, taking no space
+ * 		  as a `[[no_unique_address]]` member. The states are told apart by `I`,
+ * 		  as empty members of the same type can't share an address.
+ */
+template <int I>
+struct NoState {
+	NoState() = default;
+
+	template <typename V>
+	NoState(const V&) { }
+};
+
+template <bool ENABLED, typename V, int I>
+using feature_state_t = std::conditional_t<ENABLED, V, NoState<I>>;
+
+template <typename T, typename E = AllFeatures>
 class Node {
 public:
 	const bool is_clone, only_prev_b;
@@ -25,11 +62,12 @@ public:
 	int ts, b_ts, tk_ts;
 	T tk_prob, b_prob, prev_b_score, squash_score, prev_score;
 	T max_prob, _max_prob, p_score, score, ovrl_score, lm_lex_score;
-	T hw_score;
+	[[no_unique_address]] zctc::feature_state_t<E::hotwords, T, 0> hw_score;
 
 	Node* parent;
-	lm::ngram::State lm_state;
-	fst::StdVectorFst::StateId lexicon_state, hotword_state;
+	[[no_unique_address]] zctc::feature_state_t<E::lm, lm::ngram::State, 1> lm_state;
+	[[no_unique_address]] zctc::feature_state_t<E::lexicon, fst::StdVectorFst::StateId, 2> lexicon_state;
+	[[no_unique_address]] zctc::feature_state_t<E::hotwords, fst::StdVectorFst::StateId, 3> hotword_state;
 	std::vector<Node*> childs;
 	std::vector<Node*>& alt_childs;
 
@@ -164,14 +202,18 @@ public:
 	inline void acc_prob(T prob, std::vector<Node*>& writer);
 	inline void acc_tk_and_parent_prob(T prob, std::vector<Node*>& writer);
 	inline void acc_repeat_token_prob_for_cloned(int ts, T prob, Node* r_node, std::vector<Node*>& writer,
-												 std::vector<Node*>& reader);
+												 std::vector<Node*>& reader, zctc::DecodeStats* stats = nullptr);
 
+	Node* prepare_score(int curr_ts, std::vector<Node*>& more_confident_repeats);
+	void apply_score(int curr_ts, T score, T prev_b_score);
+	template <typename M = zctc::ExactMath>
 	T update_score(int curr_ts, std::vector<Node*>& more_confident_repeats);
 
-	inline Node* acc_repeat_token_prob(int ts, T prob, std::vector<Node*>& writer, std::vector<Node*>& reader);
+	inline Node* acc_repeat_token_prob(int ts, T prob, std::vector<Node*>& writer, std::vector<Node*>& reader,
+									   zctc::DecodeStats* stats = nullptr);
 
 	Node* extend_path(int id, int ts, T prob, const std::string token, std::vector<Node*>& writer,
-					  std::vector<Node*>& reader);
+					  std::vector<Node*>& reader, zctc::DecodeStats* stats = nullptr);
 
 	// element-wise iterator for this class,
 	typename std::vector<Node*>::iterator begin() noexcept { return this->childs.begin(); }
@@ -180,6 +222,27 @@ public:
 	typename std::vector<Node*>::const_iterator cend() const noexcept { return this->childs.cend(); }
 };
 
+/**
+ * @brief Scores the writer nodes of a timestep together, as `Node::update_score`
+ * 		  does for one node. The inputs of the nodes are gathered into contiguous
+ * 		  arrays, scored with `zctc::update_scores` and the results are scattered
+ * 		  back to the nodes, a chunk at a time, so the nodes of the chunk are still
+ * 		  in the cache when scattering.
+ */
+template <typename T, typename M = ExactMath, typename E = AllFeatures>
+class ScoreBatch {
+public:
+	static constexpr std::size_t CHUNK_SIZE = 64;
+
+	void update(const std::vector<Node<T, E>*>& writer, int curr_ts, std::vector<Node<T, E>*>& more_confident_repeats);
+
+private:
+	enum Array { TK_PROB, B_PROB, SCORE, PREV_SCORE, PREV_B_SCORE, SQUASH_SCORE, NEW_SCORE, NEW_PREV_B_SCORE, ARRAYS };
+
+	Node<T, E>* nodes[CHUNK_SIZE];
+	alignas(zctc::SIMD_BYTES) T values[ARRAYS][CHUNK_SIZE];
+};
+
 } // namespace zctc
 
 /* ---------------------------------------------------------------------------- */
@@ -188,42 +251,45 @@ public:
  * @brief Exponential sum of two numbers in log scale, and returning the result in log scale.
  *
  * @tparam T The type of the numbers.
+ * @tparam M The precision policy of the logarithm and exponential.
  * @param x The first number in log scale.
  * @param y The second number in log scale.
  *
  * @return The result of the exponential sum of the two numbers in log scale.
  */
-template <typename T>
+template <typename T, typename M = zctc::ExactMath>
 inline T
 log_sum_exp(T x, T y)
 {
 	T max_val = std::max(x, y);
-	return std::log(std::exp(x - max_val) + std::exp(y - max_val)) + max_val;
+	return M::log(M::exp(x - max_val) + M::exp(y - max_val)) + max_val;
 }
 
 /**
  * @brief Exponential difference of two numbers in log scale, and returning the result in log scale.
  *
  * @tparam T The type of the numbers.
+ * @tparam M The precision policy of the logarithm and exponential.
  * @param x The first number in log scale.
  * @param y The second number in log scale.
  *
  * @return The result of the exponential difference of the two numbers in log scale.
  */
-template <typename T>
+template <typename T, typename M = zctc::ExactMath>
 inline T
 log_diff_exp(T x, T y)
 {
 	T max_val = std::max(x, y);
-	return std::log(std::exp(x - max_val) - std::exp(y - max_val)) + max_val;
+	return M::log(M::exp(x - max_val) - M::exp(y - max_val)) + max_val;
 }
 
 /**
- * @brief Updates the score of the node in current timestep and returns the updated score.
- * 		  The score is updated based on the token and blank probabilities, and the
- * 		  previous overlapping extension from the parent node. This function should
- * 		  be called only once per timestep and also at the end of parsing the timestep
- * 		  logits.
+ * @brief Prepares the node to be scored in current timestep, by taking the cached
+ * 		  more confident repeat token probability, and returns the node to be scored,
+ * 		  which is a new node if the node already has some childs. This function and
+ * 		  `apply_score` are the two halves of `update_score`, where the scores are
+ * 		  computed in between, either for one node or for the whole writer at once
+ * 		  by `zctc::ScoreBatch`.
  *
  * @param curr_ts The current timestep.
  * @param more_confident_repeats The vector to store the more confident repeat tokens, since
@@ -231,11 +297,11 @@ log_diff_exp(T x, T y)
  * 								 into account all possible ways of arriving probabilities
  * 								 by the old node.
  *
- * @return The updated score of the node.
+ * @return zctc::Node<T, E>* The node to be scored.
  */
-template <typename T>
-T
-zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confident_repeats)
+template <typename T, typename E>
+zctc::Node<T, E>*
+zctc::Node<T, E>::prepare_score(int curr_ts, std::vector<zctc::Node<T, E>*>& more_confident_repeats)
 {
 	if (this->_max_prob > this->max_prob) {
 
@@ -249,7 +315,7 @@ zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confi
 			 * 		 update the score with the most confident
 			 * 		 probability.
 			 */
-			zctc::Node<T>* node = new zctc::Node<T>(*this);
+			zctc::Node<T, E>* node = new zctc::Node<T, E>(*this);
 			more_confident_repeats.emplace_back(node);
 
 			node->tk_prob = node->_max_prob;
@@ -261,7 +327,7 @@ zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confi
 			this->is_at_writer = false;
 			this->is_deprecated = true;
 
-			return node->update_score(curr_ts, more_confident_repeats);
+			return node;
 		}
 
 		this->tk_prob = this->_max_prob;
@@ -269,24 +335,30 @@ zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confi
 		this->ts = curr_ts;
 	}
 
-	/**
-	 * NOTE: Here,
-	 * 		 `*_prob` will be in linear scale,
-	 * 		 `*_score` will be in log scale,
-	 */
-	T prev_score = this->score;
-	this->score = prev_score + std::log(this->tk_prob + this->b_prob);
-
-	if ((this->prev_b_score != 0.0) && this->tk_prob != 0.0) {
-		this->score = log_diff_exp(this->score, this->prev_score + this->prev_b_score + std::log(this->tk_prob));
-	}
-	if (this->squash_score != 0.0) {
-		this->score = log_sum_exp(this->score, this->squash_score);
-		this->squash_score = 0.0;
-	}
+	return this;
+}
 
-	this->ovrl_score = this->score + this->lm_lex_score + this->hw_score;
-	this->prev_score = prev_score;
+/**
+ * @brief Sets the computed score of the node in current timestep, and resets the
+ * 		  probabilities accumulated within the timestep.
+ *
+ * @param curr_ts The current timestep.
+ * @param score The updated score of the node.
+ * @param prev_b_score The blank score of the node in current timestep, zero if none.
+ *
+ * @return void
+ */
+template <typename T, typename E>
+void
+zctc::Node<T, E>::apply_score(int curr_ts, T score, T prev_b_score)
+{
+	this->prev_score = this->score;
+	this->score = score;
+	this->squash_score = 0.0;
+	if constexpr (E::hotwords)
+		this->ovrl_score = this->score + this->lm_lex_score + this->hw_score;
+	else
+		this->ovrl_score = this->score + this->lm_lex_score;
 
 	if (this->tk_prob != 0.0) {
 		this->tk_ts = curr_ts;
@@ -295,14 +367,101 @@ zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confi
 
 	if (this->b_prob != 0.0) {
 		this->b_ts = curr_ts;
-		this->prev_b_score = std::log(this->b_prob);
 		this->b_prob = 0.0;
-	} else {
-		this->prev_b_score = 0.0;
 	}
+	this->prev_b_score = prev_b_score;
 
 	this->is_at_writer = false;
-	return this->ovrl_score;
+}
+
+/**
+ * @brief Updates the score of the node in current timestep and returns the updated score.
+ * 		  The score is updated based on the token and blank probabilities, and the
+ * 		  previous overlapping extension from the parent node. This function should
+ * 		  be called only once per timestep and also at the end of parsing the timestep
+ * 		  logits.
+ *
+ * @tparam M The precision policy of the logarithm and exponential.
+ * @param curr_ts The current timestep.
+ * @param more_confident_repeats The vector to store the more confident repeat tokens, since
+ * 								 the more confident repeat nodes were created here to take
+ * 								 into account all possible ways of arriving probabilities
+ * 								 by the old node.
+ *
+ * @return The updated score of the node.
+ */
+template <typename T, typename E>
+template <typename M>
+T
+zctc::Node<T, E>::update_score(int curr_ts, std::vector<zctc::Node<T, E>*>& more_confident_repeats)
+{
+	zctc::Node<T, E>* node = this->prepare_score(curr_ts, more_confident_repeats);
+
+	/**
+	 * NOTE: Here,
+	 * 		 `*_prob` will be in linear scale,
+	 * 		 `*_score` will be in log scale,
+	 */
+	T score = node->score + M::log(node->tk_prob + node->b_prob);
+
+	if ((node->prev_b_score != 0.0) && node->tk_prob != 0.0) {
+		score = log_diff_exp<T, M>(score, node->prev_score + node->prev_b_score + M::log(node->tk_prob));
+	}
+	if (node->squash_score != 0.0) {
+		score = log_sum_exp<T, M>(score, node->squash_score);
+	}
+
+	node->apply_score(curr_ts, score, node->b_prob != 0.0 ? M::log(node->b_prob) : static_cast<T>(0.0));
+	return node->ovrl_score;
+}
+
+/**
+ * @brief Updates the scores of the writer nodes in current timestep, where the
+ * 		  more confident repeat nodes created for them are scored in their place.
+ *
+ * @param writer The nodes to be scored.
+ * @param curr_ts The current timestep.
+ * @param more_confident_repeats The vector to store the more confident repeat tokens.
+ *
+ * @return void
+ */
+template <typename T, typename M, typename E>
+void
+zctc::ScoreBatch<T, M, E>::update(const std::vector<zctc::Node<T, E>*>& writer, int curr_ts,
+							std::vector<zctc::Node<T, E>*>& more_confident_repeats)
+{
+	for (std::size_t start = 0; start < writer.size(); start += CHUNK_SIZE) {
+		std::size_t count = std::min(CHUNK_SIZE, writer.size() - start);
+		std::size_t padded = (count + zctc::LANES<T> - 1) / zctc::LANES<T> * zctc::LANES<T>;
+
+		for (std::size_t i = 0; i < count; i++) {
+			zctc::Node<T, E>* node = writer[start + i]->prepare_score(curr_ts, more_confident_repeats);
+			this->nodes[i] = node;
+			this->values[TK_PROB][i] = node->tk_prob;
+			this->values[B_PROB][i] = node->b_prob;
+			this->values[SCORE][i] = node->score;
+			this->values[PREV_SCORE][i] = node->prev_score;
+			this->values[PREV_B_SCORE][i] = node->prev_b_score;
+			this->values[SQUASH_SCORE][i] = node->squash_score;
+		}
+
+		/**
+		 * NOTE: The padded lanes are scored as a node with only a token
+		 * 		 probability of 1, so none of them produce a NaN or trap.
+		 */
+		for (std::size_t i = count; i < padded; i++) {
+			this->values[TK_PROB][i] = 1.0;
+			this->values[B_PROB][i] = this->values[SCORE][i] = this->values[PREV_SCORE][i] = 0.0;
+			this->values[PREV_B_SCORE][i] = this->values[SQUASH_SCORE][i] = 0.0;
+		}
+
+		zctc::update_scores<T, M>(padded, this->values[TK_PROB], this->values[B_PROB], this->values[SCORE],
+								  this->values[PREV_SCORE], this->values[PREV_B_SCORE], this->values[SQUASH_SCORE],
+								  this->values[NEW_SCORE], this->values[NEW_PREV_B_SCORE]);
+
+		for (std::size_t i = 0; i < count; i++)
+			this->nodes[i]->apply_score(curr_ts, this->values[NEW_SCORE][i], this->values[NEW_PREV_B_SCORE][i]);
+	}
 }
 
 /**
@@ -315,9 +474,9 @@ zctc::Node<T>::update_score(int curr_ts, std::vector<zctc::Node<T>*>& more_confi
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::Node<T>::acc_prob(T prob, std::vector<zctc::Node<T>*>& writer)
+zctc::Node<T, E>::acc_prob(T prob, std::vector<zctc::Node<T, E>*>& writer)
 {
 	/**
 	 * NOTE: Instead of creating a duplicate when we encounter a more
@@ -366,9 +525,9 @@ zctc::Node<T>::acc_prob(T prob, std::vector<zctc::Node<T>*>& writer)
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::Node<T>::acc_tk_and_parent_prob(T prob, std::vector<zctc::Node<T>*>& writer)
+zctc::Node<T, E>::acc_tk_and_parent_prob(T prob, std::vector<zctc::Node<T, E>*>& writer)
 {
 	if (!this->is_at_writer) {
 		writer.emplace_back(this);
@@ -417,17 +576,18 @@ zctc::Node<T>::acc_tk_and_parent_prob(T prob, std::vector<zctc::Node<T>*>& write
  * @param r_node The reference node.
  * @param writer The vector to store the nodes to be written to the next timestep.
  * @param reader The vector to remove the redundant node existence in case of cloning.
+ * @param stats The decode stats to count the cloned node in, if any.
  *
  * @return void
  */
-template <typename T>
+template <typename T, typename E>
 void
-zctc::Node<T>::acc_repeat_token_prob_for_cloned(int ts, T prob, zctc::Node<T>* r_node,
-												std::vector<zctc::Node<T>*>& writer,
-												std::vector<zctc::Node<T>*>& reader)
+zctc::Node<T, E>::acc_repeat_token_prob_for_cloned(int ts, T prob, zctc::Node<T, E>* r_node,
+												std::vector<zctc::Node<T, E>*>& writer,
+												std::vector<zctc::Node<T, E>*>& reader, zctc::DecodeStats* stats)
 {
 
-	zctc::Node<T>* child;
+	zctc::Node<T, E>* child;
 	/**
 	 * NOTE: If it has no childs, then we can just
 	 * 		 move the node to the `clone` node's
@@ -450,7 +610,11 @@ zctc::Node<T>::acc_repeat_token_prob_for_cloned(int ts, T prob, zctc::Node<T>* r
 		std::iter_swap(std::find(this->alt_childs.begin(), this->alt_childs.end(), r_node), this->alt_childs.end() - 1);
 		this->alt_childs.erase(this->alt_childs.end() - 1);
 	} else {
-		child = new zctc::Node<T>(ts, prob, this, r_node);
+		child = new zctc::Node<T, E>(ts, prob, this, r_node);
+		if (stats) {
+			stats->nodes_cloned++;
+			stats->nodes_deprecated++;
+		}
 		std::replace(reader.begin(), reader.end(), r_node, child);
 		if (r_node->is_at_writer) {
 			std::replace(writer.begin(), writer.end(), r_node, child);
@@ -482,13 +646,14 @@ zctc::Node<T>::acc_repeat_token_prob_for_cloned(int ts, T prob, zctc::Node<T>* r
  * @param prob The token probability to be accumulated.
  * @param writer The vector to store the nodes to be written to the next timestep.
  * @param reader The vector to remove the redundant node existence in case of cloning.
+ * @param stats The decode stats to count the cloned node in, if any.
  *
  * @return The child node if the path is extended, else `nullptr`.
  */
-template <typename T>
-zctc::Node<T>*
-zctc::Node<T>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T>*>& writer,
-									 std::vector<zctc::Node<T>*>& reader)
+template <typename T, typename E>
+zctc::Node<T, E>*
+zctc::Node<T, E>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T, E>*>& writer,
+									 std::vector<zctc::Node<T, E>*>& reader, zctc::DecodeStats* stats)
 {
 	/**
 	 * NOTE: In case, if the token is the most recent than the blank, or,
@@ -524,7 +689,7 @@ zctc::Node<T>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T>*>
 		 * 		 Not sure if this case is possible or not, but just wanted to
 		 * 		 ensure that we are not creating duplicate child nodes.
 		 */
-		for (zctc::Node<T>* r_node : *this) {
+		for (zctc::Node<T, E>* r_node : *this) {
 			if ((r_node->id != id) || r_node->is_deprecated)
 				continue;
 
@@ -537,11 +702,11 @@ zctc::Node<T>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T>*>
 			 * NOTE: If this is a cloned node, then we'll look
 			 * 		 for the `source` node's child list too.
 			 */
-			for (zctc::Node<T>* r_node : this->alt_childs) {
+			for (zctc::Node<T, E>* r_node : this->alt_childs) {
 				if ((r_node->id != id) || r_node->is_deprecated)
 					continue;
 
-				this->acc_repeat_token_prob_for_cloned(ts, prob, r_node, writer, reader);
+				this->acc_repeat_token_prob_for_cloned(ts, prob, r_node, writer, reader, stats);
 				return nullptr;
 			}
 		}
@@ -555,7 +720,7 @@ zctc::Node<T>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T>*>
 		 * 		 node has both `blank` and `token` encountered previously, then
 		 * 		 we'll only consider the previous `blank`.
 		 */
-		zctc::Node<T>* child = new zctc::Node<T>(id, ts, prob, token, this, true);
+		zctc::Node<T, E>* child = new zctc::Node<T, E>(id, ts, prob, token, this, true);
 
 		this->childs.emplace_back(child);
 		writer.emplace_back(child);
@@ -580,18 +745,19 @@ zctc::Node<T>::acc_repeat_token_prob(int ts, T prob, std::vector<zctc::Node<T>*>
  * @param token The token string.
  * @param writer The vector to store the nodes to be written to the next timestep.
  * @param reader The vector to remove the redundant node existence in case of cloning.
+ * @param stats The decode stats to count the cloned nodes in, if any.
  *
  * @return The child node if the path is extended, else `nullptr`.
  */
-template <typename T>
-zctc::Node<T>*
-zctc::Node<T>::extend_path(int id, int ts, T prob, const std::string token, std::vector<zctc::Node<T>*>& writer,
-						   std::vector<zctc::Node<T>*>& reader)
+template <typename T, typename E>
+zctc::Node<T, E>*
+zctc::Node<T, E>::extend_path(int id, int ts, T prob, const std::string token, std::vector<zctc::Node<T, E>*>& writer,
+						   std::vector<zctc::Node<T, E>*>& reader, zctc::DecodeStats* stats)
 {
 	if (id == this->id)
-		return this->acc_repeat_token_prob(ts, prob, writer, reader);
+		return this->acc_repeat_token_prob(ts, prob, writer, reader, stats);
 
-	for (zctc::Node<T>* r_node : *this) {
+	for (zctc::Node<T, E>* r_node : *this) {
 		if ((r_node->id != id) || r_node->is_deprecated)
 			continue;
 
@@ -615,11 +781,11 @@ zctc::Node<T>::extend_path(int id, int ts, T prob, const std::string token, std:
 		 * NOTE: If this is a cloned node, then we'll look
 		 * 		 for the `source` node's child list too.
 		 */
-		for (zctc::Node<T>* r_node : this->alt_childs) {
+		for (zctc::Node<T, E>* r_node : this->alt_childs) {
 			if ((r_node->id != id) || r_node->is_deprecated)
 				continue;
 
-			this->acc_repeat_token_prob_for_cloned(ts, prob, r_node, writer, reader);
+			this->acc_repeat_token_prob_for_cloned(ts, prob, r_node, writer, reader, stats);
 			return nullptr;
 		}
 	}
@@ -628,7 +794,7 @@ zctc::Node<T>::extend_path(int id, int ts, T prob, const std::string token, std:
 	 * NOTE: If the current node has no child with the provided id,
 	 * 		 then we can create a new child node and extend the path.
 	 */
-	zctc::Node<T>* child = new zctc::Node<T>(id, ts, prob, token, this);
+	zctc::Node<T, E>* child = new zctc::Node<T, E>(id, ts, prob, token, this);
 
 	this->childs.emplace_back(child);
 	writer.emplace_back(child);
@@ -0,0 +1,268 @@
+#ifndef _ZCTC_NPY_H
+#define _ZCTC_NPY_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace zctc {
+
+/**
+ * @brief A C ordered array loaded from a NumPy `.npy` file, of little endian
+ * 		  `float32` or `float64` values, as saved by `numpy.save`.
+ */
+struct NpyArray {
+	std::string dtype;
+	std::vector<std::size_t> shape;
+	std::vector<char> data;
+
+	std::size_t size() const;
+
+	template <typename T>
+	std::vector<T> as() const;
+};
+
+/**
+ * @brief A `.npy` file mapped into memory, whose values are read in place
+ * 		  from the mapping, without copying them.
+ */
+class MappedNpy {
+public:
+	std::string dtype;
+	std::vector<std::size_t> shape;
+
+	explicit MappedNpy(const std::string& path, bool populate = false);
+	~MappedNpy();
+
+	MappedNpy(const MappedNpy&) = delete;
+	MappedNpy& operator=(const MappedNpy&) = delete;
+
+	std::size_t size() const;
+	const void* values() const;
+
+private:
+	void* mapping = MAP_FAILED;
+	std::size_t length = 0, data_offset = 0;
+};
+
+NpyArray load_npy(const std::string& path);
+void parse_npy_header(const std::string& header, const std::string& path, std::string& dtype,
+					  std::vector<std::size_t>& shape);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Gets the number of values of the array.
+ *
+ * @return std::size_t The product of the shape.
+ */
+std::size_t
+zctc::NpyArray::size() const
+{
+	std::size_t size = 1;
+	for (std::size_t dim : this->shape)
+		size *= dim;
+
+	return size;
+}
+
+/**
+ * @brief Converts the values of the array to the provided type.
+ *
+ * @tparam T The type to convert the values to.
+ *
+ * @return std::vector<T> The values in C order.
+ */
+template <typename T>
+std::vector<T>
+zctc::NpyArray::as() const
+{
+	std::vector<T> values(this->size());
+
+	if (this->dtype == "<f4") {
+		const float* src = reinterpret_cast<const float*>(this->data.data());
+		for (std::size_t i = 0; i < values.size(); i++)
+			values[i] = static_cast<T>(src[i]);
+	} else {
+		const double* src = reinterpret_cast<const double*>(this->data.data());
+		for (std::size_t i = 0; i < values.size(); i++)
+			values[i] = static_cast<T>(src[i]);
+	}
+
+	return values;
+}
+
+/**
+ * @brief Loads a `.npy` file of version 1, 2 or 3. Only the dtype, order and
+ * 		  shape of the header dict are parsed, which is all `numpy.save` writes.
+ *
+ * @param path The path to the `.npy` file.
+ *
+ * @return zctc::NpyArray The loaded array.
+ */
+zctc::NpyArray
+zctc::load_npy(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("Cannot open npy file from the path provided, " + path);
+
+	char magic[8];
+	if (!file.read(magic, 8) || std::memcmp(magic, "\x93NUMPY", 6) != 0)
+		throw std::runtime_error("Invalid npy file, " + path);
+
+	// NOTE: Version 1 has a 2 byte header length, the later versions have 4 bytes.
+	std::uint32_t header_len = 0;
+	unsigned char len_bytes[4] = { 0, 0, 0, 0 };
+	file.read(reinterpret_cast<char*>(len_bytes), (magic[6] == 1) ? 2 : 4);
+	for (int i = 3; i >= 0; i--)
+		header_len = (header_len << 8) | len_bytes[i];
+
+	std::string header(header_len, '\0');
+	if (!file.read(header.data(), header_len))
+		throw std::runtime_error("Truncated npy header, " + path);
+
+	zctc::NpyArray array;
+	zctc::parse_npy_header(header, path, array.dtype, array.shape);
+
+	array.data.resize(array.size() * ((array.dtype == "<f4") ? sizeof(float) : sizeof(double)));
+	if (!file.read(array.data.data(), array.data.size()))
+		throw std::runtime_error("Truncated npy data, " + path);
+
+	return array;
+}
+
+/**
+ * @brief Parses the dtype and shape of the header dict of a `.npy` file, of
+ * 		  `float32` or `float64` values in C order.
+ *
+ * @param header The header dict following the header length.
+ * @param path The path of the file, to report the errors with.
+ * @param dtype The dtype to fill, `<f4` or `<f8`.
+ * @param shape The shape to fill.
+ *
+ * @return void
+ */
+void
+zctc::parse_npy_header(const std::string& header, const std::string& path, std::string& dtype,
+					   std::vector<std::size_t>& shape)
+{
+	auto field = [&](const std::string& key) {
+		std::size_t pos = header.find("'" + key + "'");
+		if (pos == std::string::npos)
+			throw std::runtime_error("Missing " + key + " in npy header, " + path);
+
+		return header.find(':', pos) + 1;
+	};
+
+	std::size_t start = header.find('\'', field("descr")) + 1;
+	dtype = header.substr(start, header.find('\'', start) - start);
+	if (dtype != "<f4" && dtype != "<f8")
+		throw std::runtime_error("Unsupported npy dtype " + dtype + ", expected <f4 or <f8, " + path);
+
+	if (header.compare(header.find_first_not_of(' ', field("fortran_order")), 4, "True") == 0)
+		throw std::runtime_error("Fortran ordered npy arrays aren't supported, " + path);
+
+	start = header.find('(', field("shape")) + 1;
+	std::string dims = header.substr(start, header.find(')', start) - start);
+	for (std::size_t pos = 0; pos < dims.size();) {
+		std::size_t end = dims.find(',', pos);
+		if (end == std::string::npos)
+			end = dims.size();
+		if (dims.find_first_not_of(' ', pos) < end)
+			shape.emplace_back(std::stoul(dims.substr(pos, end - pos)));
+		pos = end + 1;
+	}
+}
+
+/**
+ * @brief Maps a `.npy` file of version 1, 2 or 3 into memory.
+ *
+ * @param path The path to the `.npy` file.
+ * @param populate Whether to read the whole file into the page cache while mapping, so reading the values later
+ * doesn't wait on the disk, instead of faulting the pages in on the first reads.
+ */
+zctc::MappedNpy::MappedNpy(const std::string& path, bool populate)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Cannot open npy file from the path provided, " + path);
+
+	struct stat file_stat;
+	if (::fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+		this->length = file_stat.st_size;
+		this->mapping
+			= ::mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+	}
+	::close(fd);
+	if (this->mapping == MAP_FAILED)
+		throw std::runtime_error("Cannot map npy file from the path provided, " + path);
+
+	const char* bytes = static_cast<const char*>(this->mapping);
+	if (this->length < 12 || std::memcmp(bytes, "\x93NUMPY", 6) != 0) {
+		::munmap(this->mapping, this->length);
+		throw std::runtime_error("Invalid npy file, " + path);
+	}
+
+	// NOTE: Version 1 has a 2 byte header length, the later versions have 4 bytes.
+	std::size_t len_bytes = (bytes[6] == 1) ? 2 : 4, header_len = 0;
+	for (int i = len_bytes - 1; i >= 0; i--)
+		header_len = (header_len << 8) | static_cast<unsigned char>(bytes[8 + i]);
+	this->data_offset = 8 + len_bytes + header_len;
+
+	try {
+		if (this->data_offset > this->length)
+			throw std::runtime_error("Truncated npy header, " + path);
+
+		zctc::parse_npy_header(std::string(bytes + 8 + len_bytes, header_len), path, this->dtype, this->shape);
+		if (this->data_offset + this->size() * ((this->dtype == "<f4") ? sizeof(float) : sizeof(double))
+			> this->length)
+			throw std::runtime_error("Truncated npy data, " + path);
+	} catch (...) {
+		::munmap(this->mapping, this->length);
+		throw;
+	}
+}
+
+zctc::MappedNpy::~MappedNpy()
+{
+	::munmap(this->mapping, this->length);
+}
+
+/**
+ * @brief Gets the number of values of the array.
+ *
+ * @return std::size_t The product of the shape.
+ */
+std::size_t
+zctc::MappedNpy::size() const
+{
+	std::size_t size = 1;
+	for (std::size_t dim : this->shape)
+		size *= dim;
+
+	return size;
+}
+
+/**
+ * @brief Gets the values of the array, in C order, of the type of the dtype.
+ *
+ * @return const void* The values within the mapping, valid while the array is.
+ */
+const void*
+zctc::MappedNpy::values() const
+{
+	return static_cast<const char*>(this->mapping) + this->data_offset;
+}
+
+#endif // _ZCTC_NPY_H
@@ -0,0 +1,221 @@
+#ifndef _ZCTC_PERF_H
+#define _ZCTC_PERF_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif // __linux__
+
+#include "./stats.hh"
+
+namespace zctc {
+
+/**
+ * @brief Group of hardware counters (cycles, instructions, LLC misses and
+ * 		  branch misses) of the calling thread, opened with `perf_event_open`
+ * 		  and accumulated into the phase counters of the stats on every lap,
+ * 		  like `zctc::PhaseClock` does for the wall time.
+ *
+ * 		  The counters only count user space, so the `read` syscalls of the
+ * 		  laps themselves aren't included, and it also works with the default
+ * 		  `perf_event_paranoid` level. If the cycles counter can't be opened,
+ * 		  (ie) not Linux, no PMU in the VM, or not permitted, the group is left
+ * 		  unavailable and every lap is a no-op. Any other counter which can't be
+ * 		  opened just stays zero.
+ *
+ * 		  If the PMU has fewer counters than the group and other groups, the
+ * 		  group is multiplexed, (ie) it only counts for a part of the time.
+ * 		  The counts of every lap are then scaled by the time the group was
+ * 		  enabled over the time it was counting, as `perf stat` does.
+ */
+class PhaseCounters {
+public:
+	enum Event { CYCLES, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, EVENT_COUNT };
+
+	explicit PhaseCounters(DecodeStats* stats);
+	~PhaseCounters();
+
+	PhaseCounters(const PhaseCounters&) = delete;
+	PhaseCounters& operator=(const PhaseCounters&) = delete;
+
+	inline bool available() const { return this->stats != nullptr; }
+
+	void lap(HardwareCounters DecodeStats::*phase);
+
+private:
+	struct Reading {
+		std::uint64_t time_enabled, time_running;
+		std::uint64_t values[EVENT_COUNT];
+	};
+
+	DecodeStats* stats;
+	int fds[EVENT_COUNT];
+	int slots[EVENT_COUNT];
+	int opened;
+	Reading last;
+
+	bool read_values(Reading& reading) const;
+	static void add_delta(HardwareCounters& counters, const Reading& from, const Reading& to);
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Opens the counter group for the calling thread, if the stats ask for
+ * 		  hardware counters, and marks them unavailable in the stats otherwise.
+ *
+ * @param stats The stats to accumulate the phase counts in, if any.
+ */
+zctc::PhaseCounters::PhaseCounters(zctc::DecodeStats* stats)
+	: stats(nullptr)
+	, opened(0)
+{
+	std::fill(this->fds, this->fds + EVENT_COUNT, -1);
+	std::fill(this->slots, this->slots + EVENT_COUNT, -1);
+	this->last = {};
+
+	if (stats == nullptr || !stats->hw_counters)
+		return;
+
+	stats->hw_counters = false;
+
+#ifdef __linux__
+	const std::uint64_t configs[EVENT_COUNT] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+												 PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+	for (int event = 0; event < EVENT_COUNT; event++) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[event];
+		attr.disabled = (event == CYCLES);
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		int fd = syscall(SYS_perf_event_open, &attr, 0, -1, (event == CYCLES) ? -1 : this->fds[CYCLES], 0);
+		if (fd < 0) {
+			// NOTE: Without the group leader, none of the counters can be read.
+			if (event == CYCLES)
+				return;
+
+			continue;
+		}
+
+		this->fds[event] = fd;
+		this->slots[event] = this->opened++;
+	}
+
+	ioctl(this->fds[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(this->fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+	if (!this->read_values(this->last))
+		return;
+
+	this->stats = stats;
+	stats->hw_counters = true;
+#endif // __linux__
+}
+
+zctc::PhaseCounters::~PhaseCounters()
+{
+#ifdef __linux__
+	for (int fd : this->fds)
+		if (fd >= 0)
+			close(fd);
+#endif // __linux__
+}
+
+/**
+ * @brief Reads the current value of every counter of the group, where the
+ * 		  counters which couldn't be opened are read as zero, along with the
+ * 		  times the group was enabled and counting.
+ *
+ * @param reading The reading to read into.
+ *
+ * @return bool `false` if the group couldn't be read or was never scheduled on the PMU.
+ */
+bool
+zctc::PhaseCounters::read_values(zctc::PhaseCounters::Reading& reading) const
+{
+#ifdef __linux__
+	// NOTE: Layout of `PERF_FORMAT_GROUP`, { nr, time_enabled, time_running, value[nr] }.
+	std::uint64_t buffer[3 + EVENT_COUNT];
+
+	ssize_t size = read(this->fds[CYCLES], buffer, sizeof(buffer));
+	if (size < static_cast<ssize_t>((3 + this->opened) * sizeof(std::uint64_t)) || buffer[2] == 0)
+		return false;
+
+	reading.time_enabled = buffer[1];
+	reading.time_running = buffer[2];
+	for (int event = 0; event < EVENT_COUNT; event++)
+		reading.values[event] = (this->slots[event] < 0) ? 0 : buffer[3 + this->slots[event]];
+
+	return true;
+#else
+	return false;
+#endif // __linux__
+}
+
+/**
+ * @brief Adds the counts between the two readings to the phase counters,
+ * 		  scaled up by the share of the time the group wasn't counting, if
+ * 		  it was multiplexed in between.
+ *
+ * @param counters The phase counters to add to.
+ * @param from The earlier reading.
+ * @param to The later reading.
+ *
+ * @return void
+ */
+void
+zctc::PhaseCounters::add_delta(zctc::HardwareCounters& counters, const zctc::PhaseCounters::Reading& from,
+							   const zctc::PhaseCounters::Reading& to)
+{
+	std::uint64_t enabled = to.time_enabled - from.time_enabled;
+	std::uint64_t running = to.time_running - from.time_running;
+
+	// NOTE: Not scheduled at all in between, so there's nothing to scale up.
+	if (running == 0)
+		return;
+
+	double scale = (running < enabled) ? static_cast<double>(enabled) / running : 1.0;
+	auto delta = [&](int event) { return static_cast<long>((to.values[event] - from.values[event]) * scale); };
+
+	counters.cycles += delta(CYCLES);
+	counters.instructions += delta(INSTRUCTIONS);
+	counters.llc_misses += delta(LLC_MISSES);
+	counters.branch_misses += delta(BRANCH_MISSES);
+}
+
+/**
+ * @brief Adds the counts since the previous lap to the provided phase.
+ *
+ * @param phase The phase counters of the stats to add to.
+ *
+ * @return void
+ */
+void
+zctc::PhaseCounters::lap(zctc::HardwareCounters zctc::DecodeStats::*phase)
+{
+	if (!this->stats)
+		return;
+
+	Reading now;
+	if (!this->read_values(now))
+		return;
+
+	add_delta(this->stats->*phase, this->last, now);
+	this->last = now;
+}
+
+#endif // _ZCTC_PERF_H
@@ -0,0 +1,141 @@
+#ifndef _ZCTC_PROTOCOL_H
+#define _ZCTC_PROTOCOL_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace zctc {
+
+/**
+ * @brief Wire format of the decoding server, over a Unix domain stream socket.
+ * 		  The fields are in the host byte order, as both ends share the host.
+ *
+ * 		  On connecting, the server sends a `ServerHello`. Then the client sends
+ * 		  any number of requests, each a `RequestHeader` followed by `seq_len x
+ * 		  vocab_size` float32 probabilities, without waiting for the responses.
+ * 		  Every request gets a `ResponseHeader` with the request's id, in the
+ * 		  order they're decoded, which isn't the order they're sent. If decoded,
+ * 		  the header is followed by `count` beams, best first, each a uint32
+ * 		  length followed by that many int32 labels and then their timesteps.
+ * 		  Else it's followed by `count` bytes of the error message.
+ */
+namespace protocol {
+
+constexpr std::uint32_t MAGIC = 0x5a435443; // "ZCTC"
+constexpr std::uint32_t VERSION = 1;
+
+enum Status : std::int32_t { OK = 0, INVALID_REQUEST = 1, DECODE_FAILED = 2 };
+
+struct ServerHello {
+	std::uint32_t magic, version, vocab_size, blank_id, beam_width;
+};
+
+struct RequestHeader {
+	std::uint32_t magic, id, seq_len, beams;
+};
+
+struct ResponseHeader {
+	std::uint32_t magic, id;
+	std::int32_t status;
+	std::uint32_t count;
+};
+
+} // namespace protocol
+
+bool read_exact(int fd, void* buffer, std::size_t size);
+bool write_exact(int fd, const void* buffer, std::size_t size);
+
+sockaddr_un unix_address(const std::string& path);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Reads exactly `size` bytes, retrying the short and interrupted reads.
+ *
+ * @param fd The socket to read from.
+ * @param buffer The buffer to read into.
+ * @param size The number of bytes to read.
+ *
+ * @return bool Whether all the bytes are read, false on an error or if the peer closed the socket.
+ */
+bool
+zctc::read_exact(int fd, void* buffer, std::size_t size)
+{
+	char* pos = static_cast<char*>(buffer);
+
+	while (size > 0) {
+		ssize_t count = ::recv(fd, pos, size, 0);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+
+		pos += count;
+		size -= count;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Writes exactly `size` bytes, retrying the short and interrupted writes.
+ * 		  A closed peer fails the write rather than raising SIGPIPE.
+ *
+ * @param fd The socket to write to.
+ * @param buffer The bytes to write.
+ * @param size The number of bytes to write.
+ *
+ * @return bool Whether all the bytes are written.
+ */
+bool
+zctc::write_exact(int fd, const void* buffer, std::size_t size)
+{
+	const char* pos = static_cast<const char*>(buffer);
+
+	while (size > 0) {
+		ssize_t count = ::send(fd, pos, size, MSG_NOSIGNAL);
+		if (count < 0 && errno == EINTR)
+			continue;
+		if (count <= 0)
+			return false;
+
+		pos += count;
+		size -= count;
+	}
+
+	return true;
+}
+
+/**
+ * @brief Builds the address of a Unix domain socket path.
+ *
+ * @param path The filesystem path of the socket.
+ *
+ * @return sockaddr_un The socket address.
+ */
+sockaddr_un
+zctc::unix_address(const std::string& path)
+{
+	sockaddr_un address;
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+
+	if (path.empty() || path.size() >= sizeof(address.sun_path))
+		throw std::runtime_error("Invalid socket path, expected 1 to " + std::to_string(sizeof(address.sun_path) - 1)
+								 + " characters, " + path);
+
+	std::memcpy(address.sun_path, path.c_str(), path.size());
+	return address;
+}
+
+#endif // _ZCTC_PROTOCOL_H
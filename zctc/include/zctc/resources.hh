@@ -0,0 +1,375 @@
+#ifndef _ZCTC_RESOURCES_H
+#define _ZCTC_RESOURCES_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "fst/fstlib.h"
+#include "lm/model.hh"
+
+#include "./trace.hh"
+
+namespace zctc {
+
+/**
+ * @brief How KenLM loads a binary LM, as `util::LoadMethod`. `LAZY` maps the
+ * 		  file and faults the pages in on the first queries, `POPULATE_OR_*`
+ * 		  map it populated, falling back to the lazy map or a read if the
+ * 		  populated map fails, and `READ` and `PARALLEL_READ` read the whole
+ * 		  file into memory. ARPA files are always parsed into memory.
+ */
+enum class LmLoadMethod { LAZY, POPULATE_OR_LAZY, POPULATE_OR_READ, READ, PARALLEL_READ };
+
+struct LmLoadConfig {
+	LmLoadMethod method = LmLoadMethod::POPULATE_OR_READ;
+	// NOTE: Rejects ARPA files, whose parsing takes far longer than mapping a binary.
+	bool require_binary = false;
+	// NOTE: Reads the file into the page cache on a background thread after loading, for the lazy methods.
+	bool warm_up = false;
+};
+
+/**
+ * @brief The cost of loading the LM, measured once by the decoder loading it,
+ * 		  and reported as is to the decoders sharing it. The resident bytes are
+ * 		  the growth of the process' resident set during the load, so a lazily
+ * 		  mapped LM only counts the pages faulted in while loading, and the
+ * 		  files loaded concurrently by other decoders are counted as well.
+ */
+struct LmLoadStats {
+	double load_seconds = 0;
+	std::size_t file_bytes = 0, resident_bytes = 0;
+	bool binary = false, shared = false;
+};
+
+/**
+ * @brief A KenLM model along with its load stats, and its warm up thread if
+ * 		  requested, which is stopped before the model is freed.
+ */
+class LoadedLm {
+public:
+	std::unique_ptr<lm::base::Model> model;
+	LmLoadStats stats;
+
+	LoadedLm(const char* lm_path, const LmLoadConfig& config);
+	~LoadedLm();
+
+	LoadedLm(const LoadedLm&) = delete;
+	LoadedLm& operator=(const LoadedLm&) = delete;
+
+private:
+	std::atomic<bool> stop_warm_up;
+	std::thread warm_up_thread;
+
+	static void warm_up(std::string path, std::atomic<bool>* stop);
+};
+
+std::size_t resident_bytes();
+
+/**
+ * @brief Process wide registry of the KenLM models and lexicon FSTs, so the
+ * 		  decoders loading the same file share one immutable instance of it,
+ * 		  rather than one copy each. The entries are keyed by the canonical
+ * 		  path and the load options, and only hold a weak reference, so the
+ * 		  last decoder released frees the instance, and it's loaded again if
+ * 		  acquired after.
+ *
+ * 		  Safe to use from concurrent threads. A file is loaded outside the
+ * 		  registry's lock, and the decoders acquiring it meanwhile wait for
+ * 		  that single load, instead of loading it once each, while the other
+ * 		  files load concurrently.
+ */
+class ScorerResources {
+public:
+	static ScorerResources& instance()
+	{
+		static ScorerResources resources;
+		return resources;
+	}
+
+	std::shared_ptr<lm::base::Model> language_model(const char* lm_path, const LmLoadConfig& config = {},
+													LmLoadStats* stats = nullptr);
+	std::shared_ptr<fst::StdVectorFst> lexicon(const char* lexicon_path);
+
+	std::size_t size();
+
+private:
+	template <typename V>
+	struct Entry {
+		std::weak_ptr<V> instance;
+		// NOTE: Only valid while the instance is being loaded, for the other acquirers of the key to wait on.
+		std::shared_future<std::shared_ptr<V>> loading;
+	};
+
+	std::mutex mutex;
+	std::unordered_map<std::string, Entry<LoadedLm>> models;
+	std::unordered_map<std::string, Entry<fst::StdVectorFst>> lexicons;
+
+	ScorerResources() = default;
+
+	static std::string key(const char* path, const std::string& options);
+
+	template <typename V, typename L>
+	std::shared_ptr<V> acquire(std::unordered_map<std::string, Entry<V>>& entries, const std::string& key, L load);
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Loads the KenLM model of the provided path with the provided config,
+ * 		  measuring the time and memory taken, and starts its warm up thread,
+ * 		  if requested.
+ *
+ * @param lm_path The path to the KenLM model, either binary or ARPA.
+ * @param config The load config of the model.
+ */
+zctc::LoadedLm::LoadedLm(const char* lm_path, const zctc::LmLoadConfig& config)
+	: stop_warm_up(false)
+{
+	static constexpr util::LoadMethod LOAD_METHODS[]
+		= { util::LAZY, util::POPULATE_OR_LAZY, util::POPULATE_OR_READ, util::READ, util::PARALLEL_READ };
+
+	lm::ngram::Config lm_config;
+	lm_config.load_method = LOAD_METHODS[static_cast<int>(config.method)];
+
+	lm::ngram::ModelType model_type;
+	this->stats.binary = lm::ngram::RecognizeBinary(lm_path, model_type);
+	this->stats.file_bytes = std::filesystem::file_size(lm_path);
+
+	std::size_t resident_before = zctc::resident_bytes();
+	auto start = std::chrono::steady_clock::now();
+
+	this->model.reset(lm::ngram::LoadVirtual(lm_path, lm_config));
+
+	this->stats.load_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::size_t resident_after = zctc::resident_bytes();
+	this->stats.resident_bytes = (resident_after > resident_before) ? resident_after - resident_before : 0;
+
+	if (config.warm_up)
+		this->warm_up_thread = std::thread(&LoadedLm::warm_up, std::string(lm_path), &this->stop_warm_up);
+}
+
+zctc::LoadedLm::~LoadedLm()
+{
+	if (this->warm_up_thread.joinable()) {
+		this->stop_warm_up.store(true, std::memory_order_relaxed);
+		this->warm_up_thread.join();
+	}
+}
+
+/**
+ * @brief Reads the LM file into the page cache, so the first queries of a
+ * 		  lazily mapped LM only take minor page faults, instead of reading
+ * 		  from the disk while decoding. Stops early if the LM is freed.
+ *
+ * @param path The path to the LM file.
+ * @param stop The flag set when the LM is freed.
+ *
+ * @return void
+ */
+void
+zctc::LoadedLm::warm_up(std::string path, std::atomic<bool>* stop)
+{
+	zctc::TraceSpan warm_up_span("lm_warm_up");
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+	std::vector<char> buffer(1 << 20);
+	while (!stop->load(std::memory_order_relaxed) && ::read(fd, buffer.data(), buffer.size()) > 0)
+		continue;
+
+	::close(fd);
+}
+
+/**
+ * @brief Gets the resident set size of the process.
+ *
+ * @return std::size_t The resident bytes, or 0 if unknown.
+ */
+std::size_t
+zctc::resident_bytes()
+{
+	long pages = 0, resident = 0;
+
+	std::FILE* statm = std::fopen("/proc/self/statm", "r");
+	if (statm == nullptr)
+		return 0;
+
+	if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+		resident = 0;
+	std::fclose(statm);
+
+	return resident * ::sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * @brief Gets the shared KenLM model of the provided path, loading it if no
+ * 		  decoder holds it with the same load method.
+ *
+ * @param lm_path The path to the KenLM model.
+ * @param config The load config of the model. Only the load method tells the instances apart, while the warm up is
+ * only started by the decoder loading the model.
+ * @param stats The stats to write the load stats of the model in, if any.
+ *
+ * @return std::shared_ptr<lm::base::Model> The shared model.
+ */
+std::shared_ptr<lm::base::Model>
+zctc::ScorerResources::language_model(const char* lm_path, const zctc::LmLoadConfig& config,
+									  zctc::LmLoadStats* stats)
+{
+	lm::ngram::ModelType model_type;
+	if (config.require_binary && !lm::ngram::RecognizeBinary(lm_path, model_type))
+		throw std::runtime_error(std::string("Expected a binary KenLM model, but got an ARPA file, ") + lm_path);
+
+	bool loaded = false;
+	std::shared_ptr<zctc::LoadedLm> instance = this->acquire(
+		this->models, ScorerResources::key(lm_path, std::to_string(static_cast<int>(config.method))), [&]() {
+			loaded = true;
+			return new zctc::LoadedLm(lm_path, config);
+		});
+
+	if (stats) {
+		*stats = instance->stats;
+		stats->shared = !loaded;
+	}
+
+	// NOTE: The model shares the ownership of its instance, which stops the warm up once the last holder is freed.
+	return std::shared_ptr<lm::base::Model>(instance, instance->model.get());
+}
+
+/**
+ * @brief Gets the shared lexicon FST of the provided path, reading it if no
+ * 		  decoder holds it.
+ *
+ * @param lexicon_path The path to the lexicon FST.
+ *
+ * @return std::shared_ptr<fst::StdVectorFst> The shared lexicon, or empty if it can't be read.
+ */
+std::shared_ptr<fst::StdVectorFst>
+zctc::ScorerResources::lexicon(const char* lexicon_path)
+{
+	return this->acquire(this->lexicons, ScorerResources::key(lexicon_path, ""),
+						 [&]() { return fst::StdVectorFst::Read(lexicon_path); });
+}
+
+/**
+ * @brief Counts the models and lexicons currently held by any decoder.
+ *
+ * @return std::size_t The number of live instances.
+ */
+std::size_t
+zctc::ScorerResources::size()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	std::size_t count = 0;
+	for (const auto& entry : this->models)
+		count += !entry.second.instance.expired();
+	for (const auto& entry : this->lexicons)
+		count += !entry.second.instance.expired();
+
+	return count;
+}
+
+/**
+ * @brief Builds the registry key of a file, from its canonical path, so the
+ * 		  relative paths and symlinks to the same file share the instance.
+ *
+ * @param path The path to the file.
+ * @param options The load options of the file, which are part of the key as they change the instance.
+ *
+ * @return std::string The registry key.
+ */
+std::string
+zctc::ScorerResources::key(const char* path, const std::string& options)
+{
+	// NOTE: A missing file is keyed by its normalized path, and fails to load with the loader's own error.
+	return std::filesystem::weakly_canonical(std::filesystem::absolute(path)).string() + '\n' + options;
+}
+
+/**
+ * @brief Gets the live instance of the key, or loads and registers a new one.
+ * 		  The load runs without the registry's lock, so only the acquirers of
+ * 		  the same key wait for it, and get its instance or its error. The
+ * 		  entries of the freed instances are dropped along the way.
+ *
+ * @tparam V The type of the instance.
+ * @tparam L The type of the loader.
+ * @param entries The registered instances of the type.
+ * @param key The registry key of the instance.
+ * @param load The callable loading the instance, returning an owning pointer to it, or `nullptr` on failure.
+ *
+ * @return std::shared_ptr<V> The shared instance, or empty if it can't be loaded.
+ */
+template <typename V, typename L>
+std::shared_ptr<V>
+zctc::ScorerResources::acquire(std::unordered_map<std::string, Entry<V>>& entries, const std::string& key, L load)
+{
+	std::promise<std::shared_ptr<V>> loaded;
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+
+		for (auto it = entries.begin(); it != entries.end();) {
+			if (it->first != key && !it->second.loading.valid() && it->second.instance.expired())
+				it = entries.erase(it);
+			else
+				it++;
+		}
+
+		Entry<V>& entry = entries[key];
+		if (std::shared_ptr<V> instance = entry.instance.lock())
+			return instance;
+
+		if (entry.loading.valid()) {
+			std::shared_future<std::shared_ptr<V>> loading = entry.loading;
+			lock.unlock();
+
+			return loading.get();
+		}
+
+		entry.loading = loaded.get_future().share();
+	}
+
+	std::shared_ptr<V> instance;
+	try {
+		instance.reset(load());
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			entries.erase(key);
+		}
+		loaded.set_exception(std::current_exception());
+		throw;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (instance)
+			entries[key] = Entry<V> { instance, {} };
+		else
+			entries.erase(key);
+	}
+	loaded.set_value(instance);
+
+	return instance;
+}
+
+#endif // _ZCTC_RESOURCES_H
@@ -0,0 +1,527 @@
+#ifndef _ZCTC_SIMD_H
+#define _ZCTC_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+namespace zctc {
+
+/**
+ * NOTE: The vectors are GCC/Clang vector extensions of the widest registers
+ * 		 the build targets, so the same kernels are compiled to AVX-512, AVX2
+ * 		 or SSE2 instructions as per `-march`. The default x86-64 target is
+ * 		 SSE2 only, so the wider ones need the `ZCTC_NATIVE` or `ZCTC_MARCH`
+ * 		 build options.
+ */
+#if defined(__AVX512F__)
+constexpr std::size_t SIMD_BYTES = 64;
+constexpr const char* SIMD_ISA = "avx512f";
+#elif defined(__AVX2__)
+constexpr std::size_t SIMD_BYTES = 32;
+constexpr const char* SIMD_ISA = "avx2";
+#elif defined(__AVX__)
+constexpr std::size_t SIMD_BYTES = 32;
+constexpr const char* SIMD_ISA = "avx";
+#elif defined(__SSE2__)
+constexpr std::size_t SIMD_BYTES = 16;
+constexpr const char* SIMD_ISA = "sse2";
+#else
+constexpr std::size_t SIMD_BYTES = 16;
+constexpr const char* SIMD_ISA = "generic";
+#endif // __AVX512F__
+
+template <typename T>
+struct simd;
+
+template <>
+struct simd<float> {
+	typedef float type __attribute__((vector_size(SIMD_BYTES)));
+	typedef std::int32_t integer;
+	typedef integer mask __attribute__((vector_size(SIMD_BYTES)));
+
+	static constexpr int MANTISSA_BITS = 23, EXPONENT_BIAS = 127;
+	static constexpr float EXP_MIN = -87.3365447505f, EXP_MAX = 88.7228391117f;
+};
+
+template <>
+struct simd<double> {
+	typedef double type __attribute__((vector_size(SIMD_BYTES)));
+	typedef std::int64_t integer;
+	typedef integer mask __attribute__((vector_size(SIMD_BYTES)));
+
+	static constexpr int MANTISSA_BITS = 52, EXPONENT_BIAS = 1023;
+	static constexpr double EXP_MIN = -708.396418532264, EXP_MAX = 709.782712893384;
+};
+
+template <typename T>
+using vec_t = typename simd<T>::type;
+
+template <typename T>
+using mask_t = typename simd<T>::mask;
+
+template <typename T>
+constexpr std::size_t LANES = SIMD_BYTES / sizeof(T);
+
+template <typename T>
+inline vec_t<T> vbroadcast(T value);
+template <typename T>
+inline vec_t<T> vload(const T* values);
+template <typename T>
+inline void vstore(T* values, vec_t<T> vector);
+template <typename T>
+inline vec_t<T> vselect(mask_t<T> mask, vec_t<T> x, vec_t<T> y);
+template <typename T>
+inline bool vany(mask_t<T> mask);
+
+template <typename T, bool FAST = false>
+inline vec_t<T> vexp(vec_t<T> x);
+template <typename T, bool FAST = false>
+inline vec_t<T> vlog(vec_t<T> x);
+
+template <typename T>
+inline T fast_exp(T x);
+template <typename T>
+inline T fast_log(T x);
+
+/**
+ * @brief The precision policies of the log domain arithmetic of the decoder,
+ * 		  where `ExactMath` is within 2 ulp of libm and `FastMath` trades it for
+ * 		  the shorter polynomials, within an absolute error of 3.3e-6 for the
+ * 		  logarithm and a relative error of 5.4e-6 for the exponential, (ie)
+ * 		  an absolute error of about 1e-5 for the log domain scores, far below
+ * 		  the score differences which reorder the beams. The bounds are of the
+ * 		  approximations, on top of which the rounding of `T` applies, like the
+ * 		  7.6e-6 ulp of float at the log scores around 80.
+ */
+struct ExactMath {
+	static constexpr bool FAST = false;
+
+	template <typename T>
+	static T log(T x)
+	{
+		return std::log(x);
+	}
+
+	template <typename T>
+	static T exp(T x)
+	{
+		return std::exp(x);
+	}
+};
+
+struct FastMath {
+	static constexpr bool FAST = true;
+
+	template <typename T>
+	static T log(T x)
+	{
+		return zctc::fast_log(x);
+	}
+
+	template <typename T>
+	static T exp(T x)
+	{
+		return zctc::fast_exp(x);
+	}
+};
+
+template <typename T, typename M = ExactMath>
+void update_scores(std::size_t count, const T* tk_prob, const T* b_prob, const T* score, const T* prev_score,
+				   const T* prev_b_score, const T* squash_score, T* new_score, T* new_prev_b_score);
+
+template <typename T>
+int argmax(const T* values, int count);
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+template <typename T>
+zctc::vec_t<T>
+zctc::vbroadcast(T value)
+{
+	return zctc::vec_t<T> {} + value;
+}
+
+template <typename T>
+zctc::vec_t<T>
+zctc::vload(const T* values)
+{
+	zctc::vec_t<T> vector;
+	std::memcpy(&vector, values, sizeof(vector));
+	return vector;
+}
+
+template <typename T>
+void
+zctc::vstore(T* values, zctc::vec_t<T> vector)
+{
+	std::memcpy(values, &vector, sizeof(vector));
+}
+
+/**
+ * @brief Selects the lanes of `x` where the mask is set, else of `y`.
+ */
+template <typename T>
+zctc::vec_t<T>
+zctc::vselect(zctc::mask_t<T> mask, zctc::vec_t<T> x, zctc::vec_t<T> y)
+{
+	return (zctc::vec_t<T>)(((zctc::mask_t<T>)x & mask) | ((zctc::mask_t<T>)y & ~mask));
+}
+
+template <typename T>
+bool
+zctc::vany(zctc::mask_t<T> mask)
+{
+	for (std::size_t i = 0; i < zctc::LANES<T>; i++)
+		if (mask[i])
+			return true;
+
+	return false;
+}
+
+/**
+ * @brief Lane wise exponential, with the range reduction and the rational
+ * 		  (double) or polynomial (float) approximations of Cephes, within
+ * 		  2 ulp of libm for the normal results. The results below the normal
+ * 		  range are flushed to zero.
+ *
+ * @tparam FAST Whether to use the shorter polynomial of `zctc::FastMath` instead.
+ * @param x The exponents.
+ *
+ * @return vec_t<T> The exponentials.
+ */
+template <typename T, bool FAST>
+zctc::vec_t<T>
+zctc::vexp(zctc::vec_t<T> x)
+{
+	using mask = zctc::mask_t<T>;
+	using traits = zctc::simd<T>;
+
+	/**
+	 * NOTE: The lanes out of the range are computed as `exp(0)` and replaced
+	 * 		 at the end, since computing them at the bounds would produce the
+	 * 		 subnormals, which are an order of magnitude slower.
+	 */
+	zctc::vec_t<T> input = x, y;
+	x = zctc::vselect<T>((x < traits::EXP_MIN) | (x > traits::EXP_MAX), zctc::vec_t<T> {}, x);
+
+	// NOTE: n = round(x / ln(2)), x = x - n * ln(2), with ln(2) split in two for the precision.
+	zctc::vec_t<T> n = x * static_cast<T>(1.4426950408889634073599) + static_cast<T>(0.5);
+	zctc::vec_t<T> truncated = __builtin_convertvector(__builtin_convertvector(n, mask), zctc::vec_t<T>);
+	n = zctc::vselect<T>(truncated > n, truncated - 1, truncated);
+
+	if constexpr (FAST) {
+		x = x - n * static_cast<T>(0.693359375) - n * static_cast<T>(-2.121944400546905827679E-4);
+
+		y = static_cast<T>(4.1277747247E-2) * x + static_cast<T>(1.6753514296E-1);
+		y = (y * x + static_cast<T>(5.0005116058E-1)) * x * x + x + 1;
+	} else if constexpr (std::is_same_v<T, double>) {
+		x = x - n * 6.93145751953125E-1 - n * 1.42860682030941723212E-6;
+
+		zctc::vec_t<T> xx = x * x;
+		zctc::vec_t<T> px = 1.26177193074810590878E-4 * xx + 3.02994407707441961300E-2;
+		px = x * (px * xx + 9.99999999999999999910E-1);
+		zctc::vec_t<T> qx = 3.00198505138664455042E-6 * xx + 2.52448340349684104192E-3;
+		qx = (qx * xx + 2.27265548208155028766E-1) * xx + 2.00000000000000000009E0;
+		y = 1.0 + 2.0 * (px / (qx - px));
+	} else {
+		x = x - n * 0.693359375f - n * -2.12194440e-4f;
+
+		zctc::vec_t<T> xx = x * x;
+		y = 1.9875691500E-4f * x + 1.3981999507E-3f;
+		y = (y * x + 8.3334519073E-3f) * x + 4.1665795894E-2f;
+		y = (y * x + 1.6666665459E-1f) * x + 5.0000001201E-1f;
+		y = y * xx + x + 1.0f;
+	}
+
+	/**
+	 * NOTE: Scaling by 2^n, built from its exponent bits, where the largest
+	 * 		 n of the range is out of the exponent bits, so scaled in two.
+	 */
+	mask top = n > traits::EXPONENT_BIAS;
+	n = zctc::vselect<T>(top, n - 1, n);
+	y = zctc::vselect<T>(top, y + y, y);
+	mask exponent = (__builtin_convertvector(n, mask) + traits::EXPONENT_BIAS) << traits::MANTISSA_BITS;
+	y = y * (zctc::vec_t<T>)exponent;
+
+	y = zctc::vselect<T>(input < traits::EXP_MIN, zctc::vec_t<T> {}, y);
+	y = zctc::vselect<T>(input > traits::EXP_MAX, zctc::vbroadcast<T>(std::numeric_limits<T>::infinity()), y);
+	return zctc::vselect<T>(input != input, input, y);
+}
+
+/**
+ * @brief Lane wise natural logarithm, with the rational (double) or polynomial
+ * 		  (float) approximations of `log(1 + x)` of Cephes, within 2 ulp of
+ * 		  libm. Zero is mapped to `-inf`, and the negatives and NaN to NaN.
+ *
+ * @tparam FAST Whether to use the shorter polynomial of `zctc::FastMath` instead.
+ * @param x The values.
+ *
+ * @return vec_t<T> The logarithms.
+ */
+template <typename T, bool FAST>
+zctc::vec_t<T>
+zctc::vlog(zctc::vec_t<T> x)
+{
+	using mask = zctc::mask_t<T>;
+	using traits = zctc::simd<T>;
+
+	zctc::vec_t<T> input = x;
+
+	// NOTE: The subnormals are normalised first, and compensated in the exponent.
+	mask subnormal = x < std::numeric_limits<T>::min();
+	x = zctc::vselect<T>(subnormal, x * static_cast<T>(std::uint64_t(1) << traits::MANTISSA_BITS), x);
+
+	// NOTE: x = m * 2^e, where m is in [0.5, 1).
+	mask bits = (mask)x;
+	mask e_bits = ((bits >> traits::MANTISSA_BITS) & ((1 << (sizeof(T) * 8 - traits::MANTISSA_BITS - 1)) - 1))
+		- (traits::EXPONENT_BIAS - 1);
+	e_bits = e_bits - (subnormal & traits::MANTISSA_BITS);
+	zctc::vec_t<T> e = __builtin_convertvector(e_bits, zctc::vec_t<T>);
+	mask mantissa = bits & ((typename traits::integer(1) << traits::MANTISSA_BITS) - 1);
+	x = (zctc::vec_t<T>)(mantissa | (mask)zctc::vbroadcast<T>(0.5));
+
+	// NOTE: m in [sqrt(0.5), sqrt(2)) by moving a factor of 2 to the exponent, then x = m - 1.
+	mask below = x < static_cast<T>(0.707106781186547524);
+	e = zctc::vselect<T>(below, e - 1, e);
+	x = zctc::vselect<T>(below, x + x, x) - 1;
+
+	zctc::vec_t<T> y, z = x * x;
+	if constexpr (FAST) {
+		y = static_cast<T>(-1.470244363E-1) * x + static_cast<T>(2.1924394674E-1);
+		y = (y * x - static_cast<T>(2.5252153452E-1)) * x + static_cast<T>(3.3272486793E-1);
+		y = y * x * z;
+		y = y + e * static_cast<T>(-2.121944400546905827679E-4) - static_cast<T>(0.5) * z;
+		y = x + y + e * static_cast<T>(0.693359375);
+	} else if constexpr (std::is_same_v<T, double>) {
+		zctc::vec_t<T> p = 1.01875663804580931796E-4 * x + 4.97494994976747001425E-1;
+		p = (p * x + 4.70579119878881725854E0) * x + 1.44989225341610930846E1;
+		p = (p * x + 1.79368678507819816313E1) * x + 7.70838733755885391666E0;
+		zctc::vec_t<T> q = x + 1.12873587189167450590E1;
+		q = (q * x + 4.52279145837532221105E1) * x + 8.29875266912776603211E1;
+		q = (q * x + 7.11544750618563894466E1) * x + 2.31251620126765340583E1;
+		y = x * (z * p / q);
+		y = y - e * 2.121944400546905827679E-4 - 0.5 * z;
+		y = x + y + e * 0.693359375;
+	} else {
+		y = 7.0376836292E-2f * x - 1.1514610310E-1f;
+		y = (y * x + 1.1676998740E-1f) * x - 1.2420140846E-1f;
+		y = (y * x + 1.4249322787E-1f) * x - 1.6668057665E-1f;
+		y = (y * x + 2.0000714765E-1f) * x - 2.4999993993E-1f;
+		y = (y * x + 3.3333331174E-1f) * x * z;
+		y = y + e * -2.12194440e-4f - 0.5f * z;
+		y = x + y + e * 0.693359375f;
+	}
+
+	y = zctc::vselect<T>(input == 0, zctc::vbroadcast<T>(-std::numeric_limits<T>::infinity()), y);
+	y = zctc::vselect<T>(input == std::numeric_limits<T>::infinity(), input, y);
+	mask invalid = (input < 0) | (input != input);
+	return zctc::vselect<T>(invalid, zctc::vbroadcast<T>(std::numeric_limits<T>::quiet_NaN()), y);
+}
+
+/**
+ * @brief Scalar exponential of `zctc::FastMath`, with the same approximation as
+ * 		  `zctc::vexp`, where the results out of the normal range, and NaN, are
+ * 		  left to libm.
+ *
+ * @param x The exponent.
+ *
+ * @return T The exponential.
+ */
+template <typename T>
+T
+zctc::fast_exp(T x)
+{
+	using traits = zctc::simd<T>;
+	using integer = typename traits::integer;
+
+	if (!(x >= traits::EXP_MIN && x <= traits::EXP_MAX))
+		return std::exp(x);
+
+	T t = x * static_cast<T>(1.4426950408889634073599);
+	integer n = static_cast<integer>(t < 0 ? t - static_cast<T>(0.5) : t + static_cast<T>(0.5));
+	x = x - n * static_cast<T>(0.693359375) - n * static_cast<T>(-2.121944400546905827679E-4);
+
+	T y = static_cast<T>(4.1277747247E-2) * x + static_cast<T>(1.6753514296E-1);
+	y = (y * x + static_cast<T>(5.0005116058E-1)) * x * x + x + 1;
+
+	if (n > traits::EXPONENT_BIAS) {
+		n = n - 1;
+		y = y + y;
+	}
+
+	integer bits = (n + traits::EXPONENT_BIAS) << traits::MANTISSA_BITS;
+	T scale;
+	std::memcpy(&scale, &bits, sizeof(T));
+	return y * scale;
+}
+
+/**
+ * @brief Scalar natural logarithm of `zctc::FastMath`, with the same approximation
+ * 		  as `zctc::vlog`, where the zero, subnormal, negative, infinite and NaN
+ * 		  values are left to libm.
+ *
+ * @param x The value.
+ *
+ * @return T The logarithm.
+ */
+template <typename T>
+T
+zctc::fast_log(T x)
+{
+	using traits = zctc::simd<T>;
+	using integer = typename traits::integer;
+
+	if (!(x >= std::numeric_limits<T>::min() && x <= std::numeric_limits<T>::max()))
+		return std::log(x);
+
+	integer bits;
+	std::memcpy(&bits, &x, sizeof(T));
+	T e = static_cast<T>((bits >> traits::MANTISSA_BITS) - (traits::EXPONENT_BIAS - 1));
+
+	T half = 0.5;
+	integer half_bits;
+	std::memcpy(&half_bits, &half, sizeof(T));
+	bits = (bits & ((integer(1) << traits::MANTISSA_BITS) - 1)) | half_bits;
+	std::memcpy(&x, &bits, sizeof(T));
+
+	if (x < static_cast<T>(0.707106781186547524)) {
+		e = e - 1;
+		x = x + x;
+	}
+	x = x - 1;
+
+	T z = x * x;
+	T y = static_cast<T>(-1.470244363E-1) * x + static_cast<T>(2.1924394674E-1);
+	y = (y * x - static_cast<T>(2.5252153452E-1)) * x + static_cast<T>(3.3272486793E-1);
+	y = y * x * z;
+	y = y + e * static_cast<T>(-2.121944400546905827679E-4) - static_cast<T>(0.5) * z;
+	return x + y + e * static_cast<T>(0.693359375);
+}
+
+/**
+ * @brief Computes the scores of a batch of nodes at the end of a timestep, as
+ * 		  `zctc::Node::update_score` does for one node, over contiguous arrays.
+ * 		  The `log_diff_exp` and `log_sum_exp` terms are only computed for the
+ * 		  vectors where any of the lanes need them.
+ *
+ * @tparam M The precision policy, either `zctc::ExactMath` or `zctc::FastMath`.
+ * @param count The number of nodes, where the arrays are padded to a multiple of `LANES<T>`.
+ * @param tk_prob The token probabilities of the timestep, in linear scale.
+ * @param b_prob The blank probabilities of the timestep, in linear scale.
+ * @param score The scores of the previous timestep.
+ * @param prev_score The scores of the timestep before the previous.
+ * @param prev_b_score The blank scores of the previous timestep, zero if none.
+ * @param squash_score The squashed scores of the merged paths, zero if none.
+ * @param new_score The array to write the updated scores to.
+ * @param new_prev_b_score The array to write the blank scores of the timestep to, zero if none.
+ *
+ * @return void
+ */
+template <typename T, typename M>
+void
+zctc::update_scores(std::size_t count, const T* tk_prob, const T* b_prob, const T* score, const T* prev_score,
+					const T* prev_b_score, const T* squash_score, T* new_score, T* new_prev_b_score)
+{
+	using vec = zctc::vec_t<T>;
+	using mask = zctc::mask_t<T>;
+	constexpr bool FAST = M::FAST;
+
+	for (std::size_t i = 0; i < count; i += zctc::LANES<T>) {
+		vec tk = zctc::vload(tk_prob + i), b = zctc::vload(b_prob + i), zero {};
+		vec s = zctc::vload(score + i) + zctc::vlog<T, FAST>(tk + b);
+
+		mask overlapped = (zctc::vload(prev_b_score + i) != 0) & (tk != 0);
+		if (zctc::vany<T>(overlapped)) {
+			vec other = zctc::vload(prev_score + i) + zctc::vload(prev_b_score + i) + zctc::vlog<T, FAST>(tk);
+			vec max_val = zctc::vselect<T>(s > other, s, other);
+			vec diff = zctc::vexp<T, FAST>(s - max_val) - zctc::vexp<T, FAST>(other - max_val);
+			vec diff_score = zctc::vlog<T, FAST>(diff) + max_val;
+			s = zctc::vselect<T>(overlapped, diff_score, s);
+		}
+
+		vec squash = zctc::vload(squash_score + i);
+		mask squashed = squash != 0;
+		if (zctc::vany<T>(squashed)) {
+			vec max_val = zctc::vselect<T>(s > squash, s, squash);
+			vec sum = zctc::vexp<T, FAST>(s - max_val) + zctc::vexp<T, FAST>(squash - max_val);
+			vec sum_score = zctc::vlog<T, FAST>(sum) + max_val;
+			s = zctc::vselect<T>(squashed, sum_score, s);
+		}
+
+		zctc::vstore(new_score + i, s);
+		zctc::vstore(new_prev_b_score + i, zctc::vselect<T>(b != 0, zctc::vlog<T, FAST>(b), zero));
+	}
+}
+
+/**
+ * @brief Gets the index of the largest of the values, the first one if tied,
+ * 		  same as `std::max_element`. Every lane tracks the largest value and
+ * 		  its index of its own column, which are reduced once at the end, so
+ * 		  the loop is a compare and two selects per vector. Two vectors are
+ * 		  tracked independently, so their selects don't wait on each other.
+ *
+ * @param values The values, at least one.
+ * @param count The number of values.
+ *
+ * @return int The index of the largest value.
+ */
+template <typename T>
+int
+zctc::argmax(const T* values, int count)
+{
+	using vec = zctc::vec_t<T>;
+	using mask = zctc::mask_t<T>;
+	constexpr int lanes = zctc::LANES<T>;
+
+	int i = 0, best_index = 0;
+	T best_value = values[0];
+
+	if (count >= 2 * lanes) {
+		vec best[2] = { zctc::vload(values), zctc::vload(values + lanes) };
+		mask index[2], lane_index[2];
+		for (int l = 0; l < lanes; l++) {
+			index[0][l] = l;
+			index[1][l] = lanes + l;
+		}
+		lane_index[0] = index[0];
+		lane_index[1] = index[1];
+
+		for (i = 2 * lanes; i + 2 * lanes <= count; i += 2 * lanes) {
+			for (int k = 0; k < 2; k++) {
+				index[k] += 2 * lanes;
+				vec value = zctc::vload(values + i + k * lanes);
+				mask greater = value > best[k];
+				best[k] = zctc::vselect<T>(greater, value, best[k]);
+				lane_index[k] = (greater & index[k]) | (~greater & lane_index[k]);
+			}
+		}
+
+		best_value = best[0][0];
+		best_index = lane_index[0][0];
+		for (int k = 0; k < 2; k++) {
+			for (int l = 0; l < lanes; l++) {
+				if (best[k][l] > best_value || (best[k][l] == best_value && lane_index[k][l] < best_index)) {
+					best_value = best[k][l];
+					best_index = lane_index[k][l];
+				}
+			}
+		}
+	}
+
+	for (; i < count; i++) {
+		if (values[i] > best_value) {
+			best_value = values[i];
+			best_index = i;
+		}
+	}
+
+	return best_index;
+}
+
+#endif // _ZCTC_SIMD_H
@@ -0,0 +1,96 @@
+#ifndef _ZCTC_STATS_H
+#define _ZCTC_STATS_H
+
+#include <chrono>
+
+namespace zctc {
+
+/**
+ * @brief Hardware event counts of a decode phase, user space only.
+ */
+struct HardwareCounters {
+	long cycles = 0;
+	long instructions = 0;
+	long llc_misses = 0;
+	long branch_misses = 0;
+};
+
+/**
+ * @brief Per utterance counters of the beam search, collected by `zctc::decode`
+ * 		  when a stats pointer is provided. Every collection site is guarded by a
+ * 		  null check of the pointer, so decoding without stats pays only for
+ * 		  that branch.
+ */
+struct DecodeStats {
+	long frames = 0;
+	long candidates = 0;
+	long nodes_created = 0;
+	long nodes_cloned = 0;
+	long nodes_deprecated = 0;
+	long pruned_by_deviation = 0;
+	long pruned_by_beam_width = 0;
+	long lm_queries = 0;
+	long lm_cache_hits = 0;
+	long lexicon_lookups = 0;
+	long hotword_lookups = 0;
+	long total_nodes = 0;
+
+	/**
+	 * NOTE: The work saved by the adaptive beam, (ie) the frames searched
+	 * 		 with less than the maximum budget, and the beam width and
+	 * 		 candidates they were narrowed by, summed over the frames.
+	 */
+	long narrowed_frames = 0;
+	long beam_width_saved = 0;
+	long cutoff_top_n_saved = 0;
+
+	long expand_ns = 0;
+	long ext_scoring_ns = 0;
+	long score_ns = 0;
+	long prune_ns = 0;
+	long backtrace_ns = 0;
+
+	/**
+	 * NOTE: Set `hw_counters` before decoding to also count the hardware
+	 * 		 events of every phase, it is reset if the counters couldn't
+	 * 		 be opened, leaving the phase counts zero.
+	 */
+	bool hw_counters = false;
+	HardwareCounters expand_hw;
+	HardwareCounters ext_scoring_hw;
+	HardwareCounters score_hw;
+	HardwareCounters prune_hw;
+};
+
+/**
+ * @brief Accumulates the wall time between consecutive laps into a phase
+ * 		  counter of the stats. Does nothing, not even reading the clock,
+ * 		  without stats.
+ */
+class PhaseClock {
+public:
+	explicit PhaseClock(DecodeStats* stats)
+		: stats(stats)
+	{
+		if (this->stats)
+			this->last = std::chrono::steady_clock::now();
+	}
+
+	inline void lap(long DecodeStats::*phase_ns)
+	{
+		if (!this->stats)
+			return;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		this->stats->*phase_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(now - this->last).count();
+		this->last = now;
+	}
+
+private:
+	DecodeStats* const stats;
+	std::chrono::steady_clock::time_point last;
+};
+
+} // namespace zctc
+
+#endif // _ZCTC_STATS_H
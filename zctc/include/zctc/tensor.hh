@@ -0,0 +1,323 @@
+#ifndef _ZCTC_TENSOR_H
+#define _ZCTC_TENSOR_H
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pybind11/pybind11.h"
+
+#include "./logits.hh"
+
+namespace py = pybind11;
+
+namespace zctc {
+
+/**
+ * @brief The subset of the DLPack ABI needed to read a borrowed tensor, as
+ * 		  defined by `dlpack.h` of the DLPack specification.
+ */
+namespace dlpack {
+
+	enum DLDeviceType : std::int32_t {
+		kDLCPU = 1,
+		kDLCUDAHost = 3,
+	};
+
+	enum DLDataTypeCode : std::uint8_t {
+		kDLInt = 0,
+		kDLUInt = 1,
+		kDLFloat = 2,
+		kDLBfloat = 4,
+	};
+
+	struct DLDevice {
+		std::int32_t device_type;
+		std::int32_t device_id;
+	};
+
+	struct DLDataType {
+		std::uint8_t code;
+		std::uint8_t bits;
+		std::uint16_t lanes;
+	};
+
+	struct DLTensor {
+		void* data;
+		DLDevice device;
+		std::int32_t ndim;
+		DLDataType dtype;
+		std::int64_t* shape;
+		std::int64_t* strides;
+		std::uint64_t byte_offset;
+	};
+
+	struct DLManagedTensor {
+		DLTensor dl_tensor;
+		void* manager_ctx;
+		void (*deleter)(DLManagedTensor* self);
+	};
+
+} // namespace dlpack
+
+enum class DType { FLOAT16, BFLOAT16, FLOAT32, FLOAT64, INT8, INT32, INT64 };
+
+/**
+ * @brief Borrowed, read only view of a host tensor, from either a DLPack
+ * 		  producer (`torch`, `jax`, ...) or an object implementing the buffer
+ * 		  protocol (`numpy`, `memoryview`, ...). Nothing is copied, the strides
+ * 		  are kept as is, in elements, and the producer is kept alive until
+ * 		  the view is destroyed.
+ *
+ * 		  The view must be created and destroyed with the GIL held, but the
+ * 		  data can be read without it.
+ */
+class TensorView {
+public:
+	void* data;
+	zctc::DType dtype;
+	std::vector<long> shape, strides;
+
+	explicit TensorView(py::handle object);
+
+	TensorView(const TensorView&) = delete;
+	TensorView& operator=(const TensorView&) = delete;
+
+	template <typename L>
+	zctc::StridedLogits<L> strided_logits(bool time_major) const;
+
+	template <typename F>
+	void visit_logits(bool time_major, F&& visitor) const;
+
+	std::vector<int> to_ints() const;
+	std::vector<float> to_floats() const;
+
+private:
+	py::object owner;
+	std::unique_ptr<py::buffer_info> buffer;
+
+	void from_dlpack(const zctc::dlpack::DLTensor& tensor);
+	void from_buffer(const py::buffer_info& info);
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Creates the view of the provided object, preferring the buffer
+ * 		  protocol, and then the `__dlpack__` method or an already exported
+ * 		  DLPack capsule.
+ *
+ * NOTE: The capsule is only borrowed, not consumed, so it's still named
+ * 		 `dltensor` and the producer's capsule destructor frees the tensor
+ * 		 once the view releases it.
+ *
+ * @param object The tensor like object.
+ */
+zctc::TensorView::TensorView(py::handle object)
+{
+	if (PyObject_CheckBuffer(object.ptr())) {
+		this->owner = py::reinterpret_borrow<py::object>(object);
+		this->buffer = std::make_unique<py::buffer_info>(py::reinterpret_borrow<py::buffer>(object).request());
+		this->from_buffer(*this->buffer);
+		return;
+	}
+
+	if (PyCapsule_CheckExact(object.ptr()))
+		this->owner = py::reinterpret_borrow<py::object>(object);
+	else if (py::hasattr(object, "__dlpack__"))
+		this->owner = object.attr("__dlpack__")();
+	else
+		throw std::runtime_error("Expected a tensor implementing either the DLPack or the buffer protocol.");
+
+	auto* managed = static_cast<zctc::dlpack::DLManagedTensor*>(PyCapsule_GetPointer(this->owner.ptr(), "dltensor"));
+	if (managed == nullptr) {
+		PyErr_Clear();
+		throw std::runtime_error("Invalid or already consumed DLPack capsule.");
+	}
+
+	this->from_dlpack(managed->dl_tensor);
+}
+
+void
+zctc::TensorView::from_dlpack(const zctc::dlpack::DLTensor& tensor)
+{
+	if (tensor.device.device_type != zctc::dlpack::kDLCPU && tensor.device.device_type != zctc::dlpack::kDLCUDAHost)
+		throw std::runtime_error("Expected a tensor in host memory, move the tensor to CPU before decoding.");
+	if (tensor.dtype.lanes != 1)
+		throw std::runtime_error("Vectorized tensor dtypes are not supported.");
+
+	int code = tensor.dtype.code, bits = tensor.dtype.bits;
+	if (code == zctc::dlpack::kDLFloat && bits == 16)
+		this->dtype = zctc::DType::FLOAT16;
+	else if (code == zctc::dlpack::kDLBfloat && bits == 16)
+		this->dtype = zctc::DType::BFLOAT16;
+	else if (code == zctc::dlpack::kDLFloat && bits == 32)
+		this->dtype = zctc::DType::FLOAT32;
+	else if (code == zctc::dlpack::kDLFloat && bits == 64)
+		this->dtype = zctc::DType::FLOAT64;
+	else if (code == zctc::dlpack::kDLInt && bits == 8)
+		this->dtype = zctc::DType::INT8;
+	else if (code == zctc::dlpack::kDLInt && bits == 32)
+		this->dtype = zctc::DType::INT32;
+	else if (code == zctc::dlpack::kDLInt && bits == 64)
+		this->dtype = zctc::DType::INT64;
+	else
+		throw std::runtime_error("Unsupported tensor dtype, code " + std::to_string(code) + " of " + std::to_string(bits)
+								 + " bits.");
+
+	this->data = static_cast<char*>(tensor.data) + tensor.byte_offset;
+	this->shape.assign(tensor.shape, tensor.shape + tensor.ndim);
+
+	// NOTE: The strides are optional in DLPack, meaning a compact row major tensor.
+	this->strides.resize(tensor.ndim);
+	for (int i = tensor.ndim - 1; i >= 0; i--) {
+		if (tensor.strides)
+			this->strides[i] = tensor.strides[i];
+		else
+			this->strides[i] = (i == tensor.ndim - 1) ? 1 : this->strides[i + 1] * this->shape[i + 1];
+	}
+}
+
+void
+zctc::TensorView::from_buffer(const py::buffer_info& info)
+{
+	// NOTE: Only the native byte order is supported, which may be explicitly stated.
+	std::string format = info.format;
+	if (!format.empty() && (format[0] == '@' || format[0] == '=' || format[0] == '<'))
+		format.erase(0, 1);
+
+	if (format == "e")
+		this->dtype = zctc::DType::FLOAT16;
+	else if (format == "f")
+		this->dtype = zctc::DType::FLOAT32;
+	else if (format == "d")
+		this->dtype = zctc::DType::FLOAT64;
+	else if (format == "b")
+		this->dtype = zctc::DType::INT8;
+	else if ((format == "i" || format == "l" || format == "q") && info.itemsize == 4)
+		this->dtype = zctc::DType::INT32;
+	else if ((format == "i" || format == "l" || format == "q") && info.itemsize == 8)
+		this->dtype = zctc::DType::INT64;
+	else
+		throw std::runtime_error("Unsupported buffer format '" + info.format + "'.");
+
+	this->data = info.ptr;
+	this->shape.assign(info.shape.begin(), info.shape.end());
+	this->strides.resize(info.ndim);
+	for (int i = 0; i < info.ndim; i++) {
+		if (info.strides[i] % info.itemsize != 0)
+			throw std::runtime_error("Buffer strides which are not a multiple of the item size are not supported.");
+		this->strides[i] = info.strides[i] / info.itemsize;
+	}
+}
+
+/**
+ * @brief Gets the strided logits source of the view, of shape Batch x SeqLen x Vocab
+ * 		  or SeqLen x Batch x Vocab if time major.
+ *
+ * @tparam L The logits type, which should match the dtype of the view.
+ * @param time_major Whether the first axis is the time instead of the batch.
+ *
+ * @return zctc::StridedLogits<L> The strided logits.
+ */
+template <typename L>
+zctc::StridedLogits<L>
+zctc::TensorView::strided_logits(bool time_major) const
+{
+	return { static_cast<const L*>(this->data), this->strides[time_major ? 1 : 0], this->strides[time_major ? 0 : 1],
+			 this->strides[2] };
+}
+
+/**
+ * @brief Calls the visitor with the strided logits of the view's floating
+ * 		  point type, so the callers are instantiated once for each type.
+ *
+ * @param time_major Whether the first axis is the time instead of the batch.
+ * @param visitor The callable taking the `zctc::StridedLogits` of any type.
+ *
+ * @return void
+ */
+template <typename F>
+void
+zctc::TensorView::visit_logits(bool time_major, F&& visitor) const
+{
+	switch (this->dtype) {
+	case zctc::DType::FLOAT16:
+		visitor(this->strided_logits<zctc::float16>(time_major));
+		break;
+	case zctc::DType::BFLOAT16:
+		visitor(this->strided_logits<zctc::bfloat16>(time_major));
+		break;
+	case zctc::DType::FLOAT32:
+		visitor(this->strided_logits<float>(time_major));
+		break;
+	case zctc::DType::FLOAT64:
+		visitor(this->strided_logits<double>(time_major));
+		break;
+	default:
+		throw std::runtime_error("Invalid logit dtype. Expected floating point value of precision 16, 32 or 64 bits.");
+	}
+}
+
+/**
+ * @brief Copies the 1-D integer view into an int vector, used for the small
+ * 		  per utterance arrays, like the sequence lengths.
+ *
+ * @return std::vector<int> The values of the view.
+ */
+std::vector<int>
+zctc::TensorView::to_ints() const
+{
+	if (this->shape.size() != 1)
+		throw std::runtime_error("Expected a 1-D integer tensor.");
+
+	std::vector<int> values(this->shape[0]);
+	for (long i = 0; i < this->shape[0]; i++) {
+		if (this->dtype == zctc::DType::INT32)
+			values[i] = static_cast<const std::int32_t*>(this->data)[i * this->strides[0]];
+		else if (this->dtype == zctc::DType::INT64)
+			values[i] = static_cast<const std::int64_t*>(this->data)[i * this->strides[0]];
+		else
+			throw std::runtime_error("Expected an integer tensor of 32 or 64 bits.");
+	}
+
+	return values;
+}
+
+/**
+ * @brief Copies the 1-D or 2-D floating point view into a row major float
+ * 		  vector, used for the small per utterance or per frame arrays, like
+ * 		  the quantization scales.
+ *
+ * @return std::vector<float> The values of the view.
+ */
+std::vector<float>
+zctc::TensorView::to_floats() const
+{
+	if (this->shape.empty() || this->shape.size() > 2)
+		throw std::runtime_error("Expected a 1-D or 2-D floating point tensor.");
+
+	long rows = this->shape[0], cols = this->shape.size() == 2 ? this->shape[1] : 1;
+	long row_stride = this->strides[0], col_stride = this->shape.size() == 2 ? this->strides[1] : 0;
+
+	std::vector<float> values(rows * cols);
+	for (long i = 0; i < rows; i++) {
+		for (long j = 0; j < cols; j++) {
+			long offset = i * row_stride + j * col_stride;
+			if (this->dtype == zctc::DType::FLOAT32)
+				values[i * cols + j] = static_cast<const float*>(this->data)[offset];
+			else if (this->dtype == zctc::DType::FLOAT64)
+				values[i * cols + j] = static_cast<const double*>(this->data)[offset];
+			else
+				throw std::runtime_error("Expected a floating point tensor of 32 or 64 bits.");
+		}
+	}
+
+	return values;
+}
+
+#endif // _ZCTC_TENSOR_H
@@ -0,0 +1,339 @@
+#ifndef _ZCTC_TRACE_H
+#define _ZCTC_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace zctc {
+
+struct TraceEvent {
+	const char* name;
+	const char* arg_name;
+	long start_ns, dur_ns, arg;
+};
+
+/**
+ * @brief Fixed size ring of trace events, written only by the thread owning
+ * 		  it, so recording is a plain store followed by a release of the head.
+ * 		  Once full, the oldest events are overwritten.
+ */
+class TraceRing {
+public:
+	static constexpr std::size_t CAPACITY = 1 << 14;
+
+	const int tid;
+
+	explicit TraceRing(int tid)
+		: tid(tid)
+		, events(CAPACITY)
+		, head(0)
+	{
+	}
+
+	inline void push(const TraceEvent& event)
+	{
+		std::size_t pos = this->head.load(std::memory_order_relaxed);
+		this->events[pos & (CAPACITY - 1)] = event;
+		this->head.store(pos + 1, std::memory_order_release);
+	}
+
+	template <typename F>
+	void for_each(F&& callback) const;
+
+private:
+	std::vector<TraceEvent> events;
+	std::atomic<std::size_t> head;
+};
+
+/**
+ * @brief Process wide collector of the decoding spans, exported as a Chrome
+ * 		  trace JSON file, which can be opened in `chrome://tracing` or Perfetto.
+ * 		  Tracing is enabled by the `trace_path` decoder option or the
+ * 		  `ZCTC_TRACE` environment variable, and without it every span costs a
+ * 		  single relaxed load. While enabled, the spans of every decoder are
+ * 		  written to the single trace path, which is held till the last
+ * 		  decoder tracing to it is destroyed.
+ *
+ * 		  Every thread records into its own ring, taken from the tracer on its
+ * 		  first span and returned on thread exit, so the workers of the
+ * 		  decoders created one after another reuse the same rings, which
+ * 		  shows up as one timeline lane per ring.
+ */
+class Tracer {
+public:
+	static Tracer& instance()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+	static inline bool enabled() { return active.load(std::memory_order_relaxed); }
+
+	~Tracer() { this->flush(); }
+
+	bool configure(const char* trace_path);
+	void release();
+	void flush();
+
+	inline long now_ns() const
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->epoch)
+			.count();
+	}
+
+	inline void record(const char* name, long start_ns, long end_ns, const char* arg_name = nullptr, long arg = 0)
+	{
+		this->thread_ring()->push({name, arg_name, start_ns, end_ns - start_ns, arg});
+	}
+
+private:
+	static inline std::atomic<bool> active { false };
+
+	std::mutex mutex;
+	std::string path;
+	int users = 0;
+	long since_ns = 0;
+	const std::chrono::steady_clock::time_point epoch;
+	std::vector<std::unique_ptr<TraceRing>> rings;
+	std::vector<TraceRing*> free_rings;
+
+	Tracer()
+		: epoch(std::chrono::steady_clock::now())
+	{
+	}
+
+	TraceRing* thread_ring();
+	void release_ring(TraceRing* ring);
+	void write();
+};
+
+/**
+ * @brief Records the lifetime of the object as a span of the current thread,
+ * 		  if tracing is enabled. The name and argument name should be string
+ * 		  literals, as only their pointers are stored.
+ */
+class TraceSpan {
+public:
+	explicit TraceSpan(const char* name, const char* arg_name = nullptr, long arg = 0)
+		: name(name)
+		, arg_name(arg_name)
+		, arg(arg)
+		, start_ns(Tracer::enabled() ? Tracer::instance().now_ns() : -1)
+	{
+	}
+
+	~TraceSpan()
+	{
+		if (this->start_ns >= 0)
+			Tracer::instance().record(this->name, this->start_ns, Tracer::instance().now_ns(), this->arg_name,
+									  this->arg);
+	}
+
+	TraceSpan(const TraceSpan&) = delete;
+	TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+	const char *name, *arg_name;
+	const long arg, start_ns;
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Calls the callback with every event still present in the ring,
+ * 		  from the oldest to the latest. Should only be called while the
+ * 		  owning thread isn't recording.
+ *
+ * @param callback The callable taking a `const zctc::TraceEvent&`.
+ *
+ * @return void
+ */
+template <typename F>
+void
+zctc::TraceRing::for_each(F&& callback) const
+{
+	std::size_t end = this->head.load(std::memory_order_acquire);
+	std::size_t begin = (end > CAPACITY) ? end - CAPACITY : 0;
+
+	for (std::size_t pos = begin; pos < end; pos++)
+		callback(this->events[pos & (CAPACITY - 1)]);
+}
+
+/**
+ * @brief Enables tracing to the provided path, or to the path in the
+ * 		  `ZCTC_TRACE` environment variable, if no path is provided.
+ * 		  Tracing stays disabled if neither of them is set. Every call
+ * 		  enabling tracing should be paired with a `release`.
+ *
+ * @param trace_path The path of the Chrome trace JSON file to write.
+ *
+ * @return bool True if tracing is enabled by the call.
+ */
+bool
+zctc::Tracer::configure(const char* trace_path)
+{
+	if (trace_path == nullptr)
+		trace_path = std::getenv("ZCTC_TRACE");
+
+	if (trace_path == nullptr || *trace_path == '\0')
+		return false;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->users > 0 && this->path != trace_path)
+		throw std::runtime_error("Tracing is process wide and already writes to " + this->path + ", so it can't write to "
+								 + trace_path + " till every decoder tracing there is destroyed");
+
+	if (this->users++ == 0) {
+		this->path = trace_path;
+		this->since_ns = this->now_ns();
+		active.store(true, std::memory_order_relaxed);
+	}
+
+	return true;
+}
+
+/**
+ * @brief Releases a `configure` enabling tracing. The last release writes
+ * 		  the trace file and disables tracing, so another path can be traced
+ * 		  to afterwards, without the spans recorded till now.
+ *
+ * @return void
+ */
+void
+zctc::Tracer::release()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (--this->users > 0)
+		return;
+
+	active.store(false, std::memory_order_relaxed);
+	this->write();
+	this->path.clear();
+}
+
+/**
+ * @brief Writes every recorded span to the trace file, overwriting the file
+ * 		  of the previous flush, if any. Called on process exit, and can be
+ * 		  called at any quiescent point, (ie) while no batch is being decoded.
+ *
+ * @return void
+ */
+void
+zctc::Tracer::flush()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->write();
+}
+
+/**
+ * @brief Writes the spans recorded since tracing is enabled to the trace file,
+ * 		  with the mutex held.
+ *
+ * @return void
+ */
+void
+zctc::Tracer::write()
+{
+	if (this->path.empty())
+		return;
+
+	std::ofstream file(this->path, std::ios::trunc);
+	if (!file)
+		return;
+
+	const long pid = ::getpid();
+	bool first = true;
+	char buffer[512];
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	for (const std::unique_ptr<TraceRing>& ring : this->rings) {
+		std::snprintf(buffer, sizeof(buffer),
+					  "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%d,\"args\":{\"name\":\"zctc-%d\"}}",
+					  first ? "" : ",", pid, ring->tid, ring->tid);
+		file << buffer;
+		first = false;
+
+		ring->for_each([&](const zctc::TraceEvent& event) {
+			if (event.start_ns < this->since_ns)
+				return;
+
+			// NOTE: Chrome traces are in microseconds, keeping the nanoseconds as fractions.
+			int len = std::snprintf(buffer, sizeof(buffer),
+									",\n{\"name\":\"%s\",\"cat\":\"zctc\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+									"\"pid\":%ld,\"tid\":%d",
+									event.name, event.start_ns / 1e3, event.dur_ns / 1e3, pid, ring->tid);
+			if (event.arg_name)
+				std::snprintf(buffer + len, sizeof(buffer) - len, ",\"args\":{\"%s\":%ld}}", event.arg_name, event.arg);
+			else
+				std::snprintf(buffer + len, sizeof(buffer) - len, "}");
+
+			file << buffer;
+		});
+	}
+	file << "\n]}\n";
+}
+
+/**
+ * @brief Gets the ring of the current thread, taking a free ring or creating
+ * 		  a new one on the first call from the thread. The ring is returned
+ * 		  to the tracer when the thread exits.
+ *
+ * @return zctc::TraceRing* The ring of the current thread.
+ */
+zctc::TraceRing*
+zctc::Tracer::thread_ring()
+{
+	struct RingHandle {
+		TraceRing* ring = nullptr;
+
+		~RingHandle()
+		{
+			if (this->ring)
+				zctc::Tracer::instance().release_ring(this->ring);
+		}
+	};
+	thread_local RingHandle handle;
+
+	if (handle.ring)
+		return handle.ring;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->free_rings.empty()) {
+		this->rings.emplace_back(std::make_unique<TraceRing>(this->rings.size()));
+		handle.ring = this->rings.back().get();
+	} else {
+		handle.ring = this->free_rings.back();
+		this->free_rings.pop_back();
+	}
+
+	return handle.ring;
+}
+
+/**
+ * @brief Returns the ring of an exiting thread to the tracer, to be reused
+ * 		  by the next thread, keeping the recorded events.
+ *
+ * @param ring The ring to return.
+ *
+ * @return void
+ */
+void
+zctc::Tracer::release_ring(zctc::TraceRing* ring)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->free_rings.emplace_back(ring);
+}
+
+#endif // _ZCTC_TRACE_H
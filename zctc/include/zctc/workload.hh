@@ -0,0 +1,215 @@
+#ifndef _ZCTC_WORKLOAD_H
+#define _ZCTC_WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace zctc {
+
+/**
+ * @brief Seeded generator of synthetic CTC posteriors, shaped like the output
+ * 		  of a trained acoustic model rather than random noise. Most frames are
+ * 		  dominated by the blank, tokens are emitted as short spiky runs, and
+ * 		  every frame's mass is concentrated on its top token with a few
+ * 		  competitors and a long tail.
+ *
+ * 		  The knobs are,
+ * 		  blank_ratio - Fraction of frames where blank is the top token.
+ * 		  peakiness - Mean probability of the top token of a frame, in (0, 1).
+ * 		  token_rate - Mean number of tokens emitted per frame. Along with the
+ * 					   blank ratio this decides the length of the token runs,
+ * 					   (1 - blank_ratio) / token_rate frames on average.
+ * 		  Emitted tokens follow a Zipf distribution over a seeded permutation
+ * 		  of the non-blank vocab, so frequent tokens aren't just the low ids.
+ */
+class SyntheticCTC {
+public:
+	static constexpr int COMPETITOR_COUNT = 8;
+
+	const int vocab_size, blank_id;
+	const float blank_ratio, peakiness, token_rate;
+
+	SyntheticCTC(int vocab_size, int blank_id, float blank_ratio, float peakiness, float token_rate,
+				 unsigned int seed)
+		: vocab_size(vocab_size)
+		, blank_id(blank_id)
+		, blank_ratio(std::clamp(blank_ratio, 0.0f, 1.0f))
+		, peakiness(std::clamp(peakiness, 0.01f, 0.999f))
+		, token_rate(std::clamp(token_rate, 1e-6f, 1.0f))
+		, rng(seed)
+		, zipf_cdf(vocab_size - 1)
+		, token_ids(vocab_size - 1)
+	{
+		double total = 0;
+		for (int i = 0; i < vocab_size - 1; i++) {
+			total += 1.0 / (i + 1);
+			this->zipf_cdf[i] = total;
+		}
+		for (double& c : this->zipf_cdf)
+			c /= total;
+
+		std::iota(this->token_ids.begin(), this->token_ids.end(), 0);
+		for (int& id : this->token_ids)
+			id += (id >= blank_id);
+		std::shuffle(this->token_ids.begin(), this->token_ids.end(), this->rng);
+	}
+
+	template <typename T>
+	void generate(int seq_len, T* logits, int* ids, int sort_top_n = 0);
+
+	int sample_seq_len(int min_len, int max_len);
+
+private:
+	std::mt19937 rng;
+	std::vector<double> zipf_cdf;
+	std::vector<int> token_ids;
+
+	int sample_token();
+
+	template <typename T>
+	void fill_frame(int top_id, bool is_token_frame, T* frame);
+};
+
+} // namespace zctc
+
+/* ---------------------------------------------------------------------------- */
+
+/**
+ * @brief Generates the posteriors of an utterance, along with the sorted ids
+ * 		  of every frame as `zctc::decode` expects.
+ *
+ * @param seq_len The number of frames to generate.
+ * @param logits The array of shape SeqLen x Vocab, to write the softmaxed probabilities in linear scale.
+ * @param ids The array of shape SeqLen x Vocab, to write the ids of every frame sorted descendingly.
+ * @param sort_top_n Only the top `sort_top_n` ids of a frame are sorted, the rest are left in any order.
+ * 					 Sorts the whole frame, if 0.
+ *
+ * @return void
+ */
+template <typename T>
+void
+zctc::SyntheticCTC::generate(int seq_len, T* logits, int* ids, int sort_top_n)
+{
+	float token_frames = 1.0f - this->blank_ratio;
+	float mean_run = std::max(1.0f, token_frames / this->token_rate);
+	/**
+	 * NOTE: Tokens only start from blank frames, so the per blank frame
+	 * 		 start probability is scaled up to keep `token_rate` per frame.
+	 */
+	float start_prob = std::min(1.0f, this->token_rate / std::max(this->blank_ratio, 1e-6f));
+	std::bernoulli_distribution start_dist(start_prob);
+	std::geometric_distribution<int> extra_run_dist(1.0 / mean_run);
+
+	int run_left = 0, token = this->blank_id;
+	sort_top_n = (sort_top_n <= 0) ? this->vocab_size : std::min(sort_top_n, this->vocab_size);
+
+	for (int t = 0; t < seq_len; t++) {
+		if (run_left == 0 && start_dist(this->rng)) {
+			token = this->sample_token();
+			run_left = 1 + extra_run_dist(this->rng);
+		}
+
+		bool is_token_frame = run_left > 0;
+		if (is_token_frame)
+			run_left--;
+
+		T* frame = logits + static_cast<std::size_t>(t) * this->vocab_size;
+		int* frame_ids = ids + static_cast<std::size_t>(t) * this->vocab_size;
+
+		this->fill_frame(is_token_frame ? token : this->blank_id, is_token_frame, frame);
+
+		std::iota(frame_ids, frame_ids + this->vocab_size, 0);
+		std::partial_sort(frame_ids, frame_ids + sort_top_n, frame_ids + this->vocab_size,
+						  [frame](int a, int b) { return frame[a] > frame[b]; });
+	}
+}
+
+/**
+ * @brief Fills a frame with `top_id` as the top token, a few competitors
+ * 		  sharing most of the remaining mass, and a noisy long tail.
+ *
+ * @param top_id The top token of the frame.
+ * @param is_token_frame Whether the frame is a token emission frame, for which
+ * 						 the blank is always one of the competitors.
+ * @param frame The frame of `vocab_size` probabilities to fill.
+ *
+ * @return void
+ */
+template <typename T>
+void
+zctc::SyntheticCTC::fill_frame(int top_id, bool is_token_frame, T* frame)
+{
+	std::normal_distribution<float> jitter(0.0f, 0.05f), log_weight(0.0f, 1.0f);
+	std::uniform_real_distribution<float> tail(0.5f, 1.5f);
+
+	float peak = std::clamp(this->peakiness + jitter(this->rng), 0.01f, 0.999f);
+	float rest = 1.0f - peak;
+	int competitors = std::min(COMPETITOR_COUNT, this->vocab_size - 1);
+
+	std::fill(frame, frame + this->vocab_size, 0);
+	frame[top_id] = peak;
+
+	/**
+	 * NOTE: 90% of the remaining mass goes to the competitors and the
+	 * 		 rest is spread over the whole vocab as the long tail.
+	 */
+	float weight_sum = 0;
+	std::vector<std::pair<int, float>> picked;
+	for (int i = 0; i < competitors; i++) {
+		int id = (i == 0 && is_token_frame) ? this->blank_id : this->sample_token();
+		if (id == top_id)
+			continue;
+
+		float weight = std::exp(2.0f * log_weight(this->rng));
+		picked.emplace_back(id, weight);
+		weight_sum += weight;
+	}
+	for (auto [id, weight] : picked)
+		frame[id] += 0.9f * rest * weight / weight_sum;
+
+	float tail_sum = 0;
+	std::vector<float> tail_weights(this->vocab_size);
+	for (float& weight : tail_weights) {
+		weight = tail(this->rng);
+		tail_sum += weight;
+	}
+
+	float mass = picked.empty() ? rest : 0.1f * rest;
+	for (int v = 0; v < this->vocab_size; v++)
+		frame[v] += mass * tail_weights[v] / tail_sum;
+}
+
+/**
+ * @brief Samples a non-blank token from the Zipf distribution.
+ *
+ * @return int The sampled token id.
+ */
+int
+zctc::SyntheticCTC::sample_token()
+{
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	auto it = std::lower_bound(this->zipf_cdf.begin(), this->zipf_cdf.end(), uniform(this->rng));
+
+	return this->token_ids[std::min(static_cast<std::size_t>(it - this->zipf_cdf.begin()),
+									this->token_ids.size() - 1)];
+}
+
+/**
+ * @brief Samples an utterance length uniformly from the provided range.
+ *
+ * @param min_len The minimum length, inclusive.
+ * @param max_len The maximum length, inclusive.
+ *
+ * @return int The sampled length.
+ */
+int
+zctc::SyntheticCTC::sample_seq_len(int min_len, int max_len)
+{
+	std::uniform_int_distribution<int> dist(min_len, std::max(min_len, max_len));
+	return dist(this->rng);
+}
+
+#endif // _ZCTC_WORKLOAD_H
@@ -1,10 +1,25 @@
 #ifndef _ZCTC_ZFST_H
 #define _ZCTC_ZFST_H
 
+#include <charconv>
+#include <cstring>
+#include <deque>
 #include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <numeric>
+#include <queue>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "ThreadPool.h"
 #include "pybind11/pybind11.h"
 #include "pybind11/stl.h"
@@ -17,11 +32,161 @@ namespace zctc {
 void
 init_fst(fst::StdVectorFst* fst);
 
+/**
+ * @brief Read-only memory mapping of a file, unmapped on destruction.
+ */
+class MappedFile {
+public:
+	const char* data;
+	std::size_t size;
+
+	explicit MappedFile(const std::string& file_path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
+
+/**
+ * @brief Open addressing hash table over the vocab tokens, kept at most half
+ * 		  full so a lookup is a single hash and a short linear probe. Every
+ * 		  slot keeps the token's hash, so only a matching hash is compared as
+ * 		  a string.
+ */
+class TokenTable {
+public:
+	void build(const std::unordered_map<std::string, int>& char_map);
+	inline int find(std::string_view token) const;
+
+private:
+	std::size_t mask = 0;
+	std::vector<int> slots;
+	std::vector<std::uint64_t> hashes;
+	std::vector<std::string> tokens;
+	std::vector<int> ids;
+
+	static inline std::uint64_t hash(std::string_view token);
+};
+
+/**
+ * @brief Parsing counters of the lexicon files inserted into the FST.
+ */
+struct LexiconStats {
+	long lines = 0;
+	long words = 0;
+	long malformed_lines = 0;
+	long skipped_by_freq = 0;
+	long skipped_with_unknown = 0;
+	long unknown_tokens = 0;
+	std::vector<std::string> unknown_samples;
+
+	void merge(const LexiconStats& other);
+};
+
+/**
+ * @brief Words of a lexicon file chunk, tokenized into vocab ids and
+ * 		  stored flat, `offsets[i]` to `offsets[i + 1]` being the i-th word.
+ */
+struct LexiconChunk {
+	std::vector<int> tokens;
+	std::vector<std::size_t> offsets { 0 };
+	LexiconStats stats;
+};
+
+/**
+ * @brief Incremental construction of the minimal deterministic acyclic
+ * 		  automaton for a set of token sequences added in lexicographic
+ * 		  order (Daciuk et al., 2000). Only the states along the last added
+ * 		  word are kept unregistered, every other state is deduplicated
+ * 		  against a register as soon as its right language is final, so
+ * 		  the memory stays bounded by the size of the minimal automaton.
+ */
+class MinimalFstBuilder {
+public:
+	MinimalFstBuilder();
+	MinimalFstBuilder(const MinimalFstBuilder&) = delete;
+	MinimalFstBuilder& operator=(const MinimalFstBuilder&) = delete;
+
+	void add(const int* tokens, std::size_t len);
+	bool follows(const int* tokens, std::size_t len) const;
+	void finish(fst::StdVectorFst* fst);
+	std::size_t num_states() const { return this->reg_final.size() + this->path.size(); }
+
+private:
+	struct PathState {
+		bool is_final = false;
+		std::vector<std::pair<int, int>> arcs;
+	};
+
+	struct StateHash {
+		const MinimalFstBuilder* builder;
+		std::size_t operator()(int state) const;
+	};
+
+	struct StateEqual {
+		const MinimalFstBuilder* builder;
+		bool operator()(int x, int y) const;
+	};
+
+	std::vector<int> prev_word;
+	std::vector<PathState> path;
+	std::vector<char> reg_final;
+	std::vector<std::size_t> reg_offsets;
+	std::vector<std::pair<int, int>> reg_arcs;
+	std::unordered_set<int, StateHash, StateEqual> registry;
+
+	void minimize_path(std::size_t depth);
+	int replace_or_register(PathState& state);
+};
+
+/**
+ * @brief External sort of the tokenized words, for the lexicons which aren't
+ * 		  sorted by their token ids. Words are buffered into a run of at most
+ * 		  `max_run_tokens` tokens, every full run is sorted and spilled into
+ * 		  a temporary file, and the runs are merged into the builder at last.
+ */
+class WordRuns {
+public:
+	static constexpr std::size_t DEFAULT_RUN_TOKENS = 1 << 24;
+
+	explicit WordRuns(std::size_t max_run_tokens = DEFAULT_RUN_TOKENS)
+		: max_run_tokens(max_run_tokens)
+	{
+	}
+
+	WordRuns(const WordRuns&) = delete;
+	WordRuns& operator=(const WordRuns&) = delete;
+	~WordRuns();
+
+	void add(const LexiconChunk& chunk);
+	void merge_into(MinimalFstBuilder& builder);
+	std::size_t num_spilled() const { return this->run_paths.size(); }
+
+private:
+	struct RunReader {
+		std::ifstream in;
+		std::vector<int> word;
+
+		bool next();
+	};
+
+	std::size_t max_run_tokens;
+	LexiconChunk run;
+	std::vector<std::string> run_paths;
+
+	std::vector<std::size_t> sorted_run() const;
+	void spill();
+};
+
 class ZFST {
 public:
+	static constexpr std::size_t MAX_UNKNOWN_SAMPLES = 32;
+
 	fst::StdVectorFst* fst;
 	std::mutex mutex;
 	std::unordered_map<std::string, int> char_map;
+	TokenTable token_table;
+	LexiconStats lexicon_stats;
 
 	ZFST(char* vocab_path, char* fst_path)
 		: fst(nullptr)
@@ -47,9 +212,11 @@ public:
 	~ZFST() { delete fst; }
 
 	void insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, std::vector<std::vector<int>>& tokens_group);
+	void insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, const LexiconChunk& chunk);
 	void optimize();
 	int parse_lexicon_files(std::vector<std::string>& file_paths, int freq_threshold, int worker_count);
-	int parse_lexicon_file(std::string file_path, int freq_threshold);
+	int parse_lexicon_file(std::string file_path, int freq_threshold, int worker_count = 1);
+	int build_minimal(std::vector<std::string>& file_paths, int freq_threshold, int worker_count);
 	bool write(std::string output_path);
 
 	inline void insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, std::vector<int>& tokens);
@@ -60,6 +227,13 @@ protected:
 
 int
 parse_lexicon_file(ZFST* zfst, std::string file_path, int freq_threshold);
+std::vector<std::pair<const char*, const char*>>
+split_at_lines(const MappedFile& file, std::size_t parts);
+void
+parse_lexicon_chunk(const ZFST* zfst, const char* begin, const char* end, int freq_threshold, LexiconChunk& chunk);
+bool
+parse_lexicon_chunks(const ZFST* zfst, const std::vector<std::string>& file_paths, int freq_threshold, int worker_count,
+					 const std::function<bool(LexiconChunk&)>& consume);
 // NOTE: hotwords_weight should be sorted in descending order...
 void
 populate_hotword_fst(fst::StdVectorFst* fst, const std::vector<std::vector<int>>& hotwords,
@@ -75,13 +249,38 @@ populate_hotword_fst(fst::StdVectorFst* fst, const std::vector<std::vector<int>>
  *
  * @param file_path The path to the lexicon file.
  * @param freq_threshold The frequency threshold to consider for the words.
+ * @param worker_count The number of workers to parse the file with. The mapped
+ * 					   file is split into that many chunks at line boundaries.
  *
  * @return int 0 on successful execution.
  */
 int
-zctc::ZFST::parse_lexicon_file(std::string file_path, int freq_threshold)
+zctc::ZFST::parse_lexicon_file(std::string file_path, int freq_threshold, int worker_count)
 {
-	return zctc::parse_lexicon_file(this, file_path, freq_threshold);
+	if (worker_count <= 1)
+		return zctc::parse_lexicon_file(this, file_path, freq_threshold);
+
+	zctc::MappedFile file(file_path);
+	ThreadPool pool(worker_count);
+	std::vector<std::future<int>> results;
+
+	for (auto [begin, end] : zctc::split_at_lines(file, std::max(worker_count, 1))) {
+		results.emplace_back(pool.enqueue([this, begin, end, freq_threshold]() {
+			zctc::LexiconChunk chunk;
+			fst::SortedMatcher<fst::StdVectorFst> matcher(this->fst, fst::MATCH_INPUT);
+
+			zctc::parse_lexicon_chunk(this, begin, end, freq_threshold, chunk);
+			this->insert_into_fst(&matcher, chunk);
+
+			return 0;
+		}));
+	}
+
+	for (auto&& result : results)
+		if (result.get() != 0)
+			throw std::runtime_error("Unexpected error occured during execution");
+
+	return 0;
 }
 
 /**
@@ -110,6 +309,81 @@ zctc::ZFST::parse_lexicon_files(std::vector<std::string>& file_paths, int freq_t
 	return 0;
 }
 
+/**
+ * @brief Parse the provided lexicon files and build the minimal deterministic
+ * 		  lexicon FST directly, instead of inserting the words into a trie and
+ * 		  running `optimize` over it. The words of lexicons sorted by their
+ * 		  token ids are streamed into `MinimalFstBuilder` chunk by chunk, so
+ * 		  the peak memory is the chunks being parsed plus the minimal FST.
+ * 		  The FST should be empty before calling this.
+ *
+ * NOTE: An unsorted lexicon, the common case, is only detected once a word
+ * 		 out of order is parsed, after which the files are parsed a second
+ * 		 time into an external sort, costing the second parse and a write
+ * 		 and read of every word through the temporary run files.
+ *
+ * @param file_paths The path to the lexicon files.
+ * @param freq_threshold The frequency threshold to consider for the words.
+ * @param worker_count The number of workers to use for concurrent parsing.
+ *
+ * @return int 0 on successful execution
+ */
+int
+zctc::ZFST::build_minimal(std::vector<std::string>& file_paths, int freq_threshold, int worker_count)
+{
+	{
+		std::lock_guard<std::mutex> guard(this->mutex);
+		if (this->fst->NumStates() > 1 || this->fst->NumArcs(this->fst->Start()) != 0)
+			throw std::runtime_error("Minimal FST can only be built into an empty FST");
+	}
+
+	zctc::LexiconStats stats;
+	auto builder = std::make_unique<zctc::MinimalFstBuilder>();
+
+	bool sorted = zctc::parse_lexicon_chunks(
+		this, file_paths, freq_threshold, worker_count, [&](zctc::LexiconChunk& chunk) {
+			for (std::size_t w = 0; w + 1 < chunk.offsets.size(); w++) {
+				const int* word = chunk.tokens.data() + chunk.offsets[w];
+				std::size_t len = chunk.offsets[w + 1] - chunk.offsets[w];
+				if (!builder->follows(word, len))
+					return false;
+
+				builder->add(word, len);
+			}
+
+			stats.merge(chunk.stats);
+			return true;
+		});
+
+	if (!sorted) {
+		/**
+		 * NOTE: The words already added can't be taken back out of the
+		 * 		 builder, so the files are parsed again into an external
+		 * 		 sort, which keeps the memory bounded by its run size.
+		 */
+		builder = std::make_unique<zctc::MinimalFstBuilder>();
+		stats = zctc::LexiconStats();
+
+		zctc::WordRuns runs;
+		zctc::parse_lexicon_chunks(this, file_paths, freq_threshold, worker_count, [&](zctc::LexiconChunk& chunk) {
+			runs.add(chunk);
+			stats.merge(chunk.stats);
+			return true;
+		});
+		runs.merge_into(*builder);
+	}
+
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	delete this->fst;
+	this->fst = new fst::StdVectorFst;
+	builder->finish(this->fst);
+
+	this->lexicon_stats.merge(stats);
+
+	return 0;
+}
+
 /**
  * @brief Write the FST to the provided output path.
  *
@@ -221,6 +495,43 @@ zctc::ZFST::insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, std:
 	}
 }
 
+/**
+ * @brief Insert the words of a parsed lexicon chunk into the FST, holding
+ * 		  the lock once for the whole chunk, and merge its parsing counters.
+ *
+ * @param matcher The FST matcher to use for searching.
+ * @param chunk The parsed lexicon chunk to insert.
+ *
+ * @return void
+ */
+void
+zctc::ZFST::insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, const zctc::LexiconChunk& chunk)
+{
+	fst::StdVectorFst::StateId next_state, state;
+	std::lock_guard<std::mutex> guard(this->mutex);
+
+	for (std::size_t i = 0; i + 1 < chunk.offsets.size(); i++) {
+		state = this->fst->Start();
+
+		for (std::size_t j = chunk.offsets[i]; j < chunk.offsets[i + 1]; j++) {
+			int token = chunk.tokens[j];
+
+			matcher->SetState(state);
+			if (matcher->Find(token)) {
+				state = matcher->Value().nextstate;
+			} else {
+				next_state = this->fst->AddState();
+				this->fst->AddArc(state, fst::StdArc(token, token, 0, next_state));
+				state = next_state;
+			}
+		}
+
+		this->fst->SetFinal(state, 0);
+	}
+
+	this->lexicon_stats.merge(chunk.stats);
+}
+
 /**
  * @brief Parse the lexicon file based on the frequency threshold,
  *        and insert words into FST.
@@ -234,17 +545,37 @@ zctc::ZFST::insert_into_fst(fst::SortedMatcher<fst::StdVectorFst>* matcher, std:
 int
 zctc::parse_lexicon_file(zctc::ZFST* zfst, std::string file_path, int freq_threshold)
 {
-	int freq;
-	std::string word, tmp, line;
-	std::vector<int> tokens;
+	zctc::LexiconChunk chunk;
+	zctc::MappedFile file(file_path);
 	fst::SortedMatcher<fst::StdVectorFst> matcher(zfst->fst, fst::MATCH_INPUT);
 
-	std::ifstream file(file_path);
-	if (!file) {
-		std::runtime_error(std::string("Failed to read FST file from the path, ") + file_path);
-	}
+	zctc::parse_lexicon_chunk(zfst, file.data, file.data + file.size, freq_threshold, chunk);
+	zfst->insert_into_fst(&matcher, chunk);
+
+	return 0;
+}
+
+/**
+ * @brief Parse the lines of a lexicon file between `begin` and `end` into
+ * 		  vocab token ids, without copying the line contents. Words having
+ * 		  any token missing from the vocab are not inserted, but counted
+ * 		  in the chunk stats along with a few samples of the unknown tokens.
+ *
+ * @param zfst The ZFST object whose token table is used for the lookups.
+ * @param begin The start of the chunk, should be the start of a line.
+ * @param end The end of the chunk, should be the end of a line.
+ * @param freq_threshold The frequency threshold to consider for the words.
+ * @param chunk The chunk to append the parsed words to.
+ *
+ * @return void
+ */
+void
+zctc::parse_lexicon_chunk(const zctc::ZFST* zfst, const char* begin, const char* end, int freq_threshold,
+						  zctc::LexiconChunk& chunk)
+{
+	auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\r'; };
 
-	while (std::getline(file, line)) {
+	while (begin < end) {
 		/**
 		 * NOTE: Lexicon file format:
 		 * 		 freq-count actual-word *tokenized-version-of-the-word
@@ -255,23 +586,76 @@ zctc::parse_lexicon_file(zctc::ZFST* zfst, std::string file_path, int freq_thres
 		 * 		 The file is generally space seperated. But here, for
 		 * 		 clarity, it was depicted with tabs.
 		 */
-		std::istringstream iss(line);
-		iss >> freq;
+		const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+		if (!line_end)
+			line_end = end;
+
+		const char* pos = begin;
+		begin = line_end + 1;
+		chunk.stats.lines++;
+
+		while (pos < line_end && is_space(*pos))
+			pos++;
+
+		int freq;
+		std::from_chars_result res = std::from_chars(pos, line_end, freq);
+		if (res.ec != std::errc()) {
+			chunk.stats.malformed_lines++;
+			continue;
+		}
 		if (freq < freq_threshold) {
+			chunk.stats.skipped_by_freq++;
 			continue;
 		}
+		pos = res.ptr;
+
+		// NOTE: Skipping the actual word, only the tokenized version is inserted.
+		while (pos < line_end && is_space(*pos))
+			pos++;
+		while (pos < line_end && !is_space(*pos))
+			pos++;
+
+		bool has_unknown = false;
+		std::size_t word_start = chunk.tokens.size();
+
+		while (pos < line_end) {
+			while (pos < line_end && is_space(*pos))
+				pos++;
+			if (pos == line_end)
+				break;
+
+			const char* tok_start = pos;
+			while (pos < line_end && !is_space(*pos))
+				pos++;
+
+			std::string_view token(tok_start, pos - tok_start);
+			int id = zfst->token_table.find(token);
+
+			if (id < 0) {
+				has_unknown = true;
+				chunk.stats.unknown_tokens++;
+				std::vector<std::string>& samples = chunk.stats.unknown_samples;
+				if (samples.size() < zctc::ZFST::MAX_UNKNOWN_SAMPLES
+					&& std::find(samples.begin(), samples.end(), token) == samples.end())
+					samples.emplace_back(token);
+				continue;
+			}
+			chunk.tokens.emplace_back(id);
+		}
 
-		iss >> word;
-		while (iss.good()) {
-			iss >> tmp;
-			tokens.emplace_back(zfst->char_map[tmp]);
+		if (has_unknown || chunk.tokens.size() == word_start) {
+			if (has_unknown)
+				chunk.stats.skipped_with_unknown++;
+			else
+				chunk.stats.malformed_lines++;
+
+			chunk.tokens.resize(word_start);
+			continue;
 		}
 
-		zfst->insert_into_fst(&matcher, tokens);
-		tokens.clear();
+		chunk.offsets.emplace_back(chunk.tokens.size());
+		chunk.stats.words++;
 	}
-
-	return 0;
 }
 
 /**
@@ -318,7 +702,7 @@ zctc::populate_hotword_fst(fst::StdVectorFst* fst, const std::vector<std::vector
 				continue;
 			}
 		}
-		fst->SetFinal(state, fst::StdArc::Weight::Zero())
+		fst->SetFinal(state, fst::StdArc::Weight::Zero());
 	}
 
 	fst::RmEpsilon(fst);
@@ -345,6 +729,564 @@ zctc::ZFST::load_vocab(char* vocab_path)
 
 	while (std::getline(inputFile, line))
 		this->char_map[line] = id++;
+
+	this->token_table.build(this->char_map);
+}
+
+/**
+ * @brief Memory map the provided file for reading.
+ *
+ * @param file_path The path to the file.
+ */
+zctc::MappedFile::MappedFile(const std::string& file_path)
+	: data(nullptr)
+	, size(0)
+{
+	int fd = ::open(file_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error(std::string("Failed to open file from the path, ") + file_path);
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw std::runtime_error(std::string("Failed to stat file from the path, ") + file_path);
+	}
+
+	this->size = st.st_size;
+	if (this->size != 0) {
+		void* addr = ::mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) {
+			::close(fd);
+			throw std::runtime_error(std::string("Failed to memory map file from the path, ") + file_path);
+		}
+
+		::madvise(addr, this->size, MADV_SEQUENTIAL);
+		this->data = static_cast<const char*>(addr);
+	}
+
+	::close(fd);
+}
+
+zctc::MappedFile::~MappedFile()
+{
+	if (this->data)
+		::munmap(const_cast<char*>(this->data), this->size);
+}
+
+/**
+ * @brief FNV-1a hash of the token, with the high bits folded into the low
+ * 		  ones used to index the table.
+ *
+ * @param token The token to hash.
+ *
+ * @return std::uint64_t The hash value.
+ */
+std::uint64_t
+zctc::TokenTable::hash(std::string_view token)
+{
+	std::uint64_t h = 14695981039346656037ULL;
+	for (char c : token) {
+		h ^= static_cast<unsigned char>(c);
+		h *= 1099511628211ULL;
+	}
+
+	return h ^ (h >> 29);
+}
+
+/**
+ * @brief Build the table for the provided vocab, with at least twice as
+ * 		  many slots as tokens, so the memory and the time stay linear in
+ * 		  the vocab size.
+ *
+ * @param char_map The vocab token to id map.
+ *
+ * @return void
+ */
+void
+zctc::TokenTable::build(const std::unordered_map<std::string, int>& char_map)
+{
+	this->tokens.clear();
+	this->ids.clear();
+	this->hashes.clear();
+	for (const auto& [token, id] : char_map) {
+		this->tokens.emplace_back(token);
+		this->ids.emplace_back(id);
+		this->hashes.emplace_back(TokenTable::hash(token));
+	}
+
+	std::size_t table_size = 1;
+	while (table_size < 2 * this->tokens.size())
+		table_size <<= 1;
+
+	this->mask = table_size - 1;
+	this->slots.assign(table_size, -1);
+
+	for (int i = 0; i < static_cast<int>(this->tokens.size()); i++) {
+		std::size_t slot = this->hashes[i] & this->mask;
+		while (this->slots[slot] != -1)
+			slot = (slot + 1) & this->mask;
+
+		this->slots[slot] = i;
+	}
+}
+
+/**
+ * @brief Lookup the vocab id of the token.
+ *
+ * @param token The token to lookup.
+ *
+ * @return int The vocab id of the token, -1 if the token is not in the vocab.
+ */
+int
+zctc::TokenTable::find(std::string_view token) const
+{
+	if (this->slots.empty())
+		return -1;
+
+	std::uint64_t h = TokenTable::hash(token);
+	for (std::size_t slot = h & this->mask; this->slots[slot] != -1; slot = (slot + 1) & this->mask) {
+		int i = this->slots[slot];
+		if (this->hashes[i] == h && this->tokens[i] == token)
+			return this->ids[i];
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Accumulate the counters of another stats into this one.
+ *
+ * @param other The stats to accumulate.
+ *
+ * @return void
+ */
+void
+zctc::LexiconStats::merge(const zctc::LexiconStats& other)
+{
+	this->lines += other.lines;
+	this->words += other.words;
+	this->malformed_lines += other.malformed_lines;
+	this->skipped_by_freq += other.skipped_by_freq;
+	this->skipped_with_unknown += other.skipped_with_unknown;
+	this->unknown_tokens += other.unknown_tokens;
+
+	for (const std::string& token : other.unknown_samples) {
+		if (this->unknown_samples.size() >= zctc::ZFST::MAX_UNKNOWN_SAMPLES)
+			break;
+		if (std::find(this->unknown_samples.begin(), this->unknown_samples.end(), token)
+			== this->unknown_samples.end())
+			this->unknown_samples.emplace_back(token);
+	}
+}
+
+/**
+ * @brief Split the mapped file into about `parts` chunks of equal size.
+ * 		  Every chunk is extended till the end of the line it stops in,
+ * 		  so no line gets split between two chunks.
+ *
+ * @param file The mapped file to split.
+ * @param parts The number of chunks to split into.
+ *
+ * @return std::vector<std::pair<const char*, const char*>> The begin and end of each chunk.
+ */
+std::vector<std::pair<const char*, const char*>>
+zctc::split_at_lines(const zctc::MappedFile& file, std::size_t parts)
+{
+	std::vector<std::pair<const char*, const char*>> chunks;
+	const char* begin = file.data;
+	const char* end = file.data + file.size;
+	std::size_t chunk_size = file.size / std::max(parts, std::size_t(1)) + 1;
+
+	while (begin < end) {
+		const char* chunk_end = begin + std::min(chunk_size, static_cast<std::size_t>(end - begin));
+		chunk_end = static_cast<const char*>(std::memchr(chunk_end, '\n', end - chunk_end));
+		chunk_end = chunk_end ? chunk_end + 1 : end;
+
+		chunks.emplace_back(begin, chunk_end);
+		begin = chunk_end;
+	}
+
+	return chunks;
+}
+
+/**
+ * @brief Parse the provided lexicon files into chunks of bounded size and hand
+ * 		  them to `consume` in the order of the files and of their lines. At
+ * 		  most twice as many chunks as workers are parsed ahead, and every
+ * 		  chunk is freed once consumed.
+ *
+ * @param zfst The FST whose vocab to tokenize the words with.
+ * @param file_paths The path to the lexicon files.
+ * @param freq_threshold The frequency threshold to consider for the words.
+ * @param worker_count The number of workers to use for concurrent parsing.
+ * @param consume The callback to consume every parsed chunk, returning false
+ * 				  to stop the parsing.
+ *
+ * @return bool False if `consume` stopped the parsing.
+ */
+bool
+zctc::parse_lexicon_chunks(const zctc::ZFST* zfst, const std::vector<std::string>& file_paths, int freq_threshold,
+						   int worker_count, const std::function<bool(zctc::LexiconChunk&)>& consume)
+{
+	static constexpr std::size_t CHUNK_BYTES = 8 << 20;
+
+	worker_count = std::max(worker_count, 1);
+
+	for (const std::string& file_path : file_paths) {
+		zctc::MappedFile file(file_path);
+		std::size_t parts = std::max(static_cast<std::size_t>(worker_count), file.size / CHUNK_BYTES + 1);
+
+		// NOTE: Declared after the file, so its tasks are joined before the file is unmapped
+		ThreadPool pool(worker_count);
+		std::deque<std::future<zctc::LexiconChunk>> results;
+
+		auto consume_next = [&results, &consume]() {
+			zctc::LexiconChunk chunk = results.front().get();
+			results.pop_front();
+			return consume(chunk);
+		};
+
+		for (auto [begin, end] : zctc::split_at_lines(file, parts)) {
+			if (results.size() == 2 * static_cast<std::size_t>(worker_count) && !consume_next())
+				return false;
+
+			results.emplace_back(pool.enqueue([zfst, begin, end, freq_threshold]() {
+				zctc::LexiconChunk chunk;
+				zctc::parse_lexicon_chunk(zfst, begin, end, freq_threshold, chunk);
+				return chunk;
+			}));
+		}
+
+		while (!results.empty()) {
+			if (!consume_next())
+				return false;
+		}
+	}
+
+	return true;
+}
+
+zctc::MinimalFstBuilder::MinimalFstBuilder()
+	: path(1)
+	, reg_offsets { 0 }
+	, registry(0, StateHash { this }, StateEqual { this })
+{
+}
+
+/**
+ * @brief Add a word to the automaton. Words should be added in lexicographic
+ * 		  order of their token ids, repeated words are ignored.
+ *
+ * @param tokens The word tokens to add.
+ * @param len The number of tokens in the word.
+ *
+ * @return void
+ */
+void
+zctc::MinimalFstBuilder::add(const int* tokens, std::size_t len)
+{
+	if (!this->prev_word.empty() || this->path[0].is_final) {
+		if (std::lexicographical_compare(tokens, tokens + len, this->prev_word.begin(), this->prev_word.end()))
+			throw std::runtime_error("Words should be added to the minimal FST in sorted order");
+		if (std::equal(tokens, tokens + len, this->prev_word.begin(), this->prev_word.end()))
+			return;
+	}
+
+	std::size_t prefix_len = 0;
+	while (prefix_len < len && prefix_len < this->prev_word.size() && tokens[prefix_len] == this->prev_word[prefix_len])
+		prefix_len++;
+
+	/**
+	 * NOTE: The states of the previous word beyond the common prefix
+	 * 		 can't get any more arcs, since the later words are greater,
+	 * 		 so they're final and can be registered.
+	 */
+	this->minimize_path(prefix_len);
+
+	for (std::size_t i = prefix_len; i < len; i++) {
+		this->path.back().arcs.emplace_back(tokens[i], -1);
+		this->path.emplace_back();
+	}
+	this->path.back().is_final = true;
+
+	this->prev_word.assign(tokens, tokens + len);
+}
+
+/**
+ * @brief Whether the word can be added after the last added one, (ie) it
+ * 		  isn't lesser than the last word in the lexicographic order.
+ *
+ * @param tokens The word tokens to check.
+ * @param len The number of tokens in the word.
+ *
+ * @return bool True if the word can be added.
+ */
+bool
+zctc::MinimalFstBuilder::follows(const int* tokens, std::size_t len) const
+{
+	return !std::lexicographical_compare(tokens, tokens + len, this->prev_word.begin(), this->prev_word.end());
+}
+
+/**
+ * @brief Register the remaining states and write the minimal automaton into
+ * 		  the provided FST. The arcs of every state are written in ascending
+ * 		  label order, so the FST is input label sorted as `SortedMatcher`
+ * 		  expects, without any further optimization. The builder is reset
+ * 		  after, so it can be reused for another set of words.
+ *
+ * @param fst The empty FST to write the automaton into.
+ *
+ * @return void
+ */
+void
+zctc::MinimalFstBuilder::finish(fst::StdVectorFst* fst)
+{
+	this->minimize_path(0);
+	int start = this->replace_or_register(this->path[0]);
+	int num_states = this->reg_final.size();
+
+	fst->ReserveStates(num_states);
+	for (int state = 0; state < num_states; state++)
+		fst->AddState();
+
+	for (int state = 0; state < num_states; state++) {
+		fst->ReserveArcs(state, this->reg_offsets[state + 1] - this->reg_offsets[state]);
+
+		for (std::size_t i = this->reg_offsets[state]; i < this->reg_offsets[state + 1]; i++) {
+			auto [label, next_state] = this->reg_arcs[i];
+			fst->AddArc(state, fst::StdArc(label, label, 0, next_state));
+		}
+
+		if (this->reg_final[state])
+			fst->SetFinal(state, 0);
+	}
+
+	fst->SetStart(start);
+	fst->SetProperties(fst::kILabelSorted | fst::kOLabelSorted | fst::kAcceptor | fst::kIDeterministic
+						   | fst::kAcyclic,
+					   fst::kILabelSorted | fst::kOLabelSorted | fst::kAcceptor | fst::kIDeterministic
+						   | fst::kAcyclic);
+
+	this->path.assign(1, PathState());
+	this->prev_word.clear();
+	this->registry.clear();
+	this->reg_final.clear();
+	this->reg_offsets.assign(1, 0);
+	this->reg_arcs.clear();
+}
+
+/**
+ * @brief Register the unregistered states deeper than `depth` along the
+ * 		  last added word, deepest first, linking each to its parent.
+ *
+ * @param depth The number of tokens of the last word to keep unregistered.
+ *
+ * @return void
+ */
+void
+zctc::MinimalFstBuilder::minimize_path(std::size_t depth)
+{
+	while (this->path.size() > depth + 1) {
+		int state = this->replace_or_register(this->path.back());
+		this->path.pop_back();
+		this->path.back().arcs.back().second = state;
+	}
+}
+
+/**
+ * @brief Return the registered state equivalent to the provided one,
+ * 		  registering it as a new state if there is none.
+ *
+ * @param state The state whose childs are all registered.
+ *
+ * @return int The registered state id.
+ */
+int
+zctc::MinimalFstBuilder::replace_or_register(PathState& state)
+{
+	/**
+	 * NOTE: The candidate is appended to the register storage first,
+	 * 		 so it can be hashed and compared as any registered state,
+	 * 		 and popped back if an equivalent state already exists.
+	 */
+	int candidate = this->reg_final.size();
+	this->reg_final.emplace_back(state.is_final);
+	this->reg_arcs.insert(this->reg_arcs.end(), state.arcs.begin(), state.arcs.end());
+	this->reg_offsets.emplace_back(this->reg_arcs.size());
+
+	auto [it, inserted] = this->registry.insert(candidate);
+	if (inserted)
+		return candidate;
+
+	this->reg_final.pop_back();
+	this->reg_offsets.pop_back();
+	this->reg_arcs.resize(this->reg_offsets.back());
+
+	return *it;
+}
+
+std::size_t
+zctc::MinimalFstBuilder::StateHash::operator()(int state) const
+{
+	std::size_t h = this->builder->reg_final[state];
+	for (std::size_t i = this->builder->reg_offsets[state]; i < this->builder->reg_offsets[state + 1]; i++) {
+		const std::pair<int, int>& arc = this->builder->reg_arcs[i];
+		h = (h * 1000003) ^ static_cast<std::size_t>(arc.first);
+		h = (h * 1000003) ^ static_cast<std::size_t>(arc.second);
+	}
+
+	return h;
+}
+
+bool
+zctc::MinimalFstBuilder::StateEqual::operator()(int x, int y) const
+{
+	const MinimalFstBuilder* b = this->builder;
+
+	return b->reg_final[x] == b->reg_final[y]
+		   && std::equal(b->reg_arcs.begin() + b->reg_offsets[x], b->reg_arcs.begin() + b->reg_offsets[x + 1],
+						 b->reg_arcs.begin() + b->reg_offsets[y], b->reg_arcs.begin() + b->reg_offsets[y + 1]);
+}
+
+zctc::WordRuns::~WordRuns()
+{
+	for (const std::string& run_path : this->run_paths) {
+		std::error_code error;
+		std::filesystem::remove(run_path, error);
+	}
+}
+
+/**
+ * @brief Add the words of the chunk to the current run, spilling the run
+ * 		  once it's full.
+ *
+ * @param chunk The parsed chunk to add the words of.
+ *
+ * @return void
+ */
+void
+zctc::WordRuns::add(const zctc::LexiconChunk& chunk)
+{
+	for (std::size_t w = 0; w + 1 < chunk.offsets.size(); w++) {
+		this->run.tokens.insert(this->run.tokens.end(), chunk.tokens.begin() + chunk.offsets[w],
+								chunk.tokens.begin() + chunk.offsets[w + 1]);
+		this->run.offsets.emplace_back(this->run.tokens.size());
+
+		if (this->run.tokens.size() >= this->max_run_tokens)
+			this->spill();
+	}
+}
+
+/**
+ * @brief Add every word of the runs to the builder in sorted order. A single
+ * 		  run is sorted in memory, otherwise the spilled runs are merged.
+ *
+ * @param builder The empty builder to add the words to.
+ *
+ * @return void
+ */
+void
+zctc::WordRuns::merge_into(zctc::MinimalFstBuilder& builder)
+{
+	if (this->run_paths.empty()) {
+		for (std::size_t w : this->sorted_run())
+			builder.add(this->run.tokens.data() + this->run.offsets[w], this->run.offsets[w + 1] - this->run.offsets[w]);
+
+		return;
+	}
+
+	if (this->run.offsets.size() > 1)
+		this->spill();
+
+	std::vector<RunReader> readers(this->run_paths.size());
+	auto greater = [&readers](int x, int y) { return readers[y].word < readers[x].word; };
+	std::priority_queue<int, std::vector<int>, decltype(greater)> heads(greater);
+
+	for (int i = 0; i < static_cast<int>(readers.size()); i++) {
+		readers[i].in.open(this->run_paths[i], std::ios::binary);
+		if (readers[i].next())
+			heads.push(i);
+	}
+
+	while (!heads.empty()) {
+		int i = heads.top();
+		heads.pop();
+
+		builder.add(readers[i].word.data(), readers[i].word.size());
+		if (readers[i].next())
+			heads.push(i);
+	}
+}
+
+/**
+ * @brief Sort the words of the current run.
+ *
+ * @return std::vector<std::size_t> The word indices of the run in sorted order.
+ */
+std::vector<std::size_t>
+zctc::WordRuns::sorted_run() const
+{
+	const std::vector<int>& tokens = this->run.tokens;
+	const std::vector<std::size_t>& offsets = this->run.offsets;
+
+	std::vector<std::size_t> words(offsets.size() - 1);
+	std::iota(words.begin(), words.end(), 0);
+	std::sort(words.begin(), words.end(), [&](std::size_t x, std::size_t y) {
+		return std::lexicographical_compare(tokens.begin() + offsets[x], tokens.begin() + offsets[x + 1],
+											tokens.begin() + offsets[y], tokens.begin() + offsets[y + 1]);
+	});
+
+	return words;
+}
+
+/**
+ * @brief Write the current run sorted into a temporary file, as the length
+ * 		  and the tokens of every word, and free it.
+ *
+ * @return void
+ */
+void
+zctc::WordRuns::spill()
+{
+	std::string run_path = (std::filesystem::temp_directory_path() / "zctc-lexicon-XXXXXX").string();
+	int fd = ::mkstemp(run_path.data());
+	if (fd == -1)
+		throw std::runtime_error(std::string("Failed to create a temporary file to sort the lexicon, ")
+								 + std::strerror(errno));
+
+	::close(fd);
+	this->run_paths.emplace_back(run_path);
+
+	std::ofstream out(run_path, std::ios::binary);
+	for (std::size_t w : this->sorted_run()) {
+		std::uint32_t len = this->run.offsets[w + 1] - this->run.offsets[w];
+		out.write(reinterpret_cast<const char*>(&len), sizeof(len));
+		out.write(reinterpret_cast<const char*>(this->run.tokens.data() + this->run.offsets[w]), len * sizeof(int));
+	}
+
+	if (!out.flush())
+		throw std::runtime_error("Failed to write the sorted lexicon run to the temporary file, " + run_path);
+
+	this->run = zctc::LexiconChunk();
+}
+
+/**
+ * @brief Read the next word of the run.
+ *
+ * @return bool False at the end of the run.
+ */
+bool
+zctc::WordRuns::RunReader::next()
+{
+	std::uint32_t len;
+	if (!this->in.read(reinterpret_cast<char*>(&len), sizeof(len)))
+		return false;
+
+	this->word.resize(len);
+	if (!this->in.read(reinterpret_cast<char*>(this->word.data()), len * sizeof(int)))
+		throw std::runtime_error("Failed to read the sorted lexicon run, the temporary file is truncated");
+
+	return true;
 }
 
 #endif // _ZCTC_ZFST_H
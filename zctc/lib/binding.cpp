@@ -2,6 +2,29 @@
 
 PYBIND11_MODULE(_zctc, m)
 {
+	m.def(
+		"flush_trace", []() { zctc::Tracer::instance().flush(); },
+		"Writes the spans recorded so far to the trace file, if tracing is enabled",
+		py::call_guard<py::gil_scoped_release>());
+
+	m.def(
+		"shared_scorer_resources", []() { return zctc::ScorerResources::instance().size(); },
+		"Counts the KenLM models and lexicon FSTs loaded, each shared by every decoder loading the same file");
+
+	py::enum_<zctc::LmLoadMethod>(m, "_LmLoadMethod")
+		.value("LAZY", zctc::LmLoadMethod::LAZY)
+		.value("POPULATE_OR_LAZY", zctc::LmLoadMethod::POPULATE_OR_LAZY)
+		.value("POPULATE_OR_READ", zctc::LmLoadMethod::POPULATE_OR_READ)
+		.value("READ", zctc::LmLoadMethod::READ)
+		.value("PARALLEL_READ", zctc::LmLoadMethod::PARALLEL_READ);
+
+	py::class_<zctc::LmLoadStats>(m, "_LmLoadStats")
+		.def_readonly("load_seconds", &zctc::LmLoadStats::load_seconds)
+		.def_readonly("file_bytes", &zctc::LmLoadStats::file_bytes)
+		.def_readonly("resident_bytes", &zctc::LmLoadStats::resident_bytes)
+		.def_readonly("binary", &zctc::LmLoadStats::binary)
+		.def_readonly("shared", &zctc::LmLoadStats::shared);
+
 	py::class_<zctc::ExternalScorer>(m, "_ExternalScorer")
 		.def(py::init<char, int, float, float, float, char*, char*>(), py::arg("tok_sep"), py::arg("apostrophe_id"),
 			 py::arg("alpha"), py::arg("beta"), py::arg("lex_penalty"), py::arg("lm_path") = nullptr,
@@ -10,7 +33,22 @@ PYBIND11_MODULE(_zctc, m)
 		.def_readonly("apostrophe_id", &zctc::ExternalScorer::apostrophe_id)
 		.def_readonly("alpha", &zctc::ExternalScorer::alpha)
 		.def_readonly("beta", &zctc::ExternalScorer::beta)
-		.def_readonly("lex_penalty", &zctc::ExternalScorer::lex_penalty);
+		.def_readonly("lex_penalty", &zctc::ExternalScorer::lex_penalty)
+		.def_readonly("lm_load_stats", &zctc::ExternalScorer::lm_load_stats);
+
+	py::class_<zctc::ScorerParams>(m, "_ScorerParams")
+		.def(py::init<float, float, float>(), py::arg("alpha"), py::arg("beta"), py::arg("lex_penalty"))
+		.def_readwrite("alpha", &zctc::ScorerParams::alpha)
+		.def_readwrite("beta", &zctc::ScorerParams::beta)
+		.def_readwrite("lex_penalty", &zctc::ScorerParams::lex_penalty);
+
+	py::class_<zctc::DecodeOptions>(m, "_DecodeOptions")
+		.def_readwrite("beam_width", &zctc::DecodeOptions::beam_width)
+		.def_readwrite("cutoff_top_n", &zctc::DecodeOptions::cutoff_top_n)
+		.def_readwrite("nucleus_prob_per_timestep", &zctc::DecodeOptions::nucleus_prob_per_timestep)
+		.def_readwrite("min_tok_prob", &zctc::DecodeOptions::min_tok_prob)
+		.def_readwrite("max_beam_score_deviation", &zctc::DecodeOptions::max_beam_score_deviation)
+		.def_readwrite("scorer", &zctc::DecodeOptions::scorer);
 
 	py::class_<fst::StdVectorFst>(m, "_Fst")
 		.def(pybind11::init<>())
@@ -18,13 +56,67 @@ PYBIND11_MODULE(_zctc, m)
 		.def("Start", &fst::StdVectorFst::Start, "Gets the start state of the FST")
 		.def("Final", &fst::StdVectorFst::Final, "Gets the final state of the FST");
 
+	py::class_<zctc::HardwareCounters>(m, "_HardwareCounters")
+		.def_readonly("cycles", &zctc::HardwareCounters::cycles)
+		.def_readonly("instructions", &zctc::HardwareCounters::instructions)
+		.def_readonly("llc_misses", &zctc::HardwareCounters::llc_misses)
+		.def_readonly("branch_misses", &zctc::HardwareCounters::branch_misses);
+
+	py::class_<zctc::DecodeStats>(m, "_DecodeStats")
+		.def_readonly("frames", &zctc::DecodeStats::frames)
+		.def_readonly("candidates", &zctc::DecodeStats::candidates)
+		.def_readonly("nodes_created", &zctc::DecodeStats::nodes_created)
+		.def_readonly("nodes_cloned", &zctc::DecodeStats::nodes_cloned)
+		.def_readonly("nodes_deprecated", &zctc::DecodeStats::nodes_deprecated)
+		.def_readonly("pruned_by_deviation", &zctc::DecodeStats::pruned_by_deviation)
+		.def_readonly("pruned_by_beam_width", &zctc::DecodeStats::pruned_by_beam_width)
+		.def_readonly("lm_queries", &zctc::DecodeStats::lm_queries)
+		.def_readonly("lm_cache_hits", &zctc::DecodeStats::lm_cache_hits)
+		.def_readonly("lexicon_lookups", &zctc::DecodeStats::lexicon_lookups)
+		.def_readonly("hotword_lookups", &zctc::DecodeStats::hotword_lookups)
+		.def_readonly("total_nodes", &zctc::DecodeStats::total_nodes)
+		.def_readonly("narrowed_frames", &zctc::DecodeStats::narrowed_frames)
+		.def_readonly("beam_width_saved", &zctc::DecodeStats::beam_width_saved)
+		.def_readonly("cutoff_top_n_saved", &zctc::DecodeStats::cutoff_top_n_saved)
+		.def_readonly("expand_ns", &zctc::DecodeStats::expand_ns)
+		.def_readonly("ext_scoring_ns", &zctc::DecodeStats::ext_scoring_ns)
+		.def_readonly("score_ns", &zctc::DecodeStats::score_ns)
+		.def_readonly("prune_ns", &zctc::DecodeStats::prune_ns)
+		.def_readonly("backtrace_ns", &zctc::DecodeStats::backtrace_ns)
+		.def_readonly("hw_counters", &zctc::DecodeStats::hw_counters)
+		.def_readonly("expand_hw", &zctc::DecodeStats::expand_hw)
+		.def_readonly("ext_scoring_hw", &zctc::DecodeStats::ext_scoring_hw)
+		.def_readonly("score_hw", &zctc::DecodeStats::score_hw)
+		.def_readonly("prune_hw", &zctc::DecodeStats::prune_hw);
+
+	py::enum_<zctc::AdaptiveMeasure>(m, "_AdaptiveMeasure")
+		.value("NONE", zctc::AdaptiveMeasure::NONE)
+		.value("ENTROPY", zctc::AdaptiveMeasure::ENTROPY)
+		.value("MARGIN", zctc::AdaptiveMeasure::MARGIN);
+
+	py::class_<zctc::AdaptiveBeam>(m, "_AdaptiveBeam")
+		.def_readonly("measure", &zctc::AdaptiveBeam::measure)
+		.def_readonly("min_beam_width", &zctc::AdaptiveBeam::min_beam_width)
+		.def_readonly("max_beam_width", &zctc::AdaptiveBeam::max_beam_width)
+		.def_readonly("min_cutoff_top_n", &zctc::AdaptiveBeam::min_cutoff_top_n)
+		.def_readonly("max_cutoff_top_n", &zctc::AdaptiveBeam::max_cutoff_top_n)
+		.def_readonly("threshold", &zctc::AdaptiveBeam::threshold);
+
 	py::class_<zctc::Decoder>(m, "_Decoder")
 		.def(py::init<int, int, int, int, float, float, float, py::ssize_t, float, float, float, char,
-					  std::vector<std::string>, char*, char*>(),
+					  std::vector<std::string>, char*, char*, char*, bool, zctc::AdaptiveMeasure, py::ssize_t, int,
+					  float, zctc::LmLoadMethod, bool, bool, int, float, const std::string&>(),
 			 py::arg("thread_count"), py::arg("blank_id"), py::arg("cutoff_top_n"), py::arg("apostrophe_id"),
 			 py::arg("nucleus_prob_per_timestep"), py::arg("alpha"), py::arg("beta"), py::arg("beam_width"),
 			 py::arg("lex_penalty"), py::arg("min_tok_prob"), py::arg("max_beam_score_deviation"), py::arg("tok_sep"),
-			 py::arg("vocab"), py::arg("lm_path") = nullptr, py::arg("lexicon_path") = nullptr)
+			 py::arg("vocab"), py::arg("lm_path") = nullptr, py::arg("lexicon_path") = nullptr,
+			 py::arg("trace_path") = nullptr, py::arg("fast_math") = false,
+			 py::arg("adaptive_measure") = zctc::AdaptiveMeasure::NONE, py::arg("min_beam_width") = 0,
+			 py::arg("min_cutoff_top_n") = 0, py::arg("adaptive_threshold") = 0.0f,
+			 py::arg("lm_load_method") = zctc::LmLoadMethod::POPULATE_OR_READ, py::arg("lm_require_binary") = false,
+			 py::arg("lm_warm_up") = false, py::arg("submit_max_batch_size") = 32, py::arg("submit_max_wait_ms") = 1.0f,
+			 py::arg("worker_cpus") = "")
+		.def("options", &zctc::Decoder::options, "Gets a copy of the decoder's options, to override per call")
 		.def("generate_hw_fst", &zctc::Decoder::generate_hw_fst, py::arg("hotwords_id"), py::arg("hotwords_weight"),
 			 py::arg("hotwords_fst") = nullptr, pybind11::return_value_policy::take_ownership,
 			 py::call_guard<py::gil_scoped_release>())
@@ -32,7 +124,29 @@ PYBIND11_MODULE(_zctc, m)
 			 py::arg("ids"), py::arg("labels"), py::arg("timesteps"), py::arg("seq_len"), py::arg("seq_pos"),
 			 py::arg("batch_size"), py::arg("max_seq_len"), py::arg("hotwords") = std::vector<std::vector<int>>(),
 			 py::arg("hotwords_weight") = std::vector<float>(), py::arg("hotwords_fst") = nullptr,
+			 py::arg("collect_stats") = false, py::arg("hw_counters") = false, py::arg("is_bfloat16") = false,
 			 py::call_guard<py::gil_scoped_release>())
+		// NOTE: The GIL is released within, only while decoding, since the tensor views need it.
+		.def("batch_decode_tensor", &zctc::Decoder::batch_decode_tensor, py::arg("logits"), py::arg("seq_len"),
+			 py::arg("time_major") = false, py::arg("hotwords") = std::vector<std::vector<int>>(),
+			 py::arg("hotwords_weight") = std::vector<float>(), py::arg("hotwords_fst") = nullptr,
+			 py::arg("collect_stats") = false, py::arg("hw_counters") = false, py::arg("options") = nullptr)
+		.def("batch_decode_tensor_async", &zctc::Decoder::batch_decode_tensor_async, py::arg("logits"),
+			 py::arg("seq_len"), py::arg("time_major"), py::arg("hotwords"), py::arg("hotwords_weight"),
+			 py::arg("hotwords_fst"), py::arg("collect_stats"), py::arg("hw_counters"), py::arg("callback"),
+			 py::arg("options") = nullptr)
+		.def("batch_decode_tensor_multi", &zctc::Decoder::batch_decode_tensor_multi, py::arg("logits"),
+			 py::arg("seq_len"), py::arg("time_major"), py::arg("configs"),
+			 py::arg("hotwords") = std::vector<std::vector<int>>(), py::arg("hotwords_weight") = std::vector<float>(),
+			 py::arg("hotwords_fst") = nullptr, py::arg("collect_stats") = false, py::arg("hw_counters") = false)
+		.def("submit_tensor", &zctc::Decoder::submit_tensor, py::arg("logits"), py::arg("callback"),
+			 py::arg("options") = nullptr)
+		.def("batch_greedy_decode_tensor", &zctc::Decoder::batch_greedy_decode_tensor, py::arg("logits"),
+			 py::arg("seq_len"), py::arg("time_major") = false)
+		.def("batch_decode_quantized_tensor", &zctc::Decoder::batch_decode_quantized_tensor, py::arg("values"),
+			 py::arg("scales"), py::arg("offsets"), py::arg("seq_len"),
+			 py::arg("hotwords") = std::vector<std::vector<int>>(), py::arg("hotwords_weight") = std::vector<float>(),
+			 py::arg("hotwords_fst") = nullptr, py::arg("collect_stats") = false, py::arg("hw_counters") = false)
 
 #ifndef NDEBUG
 		// NOTE: This function is only for debugging purpose.
@@ -51,8 +165,20 @@ PYBIND11_MODULE(_zctc, m)
 		.def_readonly("min_tok_prob", &zctc::Decoder::min_tok_prob)
 		.def_readonly("max_beam_score_deviation", &zctc::Decoder::max_beam_score_deviation)
 		.def_readonly("nucleus_prob_per_timestep", &zctc::Decoder::nucleus_prob_per_timestep)
+		.def_readonly("fast_math", &zctc::Decoder::fast_math)
+		.def_readonly("adaptive", &zctc::Decoder::adaptive)
 		.def_readonly("vocab", &zctc::Decoder::vocab)
-		.def_readonly("ext_scorer", &zctc::Decoder::ext_scorer);
+		.def_readonly("ext_scorer", &zctc::Decoder::ext_scorer)
+		.def_readonly("worker_cpus", &zctc::Decoder::worker_cpus);
+
+	py::class_<zctc::LexiconStats>(m, "_LexiconStats")
+		.def_readonly("lines", &zctc::LexiconStats::lines)
+		.def_readonly("words", &zctc::LexiconStats::words)
+		.def_readonly("malformed_lines", &zctc::LexiconStats::malformed_lines)
+		.def_readonly("skipped_by_freq", &zctc::LexiconStats::skipped_by_freq)
+		.def_readonly("skipped_with_unknown", &zctc::LexiconStats::skipped_with_unknown)
+		.def_readonly("unknown_tokens", &zctc::LexiconStats::unknown_tokens)
+		.def_readonly("unknown_samples", &zctc::LexiconStats::unknown_samples);
 
 	py::class_<zctc::ZFST>(m, "_ZFST")
 		.def(py::init<char*, char*>(), py::arg("vocab_path"), py::arg("fst_path") = nullptr)
@@ -60,9 +186,12 @@ PYBIND11_MODULE(_zctc, m)
 		.def("parse_lexicon_files", &zctc::ZFST::parse_lexicon_files, py::arg("file_paths"), py::arg("freq_threshold"),
 			 py::arg("worker_count"), py::call_guard<py::gil_scoped_release>())
 		.def("parse_lexicon_file", &zctc::ZFST::parse_lexicon_file, py::arg("file_path"), py::arg("freq_threshold"),
-			 py::call_guard<py::gil_scoped_release>())
+			 py::arg("worker_count") = 1, py::call_guard<py::gil_scoped_release>())
+		.def("build_minimal", &zctc::ZFST::build_minimal, py::arg("file_paths"), py::arg("freq_threshold"),
+			 py::arg("worker_count") = 1, py::call_guard<py::gil_scoped_release>())
 		.def("optimize", &zctc::ZFST::optimize)
 		.def("write", &zctc::ZFST::write, py::arg("output_path"))
-		.def_readonly("char_map", &zctc::ZFST::char_map);
-	.def_readonly("fst", &zctc::ZFST::fst);
+		.def_readonly("char_map", &zctc::ZFST::char_map)
+		.def_readonly("lexicon_stats", &zctc::ZFST::lexicon_stats)
+		.def_readonly("fst", &zctc::ZFST::fst);
 }